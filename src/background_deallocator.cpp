@@ -0,0 +1,184 @@
+#include "background_deallocator.hpp"
+
+namespace duckdb {
+
+BackgroundDeallocator::BackgroundDeallocator(Device &device, bool background)
+    : device(device), pending_lbas(0), in_flight_lbas(0), released_lbas(0), enabled(true), last_io(0), shutdown(false) {
+	NotifyIO();
+	if (background) {
+		thread = std::thread([this]() { Run(); });
+	}
+}
+
+BackgroundDeallocator::~BackgroundDeallocator() {
+	{
+		lock_guard<mutex> guard(wait_lock);
+		shutdown = true;
+	}
+	wait_condition.notify_all();
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	try {
+		Flush();
+	} catch (std::exception &) {
+		// Deallocation is an optimization, the ranges are simply left allocated
+	}
+}
+
+void BackgroundDeallocator::Add(idx_t start_lba, idx_t nr_lbas) {
+	if (nr_lbas == 0 || !enabled.load()) {
+		return;
+	}
+
+	lock_guard<mutex> guard(lock);
+	idx_t end_lba = start_lba + nr_lbas;
+
+	// Merge with a preceding range that overlaps or is adjacent
+	auto entry = ranges.upper_bound(start_lba);
+	if (entry != ranges.begin()) {
+		auto previous = std::prev(entry);
+		if (previous->first + previous->second >= start_lba) {
+			start_lba = previous->first;
+			end_lba = MaxValue<idx_t>(end_lba, previous->first + previous->second);
+			pending_lbas -= previous->second;
+			entry = ranges.erase(previous);
+		}
+	}
+
+	// Merge with all following ranges that overlap or are adjacent
+	while (entry != ranges.end() && entry->first <= end_lba) {
+		end_lba = MaxValue<idx_t>(end_lba, entry->first + entry->second);
+		pending_lbas -= entry->second;
+		entry = ranges.erase(entry);
+	}
+
+	ranges[start_lba] = end_lba - start_lba;
+	pending_lbas += end_lba - start_lba;
+}
+
+void BackgroundDeallocator::Cancel(idx_t start_lba, idx_t nr_lbas) {
+	// Flush counts ranges as in flight before it removes them from the pending ranges, hence a range is always seen by
+	// one of the loads in this order
+	if (pending_lbas.load() == 0 && in_flight_lbas.load() == 0) {
+		return;
+	}
+
+	unique_lock<mutex> guard(lock);
+	idx_t end_lba = start_lba + nr_lbas;
+
+	// The LBAs can only be written once their deallocation has completed
+	in_flight_condition.wait(guard, [&]() {
+		for (auto entry = in_flight.begin(); entry != in_flight.end() && entry->first < end_lba; entry++) {
+			if (entry->first + entry->second > start_lba) {
+				return false;
+			}
+		}
+		return true;
+	});
+
+	auto entry = ranges.upper_bound(start_lba);
+	if (entry != ranges.begin()) {
+		entry = std::prev(entry);
+	}
+
+	while (entry != ranges.end() && entry->first < end_lba) {
+		idx_t range_start = entry->first;
+		idx_t range_end = entry->first + entry->second;
+		if (range_end <= start_lba) {
+			entry++;
+			continue;
+		}
+
+		// Keep the parts of the range before and after the cancelled LBAs
+		pending_lbas -= entry->second;
+		entry = ranges.erase(entry);
+		if (range_start < start_lba) {
+			ranges[range_start] = start_lba - range_start;
+			pending_lbas += start_lba - range_start;
+		}
+		if (range_end > end_lba) {
+			ranges[end_lba] = range_end - end_lba;
+			pending_lbas += range_end - end_lba;
+		}
+	}
+}
+
+idx_t BackgroundDeallocator::Flush() {
+	unique_lock<mutex> guard(lock);
+	if (ranges.empty()) {
+		return 0;
+	}
+
+	vector<DeviceLBARange> range_list;
+	vector<multimap<idx_t, idx_t>::iterator> in_flight_entries;
+	idx_t nr_lbas = 0;
+	for (const auto &range : ranges) {
+		range_list.push_back(DeviceLBARange {range.first, range.second});
+		in_flight_entries.push_back(in_flight.emplace(range.first, range.second));
+		nr_lbas += range.second;
+	}
+
+	// The ranges are counted as in flight before they stop being pending, see Cancel
+	in_flight_lbas += nr_lbas;
+	pending_lbas -= nr_lbas;
+	ranges.clear();
+	guard.unlock();
+
+	// The ranges are dropped even if deallocation fails, leaving them allocated is harmless
+	auto complete = [&]() {
+		guard.lock();
+		for (auto &entry : in_flight_entries) {
+			in_flight.erase(entry);
+		}
+		in_flight_lbas -= nr_lbas;
+		guard.unlock();
+		in_flight_condition.notify_all();
+	};
+	bool deallocated;
+	try {
+		deallocated = device.Deallocate(range_list.data(), range_list.size());
+	} catch (std::exception &) {
+		complete();
+		throw;
+	}
+	complete();
+
+	if (!deallocated) {
+		// The device can not deallocate, stop gathering ranges
+		enabled = false;
+		return 0;
+	}
+
+	released_lbas += nr_lbas;
+	return nr_lbas;
+}
+
+void BackgroundDeallocator::Run() {
+	auto idle_time = std::chrono::milliseconds(DEALLOCATOR_IDLE_TIME_MS);
+
+	unique_lock<mutex> guard(wait_lock);
+	while (!shutdown) {
+		wait_condition.wait_for(guard, std::chrono::milliseconds(DEALLOCATOR_POLL_INTERVAL_MS));
+		if (shutdown || pending_lbas.load() == 0) {
+			continue;
+		}
+
+		auto since_io = std::chrono::steady_clock::now().time_since_epoch() -
+		                std::chrono::steady_clock::duration(last_io.load(std::memory_order_relaxed));
+		if (since_io < idle_time && pending_lbas.load() < DEALLOCATOR_MAX_PENDING_LBAS) {
+			continue;
+		}
+
+		guard.unlock();
+		try {
+			Flush();
+		} catch (std::exception &) {
+			// Deallocation is an optimization, the failed ranges are simply left allocated
+		}
+		guard.lock();
+	}
+}
+
+} // namespace duckdb
@@ -0,0 +1,133 @@
+#include "block_checksum_table.hpp"
+
+#include "crc32c.hpp"
+
+namespace duckdb {
+
+static constexpr idx_t BLOCK_CHECKSUM_PAGE_SIZE = idx_t(1) << BLOCK_CHECKSUM_PAGE_SHIFT;
+
+static uint64_t PackEntry(uint32_t crc, idx_t nr_bytes) {
+	return (static_cast<uint64_t>(nr_bytes) << 32) | crc;
+}
+
+BlockChecksumTable::BlockChecksumTable(idx_t start_lba, idx_t end_lba, idx_t lba_size)
+    : start_lba(start_lba), end_lba(end_lba), lba_size(lba_size),
+      nr_pages(((end_lba - start_lba) + BLOCK_CHECKSUM_PAGE_SIZE - 1) >> BLOCK_CHECKSUM_PAGE_SHIFT) {
+	pages = unique_ptr<atomic<atomic<uint64_t> *>[]>(new atomic<atomic<uint64_t> *>[nr_pages]);
+	for (idx_t i = 0; i < nr_pages; i++) {
+		pages[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+void BlockChecksumTable::RecordWrite(idx_t start_lba, idx_t offset, const_data_ptr_t data, idx_t nr_bytes) {
+	for (idx_t lba = start_lba; nr_bytes > 0; lba++) {
+		idx_t count = MinValue<idx_t>(nr_bytes, lba_size - offset);
+		if (lba >= this->start_lba && lba < end_lba) {
+			atomic<uint64_t> &entry = GetOrCreateEntry(lba);
+			uint64_t current = entry.load(std::memory_order_relaxed);
+			idx_t covered = current >> 32;
+
+			uint64_t updated = 0;
+			if (offset == 0) {
+				updated = PackEntry(Crc32c(0, data, count), count);
+			} else if (covered == offset) {
+				// An append to the covered bytes extends their checksum
+				updated = PackEntry(Crc32c(static_cast<uint32_t>(current), data, count), offset + count);
+			}
+			entry.store(updated, std::memory_order_relaxed);
+		}
+		data += count;
+		nr_bytes -= count;
+		offset = 0;
+	}
+}
+
+optional_idx BlockChecksumTable::Verify(idx_t start_lba, idx_t offset, const_data_ptr_t data, idx_t nr_bytes) const {
+	for (idx_t lba = start_lba; nr_bytes > 0; lba++) {
+		idx_t count = MinValue<idx_t>(nr_bytes, lba_size - offset);
+		atomic<uint64_t> *entry = lba >= this->start_lba && lba < end_lba ? GetEntry(lba) : nullptr;
+		if (entry && offset == 0) {
+			uint64_t current = entry->load(std::memory_order_relaxed);
+			idx_t covered = current >> 32;
+			if (covered > 0 && covered <= count && Crc32c(0, data, covered) != static_cast<uint32_t>(current)) {
+				return lba;
+			}
+		}
+		data += count;
+		nr_bytes -= count;
+		offset = 0;
+	}
+	return optional_idx();
+}
+
+void BlockChecksumTable::Invalidate(idx_t start_lba, idx_t nr_lbas) {
+	idx_t first = MaxValue<idx_t>(start_lba, this->start_lba);
+	idx_t last = MinValue<idx_t>(start_lba + nr_lbas, end_lba);
+	for (idx_t lba = first; lba < last; lba++) {
+		atomic<uint64_t> *entry = GetEntry(lba);
+		if (entry) {
+			entry->store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+idx_t BlockChecksumTable::GetChecksummedLBAs() const {
+	idx_t nr_lbas = 0;
+	for (idx_t page = 0; page < nr_pages; page++) {
+		atomic<uint64_t> *entries = pages[page].load(std::memory_order_acquire);
+		for (idx_t i = 0; entries && i < BLOCK_CHECKSUM_PAGE_SIZE; i++) {
+			nr_lbas += entries[i].load(std::memory_order_relaxed) != 0;
+		}
+	}
+	return nr_lbas;
+}
+
+void BlockChecksumTable::Serialize(idx_t start_lba, idx_t nr_lbas, data_ptr_t buffer) const {
+	for (idx_t lba = start_lba; lba < start_lba + nr_lbas; lba++) {
+		atomic<uint64_t> *entry = lba >= this->start_lba && lba < end_lba ? GetEntry(lba) : nullptr;
+		uint64_t value = entry ? entry->load(std::memory_order_relaxed) : 0;
+		memcpy(buffer + (lba - start_lba) * BLOCK_CHECKSUM_ENTRY_SIZE, &value, BLOCK_CHECKSUM_ENTRY_SIZE);
+	}
+}
+
+void BlockChecksumTable::Deserialize(idx_t start_lba, idx_t nr_lbas, const_data_ptr_t buffer) {
+	idx_t first = MaxValue<idx_t>(start_lba, this->start_lba);
+	idx_t last = MinValue<idx_t>(start_lba + nr_lbas, end_lba);
+	for (idx_t lba = first; lba < last; lba++) {
+		uint64_t value;
+		memcpy(&value, buffer + (lba - start_lba) * BLOCK_CHECKSUM_ENTRY_SIZE, BLOCK_CHECKSUM_ENTRY_SIZE);
+		// Pages are only allocated for LBAs that have a checksum
+		atomic<uint64_t> *entry = value != 0 ? &GetOrCreateEntry(lba) : GetEntry(lba);
+		if (entry) {
+			entry->store(value, std::memory_order_relaxed);
+		}
+	}
+}
+
+atomic<uint64_t> *BlockChecksumTable::GetEntry(idx_t lba) const {
+	idx_t index = lba - start_lba;
+	atomic<uint64_t> *entries = pages[index >> BLOCK_CHECKSUM_PAGE_SHIFT].load(std::memory_order_acquire);
+	return entries ? &entries[index & (BLOCK_CHECKSUM_PAGE_SIZE - 1)] : nullptr;
+}
+
+atomic<uint64_t> &BlockChecksumTable::GetOrCreateEntry(idx_t lba) {
+	idx_t index = lba - start_lba;
+	atomic<atomic<uint64_t> *> &page = pages[index >> BLOCK_CHECKSUM_PAGE_SHIFT];
+	atomic<uint64_t> *entries = page.load(std::memory_order_acquire);
+	if (!entries) {
+		lock_guard<mutex> guard(allocation_lock);
+		entries = page.load(std::memory_order_relaxed);
+		if (!entries) {
+			auto allocated = unique_ptr<atomic<uint64_t>[]>(new atomic<uint64_t>[BLOCK_CHECKSUM_PAGE_SIZE]);
+			for (idx_t i = 0; i < BLOCK_CHECKSUM_PAGE_SIZE; i++) {
+				allocated[i].store(0, std::memory_order_relaxed);
+			}
+			entries = allocated.get();
+			allocated_pages.push_back(std::move(allocated));
+			page.store(entries, std::memory_order_release);
+		}
+	}
+	return entries[index & (BLOCK_CHECKSUM_PAGE_SIZE - 1)];
+}
+
+} // namespace duckdb
@@ -0,0 +1,190 @@
+#include "crc32c.hpp"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace duckdb {
+
+//! The reflected Castagnoli polynomial
+static constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+//! The hardware path runs three streams over blocks of these sizes, whose checksums are then combined
+static constexpr idx_t CRC32C_LONG_BLOCK = 8192;
+static constexpr idx_t CRC32C_SHORT_BLOCK = 256;
+
+namespace {
+
+/// @brief Multiplies a vector by a 32x32 matrix over GF(2)
+uint32_t MultiplyMatrix(const uint32_t *matrix, uint32_t vector) {
+	uint32_t sum = 0;
+	for (; vector; vector >>= 1, matrix++) {
+		if (vector & 1) {
+			sum ^= *matrix;
+		}
+	}
+	return sum;
+}
+
+void SquareMatrix(uint32_t *square, const uint32_t *matrix) {
+	for (idx_t i = 0; i < 32; i++) {
+		square[i] = MultiplyMatrix(matrix, matrix[i]);
+	}
+}
+
+/// @brief The lookup tables of the checksum, and of the operators that append a block of zeros to a checksum. The
+/// checksums of the three hardware streams are combined by appending the length of the following streams in zeros to
+/// the first, which is linear in the checksum and hence a lookup per byte of it.
+struct Crc32cTables {
+	uint32_t slices[8][256];
+	uint32_t long_zeros[4][256];
+	uint32_t short_zeros[4][256];
+
+	Crc32cTables() {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t crc = n;
+			for (idx_t bit = 0; bit < 8; bit++) {
+				crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+			}
+			slices[0][n] = crc;
+		}
+		for (uint32_t n = 0; n < 256; n++) {
+			for (idx_t slice = 1; slice < 8; slice++) {
+				uint32_t previous = slices[slice - 1][n];
+				slices[slice][n] = (previous >> 8) ^ slices[0][previous & 0xFF];
+			}
+		}
+		InitializeZeros(long_zeros, CRC32C_LONG_BLOCK);
+		InitializeZeros(short_zeros, CRC32C_SHORT_BLOCK);
+	}
+
+	/// @brief Builds the tables of the operator that appends nr_bytes zeros to a checksum
+	static void InitializeZeros(uint32_t zeros[4][256], idx_t nr_bytes) {
+		// The operator of a single zero bit, squared into the operator of two and four zero bits
+		uint32_t odd[32];
+		uint32_t even[32];
+		odd[0] = CRC32C_POLYNOMIAL;
+		for (idx_t i = 1; i < 32; i++) {
+			odd[i] = uint32_t(1) << (i - 1);
+		}
+		SquareMatrix(even, odd);
+		SquareMatrix(odd, even);
+
+		// Every square doubles the number of zero bytes, starting at one, until the bits of nr_bytes are used up.
+		// The block sizes are powers of two, hence no partial products need to be multiplied in.
+		uint32_t *result = odd;
+		for (idx_t length = nr_bytes; length > 0; length >>= 1) {
+			if (result == odd) {
+				SquareMatrix(even, odd);
+				result = even;
+			} else {
+				SquareMatrix(odd, even);
+				result = odd;
+			}
+		}
+		for (uint32_t n = 0; n < 256; n++) {
+			zeros[0][n] = MultiplyMatrix(result, n);
+			zeros[1][n] = MultiplyMatrix(result, n << 8);
+			zeros[2][n] = MultiplyMatrix(result, n << 16);
+			zeros[3][n] = MultiplyMatrix(result, n << 24);
+		}
+	}
+
+	static uint32_t Shift(const uint32_t zeros[4][256], uint32_t crc) {
+		return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF] ^ zeros[2][(crc >> 16) & 0xFF] ^
+		       zeros[3][crc >> 24];
+	}
+};
+
+const Crc32cTables &GetTables() {
+	static const Crc32cTables tables;
+	return tables;
+}
+
+uint64_t LoadWord(const_data_ptr_t data) {
+	uint64_t word;
+	memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+#if defined(__x86_64__)
+/// @brief Runs three CRC32 instructions in parallel over three consecutive blocks, and combines their checksums
+__attribute__((target("sse4.2"))) const_data_ptr_t Crc32cBlocks(const uint32_t zeros[4][256], uint64_t &crc0,
+                                                                const_data_ptr_t data, idx_t block_size) {
+	uint64_t crc1 = 0;
+	uint64_t crc2 = 0;
+	const_data_ptr_t end = data + block_size;
+	for (; data < end; data += 8) {
+		crc0 = _mm_crc32_u64(crc0, LoadWord(data));
+		crc1 = _mm_crc32_u64(crc1, LoadWord(data + block_size));
+		crc2 = _mm_crc32_u64(crc2, LoadWord(data + 2 * block_size));
+	}
+	crc0 = Crc32cTables::Shift(zeros, static_cast<uint32_t>(crc0)) ^ crc1;
+	crc0 = Crc32cTables::Shift(zeros, static_cast<uint32_t>(crc0)) ^ crc2;
+	return data + 2 * block_size;
+}
+
+__attribute__((target("sse4.2"))) uint32_t Crc32cHardware(uint32_t crc, const_data_ptr_t data, idx_t nr_bytes) {
+	const Crc32cTables &tables = GetTables();
+	uint64_t crc0 = ~crc;
+
+	// Single bytes up to an 8 byte boundary
+	for (; nr_bytes > 0 && reinterpret_cast<uintptr_t>(data) % 8 != 0; data++, nr_bytes--) {
+		crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data);
+	}
+	for (; nr_bytes >= 3 * CRC32C_LONG_BLOCK; nr_bytes -= 3 * CRC32C_LONG_BLOCK) {
+		data = Crc32cBlocks(tables.long_zeros, crc0, data, CRC32C_LONG_BLOCK);
+	}
+	for (; nr_bytes >= 3 * CRC32C_SHORT_BLOCK; nr_bytes -= 3 * CRC32C_SHORT_BLOCK) {
+		data = Crc32cBlocks(tables.short_zeros, crc0, data, CRC32C_SHORT_BLOCK);
+	}
+	for (; nr_bytes >= 8; data += 8, nr_bytes -= 8) {
+		crc0 = _mm_crc32_u64(crc0, LoadWord(data));
+	}
+	for (; nr_bytes > 0; data++, nr_bytes--) {
+		crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data);
+	}
+	return ~static_cast<uint32_t>(crc0);
+}
+#endif
+
+bool DetectHardwareSupport() {
+#if defined(__x86_64__)
+	return __builtin_cpu_supports("sse4.2");
+#else
+	return false;
+#endif
+}
+
+} // namespace
+
+uint32_t Crc32cSoftware(uint32_t crc, const_data_ptr_t data, idx_t nr_bytes) {
+	const Crc32cTables &tables = GetTables();
+	crc = ~crc;
+	for (; nr_bytes >= 8; data += 8, nr_bytes -= 8) {
+		uint64_t word = LoadWord(data) ^ crc;
+		crc = tables.slices[7][word & 0xFF] ^ tables.slices[6][(word >> 8) & 0xFF] ^
+		      tables.slices[5][(word >> 16) & 0xFF] ^ tables.slices[4][(word >> 24) & 0xFF] ^
+		      tables.slices[3][(word >> 32) & 0xFF] ^ tables.slices[2][(word >> 40) & 0xFF] ^
+		      tables.slices[1][(word >> 48) & 0xFF] ^ tables.slices[0][word >> 56];
+	}
+	for (; nr_bytes > 0; data++, nr_bytes--) {
+		crc = (crc >> 8) ^ tables.slices[0][(crc ^ *data) & 0xFF];
+	}
+	return ~crc;
+}
+
+bool Crc32cIsHardwareAccelerated() {
+	static const bool hardware = DetectHardwareSupport();
+	return hardware;
+}
+
+uint32_t Crc32c(uint32_t crc, const_data_ptr_t data, idx_t nr_bytes) {
+#if defined(__x86_64__)
+	if (Crc32cIsHardwareAccelerated()) {
+		return Crc32cHardware(crc, data, nr_bytes);
+	}
+#endif
+	return Crc32cSoftware(crc, data, nr_bytes);
+}
+
+} // namespace duckdb
@@ -9,7 +9,74 @@ idx_t Device::Read(void *buffer, const CmdContext &context) {
 	throw NotImplementedException("%s: Read is not implemented", GetName());
 }
 
+idx_t Device::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		nr_lbas += Write(requests[i].buffer, *requests[i].context);
+	}
+	return nr_lbas;
+}
+
+idx_t Device::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		nr_lbas += Read(requests[i].buffer, *requests[i].context);
+	}
+	return nr_lbas;
+}
+
 DeviceGeometry Device::GetDeviceGeometry() {
 	throw NotImplementedException("%s: GetDeviceGeometry is not implemented", GetName());
 }
+
+bool Device::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	return false;
+}
+
+bool Device::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	return false;
+}
+
+data_ptr_t Device::AllocateBuffer(idx_t nr_bytes) {
+	throw NotImplementedException("%s: AllocateBuffer is not implemented", GetName());
+}
+
+void Device::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	throw NotImplementedException("%s: FreeBuffer is not implemented", GetName());
+}
+
+vector<DeviceQueueStatistics> Device::GetQueueStatistics() {
+	return {};
+}
+
+bool Device::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	return false;
+}
+
+uint8_t Device::GetPlacementIdentifier(const string &path, idx_t generation) {
+	return 0;
+}
+
+uint8_t Device::GetHotPlacementIdentifier(const string &path) {
+	return GetPlacementIdentifier(path, 0);
+}
+
+bool Device::GetZoneGeometry(DeviceZoneGeometry &geometry) {
+	return false;
+}
+
+idx_t Device::ZoneAppend(void *buffer, const CmdContext &context) {
+	throw NotImplementedException("%s: ZoneAppend is not implemented", GetName());
+}
+
+void Device::ResetZone(idx_t zone_start_lba) {
+	throw NotImplementedException("%s: ResetZone is not implemented", GetName());
+}
+
+idx_t Device::GetZoneWritePointer(idx_t zone_start_lba) {
+	throw NotImplementedException("%s: GetZoneWritePointer is not implemented", GetName());
+}
+
+void Device::SetThreadCount(idx_t nr_threads) {
+}
 } // namespace duckdb
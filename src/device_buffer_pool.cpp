@@ -0,0 +1,180 @@
+#include "device_buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+namespace duckdb {
+
+atomic<idx_t> DeviceBufferPool::pool_id_counter {1};
+thread_local idx_t DeviceBufferPool::cached_pool_id = 0;
+thread_local DeviceBufferPool::ThreadCache *DeviceBufferPool::cached_thread_cache = nullptr;
+
+DeviceBufferPool::DeviceBufferPool(buffer_alloc_function_t alloc_function, buffer_free_function_t free_function,
+                                   idx_t arena_size)
+    : alloc_function(std::move(alloc_function)), free_function(std::move(free_function)),
+      pool_id(pool_id_counter++), arena(nullptr), arena_size(0), arena_offset(0) {
+	if (arena_size > 0) {
+		InitializeArena(arena_size);
+	}
+}
+
+DeviceBufferPool::~DeviceBufferPool() {
+	// Release all cached buffers. Buffers from the arena are released together with the arena.
+	auto release = [&](vector<data_ptr_t> &free_list) {
+		for (data_ptr_t buffer : free_list) {
+			if (!IsArenaBuffer(buffer)) {
+				free_function(buffer);
+			}
+		}
+		free_list.clear();
+	};
+
+	for (auto &kv : thread_caches) {
+		for (idx_t i = 0; i < DEVICE_BUFFER_SIZE_CLASS_COUNT; i++) {
+			release(kv.second->free_lists[i]);
+		}
+	}
+	for (idx_t i = 0; i < DEVICE_BUFFER_SIZE_CLASS_COUNT; i++) {
+		release(shared_free_lists[i]);
+	}
+
+	if (arena) {
+		munmap(arena, arena_size);
+	}
+
+	// Ensure that a new pool allocated at the same address does not reuse a stale thread cache
+	if (cached_pool_id == pool_id) {
+		cached_pool_id = 0;
+		cached_thread_cache = nullptr;
+	}
+}
+
+data_ptr_t DeviceBufferPool::Allocate(idx_t nr_bytes) {
+	idx_t size_class = GetSizeClass(nr_bytes);
+	if (size_class == DEVICE_BUFFER_SIZE_CLASS_COUNT) {
+		// Not a pooled size, go directly to the allocator
+		return alloc_function(nr_bytes);
+	}
+
+	ThreadCache &cache = GetThreadCache();
+	vector<data_ptr_t> &free_list = cache.free_lists[size_class];
+	if (!free_list.empty()) {
+		data_ptr_t buffer = free_list.back();
+		free_list.pop_back();
+		return buffer;
+	}
+
+	idx_t class_bytes = DEVICE_BUFFER_SIZE_CLASSES[size_class];
+	{
+		lock_guard<mutex> lock(pool_lock);
+		vector<data_ptr_t> &shared_list = shared_free_lists[size_class];
+		if (!shared_list.empty()) {
+			data_ptr_t buffer = shared_list.back();
+			shared_list.pop_back();
+			return buffer;
+		}
+
+		data_ptr_t buffer = AllocateFromArena(class_bytes);
+		if (buffer) {
+			return buffer;
+		}
+	}
+
+	data_ptr_t buffer = alloc_function(class_bytes);
+	if (!buffer) {
+		throw OutOfMemoryException("Unable to allocate device buffer of %llu bytes", class_bytes);
+	}
+	return buffer;
+}
+
+void DeviceBufferPool::Free(data_ptr_t buffer, idx_t nr_bytes) {
+	if (!buffer) {
+		return;
+	}
+
+	idx_t size_class = GetSizeClass(nr_bytes);
+	if (size_class == DEVICE_BUFFER_SIZE_CLASS_COUNT) {
+		free_function(buffer);
+		return;
+	}
+
+	ThreadCache &cache = GetThreadCache();
+	vector<data_ptr_t> &free_list = cache.free_lists[size_class];
+	if (free_list.size() < DEVICE_BUFFER_THREAD_CACHE_SIZE) {
+		free_list.push_back(buffer);
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(pool_lock);
+		vector<data_ptr_t> &shared_list = shared_free_lists[size_class];
+		// Arena buffers can not be released individually, hence they are always kept
+		if (shared_list.size() < DEVICE_BUFFER_SHARED_CACHE_SIZE || IsArenaBuffer(buffer)) {
+			shared_list.push_back(buffer);
+			return;
+		}
+	}
+
+	free_function(buffer);
+}
+
+bool DeviceBufferPool::IsArenaBuffer(const_data_ptr_t buffer) const {
+	return arena && buffer >= arena && buffer < arena + arena_size;
+}
+
+idx_t DeviceBufferPool::GetSizeClass(idx_t nr_bytes) {
+	for (idx_t i = 0; i < DEVICE_BUFFER_SIZE_CLASS_COUNT; i++) {
+		if (nr_bytes <= DEVICE_BUFFER_SIZE_CLASSES[i]) {
+			return i;
+		}
+	}
+	return DEVICE_BUFFER_SIZE_CLASS_COUNT;
+}
+
+DeviceBufferPool::ThreadCache &DeviceBufferPool::GetThreadCache() {
+	if (cached_pool_id == pool_id) {
+		return *cached_thread_cache;
+	}
+
+	lock_guard<mutex> lock(pool_lock);
+	unique_ptr<ThreadCache> &cache = thread_caches[std::this_thread::get_id()];
+	if (!cache) {
+		cache = make_uniq<ThreadCache>();
+	}
+
+	cached_pool_id = pool_id;
+	cached_thread_cache = cache.get();
+
+	return *cache;
+}
+
+data_ptr_t DeviceBufferPool::AllocateFromArena(idx_t nr_bytes) {
+	if (!arena || arena_offset + nr_bytes > arena_size) {
+		return nullptr;
+	}
+
+	data_ptr_t buffer = arena + arena_offset;
+	arena_offset += nr_bytes;
+	return buffer;
+}
+
+void DeviceBufferPool::InitializeArena(idx_t size) {
+	// Round up to a multiple of 2 MiB such that the arena can be backed by hugepages
+	constexpr idx_t HUGEPAGE_SIZE = 1ULL << 21;
+	size = (size + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1);
+
+	void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (memory == MAP_FAILED) {
+		// No hugepages reserved on the system, fall back to transparent hugepages
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			return;
+		}
+		madvise(memory, size, MADV_HUGEPAGE);
+	}
+
+	arena = static_cast<data_ptr_t>(memory);
+	arena_size = size;
+	arena_offset = 0;
+}
+
+} // namespace duckdb
@@ -0,0 +1,325 @@
+#include "emulated_device.hpp"
+
+#include "duckdb/main/config.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace duckdb {
+
+//! Waits shorter than this are spun, as sleeping overshoots by tens of microseconds
+static constexpr std::chrono::microseconds EMULATED_SPIN_THRESHOLD(100);
+
+//! Parses a non-negative integer. std::stoull alone accepts signs, and wraps negative numbers around.
+static idx_t ParseUnsigned(const string &value) {
+	if (value.empty() || value.find_first_not_of("0123456789") != string::npos) {
+		throw std::invalid_argument(value);
+	}
+	return std::stoull(value);
+}
+
+EmulatedDeviceProfile EmulatedDeviceProfile::Load(const string &path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw IOException("Unable to open device profile \"%s\"", path);
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return Parse(contents.str());
+}
+
+EmulatedDeviceProfile EmulatedDeviceProfile::Parse(const string &contents) {
+	EmulatedDeviceProfile profile;
+	const unordered_map<string, idx_t *> integers = {
+	    {"read_latency_us", &profile.read_latency_us}, {"read_jitter_us", &profile.read_jitter_us},
+	    {"write_latency_us", &profile.write_latency_us}, {"write_jitter_us", &profile.write_jitter_us},
+	    {"tail_latency_us", &profile.tail_latency_us}, {"channels", &profile.channels}};
+	const unordered_map<string, idx_t *> sizes = {{"read_bandwidth", &profile.read_bandwidth},
+	                                              {"write_bandwidth", &profile.write_bandwidth},
+	                                              {"stripe_size", &profile.stripe_size}};
+
+	for (string line : StringUtil::Split(contents, "\n")) {
+		StringUtil::Trim(line);
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		auto separator = line.find('=');
+		if (separator == string::npos) {
+			throw InvalidInputException("Device profile: expected \"key = value\", got \"%s\"", line);
+		}
+		string key = line.substr(0, separator);
+		string value = line.substr(separator + 1);
+		StringUtil::Trim(key);
+		StringUtil::Trim(value);
+		key = StringUtil::Lower(key);
+
+		try {
+			if (integers.find(key) != integers.end()) {
+				*integers.at(key) = ParseUnsigned(value);
+			} else if (sizes.find(key) != sizes.end()) {
+				bool plain = value.find_first_not_of("0123456789") == string::npos;
+				// Negative sizes and "none" parse as no limit, which is not a size
+				idx_t size = plain ? ParseUnsigned(value) : DBConfig::ParseMemoryLimit(value);
+				if (size == DConstants::INVALID_INDEX) {
+					throw std::invalid_argument(value);
+				}
+				*sizes.at(key) = size;
+			} else if (key == "tail_probability") {
+				profile.tail_probability = std::stod(value);
+			} else if (key == "seed") {
+				profile.seed = ParseUnsigned(value);
+			} else {
+				throw InvalidInputException("Device profile: unknown key \"%s\"", key);
+			}
+		} catch (std::logic_error &) {
+			throw InvalidInputException("Device profile: invalid value \"%s\" for \"%s\"", value, key);
+		}
+	}
+
+	if (profile.channels == 0 || profile.stripe_size == 0) {
+		throw InvalidInputException("Device profile: channels and stripe_size must be at least 1");
+	}
+	// Written such that NaN is rejected as well
+	if (!(profile.tail_probability >= 0 && profile.tail_probability <= 1)) {
+		throw InvalidInputException("Device profile: tail_probability must be between 0 and 1");
+	}
+	return profile;
+}
+
+EmulatedDevice::EmulatedDevice(unique_ptr<Device> device, EmulatedDeviceProfile profile)
+    : device(std::move(device)), profile(profile), lba_size(this->device->GetDeviceGeometry().lba_size),
+      channels(profile.channels), random(profile.seed), peak_parallelism(0), shutdown(false) {
+	emulated_time_t now = std::chrono::steady_clock::now();
+	for (Channel &channel : channels) {
+		channel.available = now;
+	}
+	read_bandwidth_available = now;
+	write_bandwidth_available = now;
+}
+
+EmulatedDevice::~EmulatedDevice() {
+	{
+		lock_guard<mutex> guard(completion_lock);
+		shutdown = true;
+	}
+	completion_condition.notify_all();
+	if (completion_thread.joinable()) {
+		completion_thread.join();
+	}
+
+	// The commands have been executed already, only their delay is cut short
+	while (!pending.empty()) {
+		pending.top().completion->Complete(0);
+		pending.pop();
+	}
+}
+
+idx_t EmulatedDevice::Write(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return WriteBatch(&request, 1);
+}
+
+idx_t EmulatedDevice::Read(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return ReadBatch(&request, 1);
+}
+
+idx_t EmulatedDevice::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	emulated_time_t completion = Schedule(requests, count, true);
+	idx_t nr_lbas = device->WriteBatch(requests, count);
+	WaitUntil(completion);
+	return nr_lbas;
+}
+
+idx_t EmulatedDevice::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	emulated_time_t completion = Schedule(requests, count, false);
+	idx_t nr_lbas = device->ReadBatch(requests, count);
+	WaitUntil(completion);
+	return nr_lbas;
+}
+
+idx_t EmulatedDevice::SubmitBatchAsync(const DeviceIORequest *requests, idx_t count, bool write,
+                                       NvmeCompletion &completion) {
+	vector<emulated_time_t> completions(count);
+	Schedule(requests, count, write, completions.data());
+	idx_t nr_lbas = write ? device->WriteBatch(requests, count) : device->ReadBatch(requests, count);
+
+	lock_guard<mutex> guard(completion_lock);
+	if (!completion_thread.joinable()) {
+		completion_thread = std::thread([this]() { RunCompletions(); });
+	}
+	for (emulated_time_t time : completions) {
+		pending.push(PendingCompletion {time, &completion});
+	}
+	completion_condition.notify_one();
+	return nr_lbas;
+}
+
+idx_t EmulatedDevice::GetInFlightCount() {
+	lock_guard<mutex> guard(completion_lock);
+	return pending.size();
+}
+
+idx_t EmulatedDevice::GetPeakParallelism() {
+	lock_guard<mutex> guard(lock);
+	return peak_parallelism;
+}
+
+void EmulatedDevice::RunCompletions() {
+	std::unique_lock<mutex> guard(completion_lock);
+	while (!shutdown) {
+		if (pending.empty()) {
+			completion_condition.wait(guard);
+			continue;
+		}
+		emulated_time_t time = pending.top().time;
+		if (std::chrono::steady_clock::now() < time) {
+			completion_condition.wait_until(guard, time);
+			continue;
+		}
+		NvmeCompletion *completion = pending.top().completion;
+		pending.pop();
+		completion->Complete(0);
+	}
+}
+
+emulated_time_t EmulatedDevice::Schedule(const DeviceIORequest *requests, idx_t count, bool write,
+                                         emulated_time_t *completions) {
+	using std::chrono::microseconds;
+	using std::chrono::nanoseconds;
+
+	idx_t base_us = write ? profile.write_latency_us : profile.read_latency_us;
+	idx_t jitter_us = write ? profile.write_jitter_us : profile.read_jitter_us;
+	idx_t bandwidth = write ? profile.write_bandwidth : profile.read_bandwidth;
+	std::exponential_distribution<double> jitter(jitter_us > 0 ? 1.0 / jitter_us : 1.0);
+	std::uniform_real_distribution<double> tail(0, 1);
+
+	emulated_time_t now = std::chrono::steady_clock::now();
+	emulated_time_t last = now;
+
+	lock_guard<mutex> guard(lock);
+	emulated_time_t &bandwidth_available = write ? write_bandwidth_available : read_bandwidth_available;
+	for (idx_t i = 0; i < count; i++) {
+		const CmdContext &ctx = *requests[i].context;
+		Channel &channel = channels[(ctx.start_lba * lba_size / profile.stripe_size) % channels.size()];
+
+		nanoseconds latency = microseconds(base_us);
+		if (jitter_us > 0) {
+			latency += nanoseconds(static_cast<int64_t>(jitter(random) * 1000));
+		}
+		if (profile.tail_probability > 0 && tail(random) < profile.tail_probability) {
+			latency += microseconds(profile.tail_latency_us);
+		}
+		emulated_time_t start = MaxValue(now, channel.available);
+		emulated_time_t completion = start + latency;
+
+		// A channel that is available later than now serves its commands back to back until then, hence it is busy
+		// when this command starts
+		idx_t parallelism = 1;
+		for (const Channel &other : channels) {
+			parallelism += &other != &channel && other.available > start;
+		}
+		peak_parallelism = MaxValue(peak_parallelism, parallelism);
+
+		if (bandwidth > 0) {
+			nanoseconds transfer(static_cast<int64_t>(static_cast<double>(ctx.nr_lbas * lba_size) * 1e9 / bandwidth));
+			bandwidth_available = MaxValue(now, bandwidth_available) + transfer;
+			completion = MaxValue(completion, bandwidth_available);
+		}
+
+		channel.available = completion;
+		channel.completions++;
+		channel.total_latency += completion - now;
+		last = MaxValue(last, completion);
+		if (completions) {
+			completions[i] = completion;
+		}
+	}
+	return last;
+}
+
+void EmulatedDevice::WaitUntil(emulated_time_t time) {
+	emulated_time_t now = std::chrono::steady_clock::now();
+	if (time - now > EMULATED_SPIN_THRESHOLD) {
+		std::this_thread::sleep_until(time - EMULATED_SPIN_THRESHOLD);
+	}
+	while (std::chrono::steady_clock::now() < time) {
+		std::this_thread::yield();
+	}
+}
+
+DeviceGeometry EmulatedDevice::GetDeviceGeometry() {
+	return device->GetDeviceGeometry();
+}
+
+bool EmulatedDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	return device->Deallocate(ranges, count);
+}
+
+bool EmulatedDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	// A copy within the emulated device is a copy within the wrapped device
+	Device &target = &destination == this ? *device : destination;
+	return device->Copy(ranges, count, target, destination_lba);
+}
+
+data_ptr_t EmulatedDevice::AllocateBuffer(idx_t nr_bytes) {
+	return device->AllocateBuffer(nr_bytes);
+}
+
+void EmulatedDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	device->FreeBuffer(buffer, nr_bytes);
+}
+
+vector<DeviceQueueStatistics> EmulatedDevice::GetQueueStatistics() {
+	vector<DeviceQueueStatistics> statistics;
+	lock_guard<mutex> guard(lock);
+	for (idx_t i = 0; i < channels.size(); i++) {
+		const Channel &channel = channels[i];
+		double average_latency_us = 0;
+		if (channel.completions > 0) {
+			average_latency_us = static_cast<double>(channel.total_latency.count()) / 1000 / channel.completions;
+		}
+		string name = "channel " + std::to_string(i);
+		statistics.push_back(DeviceQueueStatistics {i, name, 1, 1, 0, average_latency_us, channel.completions});
+	}
+	return statistics;
+}
+
+bool EmulatedDevice::GetZoneGeometry(DeviceZoneGeometry &geometry) {
+	return device->GetZoneGeometry(geometry);
+}
+
+idx_t EmulatedDevice::ZoneAppend(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	emulated_time_t completion = Schedule(&request, 1, true);
+	idx_t lba = device->ZoneAppend(buffer, context);
+	WaitUntil(completion);
+	return lba;
+}
+
+void EmulatedDevice::ResetZone(idx_t zone_start_lba) {
+	device->ResetZone(zone_start_lba);
+}
+
+idx_t EmulatedDevice::GetZoneWritePointer(idx_t zone_start_lba) {
+	return device->GetZoneWritePointer(zone_start_lba);
+}
+
+bool EmulatedDevice::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	return device->GetFDPStatistics(statistics);
+}
+
+uint8_t EmulatedDevice::GetPlacementIdentifier(const string &path, idx_t generation) {
+	return device->GetPlacementIdentifier(path, generation);
+}
+
+uint8_t EmulatedDevice::GetHotPlacementIdentifier(const string &path) {
+	return device->GetHotPlacementIdentifier(path);
+}
+
+void EmulatedDevice::SetThreadCount(idx_t nr_threads) {
+	device->SetThreadCount(nr_threads);
+}
+
+} // namespace duckdb
@@ -0,0 +1,502 @@
+#include "file_device.hpp"
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace duckdb {
+
+//! Upper bound of the bytes of a single read or write, whose length is a 32-bit field in io_uring
+static constexpr idx_t FILE_DEVICE_MAX_TRANSFER_BYTES = 1ULL << 30;
+
+atomic<idx_t> FileDevice::device_counter {0};
+thread_local unordered_map<idx_t, FileDevice::ThreadRing> FileDevice::thread_rings;
+
+FileDeviceRing::~FileDeviceRing() {
+	if (initialized) {
+		io_uring_queue_exit(&ring);
+	}
+}
+
+FileDevice::FileDevice(const NvmeConfig &config)
+    : dev_path(config.device_path), fd(-1), block_device(false), queue_depth(config.queue_depth),
+      use_io_uring(true), id(device_counter++), alive(make_shared_ptr<bool>(true)) {
+	if (!IsNonZeroPowerOfTwo(queue_depth)) {
+		throw InvalidInputException("Queue depth must be a power of two, got %llu", queue_depth);
+	}
+	OpenFile(config);
+
+	idx_t alignment = MaxValue<idx_t>(geometry.lba_size, DEVICE_BUFFER_ALIGNMENT);
+	buffer_pool = make_uniq<DeviceBufferPool>(
+	    [alignment](idx_t nr_bytes) {
+		    idx_t aligned_bytes = (nr_bytes + alignment - 1) & ~(alignment - 1);
+		    return static_cast<data_ptr_t>(aligned_alloc(alignment, aligned_bytes));
+	    },
+	    [](data_ptr_t buffer) { free(buffer); }, config.hugepage_arena_size);
+
+	// Probe io_uring with the ring of the opening thread, the commands are executed synchronously without it
+	use_io_uring = GetRing() != nullptr;
+}
+
+FileDevice::~FileDevice() {
+	thread_rings.erase(id);
+	alive.reset();
+	buffer_pool.reset();
+	close(fd);
+}
+
+//! Opens a file for O_DIRECT, falling back to buffered I/O on file systems such as tmpfs that do not support it
+static int OpenDirect(const string &path) {
+	int fd = open(path.c_str(), O_RDWR | O_DIRECT | O_CLOEXEC);
+	if (fd < 0 && errno == EINVAL) {
+		fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+	}
+	return fd;
+}
+
+void FileDevice::OpenFile(const NvmeConfig &config) {
+	if (dev_path.empty()) {
+		throw InvalidInputException("FileDevice: nvme_device_path must name a file or block device");
+	}
+
+	// A file is only created when it is given a size, such that a mistyped path does not leave an empty file behind
+	bool created = false;
+	fd = OpenDirect(dev_path);
+	if (fd < 0 && errno == ENOENT) {
+		if (config.device_size == 0) {
+			throw InvalidInputException("FileDevice: \"%s\" does not exist, set device_size to create it", dev_path);
+		}
+		int created_fd = open(dev_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+		if (created_fd >= 0) {
+			created = true;
+			close(created_fd);
+			fd = OpenDirect(dev_path);
+		}
+	}
+	if (fd < 0) {
+		int err = errno;
+		if (created) {
+			unlink(dev_path.c_str());
+		}
+		throw IOException("FileDevice: unable to open \"%s\": %s", dev_path, strerror(err));
+	}
+
+	try {
+		LoadGeometry(config);
+	} catch (...) {
+		close(fd);
+		if (created) {
+			unlink(dev_path.c_str());
+		}
+		throw;
+	}
+}
+
+void FileDevice::LoadGeometry(const NvmeConfig &config) {
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		throw IOException("FileDevice: unable to stat \"%s\": %s", dev_path, strerror(errno));
+	}
+
+	idx_t nr_bytes;
+	block_device = S_ISBLK(st.st_mode);
+	if (block_device) {
+		uint64_t device_bytes = 0;
+		int logical_block_size = 0;
+		if (ioctl(fd, BLKGETSIZE64, &device_bytes) != 0 || ioctl(fd, BLKSSZGET, &logical_block_size) != 0) {
+			throw IOException("FileDevice: unable to determine the geometry of \"%s\": %s", dev_path,
+			                  strerror(errno));
+		}
+		geometry.lba_size = logical_block_size;
+		nr_bytes = device_bytes;
+	} else {
+		geometry.lba_size = FILE_DEVICE_LBA_SIZE;
+		nr_bytes = st.st_size;
+		if (config.device_size > nr_bytes) {
+			// Extend the file sparsely, blocks are allocated by the file system as they are written
+			if (ftruncate(fd, config.device_size) != 0) {
+				throw IOException("FileDevice: unable to extend \"%s\" to %llu bytes: %s", dev_path,
+				                  config.device_size, strerror(errno));
+			}
+			nr_bytes = config.device_size;
+		}
+	}
+
+	geometry.lba_count = nr_bytes / geometry.lba_size;
+	if (geometry.lba_count == 0) {
+		throw InvalidInputException("FileDevice: \"%s\" holds less than one LBA, set device_size to extend it",
+		                            dev_path);
+	}
+}
+
+idx_t FileDevice::Write(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return WriteBatch(&request, 1);
+}
+
+idx_t FileDevice::Read(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return ReadBatch(&request, 1);
+}
+
+idx_t FileDevice::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	// The partial LBAs stay locked from before they are read until they have been written, such that a concurrent
+	// partial write to disjoint bytes of one of them is merged with the result of this batch
+	vector<idx_t> partial_lbas;
+	for (idx_t i = 0; i < count; i++) {
+		GetPartialLBAs(*requests[i].context, partial_lbas);
+	}
+	PartialLBALocks::Guard guard = lba_locks.Lock(partial_lbas);
+
+	vector<FileCommand> commands(count);
+	vector<data_ptr_t> dev_buffers(count, nullptr);
+	auto free_buffers = [&]() {
+		for (idx_t i = 0; i < count; i++) {
+			if (dev_buffers[i]) {
+				FreeBuffer(dev_buffers[i], commands[i].nr_bytes);
+			}
+		}
+	};
+
+	idx_t nr_lbas = 0;
+	// The first command that has not been submitted yet
+	idx_t submitted = 0;
+	try {
+		for (idx_t i = 0; i < count; i++) {
+			const CmdContext &ctx = *requests[i].context;
+			D_ASSERT(ctx.start_lba + ctx.nr_lbas <= geometry.lba_count);
+			idx_t nr_bytes = ctx.nr_lbas * geometry.lba_size;
+
+			// A partial LBA that an earlier command of the batch writes is read after that command has completed
+			partial_lbas.clear();
+			GetPartialLBAs(ctx, partial_lbas);
+			if (IsWrittenByAny(partial_lbas, requests + submitted, i - submitted)) {
+				Submit(commands.data() + submitted, i - submitted, true);
+				submitted = i;
+			}
+
+			data_ptr_t buffer = PrepareWriteBuffer(requests[i].buffer, ctx);
+			if (buffer != requests[i].buffer) {
+				dev_buffers[i] = buffer;
+			}
+			commands[i] = FileCommand {buffer, nr_bytes, ctx.start_lba * geometry.lba_size, 0};
+			nr_lbas += ctx.nr_lbas;
+		}
+		Submit(commands.data() + submitted, count - submitted, true);
+	} catch (...) {
+		free_buffers();
+		throw;
+	}
+	free_buffers();
+	return nr_lbas;
+}
+
+idx_t FileDevice::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	vector<FileCommand> commands(count);
+	vector<data_ptr_t> dev_buffers(count, nullptr);
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		const CmdContext &ctx = *requests[i].context;
+		D_ASSERT(ctx.start_lba + ctx.nr_lbas <= geometry.lba_count);
+		idx_t nr_bytes = ctx.nr_lbas * geometry.lba_size;
+		if (!CanUseBufferDirectly(requests[i].buffer, ctx)) {
+			dev_buffers[i] = AllocateBuffer(nr_bytes);
+		}
+		data_ptr_t buffer = dev_buffers[i] ? dev_buffers[i] : static_cast<data_ptr_t>(requests[i].buffer);
+		commands[i] = FileCommand {buffer, nr_bytes, ctx.start_lba * geometry.lba_size, 0};
+		nr_lbas += ctx.nr_lbas;
+	}
+
+	try {
+		Submit(commands.data(), count, false);
+	} catch (...) {
+		for (idx_t i = 0; i < count; i++) {
+			if (dev_buffers[i]) {
+				FreeBuffer(dev_buffers[i], commands[i].nr_bytes);
+			}
+		}
+		throw;
+	}
+
+	for (idx_t i = 0; i < count; i++) {
+		if (!dev_buffers[i]) {
+			continue;
+		}
+		const CmdContext &ctx = *requests[i].context;
+		memcpy(requests[i].buffer, dev_buffers[i] + ctx.offset, ctx.nr_bytes);
+		FreeBuffer(dev_buffers[i], commands[i].nr_bytes);
+	}
+	return nr_lbas;
+}
+
+DeviceGeometry FileDevice::GetDeviceGeometry() {
+	return geometry;
+}
+
+bool FileDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	for (idx_t i = 0; i < count; i++) {
+		uint64_t offset = ranges[i].start_lba * geometry.lba_size;
+		uint64_t nr_bytes = ranges[i].nr_lbas * geometry.lba_size;
+		int err;
+		if (block_device) {
+			uint64_t range[2] = {offset, nr_bytes};
+			err = ioctl(fd, BLKDISCARD, &range);
+		} else {
+			err = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, nr_bytes);
+		}
+		if (err != 0) {
+			if (errno == EOPNOTSUPP) {
+				return false;
+			}
+			throw IOException("FileDevice: unable to deallocate %llu LBAs at LBA %llu: %s", ranges[i].nr_lbas,
+			                  ranges[i].start_lba, strerror(errno));
+		}
+	}
+	return true;
+}
+
+bool FileDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	FileDevice *target = dynamic_cast<FileDevice *>(&destination);
+	if (!target || target->geometry.lba_size != geometry.lba_size) {
+		return false;
+	}
+
+	loff_t out_offset = destination_lba * geometry.lba_size;
+	for (idx_t i = 0; i < count; i++) {
+		loff_t in_offset = ranges[i].start_lba * geometry.lba_size;
+		idx_t remaining = ranges[i].nr_lbas * geometry.lba_size;
+		while (remaining > 0) {
+			ssize_t copied = copy_file_range(fd, &in_offset, target->fd, &out_offset, remaining, 0);
+			if (copied < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				// E.g. block devices, files on different file systems or kernels without copy_file_range
+				if (errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == ENOSYS) {
+					return false;
+				}
+				throw IOException("FileDevice: unable to copy %llu LBAs at LBA %llu: %s", ranges[i].nr_lbas,
+				                  ranges[i].start_lba, strerror(errno));
+			}
+			if (copied == 0) {
+				throw IOException("FileDevice: unable to copy beyond byte %llu of %s", in_offset, dev_path);
+			}
+			remaining -= copied;
+		}
+	}
+	return true;
+}
+
+data_ptr_t FileDevice::AllocateBuffer(idx_t nr_bytes) {
+	return buffer_pool->Allocate(nr_bytes);
+}
+
+void FileDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	buffer_pool->Free(buffer, nr_bytes);
+}
+
+bool FileDevice::CanUseBufferDirectly(const void *buffer, const CmdContext &context) {
+	if (context.offset != 0 || context.nr_bytes != context.nr_lbas * geometry.lba_size) {
+		return false;
+	}
+	idx_t alignment = MaxValue<idx_t>(geometry.lba_size, DEVICE_BUFFER_ALIGNMENT);
+	return reinterpret_cast<uintptr_t>(buffer) % alignment == 0;
+}
+
+void FileDevice::GetPartialLBAs(const CmdContext &context, vector<idx_t> &lbas) {
+	if (context.offset != 0) {
+		lbas.push_back(context.start_lba);
+	}
+	idx_t end = context.offset + context.nr_bytes;
+	if (end % geometry.lba_size != 0 && (context.nr_lbas > 1 || context.offset == 0)) {
+		lbas.push_back(context.start_lba + context.nr_lbas - 1);
+	}
+}
+
+bool FileDevice::IsWrittenByAny(const vector<idx_t> &lbas, const DeviceIORequest *requests, idx_t count) {
+	for (idx_t lba : lbas) {
+		for (idx_t i = 0; i < count; i++) {
+			const CmdContext &ctx = *requests[i].context;
+			if (lba >= ctx.start_lba && lba < ctx.start_lba + ctx.nr_lbas) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+data_ptr_t FileDevice::PrepareWriteBuffer(void *buffer, const CmdContext &context) {
+	if (CanUseBufferDirectly(buffer, context)) {
+		return static_cast<data_ptr_t>(buffer);
+	}
+
+	idx_t lba_size = geometry.lba_size;
+	data_ptr_t dev_buffer = AllocateBuffer(context.nr_lbas * lba_size);
+
+	// Read the current contents of the partially written head and tail LBAs
+	vector<idx_t> partial_lbas;
+	GetPartialLBAs(context, partial_lbas);
+	FileCommand merges[2];
+	idx_t nr_merges = 0;
+	for (idx_t lba : partial_lbas) {
+		data_ptr_t merge_buffer = dev_buffer + (lba - context.start_lba) * lba_size;
+		merges[nr_merges++] = FileCommand {merge_buffer, lba_size, lba * lba_size, 0};
+	}
+	if (nr_merges > 0) {
+		try {
+			Submit(merges, nr_merges, false);
+		} catch (...) {
+			FreeBuffer(dev_buffer, context.nr_lbas * lba_size);
+			throw;
+		}
+	}
+
+	memcpy(dev_buffer + context.offset, buffer, context.nr_bytes);
+	return dev_buffer;
+}
+
+void FileDevice::Submit(FileCommand *commands, idx_t count, bool write) {
+	FileDeviceRing *ring = use_io_uring ? GetRing() : nullptr;
+	if (ring) {
+		SubmitRing(*ring, commands, count, write);
+	} else {
+		SubmitSync(commands, count, write);
+	}
+}
+
+void FileDevice::SubmitRing(FileDeviceRing &ring, FileCommand *commands, idx_t count, bool write) {
+	// Commands that still have bytes to transfer, either because they were not submitted yet or completed partially
+	vector<FileCommand *> ready;
+	ready.reserve(count);
+	for (idx_t i = count; i > 0; i--) {
+		ready.push_back(&commands[i - 1]);
+	}
+
+	idx_t in_flight = 0;
+	int error = 0;
+	// Set when the ring could not submit, after which it is only reaped and then dropped
+	bool ring_failed = false;
+	io_uring_cqe *cqe;
+	while (in_flight > 0 || (!ready.empty() && !error)) {
+		while (!error && !ready.empty() && in_flight < queue_depth) {
+			io_uring_sqe *sqe = io_uring_get_sqe(&ring.ring);
+			if (!sqe) {
+				break;
+			}
+			FileCommand *command = ready.back();
+			ready.pop_back();
+
+			idx_t remaining = command->nr_bytes - command->transferred;
+			unsigned nr_bytes = static_cast<unsigned>(MinValue(remaining, FILE_DEVICE_MAX_TRANSFER_BYTES));
+			data_ptr_t buffer = command->buffer + command->transferred;
+			uint64_t offset = command->offset + command->transferred;
+			if (write) {
+				io_uring_prep_write(sqe, fd, buffer, nr_bytes, offset);
+			} else {
+				io_uring_prep_read(sqe, fd, buffer, nr_bytes, offset);
+			}
+			io_uring_sqe_set_data(sqe, command);
+			in_flight++;
+		}
+
+		// Submits the prepared commands and waits for at least one completion in a single system call
+		int err = ring_failed ? io_uring_wait_cqe(&ring.ring, &cqe) : io_uring_submit_and_wait(&ring.ring, 1);
+		if (err < 0 && err != -EAGAIN && err != -EBUSY && err != -EINTR) {
+			if (ring_failed) {
+				// The commands in flight can not be reaped anymore, the ring is dropped below
+				break;
+			}
+			// Commands that did not reach the kernel are never submitted, as the ring is dropped below. Those in flight
+			// reference the buffers, hence they are reaped first.
+			error = err;
+			ring_failed = true;
+			in_flight -= io_uring_sq_ready(&ring.ring);
+			ready.clear();
+			continue;
+		}
+
+		while (io_uring_peek_cqe(&ring.ring, &cqe) == 0) {
+			FileCommand *command = static_cast<FileCommand *>(io_uring_cqe_get_data(cqe));
+			int res = cqe->res;
+			io_uring_cqe_seen(&ring.ring, cqe);
+			in_flight--;
+
+			if (res == -EAGAIN || res == -EINTR) {
+				ready.push_back(command);
+			} else if (res <= 0) {
+				// A read returning 0 bytes is past the end of the file
+				error = error ? error : (res < 0 ? res : -EIO);
+			} else {
+				command->transferred += res;
+				if (command->transferred < command->nr_bytes) {
+					ready.push_back(command);
+				}
+			}
+		}
+		if (error) {
+			// Stop submitting, but keep reaping the commands that are in flight as they reference the buffers
+			ready.clear();
+		}
+	}
+
+	if (ring_failed) {
+		// The next command of this thread creates a new ring
+		thread_rings.erase(id);
+		throw IOException("FileDevice: unable to submit to io_uring: %s", strerror(-error));
+	}
+	if (error) {
+		throw IOException("FileDevice: unable to %s \"%s\": %s", write ? "write to" : "read from", dev_path,
+		                  strerror(-error));
+	}
+}
+
+void FileDevice::SubmitSync(FileCommand *commands, idx_t count, bool write) {
+	for (idx_t i = 0; i < count; i++) {
+		FileCommand &command = commands[i];
+		while (command.transferred < command.nr_bytes) {
+			idx_t nr_bytes = MinValue(command.nr_bytes - command.transferred, FILE_DEVICE_MAX_TRANSFER_BYTES);
+			data_ptr_t buffer = command.buffer + command.transferred;
+			off_t offset = command.offset + command.transferred;
+			ssize_t res = write ? pwrite(fd, buffer, nr_bytes, offset) : pread(fd, buffer, nr_bytes, offset);
+			if (res < 0 && errno == EINTR) {
+				continue;
+			}
+			if (res <= 0) {
+				throw IOException("FileDevice: unable to %s \"%s\": %s", write ? "write to" : "read from", dev_path,
+				                  res < 0 ? strerror(errno) : "unexpected end of file");
+			}
+			command.transferred += res;
+		}
+	}
+}
+
+FileDeviceRing *FileDevice::GetRing() {
+	auto entry = thread_rings.find(id);
+	if (entry != thread_rings.end()) {
+		return entry->second.ring.get();
+	}
+
+	// Release the rings of devices that have been closed since this thread last created a ring
+	for (auto it = thread_rings.begin(); it != thread_rings.end();) {
+		if (it->second.alive.expired()) {
+			it = thread_rings.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	ThreadRing &thread_ring = thread_rings[id];
+	thread_ring.alive = alive;
+	thread_ring.ring = make_uniq<FileDeviceRing>();
+	if (io_uring_queue_init(queue_depth, &thread_ring.ring->ring, 0) != 0) {
+		// The thread executes its commands synchronously, e.g. when it has exhausted its locked memory
+		thread_ring.ring.reset();
+		return nullptr;
+	}
+	thread_ring.ring->initialized = true;
+	return thread_ring.ring.get();
+}
+
+} // namespace duckdb
@@ -0,0 +1,184 @@
+#include "hybrid_zoned_device.hpp"
+
+namespace duckdb {
+
+HybridZonedDevice::HybridZonedDevice(unique_ptr<Device> conventional_p, unique_ptr<Device> zoned_p)
+    : conventional(std::move(conventional_p)), zoned(std::move(zoned_p)) {
+	DeviceGeometry conventional_geometry = conventional->GetDeviceGeometry();
+	DeviceGeometry zoned_geometry = zoned->GetDeviceGeometry();
+	if (conventional_geometry.lba_size != zoned_geometry.lba_size) {
+		throw InvalidInputException(
+		    "The conventional and zoned namespace must have the same LBA size, got %llu and %llu",
+		    conventional_geometry.lba_size, zoned_geometry.lba_size);
+	}
+	if (!zoned->GetZoneGeometry(zone_geometry)) {
+		throw InvalidInputException("%s is not a zoned device", zoned->GetName());
+	}
+
+	conventional_lbas = conventional_geometry.lba_count;
+	geometry.lba_size = conventional_geometry.lba_size;
+	geometry.lba_count = conventional_lbas + zoned_geometry.lba_count;
+	// Conventional LBAs of the zoned device itself, if any, extend those of the conventional device
+	zone_geometry.conventional_lbas += conventional_lbas;
+}
+
+Device &HybridZonedDevice::Route(const CmdContext &context, NvmeCmdContext &zoned_context) {
+	if (context.start_lba + context.nr_lbas <= conventional_lbas) {
+		return *conventional;
+	}
+	if (context.start_lba < conventional_lbas) {
+		throw IOException("Command at LBA %llu spans the conventional and the zoned namespace", context.start_lba);
+	}
+	zoned_context = static_cast<const NvmeCmdContext &>(context);
+	zoned_context.start_lba -= conventional_lbas;
+	return *zoned;
+}
+
+idx_t HybridZonedDevice::Write(void *buffer, const CmdContext &context) {
+	NvmeCmdContext zoned_context;
+	Device &device = Route(context, zoned_context);
+	return device.Write(buffer, &device == zoned.get() ? zoned_context : context);
+}
+
+idx_t HybridZonedDevice::Read(void *buffer, const CmdContext &context) {
+	NvmeCmdContext zoned_context;
+	Device &device = Route(context, zoned_context);
+	return device.Read(buffer, &device == zoned.get() ? zoned_context : context);
+}
+
+idx_t HybridZonedDevice::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	return SubmitBatch(requests, count, true);
+}
+
+idx_t HybridZonedDevice::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	return SubmitBatch(requests, count, false);
+}
+
+idx_t HybridZonedDevice::SubmitBatch(const DeviceIORequest *requests, idx_t count, bool write) {
+	vector<DeviceIORequest> conventional_requests;
+	vector<DeviceIORequest> zoned_requests;
+	// Reserved up front, as the zoned requests reference the contexts
+	vector<NvmeCmdContext> zoned_contexts(count);
+	for (idx_t i = 0; i < count; i++) {
+		Device &device = Route(*requests[i].context, zoned_contexts[i]);
+		if (&device == zoned.get()) {
+			zoned_requests.push_back(DeviceIORequest {requests[i].buffer, &zoned_contexts[i]});
+		} else {
+			conventional_requests.push_back(requests[i]);
+		}
+	}
+
+	idx_t nr_lbas = 0;
+	if (!conventional_requests.empty()) {
+		nr_lbas += write ? conventional->WriteBatch(conventional_requests.data(), conventional_requests.size())
+		                 : conventional->ReadBatch(conventional_requests.data(), conventional_requests.size());
+	}
+	if (!zoned_requests.empty()) {
+		nr_lbas += write ? zoned->WriteBatch(zoned_requests.data(), zoned_requests.size())
+		                 : zoned->ReadBatch(zoned_requests.data(), zoned_requests.size());
+	}
+	return nr_lbas;
+}
+
+DeviceGeometry HybridZonedDevice::GetDeviceGeometry() {
+	return geometry;
+}
+
+bool HybridZonedDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	vector<DeviceLBARange> conventional_ranges;
+	vector<DeviceLBARange> zoned_ranges;
+	for (idx_t i = 0; i < count; i++) {
+		DeviceLBARange range = ranges[i];
+		if (range.start_lba < conventional_lbas) {
+			idx_t nr_lbas = MinValue<idx_t>(range.nr_lbas, conventional_lbas - range.start_lba);
+			conventional_ranges.push_back(DeviceLBARange {range.start_lba, nr_lbas});
+			range.start_lba += nr_lbas;
+			range.nr_lbas -= nr_lbas;
+		}
+		if (range.nr_lbas > 0) {
+			zoned_ranges.push_back(DeviceLBARange {range.start_lba - conventional_lbas, range.nr_lbas});
+		}
+	}
+
+	bool deallocated = true;
+	if (!conventional_ranges.empty()) {
+		deallocated &= conventional->Deallocate(conventional_ranges.data(), conventional_ranges.size());
+	}
+	if (!zoned_ranges.empty()) {
+		deallocated &= zoned->Deallocate(zoned_ranges.data(), zoned_ranges.size());
+	}
+	return deallocated;
+}
+
+bool HybridZonedDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		if (ranges[i].start_lba + ranges[i].nr_lbas > conventional_lbas) {
+			return false;
+		}
+		nr_lbas += ranges[i].nr_lbas;
+	}
+
+	if (&destination != this) {
+		return conventional->Copy(ranges, count, destination, destination_lba);
+	}
+	if (destination_lba + nr_lbas > conventional_lbas) {
+		return false;
+	}
+	return conventional->Copy(ranges, count, *conventional, destination_lba);
+}
+
+data_ptr_t HybridZonedDevice::AllocateBuffer(idx_t nr_bytes) {
+	return conventional->AllocateBuffer(nr_bytes);
+}
+
+void HybridZonedDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	conventional->FreeBuffer(buffer, nr_bytes);
+}
+
+vector<DeviceQueueStatistics> HybridZonedDevice::GetQueueStatistics() {
+	vector<DeviceQueueStatistics> statistics = conventional->GetQueueStatistics();
+	for (DeviceQueueStatistics &queue : zoned->GetQueueStatistics()) {
+		queue.owner = "zoned " + queue.owner;
+		statistics.push_back(queue);
+	}
+	return statistics;
+}
+
+bool HybridZonedDevice::GetZoneGeometry(DeviceZoneGeometry &geometry) {
+	geometry = zone_geometry;
+	return true;
+}
+
+idx_t HybridZonedDevice::ZoneAppend(void *buffer, const CmdContext &context) {
+	NvmeCmdContext zoned_context;
+	Route(context, zoned_context);
+	return zoned->ZoneAppend(buffer, zoned_context) + conventional_lbas;
+}
+
+void HybridZonedDevice::ResetZone(idx_t zone_start_lba) {
+	zoned->ResetZone(zone_start_lba - conventional_lbas);
+}
+
+idx_t HybridZonedDevice::GetZoneWritePointer(idx_t zone_start_lba) {
+	return zoned->GetZoneWritePointer(zone_start_lba - conventional_lbas) + conventional_lbas;
+}
+
+bool HybridZonedDevice::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	return conventional->GetFDPStatistics(statistics);
+}
+
+uint8_t HybridZonedDevice::GetPlacementIdentifier(const string &path, idx_t generation) {
+	return conventional->GetPlacementIdentifier(path, generation);
+}
+
+uint8_t HybridZonedDevice::GetHotPlacementIdentifier(const string &path) {
+	return conventional->GetHotPlacementIdentifier(path);
+}
+
+void HybridZonedDevice::SetThreadCount(idx_t nr_threads) {
+	conventional->SetThreadCount(nr_threads);
+	zoned->SetThreadCount(nr_threads);
+}
+
+} // namespace duckdb
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+
+#include <condition_variable>
+#include <thread>
+
+namespace duckdb {
+
+/// @brief Time without I/O in milliseconds after which the device is considered idle
+static constexpr idx_t DEALLOCATOR_IDLE_TIME_MS = 50;
+/// @brief Interval in milliseconds at which the deallocator checks whether the device is idle
+static constexpr idx_t DEALLOCATOR_POLL_INTERVAL_MS = 10;
+/// @brief Number of pending LBAs after which the ranges are released even if the device is busy
+static constexpr idx_t DEALLOCATOR_MAX_PENDING_LBAS = 1ULL << 24;
+
+/// @brief Gathers LBA ranges that no longer hold data, e.g. freed temporary blocks or a reset WAL, and deallocates
+/// them on the device in batches while it is idle. Adjacent and overlapping ranges are coalesced.
+///
+/// Ranges must be added before their LBAs can be reused, and every write must cancel the LBAs it covers before it is
+/// submitted. The device is called without holding the lock, hence the ranges being deallocated are tracked as in
+/// flight, and cancelling any of their LBAs waits until the deallocation has completed. A write therefore never races
+/// with the deallocation of its LBAs.
+class BackgroundDeallocator {
+public:
+	/// @brief Creates a deallocator
+	/// @param device The device to deallocate on
+	/// @param background Whether to start the background thread. Without it, ranges are only released by Flush
+	explicit BackgroundDeallocator(Device &device, bool background = true);
+	~BackgroundDeallocator();
+
+	/// @brief Adds a range of LBAs that is no longer in use
+	void Add(idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief Removes a range of LBAs that is about to be written from the pending ranges, waiting for the deallocation
+	/// of any of its LBAs that is in flight
+	void Cancel(idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief Records that I/O was issued, postponing deallocation until the device is idle again
+	void NotifyIO() {
+		last_io.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+	}
+
+	/// @brief Deallocates all pending ranges immediately
+	/// @return The number of LBAs that were released
+	idx_t Flush();
+
+	/// @brief The number of LBAs that are waiting to be deallocated
+	idx_t GetPendingLBAs() const {
+		return pending_lbas.load();
+	}
+
+	/// @brief The total number of LBAs that have been deallocated
+	idx_t GetReleasedLBAs() const {
+		return released_lbas.load();
+	}
+
+private:
+	void Run();
+
+private:
+	Device &device;
+	//! Guards the pending and in flight ranges
+	mutex lock;
+	//! Pending ranges, mapping the start LBA to the number of LBAs
+	map<idx_t, idx_t> ranges;
+	//! Ranges that are being deallocated, which may overlap if the same LBAs are added again meanwhile
+	multimap<idx_t, idx_t> in_flight;
+	//! Signalled when deallocations complete
+	std::condition_variable in_flight_condition;
+	atomic<idx_t> pending_lbas;
+	atomic<idx_t> in_flight_lbas;
+	atomic<idx_t> released_lbas;
+	//! Cleared once the device reports that it can not deallocate
+	atomic<bool> enabled;
+	atomic<std::chrono::steady_clock::rep> last_io;
+
+	std::thread thread;
+	mutex wait_lock;
+	std::condition_variable wait_condition;
+	bool shutdown;
+};
+
+} // namespace duckdb
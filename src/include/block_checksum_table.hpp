@@ -0,0 +1,75 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/common/optional_idx.hpp"
+
+namespace duckdb {
+
+/// @brief log2 of the number of LBAs whose checksums are allocated together
+static constexpr idx_t BLOCK_CHECKSUM_PAGE_SHIFT = 16;
+/// @brief The number of bytes that the checksum of an LBA takes when the table is persisted
+static constexpr idx_t BLOCK_CHECKSUM_ENTRY_SIZE = sizeof(uint64_t);
+
+/// @brief Keeps a CRC32C checksum of every LBA of a region in host memory, such that temporary and WAL data read back
+/// from the device can be verified.
+///
+/// The checksum of an LBA covers the bytes from the start of the LBA up to the last byte written to it, which lets
+/// appends to a partially written LBA, as made by the WAL, extend the checksum without reading the LBA. Writes that
+/// rewrite the middle of the covered bytes, or leave a gap after them, make the LBA unverified until it is written from
+/// its start again. Every LBA takes 8 bytes, the checksum and the number of covered bytes, which are allocated in pages
+/// of 2^BLOCK_CHECKSUM_PAGE_SHIFT LBAs when the region is first written there.
+class BlockChecksumTable {
+public:
+	/// @brief Creates a table
+	/// @param start_lba The first LBA of the region
+	/// @param end_lba The LBA after the region
+	/// @param lba_size The size of an LBA in bytes
+	BlockChecksumTable(idx_t start_lba, idx_t end_lba, idx_t lba_size);
+
+	/// @brief Records a write to the region
+	/// @param start_lba The first written LBA
+	/// @param offset Offset of the data into the first LBA
+	/// @param data The written data
+	/// @param nr_bytes The number of written bytes
+	void RecordWrite(idx_t start_lba, idx_t offset, const_data_ptr_t data, idx_t nr_bytes);
+
+	/// @brief Verifies the LBAs of which a read covers all checksummed bytes. LBAs that are only read in part are
+	/// skipped.
+	/// @param start_lba The first read LBA
+	/// @param offset Offset of the data into the first LBA
+	/// @param data The read data
+	/// @param nr_bytes The number of read bytes
+	/// @return The first LBA whose contents do not match its checksum, or an invalid index if all match
+	optional_idx Verify(idx_t start_lba, idx_t offset, const_data_ptr_t data, idx_t nr_bytes) const;
+
+	/// @brief Makes a range of LBAs unverified, e.g. when it is deallocated
+	void Invalidate(idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief The number of LBAs that have a checksum
+	idx_t GetChecksummedLBAs() const;
+
+	/// @brief Writes the checksums of a range of LBAs to a buffer of BLOCK_CHECKSUM_ENTRY_SIZE bytes per LBA, such that
+	/// they can be persisted. LBAs without a checksum or outside the region are written as unverified.
+	void Serialize(idx_t start_lba, idx_t nr_lbas, data_ptr_t buffer) const;
+
+	/// @brief Loads the checksums of a range of LBAs that Serialize wrote
+	void Deserialize(idx_t start_lba, idx_t nr_lbas, const_data_ptr_t buffer);
+
+private:
+	/// @brief Fetches the entry of an LBA, or nullptr if its page has not been allocated
+	atomic<uint64_t> *GetEntry(idx_t lba) const;
+	/// @brief Fetches the entry of an LBA, allocating its page if needed
+	atomic<uint64_t> &GetOrCreateEntry(idx_t lba);
+
+private:
+	const idx_t start_lba;
+	const idx_t end_lba;
+	const idx_t lba_size;
+	//! Per LBA, the number of covered bytes in the upper and the checksum in the lower 32 bits. 0 is unverified
+	unique_ptr<atomic<atomic<uint64_t> *>[]> pages;
+	idx_t nr_pages;
+	mutex allocation_lock;
+	vector<unique_ptr<atomic<uint64_t>[]>> allocated_pages;
+};
+
+} // namespace duckdb
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief Extends a CRC32C (Castagnoli) checksum with the given bytes. Uses the CRC32 instruction of SSE4.2 when the
+/// CPU has it, running three independent streams to hide its latency, and slicing-by-8 tables otherwise.
+/// @param crc The checksum of the preceding bytes, 0 for the first bytes
+/// @param data The bytes to add
+/// @param nr_bytes The number of bytes
+/// @return The checksum of the preceding bytes followed by the given bytes
+uint32_t Crc32c(uint32_t crc, const_data_ptr_t data, idx_t nr_bytes);
+
+/// @brief Same as Crc32c, but always computed with the lookup tables
+uint32_t Crc32cSoftware(uint32_t crc, const_data_ptr_t data, idx_t nr_bytes);
+
+/// @brief Whether Crc32c uses the CRC32 instruction of the CPU
+bool Crc32cIsHardwareAccelerated();
+
+} // namespace duckdb
@@ -1,9 +1,15 @@
 #pragma once
 
 #include "duckdb.hpp"
+#include "duckdb/common/optional_idx.hpp"
 
 namespace duckdb {
 
+/// @brief Whether a value is a power of two. Unlike IsPowerOfTwo of DuckDB, 0 is not
+inline bool IsNonZeroPowerOfTwo(idx_t value) {
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
 struct DeviceGeometry {
 	idx_t lba_size;
 	idx_t lba_count;
@@ -16,6 +22,75 @@ struct CmdContext {
 	idx_t offset;
 };
 
+/// @brief Snapshot of the state of a single I/O queue of a device
+struct DeviceQueueStatistics {
+	idx_t queue_id;
+	//! Who submits to the queue, e.g. a DuckDB thread or a reactor poller
+	string owner;
+	idx_t max_depth;
+	//! The number of commands that may currently be in flight
+	idx_t window;
+	idx_t target_latency_us;
+	double average_latency_us;
+	idx_t completions;
+};
+
+/// @brief Snapshot of the usage of a single FDP placement handle
+struct DevicePlacementStatistics {
+	//! Index of the handle, as used by the placement policy
+	idx_t placement_handle;
+	//! The placement identifier and reclaim unit handle that the device maps the handle to
+	idx_t placement_identifier;
+	idx_t reclaim_unit_handle;
+	//! Bytes written through the handle since the device was opened
+	idx_t host_bytes_written;
+	//! Bytes that can still be written to the reclaim unit that the handle currently references
+	idx_t available_bytes;
+	//! Bytes written to the reclaim unit that the handle currently references, if the reclaim unit size is known
+	optional_idx used_bytes;
+};
+
+/// @brief Snapshot of the Flexible Data Placement statistics of a device
+struct DeviceFDPStatistics {
+	//! Bytes written by the host and to the media over the lifetime of the endurance group
+	idx_t host_bytes_written = 0;
+	idx_t media_bytes_written = 0;
+	idx_t media_bytes_erased = 0;
+	//! The lifetime counters at the time the device was opened
+	idx_t initial_host_bytes_written = 0;
+	idx_t initial_media_bytes_written = 0;
+	vector<DevicePlacementStatistics> placement_handles;
+};
+
+/// @brief A contiguous range of LBAs
+struct DeviceLBARange {
+	idx_t start_lba;
+	idx_t nr_lbas;
+};
+
+/// @brief The zones of a zoned device, e.g. an NVMe Zoned Namespace. The LBAs before the first zone can be written in
+/// any order. A zone is written sequentially from its start, up to its capacity, and can only be rewritten after it has
+/// been reset as a whole.
+struct DeviceZoneGeometry {
+	//! The number of randomly writable LBAs before the first zone
+	idx_t conventional_lbas = 0;
+	//! The distance in LBAs between the starts of consecutive zones
+	idx_t zone_size = 0;
+	//! The number of LBAs that can be written to a zone, at most zone_size
+	idx_t zone_capacity = 0;
+	idx_t nr_zones = 0;
+
+	idx_t GetZoneStart(idx_t zone) const {
+		return conventional_lbas + zone * zone_size;
+	}
+};
+
+/// @brief A single command within a batch of I/O commands
+struct DeviceIORequest {
+	void *buffer;
+	const CmdContext *context;
+};
+
 class Device {
 public:
 	virtual ~Device() = default;
@@ -23,8 +98,91 @@ public:
 	virtual idx_t Write(void *buffer, const CmdContext &context);
 	virtual idx_t Read(void *buffer, const CmdContext &context);
 
+	/// @brief Writes a batch of commands to the device. Devices that can have multiple commands in flight submit the
+	/// whole batch before waiting for completions. By default, the commands are executed one at a time.
+	/// @param requests The commands to write, each with its own input buffer
+	/// @param count The number of commands in the batch
+	/// @return The total amount of LBAs written to the device
+	virtual idx_t WriteBatch(const DeviceIORequest *requests, idx_t count);
+
+	/// @brief Reads a batch of commands from the device. Devices that can have multiple commands in flight submit the
+	/// whole batch before waiting for completions. By default, the commands are executed one at a time.
+	/// @param requests The commands to read, each with its own output buffer
+	/// @param count The number of commands in the batch
+	/// @return The total amount of LBAs read from the device
+	virtual idx_t ReadBatch(const DeviceIORequest *requests, idx_t count);
+
 	virtual DeviceGeometry GetDeviceGeometry();
 
+	/// @brief Deallocates ranges of LBAs, such that the device can reclaim the underlying storage. The contents of
+	/// deallocated LBAs are undefined until they are written again. By default, deallocation is not supported.
+	/// @param ranges The ranges to deallocate
+	/// @param count The number of ranges
+	/// @return True if the ranges were deallocated, false if the device does not support deallocation
+	virtual bool Deallocate(const DeviceLBARange *ranges, idx_t count);
+
+	/// @brief Copies ranges of LBAs without transferring the data through host memory, e.g. with the NVMe Copy command.
+	/// The ranges are written back to back, starting at the destination LBA. By default, copies are not offloaded.
+	/// @param ranges The ranges to copy
+	/// @param count The number of ranges
+	/// @param destination The device to copy to, which may be this device
+	/// @param destination_lba The first LBA to write to on the destination
+	/// @return True if the ranges were copied, false if the device can not copy to the destination, in which case the
+	/// caller copies the data through host memory
+	virtual bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba);
+
+	/// @brief Allocates a buffer that can be used for I/O on the device. Should be freed with FreeBuffer.
+	/// @param nr_bytes The number of bytes to allocate (The allocated buffer might be larger)
+	/// @return Pointer to the allocated buffer
+	virtual data_ptr_t AllocateBuffer(idx_t nr_bytes);
+
+	/// @brief Returns a buffer allocated with AllocateBuffer to the device
+	/// @param buffer The buffer to free
+	/// @param nr_bytes The number of bytes that was requested when the buffer was allocated
+	virtual void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes);
+
+	/// @brief Fetches the state of the I/O queues of the device. Devices without queues return an empty list.
+	virtual vector<DeviceQueueStatistics> GetQueueStatistics();
+
+	/// @brief Fetches the Flexible Data Placement statistics of the device
+	/// @param statistics Receives the statistics
+	/// @return False if the device does not use FDP. By default, FDP is not used.
+	virtual bool GetFDPStatistics(DeviceFDPStatistics &statistics);
+
+	/// @brief Determines the placement identifier that writes to files at the given path are tagged with. Resolved
+	/// once when a file is opened. By default, all data shares placement identifier 0.
+	/// @param path The path of the file
+	/// @param generation The creation order of a temporary file, 0 for other files
+	virtual uint8_t GetPlacementIdentifier(const string &path, idx_t generation);
+
+	/// @brief Determines the placement identifier of the ranges of a file that are rewritten often. By default, the
+	/// same as the placement identifier of the file.
+	virtual uint8_t GetHotPlacementIdentifier(const string &path);
+
+	/// @brief Fetches the zones of the device
+	/// @param geometry Receives the zone geometry
+	/// @return False if the device is not zoned. By default, devices are not zoned.
+	virtual bool GetZoneGeometry(DeviceZoneGeometry &geometry);
+
+	/// @brief Appends data to a zone. The device picks the LBAs, which are the write pointer of the zone at the time
+	/// the command is executed, such that appends to the same zone need not be ordered by the host. The appended LBAs
+	/// are contiguous. The unused bytes of the last LBA are undefined.
+	/// @param buffer The data to append
+	/// @param context The command, whose start_lba is the first LBA of the zone and whose offset is 0
+	/// @return The first LBA that the data was written to
+	virtual idx_t ZoneAppend(void *buffer, const CmdContext &context);
+
+	/// @brief Resets a zone, which discards its contents and moves its write pointer back to its start
+	/// @param zone_start_lba The first LBA of the zone
+	virtual void ResetZone(idx_t zone_start_lba);
+
+	/// @brief Fetches the write pointer of a zone, which is the LBA that the next write to the zone lands on
+	/// @param zone_start_lba The first LBA of the zone
+	virtual idx_t GetZoneWritePointer(idx_t zone_start_lba);
+
+	/// @brief Adapts per-thread resources, such as I/O queues, to a new number of threads. By default, nothing is done.
+	virtual void SetThreadCount(idx_t nr_threads);
+
 	virtual string GetName() const = 0;
 };
 
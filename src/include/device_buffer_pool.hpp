@@ -0,0 +1,83 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+#include <functional>
+#include <thread>
+
+namespace duckdb {
+
+typedef std::function<data_ptr_t(idx_t nr_bytes)> buffer_alloc_function_t;
+typedef std::function<void(data_ptr_t buffer)> buffer_free_function_t;
+
+/// @brief Size classes served by the pool. These match the LBA size used for metadata and WAL writes, the temporary
+/// buffer sizes used by DuckDB (S32K to S224K) and the default DuckDB block size (256 KiB).
+static constexpr idx_t DEVICE_BUFFER_SIZE_CLASSES[] = {4096,   8192,   32768,  65536,  98304,
+                                                       131072, 163840, 196608, 229376, 262144};
+static constexpr idx_t DEVICE_BUFFER_SIZE_CLASS_COUNT =
+    sizeof(DEVICE_BUFFER_SIZE_CLASSES) / sizeof(DEVICE_BUFFER_SIZE_CLASSES[0]);
+static constexpr idx_t DEVICE_BUFFER_ALIGNMENT = 4096;
+
+/// @brief Maximum number of buffers per size class that is kept in the free list of a single thread
+static constexpr idx_t DEVICE_BUFFER_THREAD_CACHE_SIZE = 8;
+/// @brief Maximum number of buffers per size class that is kept in the shared free list
+static constexpr idx_t DEVICE_BUFFER_SHARED_CACHE_SIZE = 64;
+
+/// @brief Pool of device buffers. Buffers are grouped in size classes and recycled through per-thread free lists
+/// such that the I/O path does not pay for an allocation per command. Optionally, buffers are carved from a
+/// hugepage-backed arena that is allocated up front.
+class DeviceBufferPool {
+public:
+	/// @brief Creates a buffer pool
+	/// @param alloc_function Function used to allocate memory when no cached buffer is available
+	/// @param free_function Function used to release memory allocated through alloc_function
+	/// @param arena_size Size in bytes of the hugepage-backed arena. 0 disables the arena
+	DeviceBufferPool(buffer_alloc_function_t alloc_function, buffer_free_function_t free_function,
+	                 idx_t arena_size = 0);
+	~DeviceBufferPool();
+
+	/// @brief Fetches a buffer of at least nr_bytes. Should be returned with Free.
+	/// @param nr_bytes The number of bytes required (The returned buffer might be larger)
+	/// @return Pointer to the buffer
+	data_ptr_t Allocate(idx_t nr_bytes);
+
+	/// @brief Returns a buffer to the pool
+	/// @param buffer The buffer to return
+	/// @param nr_bytes The number of bytes that was requested when the buffer was allocated
+	void Free(data_ptr_t buffer, idx_t nr_bytes);
+
+	/// @brief Checks if the buffer is located within the hugepage-backed arena
+	bool IsArenaBuffer(const_data_ptr_t buffer) const;
+
+	/// @brief Get the size class index of the given number of bytes
+	/// @return The index of the size class or DEVICE_BUFFER_SIZE_CLASS_COUNT if the size is not pooled
+	static idx_t GetSizeClass(idx_t nr_bytes);
+
+private:
+	struct ThreadCache {
+		vector<data_ptr_t> free_lists[DEVICE_BUFFER_SIZE_CLASS_COUNT];
+	};
+
+	ThreadCache &GetThreadCache();
+	data_ptr_t AllocateFromArena(idx_t nr_bytes);
+	void InitializeArena(idx_t arena_size);
+
+private:
+	buffer_alloc_function_t alloc_function;
+	buffer_free_function_t free_function;
+
+	const idx_t pool_id;
+	mutex pool_lock;
+	unordered_map<std::thread::id, unique_ptr<ThreadCache>> thread_caches;
+	vector<data_ptr_t> shared_free_lists[DEVICE_BUFFER_SIZE_CLASS_COUNT];
+
+	data_ptr_t arena;
+	idx_t arena_size;
+	idx_t arena_offset;
+
+	static atomic<idx_t> pool_id_counter;
+	static thread_local idx_t cached_pool_id;
+	static thread_local ThreadCache *cached_thread_cache;
+};
+
+} // namespace duckdb
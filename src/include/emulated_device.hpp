@@ -0,0 +1,161 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+#include "nvme_completion.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+
+namespace duckdb {
+
+typedef std::chrono::steady_clock::time_point emulated_time_t;
+
+/// @brief The performance characteristics of an emulated drive. Latencies are in microseconds and bandwidths in
+/// bytes per second, where 0 is unlimited.
+struct EmulatedDeviceProfile {
+	//! Latency of every command, on top of which an exponentially distributed jitter with the given mean is added
+	idx_t read_latency_us = 80;
+	idx_t read_jitter_us = 10;
+	idx_t write_latency_us = 20;
+	idx_t write_jitter_us = 5;
+	//! Probability that a command hits a slow path, e.g. garbage collection, which adds tail_latency_us
+	double tail_probability = 0;
+	idx_t tail_latency_us = 0;
+	idx_t read_bandwidth = 0;
+	idx_t write_bandwidth = 0;
+	//! Number of channels (or dies) that serve commands in parallel. Consecutive stripes of stripe_size bytes are
+	//! spread over the channels, and every channel serves one command at a time
+	idx_t channels = 8;
+	idx_t stripe_size = 64ULL << 10;
+	//! Seed of the latency distributions, such that runs are reproducible
+	uint64_t seed = 0;
+
+	/// @brief Loads a profile from a file of "key = value" lines. Lines starting with '#' are comments. Bandwidths and
+	/// stripe_size accept sizes such as "3GB". Keys that are absent keep their default.
+	/// @param path The path of the profile
+	static EmulatedDeviceProfile Load(const string &path);
+
+	/// @brief Parses a profile from the contents of a profile file
+	static EmulatedDeviceProfile Parse(const string &contents);
+};
+
+/// @brief A decorator that delays the completion of the commands of another device according to a model of an SSD,
+/// such that queueing, parallelism and tail latencies can be observed and benchmarked reproducibly without the drive
+/// itself. Data is read and written through the wrapped device immediately.
+///
+/// Every command is assigned a completion time when it is submitted: it waits for its channel to be free, takes the
+/// latency drawn from the profile and is held back until the bandwidth of its direction allows its transfer. The
+/// commands of a batch are submitted together. A synchronous batch waits for its last command, while the commands of
+/// SubmitBatchAsync are completed one by one at their completion times by a completion thread. Commands of other
+/// threads share the channels and bandwidth.
+class EmulatedDevice final : public Device {
+public:
+	EmulatedDevice(unique_ptr<Device> device, EmulatedDeviceProfile profile);
+	~EmulatedDevice();
+
+	idx_t Write(void *buffer, const CmdContext &context) override;
+	idx_t Read(void *buffer, const CmdContext &context) override;
+	idx_t WriteBatch(const DeviceIORequest *requests, idx_t count) override;
+	idx_t ReadBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	/// @brief Submits a batch without waiting for it. The wrapped device executes the commands right away, and every
+	/// command is reported to the completion slot at its own emulated completion time
+	/// @param completion The slot, which must count the commands of the batch and outlive their completion
+	/// @return The total amount of LBAs transferred
+	idx_t SubmitBatchAsync(const DeviceIORequest *requests, idx_t count, bool write, NvmeCompletion &completion);
+
+	/// @brief The number of commands of SubmitBatchAsync that have not completed yet
+	idx_t GetInFlightCount();
+
+	/// @brief The largest number of commands that the channels have served at the same time
+	idx_t GetPeakParallelism();
+
+	DeviceGeometry GetDeviceGeometry() override;
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+	/// @brief Copies with the wrapped device, without delay, as the data does not cross the host interface
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+
+	/// @brief Reports every channel as a queue of depth 1, with the average emulated latency of its commands
+	vector<DeviceQueueStatistics> GetQueueStatistics() override;
+
+	bool GetZoneGeometry(DeviceZoneGeometry &geometry) override;
+	/// @brief Delays an append like a write
+	idx_t ZoneAppend(void *buffer, const CmdContext &context) override;
+	void ResetZone(idx_t zone_start_lba) override;
+	idx_t GetZoneWritePointer(idx_t zone_start_lba) override;
+
+	bool GetFDPStatistics(DeviceFDPStatistics &statistics) override;
+	uint8_t GetPlacementIdentifier(const string &path, idx_t generation) override;
+	uint8_t GetHotPlacementIdentifier(const string &path) override;
+	void SetThreadCount(idx_t nr_threads) override;
+
+	string GetName() const override {
+		return "EmulatedDevice(" + device->GetName() + ")";
+	}
+
+	const EmulatedDeviceProfile &GetProfile() const {
+		return profile;
+	}
+
+private:
+	struct Channel {
+		//! The time at which the channel has served all commands submitted to it
+		emulated_time_t available;
+		idx_t completions = 0;
+		//! Sum of the time between submission and completion of the commands of the channel
+		std::chrono::nanoseconds total_latency {0};
+	};
+
+	//! A command of SubmitBatchAsync that has not been reported to its completion slot yet
+	struct PendingCompletion {
+		emulated_time_t time;
+		NvmeCompletion *completion;
+
+		bool operator>(const PendingCompletion &other) const {
+			return time > other.time;
+		}
+	};
+
+	/// @brief Assigns completion times to a batch of commands submitted at the same time
+	/// @param completions Optionally receives the completion time of every command
+	/// @return The completion time of the last command
+	emulated_time_t Schedule(const DeviceIORequest *requests, idx_t count, bool write,
+	                         emulated_time_t *completions = nullptr);
+
+	/// @brief Reports the commands of SubmitBatchAsync to their completion slots once their completion time has passed
+	void RunCompletions();
+
+	/// @brief Waits until the given time, sleeping for long waits and spinning for the remainder
+	static void WaitUntil(emulated_time_t time);
+
+private:
+	unique_ptr<Device> device;
+	const EmulatedDeviceProfile profile;
+	const idx_t lba_size;
+
+	mutex lock;
+	vector<Channel> channels;
+	//! The time at which the bandwidth of reads and writes has been consumed by the commands submitted so far
+	emulated_time_t read_bandwidth_available;
+	emulated_time_t write_bandwidth_available;
+	std::mt19937_64 random;
+	idx_t peak_parallelism;
+
+	//! Guards the pending completions, apart from the model such that reporting completions does not hold back
+	//! submissions
+	mutex completion_lock;
+	std::condition_variable completion_condition;
+	std::priority_queue<PendingCompletion, vector<PendingCompletion>, std::greater<PendingCompletion>> pending;
+	bool shutdown;
+	//! Started by the first asynchronous submission
+	std::thread completion_thread;
+};
+
+} // namespace duckdb
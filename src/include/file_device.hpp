@@ -0,0 +1,135 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+#include "device_buffer_pool.hpp"
+#include "nvmefs_config.hpp"
+#include "partial_lba_cache.hpp"
+
+#include <liburing.h>
+
+namespace duckdb {
+
+/// @brief LBA size of a FileDevice backed by a regular file. Block devices use their logical block size.
+static constexpr idx_t FILE_DEVICE_LBA_SIZE = 4096;
+
+/// @brief An io_uring instance of a single thread
+struct FileDeviceRing {
+	io_uring ring;
+	bool initialized = false;
+	~FileDeviceRing();
+};
+
+/// @brief A device that stores the nvmefs layout in a regular file or block device. I/O bypasses the page cache with
+/// O_DIRECT and is submitted through an io_uring instance per thread, such that the metadata, temporary allocator and
+/// placement stack of nvmefs can be run and benchmarked without an NVMe device. When io_uring is not available, e.g.
+/// when it is disabled by a seccomp profile, commands are executed with pread and pwrite.
+class FileDevice final : public Device {
+public:
+	/// @brief Opens or creates the file at the device path of the config
+	/// @param config The configuration. A regular file is created or extended to device_size, unless it already
+	/// holds at least device_size bytes
+	FileDevice(const NvmeConfig &config);
+	~FileDevice();
+
+	/// @brief Writes data from the input buffer to the file. Partially written LBAs at the head and tail are read and
+	/// merged first, as O_DIRECT only transfers whole LBAs. Concurrent writes to the same partial LBA are serialized.
+	/// @return The amount of LBAs written
+	idx_t Write(void *buffer, const CmdContext &context) override;
+
+	/// @brief Reads data from the file into the output buffer
+	/// @return The amount of LBAs read
+	idx_t Read(void *buffer, const CmdContext &context) override;
+
+	/// @brief Writes a batch of commands, which are all submitted to the ring of the calling thread before completions
+	/// are reaped, keeping up to the queue depth of commands in flight. A command that partially writes an LBA that an
+	/// earlier command of the batch writes is only prepared after the earlier commands have completed.
+	/// @return The total amount of LBAs written
+	idx_t WriteBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	/// @brief Reads a batch of commands, which are all submitted to the ring of the calling thread before completions
+	/// are reaped, keeping up to the queue depth of commands in flight
+	/// @return The total amount of LBAs read
+	idx_t ReadBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	DeviceGeometry GetDeviceGeometry() override;
+
+	/// @brief Punches holes in a regular file, or discards the ranges of a block device
+	/// @return False if the file system or block device does not support it
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+
+	/// @brief Copies ranges to this or another FileDevice with copy_file_range, which file systems that support
+	/// reflinks complete without copying the data at all
+	/// @return False if the destination is not a FileDevice, or the kernel can not copy between the files
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+
+	/// @brief Fetches a buffer aligned for O_DIRECT from the buffer pool. Should be freed with FreeBuffer.
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+
+	string GetName() const override {
+		return "FileDevice";
+	}
+
+private:
+	/// @brief A command that transfers whole LBAs between an aligned buffer and the file
+	struct FileCommand {
+		data_ptr_t buffer;
+		idx_t nr_bytes;
+		idx_t offset;
+		//! The number of bytes transferred so far, as a command may complete partially
+		idx_t transferred;
+	};
+
+	/// @brief Checks if a command can be submitted directly from or into the caller's buffer
+	bool CanUseBufferDirectly(const void *buffer, const CmdContext &context);
+
+	/// @brief Appends the first and last LBA of a write to lbas if they are only partially written
+	void GetPartialLBAs(const CmdContext &context, vector<idx_t> &lbas);
+	/// @brief Checks if any of the LBAs is written by one of the commands
+	static bool IsWrittenByAny(const vector<idx_t> &lbas, const DeviceIORequest *requests, idx_t count);
+
+	/// @brief Prepares the aligned buffer of a write, merging partially written LBAs with their current contents
+	/// @return The buffer to write, which is either the caller's buffer or a buffer from the pool
+	data_ptr_t PrepareWriteBuffer(void *buffer, const CmdContext &context);
+
+	/// @brief Executes the commands and waits for all of them to complete
+	void Submit(FileCommand *commands, idx_t count, bool write);
+	void SubmitRing(FileDeviceRing &ring, FileCommand *commands, idx_t count, bool write);
+	void SubmitSync(FileCommand *commands, idx_t count, bool write);
+
+	/// @brief Fetches the ring of the calling thread, creating it on the first call
+	/// @return The ring, or nullptr if io_uring is not available
+	FileDeviceRing *GetRing();
+
+	/// @brief Opens the file and determines its geometry. A file that does not exist is created if the config has a
+	/// device_size, and removed again if it can not be used.
+	void OpenFile(const NvmeConfig &config);
+	/// @brief Determines the geometry of the opened file, extending a regular file to the device_size of the config
+	void LoadGeometry(const NvmeConfig &config);
+
+private:
+	const string dev_path;
+	int fd;
+	bool block_device;
+	DeviceGeometry geometry;
+	const idx_t queue_depth;
+	bool use_io_uring;
+	unique_ptr<DeviceBufferPool> buffer_pool;
+	//! Serializes the read-modify-write of partially written LBAs
+	PartialLBALocks lba_locks;
+	//! Distinguishes the device in the thread-local rings, as addresses may be reused
+	const idx_t id;
+	//! Expires when the device is destroyed, such that threads can release the rings of closed devices
+	shared_ptr<bool> alive;
+
+	struct ThreadRing {
+		weak_ptr<bool> alive;
+		unique_ptr<FileDeviceRing> ring;
+	};
+
+	static atomic<idx_t> device_counter;
+	static thread_local unordered_map<idx_t, ThreadRing> thread_rings;
+};
+
+} // namespace duckdb
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+#include "nvme_device.hpp"
+
+namespace duckdb {
+
+/// @brief Presents a conventional device followed by a zoned device as a single device, such that the metadata and the
+/// database are kept on a conventional namespace while the WAL and temporary files go to a Zoned Namespace. The LBAs
+/// of the conventional device come first and are reported as the conventional LBAs of the zone geometry, the LBAs of
+/// the zoned device follow. A command must not span both devices. Both devices must have the same LBA size.
+class HybridZonedDevice final : public Device {
+public:
+	HybridZonedDevice(unique_ptr<Device> conventional, unique_ptr<Device> zoned);
+
+	idx_t Write(void *buffer, const CmdContext &context) override;
+	idx_t Read(void *buffer, const CmdContext &context) override;
+	idx_t WriteBatch(const DeviceIORequest *requests, idx_t count) override;
+	idx_t ReadBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	DeviceGeometry GetDeviceGeometry() override;
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+	/// @brief Copies within the conventional device. Zones are only written sequentially, hence copies that involve
+	/// zones are not offloaded
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+
+	/// @brief Buffers are allocated by the conventional device, which both devices must be able to use for I/O
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+
+	/// @brief Reports the queues of both devices
+	vector<DeviceQueueStatistics> GetQueueStatistics() override;
+
+	bool GetZoneGeometry(DeviceZoneGeometry &geometry) override;
+	idx_t ZoneAppend(void *buffer, const CmdContext &context) override;
+	void ResetZone(idx_t zone_start_lba) override;
+	idx_t GetZoneWritePointer(idx_t zone_start_lba) override;
+
+	/// @brief The conventional device holds the database, hence it decides the data placement
+	bool GetFDPStatistics(DeviceFDPStatistics &statistics) override;
+	uint8_t GetPlacementIdentifier(const string &path, idx_t generation) override;
+	uint8_t GetHotPlacementIdentifier(const string &path) override;
+	void SetThreadCount(idx_t nr_threads) override;
+
+	string GetName() const override {
+		return "HybridZonedDevice(" + conventional->GetName() + ", " + zoned->GetName() + ")";
+	}
+
+private:
+	/// @brief Determines which device a command goes to
+	/// @param context The command
+	/// @param zoned_context Receives the command relative to the zoned device, if the command goes there. Commands are
+	/// NvmeCmdContexts, whose placement is kept
+	/// @return The device of the command
+	Device &Route(const CmdContext &context, NvmeCmdContext &zoned_context);
+
+	/// @brief Routes a batch of commands. Commands for the conventional device are submitted as one batch, followed by
+	/// the commands for the zoned device
+	idx_t SubmitBatch(const DeviceIORequest *requests, idx_t count, bool write);
+
+private:
+	unique_ptr<Device> conventional;
+	unique_ptr<Device> zoned;
+	//! The number of LBAs of the conventional device, which is where the zoned device starts
+	idx_t conventional_lbas;
+	DeviceGeometry geometry;
+	DeviceZoneGeometry zone_geometry;
+};
+
+} // namespace duckdb
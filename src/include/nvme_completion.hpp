@@ -0,0 +1,79 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief How a thread waits for the completion of its commands
+enum class NvmeWaitStrategy : uint8_t {
+	//! Poke the queue until the commands have completed
+	SPIN,
+	//! Poke the queue, yielding the CPU to other threads after a number of unsuccessful pokes
+	SPIN_YIELD,
+	//! Block on an eventfd that the pollers of the reactor signal when a command completes. Requires reactor threads,
+	//! as without them the completions are only reaped by the waiting thread itself
+	EVENTFD
+};
+
+/// @brief Status used to complete a command that could not be submitted
+static constexpr uint16_t NVME_SUBMIT_ERROR_STATUS = 0xFFFF;
+/// @brief Number of unsuccessful pokes before the SPIN_YIELD strategy starts yielding the CPU
+static constexpr idx_t NVME_SPIN_YIELD_THRESHOLD = 1 << 10;
+
+/// @brief Completion slot for one or more commands. The slot is owned by the submitter (typically on its stack) and
+/// handed to the command callback, hence no allocation is needed per command.
+struct NvmeCompletion {
+public:
+	/// @brief Creates a completion slot
+	/// @param nr_commands The number of commands that must complete before the slot is complete
+	/// @param event_fd Optional eventfd that is signalled on every command completion. -1 if not used
+	explicit NvmeCompletion(idx_t nr_commands = 1, int event_fd = -1);
+
+	/// @brief Marks a single command as completed
+	/// @param cqe_status The status field of the completion queue entry. 0 if the command succeeded
+	void Complete(uint16_t cqe_status);
+
+	/// @brief Checks if all commands have completed
+	bool IsComplete() const {
+		return remaining.load(std::memory_order_acquire) == 0;
+	}
+
+	/// @brief Number of commands that completed with a non-zero status
+	idx_t GetFailedCount() const {
+		return failed.load(std::memory_order_acquire);
+	}
+
+	/// @brief The status of the last failed command
+	uint16_t GetStatus() const {
+		return status.load(std::memory_order_acquire);
+	}
+
+	int GetEventFd() const {
+		return event_fd;
+	}
+
+	/// @brief Adds commands that must complete before the slot is complete
+	void AddCommands(idx_t nr_commands) {
+		remaining.fetch_add(nr_commands, std::memory_order_relaxed);
+	}
+
+	/// @brief Fetches the eventfd of the calling thread, creating it if it does not exist yet
+	static int GetThreadEventFd();
+
+	/// @brief Blocks until the eventfd has been signalled or the timeout expired, and resets the eventfd
+	/// @param event_fd The eventfd to wait on
+	/// @param timeout_us The maximum time to block in microseconds
+	static void WaitEventFd(int event_fd, idx_t timeout_us);
+
+	/// @brief Parses the name of a wait strategy (spin, spin_yield or eventfd). Unknown names throw an
+	/// InvalidInputException.
+	static NvmeWaitStrategy ParseWaitStrategy(const string &name);
+
+private:
+	atomic<idx_t> remaining;
+	atomic<idx_t> failed;
+	atomic<uint16_t> status;
+	const int event_fd;
+};
+
+} // namespace duckdb
@@ -4,26 +4,134 @@
 #include "duckdb/common/optional_idx.hpp"
 #include "duckdb/common/string_util.hpp"
 #include "device.hpp"
+#include "device_buffer_pool.hpp"
+#include "nvme_completion.hpp"
+#include "nvme_queue_registry.hpp"
+#include "nvme_reactor.hpp"
+#include "partial_lba_cache.hpp"
+#include "placement_policy.hpp"
+#include "nvmefs_config.hpp"
 #include <libxnvme.h>
 #include <mutex>
-#include <future>
-#include <chrono>
+#include <shared_mutex>
+#include <thread>
 
 namespace duckdb {
 
-typedef void *nvme_buf_ptr;
-static constexpr idx_t XNVME_QUEUE_DEPTH = 1 << 4;
-static constexpr std::chrono::milliseconds POKE_MAX_BACKOFF_TIME = std::chrono::milliseconds(200);
 static constexpr idx_t DATA_PLACEMENT_MODE = 2;
+static constexpr idx_t NVME_DWORD_ALIGNMENT = 4;
+//! The number of LBAs of a read or write command is a 16-bit 0-based field
+static constexpr idx_t NVME_MAX_COMMAND_LBAS = 1 << 16;
+//! A Dataset Management command holds up to 256 ranges of up to 2^32 - 1 LBAs each
+static constexpr idx_t NVME_MAX_DSM_RANGES = 256;
+static constexpr idx_t NVME_MAX_DSM_RANGE_LBAS = (1ULL << 32) - 1;
+//! A Copy command holds up to 128 source ranges in the descriptor buffer of xNVMe, of up to 2^16 LBAs each
+static constexpr idx_t NVME_MAX_COPY_RANGES = XNVME_SPEC_NVM_SCOPY_NENTRY_MAX;
+static constexpr idx_t NVME_MAX_COPY_RANGE_LBAS = 1 << 16;
+//! Log page identifiers of the FDP configurations and statistics, which are specific to an endurance group
+static constexpr uint8_t NVME_LOG_FDP_CONFIGURATIONS = 0x20;
+static constexpr uint8_t NVME_LOG_FDP_STATISTICS = 0x22;
+//! The zone append size limit (ZASL) is reported in units of the minimum memory page size, which is 4 KiB on the
+//! controllers we support
+static constexpr idx_t NVME_MIN_MEMORY_PAGE_SIZE = 4096;
+//! Zone state of a zone that has been written up to its capacity, whose write pointer is then undefined
+static constexpr uint8_t NVME_ZONE_STATE_FULL = 0xE;
 
 struct NvmeDeviceGeometry : public DeviceGeometry {};
+
 struct NvmeCmdContext : public CmdContext {
-	string filepath;
+	//! Index of the placement handle that writes are tagged with
+	uint8_t placement_identifier = 0;
+};
+
+/// @brief The dwords of a read or write that carry its length and data placement directive. Specified by the NVM
+/// Command Set Specification (revision 1.1, section 3.2.6):
+/// https://nvmexpress.org/specifications
+/// cdw12 holds the number of LBAs (0 indexed) in bits 0-15 and the directive type (dtype) in bits 20-23, cdw13 holds
+/// the directive specific value, which is the placement handle for data placement, in bits 16-31
+struct NvmeDirectiveFields {
+	uint32_t cdw12;
+	uint32_t cdw13;
+
+	/// @brief Encodes the fields. The number of LBAs must fit the 16 bits of cdw12, larger commands must be split
+	static NvmeDirectiveFields Encode(idx_t nr_lbas, uint8_t dtype, uint16_t placement_handle) {
+		D_ASSERT(nr_lbas > 0 && nr_lbas <= NVME_MAX_COMMAND_LBAS);
+		return NvmeDirectiveFields {static_cast<uint16_t>(nr_lbas - 1) | (static_cast<uint32_t>(dtype & 0xF) << 20),
+		                            static_cast<uint32_t>(placement_handle) << 16};
+	}
+
+	/// @brief Encodes the fields of a command as NvmeDevice submits it. Writes to an FDP device carry the data
+	/// placement directive, with the placement handle that the placement identifier of the command maps to. Other
+	/// commands carry no directive.
+	/// @param placement_handles The placement handle of every placement identifier, empty if FDP is not enabled
+	static NvmeDirectiveFields ForCommand(const NvmeCmdContext &context, bool write,
+	                                      const vector<uint16_t> &placement_handles) {
+		bool placement = write && !placement_handles.empty();
+		D_ASSERT(!placement || context.placement_identifier < placement_handles.size());
+		return Encode(context.nr_lbas, placement ? DATA_PLACEMENT_MODE : 0,
+		              placement ? placement_handles[context.placement_identifier] : 0);
+	}
+
+	idx_t GetLBACount() const {
+		return (cdw12 & 0xFFFF) + 1;
+	}
+
+	uint8_t GetDirectiveType() const {
+		return (cdw12 >> 20) & 0xF;
+	}
+
+	uint16_t GetPlacementHandle() const {
+		return cdw13 >> 16;
+	}
+};
+
+/// @brief The first and last LBA of a write if they are only partially written
+struct NvmePartialLBAs {
+	optional_idx head;
+	optional_idx tail;
 };
 
-class NvmeDevice : public Device {
+/// @brief The commands of a batch of writes. The partially written LBAs at the head and tail of the writes are merged
+/// into one write per LBA, and the whole LBAs in between are written as they are.
+struct NvmeWriteBatchPlan {
+	//! A write of whole LBAs from the data of a request
+	struct FullWrite {
+		NvmeCmdContext context;
+		const_data_ptr_t data;
+	};
+	//! Bytes of a request that are copied into a partially written LBA
+	struct Merge {
+		//! Index of the LBA in partial_writes
+		idx_t partial_index;
+		idx_t offset;
+		const_data_ptr_t data;
+		idx_t nr_bytes;
+	};
+
+	vector<FullWrite> full_writes;
+	//! Writes of a single LBA that one or more requests write partially
+	vector<NvmeCmdContext> partial_writes;
+	//! The merges in the order of the requests, such that later requests overwrite the bytes of earlier ones
+	vector<Merge> merges;
+	idx_t nr_lbas = 0;
+
+	/// @brief The LBAs of the partial writes
+	vector<idx_t> GetPartialLBAs() const;
+
+	/// @brief Copies the merges into the buffers of the partial writes, which hold the current contents of the LBAs
+	void ApplyMerges(const vector<data_ptr_t> &buffers) const;
+};
+
+/// @brief A Simple Copy command, which writes its source ranges back to back from its destination LBA on
+struct NvmeCopyCommand {
+	vector<DeviceLBARange> sources;
+	idx_t destination_lba;
+	idx_t nr_lbas;
+};
+
+class NvmeDevice final : public Device {
 public:
-	NvmeDevice(const string &device_path, const string &backend, const bool async, const idx_t max_threads);
+	NvmeDevice(const NvmeConfig &config);
 	~NvmeDevice();
 
 	/// @brief Writes data from the input buffer to the device at the specified LBA position
@@ -32,7 +140,8 @@ public:
 	/// @param nr_lbas The amount of LBAs to write
 	/// @param start_lab The LBA to start writing from
 	/// @param offset An offset into the LBA
-	/// @return The amount of LBAs written to the device
+	/// @return The amount of LBAs written to the device. Writes larger than the maximum data transfer size of the
+	/// device are split and submitted as a batch.
 	idx_t Write(void *buffer, const CmdContext &context) override;
 
 	/// @brief Reads data from the device at the specified LBA position into the output buffer
@@ -41,33 +150,152 @@ public:
 	/// @param nr_lbas The amount of LBAs to read
 	/// @param start_lab The LBA to start reading from
 	/// @param offset An offset into the LBA
-	/// @return The amount of LBAs read from the device
+	/// @return The amount of LBAs read from the device. Reads larger than the maximum data transfer size of the device
+	/// are split and submitted as a batch.
 	idx_t Read(void *buffer, const CmdContext &context) override;
 
+	/// @brief Writes a batch of commands. With an asynchronous backend all commands are submitted to the queue of the
+	/// calling thread before completions are reaped, keeping up to the queue depth of commands in flight.
+	/// Commands larger than the maximum data transfer size of the device are split into sub-commands first.
+	/// @param requests The commands to write
+	/// @param count The number of commands
+	/// @return The total amount of LBAs written to the device
+	idx_t WriteBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	/// @brief Reads a batch of commands. With an asynchronous backend all commands are submitted to the queue of the
+	/// calling thread before completions are reaped, keeping up to the queue depth of commands in flight.
+	/// Commands larger than the maximum data transfer size of the device are split into sub-commands first.
+	/// @param requests The commands to read
+	/// @param count The number of commands
+	/// @return The total amount of LBAs read from the device
+	idx_t ReadBatch(const DeviceIORequest *requests, idx_t count) override;
+
 	/// @brief Fetches the geometry of the device
 	/// @return The device geometry
 	DeviceGeometry GetDeviceGeometry() override;
 
+	/// @brief Deallocates ranges of LBAs with Dataset Management commands, batching up to 256 ranges per command
+	/// @param ranges The ranges to deallocate
+	/// @param count The number of ranges
+	/// @return True if the ranges were deallocated, false if the controller does not support Dataset Management
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+
+	/// @brief Copies ranges within the namespace with Simple Copy commands, split at the maximum source range count,
+	/// single source range length and copy length of the namespace
+	/// @return False if the destination is another device or the controller does not support the Copy command
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+
+	/// @brief Fetches a DMA-capable buffer from the device buffer pool. Should be freed with FreeBuffer.
+	/// @param nr_bytes The number of bytes to allocate (The allocated buffer might be larger)
+	/// @return Pointer to allocated device buffer
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+
+	/// @brief Returns the given device buffer to the device buffer pool
+	/// @param buffer The device buffer to free
+	/// @param nr_bytes The number of bytes that was requested when the buffer was allocated
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+
+	/// @brief Fetches the depth, window and completion latency of every queue
+	vector<DeviceQueueStatistics> GetQueueStatistics() override;
+
+	/// @brief Resizes the queue registry to one dedicated queue per thread
+	void SetThreadCount(idx_t nr_threads) override;
+
+	/// @brief Reads the FDP statistics log page and the status of the reclaim unit handles, and adds the bytes that
+	/// were written through every placement handle
+	bool GetFDPStatistics(DeviceFDPStatistics &statistics) override;
+
+	/// @brief Reports the zones of a Zoned Namespace. All zones of a namespace are sequential, hence there are no
+	/// conventional LBAs
+	bool GetZoneGeometry(DeviceZoneGeometry &geometry) override;
+
+	/// @brief Appends to a zone with Zone Append commands. Appends larger than the zone append size limit are split,
+	/// during which other appends are held back, such that the parts are contiguous
+	idx_t ZoneAppend(void *buffer, const CmdContext &context) override;
+
+	/// @brief Resets a zone with a Zone Management Send command
+	void ResetZone(idx_t zone_start_lba) override;
+
+	/// @brief Fetches the write pointer of a zone from a zone report
+	idx_t GetZoneWritePointer(idx_t zone_start_lba) override;
+
 	/// @brief Get the name of the device
 	/// @return Name of device
 	string GetName() const {
 		return "NvmeDevice";
 	}
 
-private:
-	/// @brief Determines which placment handler should be used for the given path
+	/// @brief Determines which placement handle should be used for the given path, according to the placement policy
 	/// @param path The path of the file that will be opened
-	/// @return A placement identifier
-	uint8_t GetPlacementIdentifierOrDefault(const string &path);
+	/// @return A placement identifier, which is 0 if the device does not have FDP enabled
+	uint8_t GetPlacementIdentifier(const string &path, idx_t generation) override;
+	uint8_t GetHotPlacementIdentifier(const string &path) override;
 
-	/// @brief Allocates a device specific buffer. Should be freed with FreeDeviceBuffer.
-	/// @param nr_bytes The number of bytes to allocate (The allocated buffer mighr be larger)
-	/// @return Pointer to allocated device buffer
-	nvme_buf_ptr AllocateDeviceBuffer(idx_t nr_bytes);
+	/// @brief Fetches the placement policy, or nullptr if the device does not have FDP enabled
+	optional_ptr<const PlacementPolicy> GetPlacementPolicy() const {
+		return placement_policy.get();
+	}
 
-	/// @brief Frees the given device buffer
-	/// @param buffer The device buffer to free
-	void FreeDeviceBuffer(nvme_buf_ptr buffer);
+	/// @brief Splits commands that exceed the maximum transfer size of a device into sub-commands, and drops commands
+	/// of 0 LBAs, which can not be submitted
+	/// @param requests The commands to split
+	/// @param count The number of commands
+	/// @param max_transfer_lbas The maximum number of LBAs per command
+	/// @param lba_size The size of an LBA in bytes
+	/// @param sub_contexts Holds the contexts of the sub-commands, which the sub-commands reference
+	/// @param sub_requests The resulting sub-commands, referencing slices of the original buffers
+	/// @return True if any command was split or dropped, in which case sub_requests should be submitted instead of
+	/// requests
+	static bool SplitRequests(const DeviceIORequest *requests, idx_t count, idx_t max_transfer_lbas, idx_t lba_size,
+	                          vector<NvmeCmdContext> &sub_contexts, vector<DeviceIORequest> &sub_requests);
+
+	/// @brief Determines which of the first and last LBA of a write are only partially written
+	static NvmePartialLBAs GetPartialLBAs(const CmdContext &context, idx_t lba_size);
+
+	/// @brief Plans the commands of a batch of writes, merging the partial writes to the same LBA
+	/// @param requests The writes, whose contexts must be NvmeCmdContexts
+	/// @param count The number of writes
+	/// @param lba_size The size of an LBA in bytes
+	static NvmeWriteBatchPlan PlanWriteBatch(const DeviceIORequest *requests, idx_t count, idx_t lba_size);
+
+	/// @brief Splits a copy into Simple Copy commands within the limits of the namespace. Ranges longer than a source
+	/// range are split over several source ranges, and a command ends once it holds max_ranges source ranges or
+	/// max_lbas LBAs
+	/// @param ranges The ranges to copy
+	/// @param count The number of ranges
+	/// @param destination_lba The first LBA that the ranges are copied to
+	/// @param max_ranges The maximum number of source ranges of a command (MSRC + 1)
+	/// @param max_range_lbas The maximum number of LBAs of a source range (MSSRL)
+	/// @param max_lbas The maximum number of LBAs of a command (MCL)
+	static vector<NvmeCopyCommand> PlanCopy(const DeviceLBARange *ranges, idx_t count, idx_t destination_lba,
+	                                        idx_t max_ranges, idx_t max_range_lbas, idx_t max_lbas);
+
+	/// @brief Determines the placement identifiers of the placement handles, one per reclaim unit handle
+	static vector<uint16_t> GetPlacementIdentifiers(const vector<xnvme_spec_ruhs_desc> &descriptors);
+
+	/// @brief Reports the usage of every placement handle
+	/// @param placement_identifiers The placement identifier of every placement handle
+	/// @param descriptors The status of the reclaim unit handles, in the order of the placement handles
+	/// @param bytes_written The bytes written through every placement handle
+	/// @param lba_size The size of an LBA in bytes
+	/// @param reclaim_unit_size The size of a reclaim unit in bytes, or 0 if it is unknown
+	static vector<DevicePlacementStatistics>
+	GetPlacementStatistics(const vector<uint16_t> &placement_identifiers,
+	                       const vector<xnvme_spec_ruhs_desc> &descriptors, const atomic<idx_t> *bytes_written,
+	                       idx_t lba_size, idx_t reclaim_unit_size);
+
+private:
+
+	/// @brief Checks if a command can be submitted directly from or into the caller's buffer without going through a
+	/// bounce buffer. This requires the command to cover whole LBAs and the buffer to be usable for DMA.
+	/// @param buffer The caller's buffer
+	/// @param context The command context
+	/// @return True if the buffer can be handed directly to the device
+	bool CanUseBufferDirectly(const void *buffer, const CmdContext &context);
+
+	/// @brief Determines the maximum number of LBAs per command from the maximum data transfer size (MDTS) of the
+	/// controller
+	idx_t LoadMaxTransferLBAs();
 
 	/// @brief Loads the geometry of the decvice
 	/// @return The device geometry
@@ -82,22 +310,126 @@ private:
 	idx_t ReadAsync(void *buffer, const CmdContext &context);
 	idx_t WriteAsync(void *buffer, const CmdContext &context);
 
-	void PrepareIOCmdContext(xnvme_cmd_ctx *ctx, const CmdContext &cmd_ctx, idx_t plid_idx, idx_t dtype, bool write);
+	/// @brief Submits all commands of a batch at once and waits for their completion
+	/// @param requests The commands to submit
+	/// @param count The number of commands
+	/// @param write Whether the commands are writes or reads
+	/// @return The total amount of LBAs read or written
+	idx_t SubmitBatchAsync(const DeviceIORequest *requests, idx_t count, bool write);
+
+	/// @brief Submits a batch of writes. Partially written LBAs at the head and tail of a write are merged with their
+	/// current contents, which are taken from the partial LBA cache or read in parallel with the fully written LBAs.
+	/// The partially written LBAs are locked until they have been written and cached.
+	/// @param requests The commands to write
+	/// @param count The number of commands
+	/// @return The total amount of LBAs written
+	idx_t SubmitWriteBatchAsync(const DeviceIORequest *requests, idx_t count);
+
+	/// @brief Submits commands to the queue leased by the calling thread and reaps their completions in a single loop.
+	/// In reactor mode the commands are handed to a poller instead, and the calling thread parks until they have
+	/// completed. Commands that fail, also on submission, are recorded in the completion slot.
+	/// @param commands The commands to submit
+	/// @param count The number of commands
+	/// @param completion The completion slot that the commands report to
+	void SubmitCommands(NvmeCommand *commands, idx_t count, NvmeCompletion &completion);
+
+	/// @brief The eventfd that completion slots should signal, or -1 if the thread does not block on completions
+	int GetCompletionEventFd();
+
+	/// @brief Throws if any command of the completion slot failed
+	void CheckCompletion(const NvmeCompletion &completion);
+
+	/// @brief Loads the current contents of a single LBA, from the partial LBA cache if possible
+	/// @param context The write that the LBA belongs to
+	/// @param lba The LBA to load
+	/// @param buffer Buffer of at least one LBA that receives the contents
+	void LoadPartialLBA(const NvmeCmdContext &context, idx_t lba, data_ptr_t buffer);
+
+	/// @brief Submits a single command to the given queue. The command's completion slot must account for the command
+	/// before it is submitted. If the command has a queue depth controller, the command is only submitted when the
+	/// window of the controller has room for it.
+	/// @param queue The queue to submit to
+	/// @param command The command to submit
+	/// @return 0 on success, -EBUSY or -EAGAIN when the queue or window is full and a negative error code otherwise
+	int SubmitCommand(xnvme_queue *queue, NvmeCommand &command);
+
+	/// @brief Reaps completions from the queue until all commands of the completion slot have completed. How the
+	/// thread waits in between pokes is decided by the configured wait strategy.
+	/// @param completion The completion slot to wait for
+	/// @param queue The queue that the commands were submitted to
+	void WaitForCompletion(NvmeCompletion &completion, xnvme_queue *queue);
+
+	void PrepareIOCmdContext(xnvme_cmd_ctx *ctx, const CmdContext &cmd_ctx, bool write);
 	bool CheckFDP();
+	/// @brief Loads the zone geometry and zone append size limit if the namespace is zoned
+	/// @return True if the namespace is zoned
+	bool LoadZoneGeometry();
+	/// @brief Checks the ONCS field of the controller for Dataset Management support
+	bool CheckDeallocate();
+	/// @brief Checks the ONCS field of the controller for Copy support, and loads the copy limits of the namespace
+	bool LoadCopyLimits();
 	void InitializePlacementHandles();
+	/// @brief Fetches the status of every reclaim unit handle that the namespace may use
+	vector<xnvme_spec_ruhs_desc> ReadReclaimUnitHandleStatus();
+	/// @brief Reads a log page of the endurance group of the namespace
+	/// @return False if the command failed
+	bool ReadLogPage(uint8_t log_identifier, data_ptr_t buffer, uint32_t nr_bytes);
+	/// @brief Reads the lifetime host bytes written, media bytes written and media bytes erased of the endurance group
+	bool ReadFDPStatisticsLog(idx_t &host_bytes_written, idx_t &media_bytes_written, idx_t &media_bytes_erased);
+	/// @brief Looks up the reclaim unit nominal size of the current FDP configuration
+	/// @return The size in bytes, or 0 if it could not be determined
+	idx_t LoadReclaimUnitSize();
+	/// @brief Accounts a write to the bytes written through a placement handle
+	void RecordPlacementWrite(idx_t plid_idx, idx_t nr_lbas) {
+		if (fdp) {
+			placement_bytes_written[plid_idx].fetch_add(nr_lbas * geometry.lba_size, std::memory_order_relaxed);
+		}
+	}
+	/// @brief Fetches an index of the calling thread, used to spread threads over the reactor pollers
 	idx_t GetThreadIndex();
 
 private:
-	map<string, uint8_t> allocated_placement_identifiers;
 	vector<uint16_t> placement_handlers;
+	unique_ptr<PlacementPolicy> placement_policy;
+	//! Bytes written through every placement handle since the device was opened
+	unique_ptr<atomic<idx_t>[]> placement_bytes_written;
+	//! Index of the FDP configuration in use, reported along with whether FDP is enabled
+	uint8_t fdp_configuration_index;
+	uint16_t endurance_group;
+	//! Reclaim unit nominal size in bytes, 0 if unknown
+	idx_t reclaim_unit_size;
+	idx_t initial_host_bytes_written;
+	idx_t initial_media_bytes_written;
 	xnvme_dev *device;
 	const string dev_path;
 	DeviceGeometry geometry;
+	idx_t max_transfer_lbas;
 	const string backend;
 	const bool async;
+	const bool spdk;
+	const NvmeWaitStrategy wait_strategy;
+	idx_t direct_io_alignment;
 	bool fdp;
-	vector<xnvme_queue *> queues;
+	bool deallocate;
+	bool copy;
+	//! Limits of a single Copy command: source ranges, LBAs per source range and LBAs in total
+	idx_t max_copy_ranges;
+	idx_t max_copy_range_lbas;
+	idx_t max_copy_lbas;
+	bool zoned;
+	DeviceZoneGeometry zone_geometry;
+	idx_t max_append_lbas;
+	//! Held shared by appends of a single command and exclusively by appends that are split
+	std::shared_mutex append_lock;
+	//! Queues of the threads that poll their own completions, absent in reactor mode
+	unique_ptr<NvmeQueueRegistry> queue_registry;
+	const idx_t queue_depth;
 	const idx_t max_threads;
+	unique_ptr<DeviceBufferPool> buffer_pool;
+	unique_ptr<NvmeReactor> reactor;
+	unique_ptr<PartialLBACache> lba_cache;
+	//! Serializes the read-modify-write of partially written LBAs
+	PartialLBALocks lba_locks;
 	atomic<idx_t> thread_id_counter;
 	static thread_local optional_idx index;
 };
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "nvme_completion.hpp"
+#include "nvme_reactor.hpp"
+#include "queue_depth_controller.hpp"
+
+#include <libxnvme.h>
+#include <functional>
+
+namespace duckdb {
+
+/// @brief Number of shared queues used by threads that could not lease a dedicated queue
+static constexpr idx_t NVME_SHARED_QUEUE_COUNT = 2;
+
+/// @brief A queue used by every thread that could not lease a dedicated queue. Submitters push their commands onto a
+/// lock-free stack, and whichever submitter claims the polling flag submits all pushed commands and reaps completions
+/// on behalf of the others.
+struct NvmeSharedQueue {
+	xnvme_queue *queue = nullptr;
+	unique_ptr<QueueDepthController> controller;
+	//! Commands pushed by submitters, linked through NvmeCommand::next in reverse order of submission
+	atomic<NvmeCommand *> submissions {nullptr};
+	//! Set while a submitter is polling the queue
+	atomic<bool> polling {false};
+	//! Commands that did not fit in the queue yet, only accessed while holding the polling flag
+	vector<NvmeCommand *> pending;
+};
+
+/// @brief Creates and destroys the queues of a NvmeQueueRegistry, such that the leasing of queues can be tested without
+/// a device
+struct NvmeQueueFunctions {
+	//! Creates a queue of the given depth, returning 0 on success and a negative errno otherwise
+	std::function<int(idx_t depth, xnvme_queue **queue)> init;
+	std::function<void(xnvme_queue *queue)> term;
+
+	/// @brief The functions that create queues on a device
+	static NvmeQueueFunctions ForDevice(xnvme_dev *device);
+};
+
+/// @brief The queue that a thread submits to. Either a dedicated queue, which only the thread itself uses, or a shared
+/// queue.
+struct NvmeQueueLease {
+	xnvme_queue *queue = nullptr;
+	QueueDepthController *controller = nullptr;
+	NvmeSharedQueue *shared = nullptr;
+};
+
+/// @brief Owns the xNVMe queues of the threads that poll their own completions. The queues are created up front and
+/// leased to threads on their first I/O. A lease is returned when the thread exits, such that the queue can be handed
+/// to another thread. Threads that find no free queue submit through a shared queue until a dedicated queue frees up.
+class NvmeQueueRegistry {
+public:
+	/// @brief Creates the registry and all of its queues
+	/// @param queue_functions The functions that create and destroy queues, usually NvmeQueueFunctions::ForDevice
+	/// @param nr_queues The number of dedicated queues, usually the number of threads
+	/// @param queue_depth The depth of every queue
+	/// @param target_latency_us The target completion latency of the queue depth controllers. 0 disables adaptation
+	/// @param submit_function Function used to submit a single command to a queue
+	NvmeQueueRegistry(NvmeQueueFunctions queue_functions, idx_t nr_queues, idx_t queue_depth, idx_t target_latency_us,
+	                  reactor_submit_function_t submit_function);
+	~NvmeQueueRegistry();
+
+	/// @brief Fetches the queue of the calling thread, leasing one on the first call. A thread that uses a shared
+	/// queue is moved to a dedicated queue once one is available.
+	NvmeQueueLease Acquire();
+
+	/// @brief Changes the number of dedicated queues. New queues are created immediately. Surplus queues are destroyed
+	/// immediately if they are free, and otherwise once their thread exits.
+	void Resize(idx_t nr_queues);
+
+	/// @brief Submits commands through a shared queue and waits until all of them have completed. The commands must
+	/// be registered with their completion slot beforehand.
+	void SubmitShared(NvmeSharedQueue &shared, NvmeCommand *commands, idx_t count, NvmeCompletion &completion);
+
+	/// @brief The number of dedicated queues that are not retired
+	idx_t GetQueueCount();
+
+	/// @brief Calls the callback with the owner and controller of every queue
+	void ForEachQueue(const std::function<void(const string &owner, const QueueDepthController &controller)> &callback);
+
+private:
+	struct Slot {
+		xnvme_queue *queue = nullptr;
+		unique_ptr<QueueDepthController> controller;
+		bool leased = false;
+		//! Set when the registry shrinks while the queue is leased, the queue is destroyed once it is returned
+		bool retired = false;
+	};
+
+	//! State shared with the thread-local leases, such that a thread exiting after the registry is destroyed can
+	//! detect it
+	struct State {
+		mutex lock;
+		vector<unique_ptr<Slot>> slots;
+		vector<idx_t> free_slots;
+		atomic<idx_t> nr_free {0};
+		bool closed = false;
+		//! Destroys the queues of retired slots that are released
+		std::function<void(xnvme_queue *queue)> term;
+
+		void Release(idx_t slot);
+	};
+
+	struct ThreadLease {
+		weak_ptr<State> state;
+		optional_idx slot;
+		//! The leased slot, which stays in place as slots are never removed from the state
+		Slot *slot_ptr = nullptr;
+		idx_t shared = 0;
+	};
+
+	struct ThreadLeases {
+		~ThreadLeases();
+		unordered_map<idx_t, ThreadLease> leases;
+	};
+
+	/// @brief Creates a queue for the slot. Must be called while holding the lock of the state.
+	void InitializeSlot(Slot &slot);
+	/// @brief Submits the pushed commands of a shared queue and reaps its completions
+	void PollShared(NvmeSharedQueue &shared);
+
+private:
+	NvmeQueueFunctions queue_functions;
+	const idx_t queue_depth;
+	const idx_t target_latency_us;
+	reactor_submit_function_t submit_function;
+	//! Distinguishes the registry in the thread-local leases, as addresses may be reused
+	const idx_t id;
+	shared_ptr<State> state;
+	vector<unique_ptr<NvmeSharedQueue>> shared_queues;
+	atomic<idx_t> shared_counter;
+
+	static atomic<idx_t> registry_counter;
+	static thread_local ThreadLeases thread_leases;
+};
+
+} // namespace duckdb
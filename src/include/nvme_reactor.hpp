@@ -0,0 +1,95 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+#include "nvme_completion.hpp"
+#include "queue_depth_controller.hpp"
+
+#include <libxnvme.h>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace duckdb {
+
+/// @brief Maximum time in microseconds that an idle poller blocks before checking for shutdown
+static constexpr idx_t NVME_REACTOR_IDLE_WAIT_US = 1000;
+
+/// @brief A command to be submitted to an xNVMe queue, together with the completion slot it reports to. The command
+/// is passed to the completion callback, hence it must stay in place until it has completed.
+struct NvmeCommand {
+	const CmdContext *context;
+	data_ptr_t buffer;
+	bool write;
+	NvmeCompletion *completion;
+	//! Controller of the queue that the command is submitted to, which is fed the completion latency
+	QueueDepthController *controller;
+	std::chrono::steady_clock::time_point submit_time;
+	//! Links the command into the submission stack of a shared queue
+	NvmeCommand *next;
+};
+
+/// @brief Submits a single command on the given queue. Returns 0 on success, -EBUSY or -EAGAIN when the queue is full
+/// and any other negative value on errors.
+typedef std::function<int(xnvme_queue *queue, NvmeCommand &command)> reactor_submit_function_t;
+
+/// @brief Dedicated poller threads that own the xNVMe queues. Submitters hand their commands to a poller and park on
+/// an eventfd, while the poller submits the commands, reaps completions in batches and wakes up the waiters.
+class NvmeReactor {
+public:
+	/// @brief Creates the reactor and starts its pollers
+	/// @param device The device to create queues for
+	/// @param nr_pollers The number of poller threads
+	/// @param cpus CPUs that the pollers are pinned to (round-robin). Empty if the pollers should not be pinned
+	/// @param queue_depth The depth of the queue owned by each poller
+	/// @param target_latency_us The target completion latency of the queue depth controllers. 0 disables adaptation
+	/// @param submit_function Function used by the pollers to submit a command
+	NvmeReactor(xnvme_dev *device, idx_t nr_pollers, const vector<idx_t> &cpus, idx_t queue_depth,
+	            idx_t target_latency_us, reactor_submit_function_t submit_function);
+	~NvmeReactor();
+
+	/// @brief Hands commands to a poller. The commands must be registered with their completion slot beforehand, and
+	/// must stay in place until they have completed.
+	/// @param commands The commands to submit
+	/// @param count The number of commands
+	/// @param hint Used to select the poller, e.g. the index of the submitting thread
+	void Submit(NvmeCommand *commands, idx_t count, idx_t hint);
+
+	/// @brief Blocks until all commands of the completion slot have been completed by a poller
+	static void Wait(NvmeCompletion &completion);
+
+	idx_t GetPollerCount() const {
+		return pollers.size();
+	}
+
+	/// @brief Fetches the queue depth controller of a poller
+	const QueueDepthController &GetController(idx_t poller) const {
+		return *pollers[poller]->controller;
+	}
+
+	/// @brief Parses a comma separated list of CPUs and ranges of CPUs, e.g. "2,3" or "0-3,8". Malformed entries and
+	/// CPUs that are listed twice throw an InvalidInputException
+	static vector<idx_t> ParseCpuList(const string &cpus);
+
+private:
+	struct Poller {
+		xnvme_queue *queue = nullptr;
+		unique_ptr<QueueDepthController> controller;
+		std::thread thread;
+		mutex submission_lock;
+		vector<NvmeCommand *> submissions;
+		int wake_fd = -1;
+	};
+
+	/// @brief Stops the pollers that were started and releases the queues and eventfds of all pollers
+	void Stop();
+	void Run(Poller &poller, optional_idx cpu);
+	void SubmitPending(Poller &poller, vector<NvmeCommand *> &pending);
+
+private:
+	reactor_submit_function_t submit_function;
+	vector<unique_ptr<Poller>> pollers;
+	atomic<bool> shutdown;
+};
+
+} // namespace duckdb
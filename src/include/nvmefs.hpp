@@ -4,18 +4,33 @@
 #include "duckdb/common/file_system.hpp"
 #include "duckdb/common/map.hpp"
 
+#include "background_deallocator.hpp"
+#include "block_checksum_table.hpp"
+#include "temporary_block_compressor.hpp"
 #include "device.hpp"
+#include "emulated_device.hpp"
+#include "file_device.hpp"
+#include "hybrid_zoned_device.hpp"
 #include "nvme_device.hpp"
 #include "nvmefs_config.hpp"
+#include "region_device.hpp"
+#include "scan_readahead.hpp"
 #include "temporary_file_metadata_manager.hpp"
+#include "write_frequency_tracker.hpp"
+#include "zoned_write_ahead_log.hpp"
 
 namespace duckdb {
 
 constexpr idx_t NVMEFS_GLOBAL_METADATA_LOCATION = 0;
 constexpr char NVMEFS_MAGIC_BYTES[] = "NVMEFS";
+//! Version of the layout of GlobalMetadata. The first layout had no version and ended after the WAL location.
+constexpr uint64_t NVMEFS_METADATA_VERSION = 2;
 const string NVMEFS_PATH_PREFIX = "nvmefs://";
 const string NVMEFS_TMP_DIR_PATH = "nvmefs:///tmp";
 const string NVMEFS_GLOBAL_METADATA_PATH = "nvmefs://.global_metadata";
+//! Data that the device can not copy itself is copied through host memory in batches of commands of this size
+constexpr idx_t NVMEFS_COPY_COMMAND_SIZE = 1ULL << 20;
+constexpr idx_t NVMEFS_COPY_BATCH_SIZE = 16;
 
 enum MetadataType { DATABASE, WAL, TEMPORARY };
 
@@ -29,6 +44,22 @@ struct GlobalMetadata {
 
 	uint64_t db_location;
 	uint64_t wal_location;
+
+	//! The fields below are only valid if this equals NVMEFS_METADATA_VERSION
+	uint64_t version;
+	//! First LBA of the checksums of the WAL, which are kept before the WAL if block checksums were enabled when the
+	//! database was created. 0 if there are none.
+	uint64_t checksum_start;
+	//! The WAL location up to which the persisted checksums are valid
+	uint64_t checksum_location;
+};
+
+/// @brief Outcome of cloning the database to another device
+struct NvmeCloneStatistics {
+	idx_t database_bytes = 0;
+	idx_t wal_bytes = 0;
+	//! Whether all data was copied by the device, rather than through host memory
+	bool offloaded = true;
 };
 
 struct TemporaryFileMetadata {
@@ -53,8 +84,11 @@ public:
 	void Close() override;
 
 private:
-	unique_ptr<CmdContext> PrepareWriteCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset);
-	unique_ptr<CmdContext> PrepareReadCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset);
+	/// @brief Builds the command for a range of the file
+	/// @param nr_bytes The number of bytes to read or write
+	/// @param start_lba The first LBA of the range
+	/// @param offset Offset into the first LBA
+	NvmeCmdContext PrepareCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset);
 
 	/// @brief Calculates the amount of LBAs required to store the given number of bytes
 	/// @param nr_bytes The number of bytes to store
@@ -66,6 +100,21 @@ private:
 
 private:
 	idx_t cursor_offset;
+	idx_t lba_size;
+	//! log2 of the LBA size, such that LBA math are shifts and masks
+	idx_t lba_shift;
+
+	//! Resolved once when the file is opened, such that the I/O path does not need to inspect the path
+	MetadataType type;
+	//! First and last LBA of the region that holds files of this type
+	idx_t region_start;
+	idx_t region_end;
+	uint8_t placement_identifier;
+	//! Placement of the ranges of a database file that are rewritten often
+	uint8_t hot_placement_identifier;
+	//! Metadata of a temporary file. Resolved on first use if the file did not exist yet when it was opened, and
+	//! resolved again if the file was deleted since
+	shared_ptr<TempFileMetadata> temp_file;
 };
 
 class NvmeFileSystem : public FileSystem {
@@ -100,36 +149,186 @@ public:
 
 	Device &GetDevice();
 
+	/// @brief Fetches the background deallocator, if background deallocation is enabled
+	optional_ptr<BackgroundDeallocator> GetDeallocator();
+
+	/// @brief Fetches the tracker of rewrites to the database region, if write tracking is enabled and a database is
+	/// attached
+	optional_ptr<WriteFrequencyTracker> GetWriteFrequencyTracker();
+
+	/// @brief Fetches the checksums of the temporary and WAL data, if block checksums are enabled and a database is
+	/// attached
+	optional_ptr<BlockChecksumTable> GetBlockChecksums();
+
+	/// @brief Fetches the compressor of temporary blocks, if temporary compression is enabled
+	optional_ptr<TemporaryBlockCompressor> GetTemporaryBlockCompressor();
+
+	/// @brief Fetches the readahead of database scans, if readahead is enabled and a database is attached
+	optional_ptr<ScanReadahead> GetScanReadahead();
+
+	/// @brief Clones the database and its WAL to the region at the given offset of the device at the given path, which
+	/// is opened with the backend of this file system. On the device of this file system, the clone takes a region of
+	/// the size of the region of the database, which must not overlap it. See CloneDatabase(Device &)
+	/// @param target_path The device to clone to
+	/// @param target_offset The byte offset of the region of the clone, a multiple of the LBA size
+	NvmeCloneStatistics CloneDatabase(const string &target_path, idx_t target_offset = 0);
+
+	/// @brief Clones the database and its WAL to the same LBAs of another device, which can then be attached as a copy
+	/// of the database. The used LBAs are copied by the device where possible, and through host memory otherwise. The
+	/// metadata is copied last, such that an interrupted clone is not recognized as a database. The clone reflects the
+	/// writes that completed before it started, hence the database should be checkpointed first.
+	/// @param target The device to clone to, which must have the same LBA size and room for the layout of the database.
+	/// A RegionDevice of the device of the database must not overlap the region of the database
+	NvmeCloneStatistics CloneDatabase(Device &target);
+
 	string GetName() const {
 		return "NvmeFileSystem";
 	}
 
+	/// @brief Determines the kind of a file from its path
+	/// @throws InvalidInputException if the path is not a database, WAL or temporary file
+	static MetadataType GetMetadataType(const string &filename);
+
 private:
+	/// @brief Creates the device selected by the backend of the config, narrowed to the region of the config if there
+	/// is one, combined with the zoned namespace of the config if there is one, and wrapped in an emulated SSD if the
+	/// config names a device profile
+	static unique_ptr<Device> CreateDevice(const NvmeConfig &config);
+	/// @brief Converts the offset or size of a region to LBAs
+	/// @throws InvalidInputException if it is not a multiple of the LBA size
+	static idx_t GetRegionLBAs(idx_t nr_bytes, idx_t lba_size, const string &option);
 	bool TryLoadMetadata();
+	/// @brief Resizes the per-thread resources of the device if the number of threads of the database has changed,
+	/// e.g. through SET threads
+	void SyncThreadCount(optional_ptr<FileOpener> opener);
+	/// @brief Creates the manager of the temporary region, which hands freed blocks to the background deallocator
+	unique_ptr<TemporaryFileMetadataManager> CreateTempMetaManager(idx_t tmp_start);
+	/// @brief Creates the tracker of rewrites to the database region, or nullptr if write tracking is disabled or hot
+	/// ranges share the placement handle of the database
+	unique_ptr<WriteFrequencyTracker> CreateWriteFrequencyTracker(const GlobalMetadata &global);
+	/// @brief Creates the checksums of the WAL and temporary region, or nullptr if block checksums are disabled
+	unique_ptr<BlockChecksumTable> CreateChecksumTable(const GlobalMetadata &global);
+	/// @brief Creates the readahead of the database region, or nullptr if readahead is disabled
+	unique_ptr<ScanReadahead> CreateScanReadahead(const GlobalMetadata &global);
+	/// @brief Verifies the checksums of the LBAs that a read of a WAL or temporary file covers
+	void VerifyChecksums(const NvmeFileHandle &handle, const CmdContext &context, const void *buffer);
+	/// @brief Records the checksums of a write to the WAL in the zones, by the LBAs that the WAL bytes would take on a
+	/// conventional device
+	void RecordZonedWALChecksums(const void *buffer, idx_t nr_bytes, idx_t location);
+	/// @brief Verifies the checksums of a read of the WAL in the zones, see RecordZonedWALChecksums
+	void VerifyZonedWALChecksums(const NvmeFileHandle &handle, const void *buffer, idx_t nr_bytes, idx_t location);
+	/// @brief Marks the checksums of the WAL from an LBA on as changed since they were last persisted
+	void MarkChecksumsDirty(idx_t start_lba);
+	/// @brief Writes the checksums of the WAL that changed since they were last persisted to the checksum region, and
+	/// records up to where the persisted checksums are valid in the metadata
+	void PersistChecksums(GlobalMetadata &global);
+	/// @brief Loads the persisted checksums of the WAL into the checksum table
+	void LoadChecksums(const GlobalMetadata &global);
+	/// @brief The LBA after the database region, which ends before the checksum region if there is one
+	static idx_t GetDatabaseEnd(const GlobalMetadata &global);
+	/// @brief Creates the WAL in the zones between the start of the WAL and the temporary region
+	unique_ptr<ZonedWriteAheadLog> CreateZonedWriteAheadLog(const GlobalMetadata &global);
+	/// @brief Resets the zones of the temporary region that hold data from before the file system was opened
+	void ResetTemporaryZones(const GlobalMetadata &global);
 	void InitializeMetadata(const string &filename);
 	unique_ptr<GlobalMetadata> ReadMetadata();
 	void WriteMetadata(GlobalMetadata &global);
-	void UpdateMetadata(CmdContext &Context);
-	MetadataType GetMetadataType(const string &filename);
-	idx_t GetLBA(const string &filename, idx_t nr_bytes, idx_t location, idx_t nr_lbas);
+	void UpdateMetadata(NvmeFileHandle &handle, const CmdContext &context);
+
+	/// @brief Caches the LBA size of the device, and whether the I/O path can call the device through its concrete
+	/// type. Called once when the file system is created.
+	void BindDevice();
+
+	/// @brief The I/O path, specialized on the device type such that calls to NvmeDevice are direct
+	template <class DEVICE>
+	void ReadInternal(DEVICE &dev, NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location);
+	template <class DEVICE>
+	void WriteInternal(DEVICE &dev, NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location);
+	/// @brief Issues a read or write of LBAs that have already been resolved from a location in the file
+	template <class DEVICE>
+	void ReadCommand(DEVICE &dev, NvmeFileHandle &fh, void *buffer, NvmeCmdContext &cmd_ctx);
+	template <class DEVICE>
+	void WriteCommand(DEVICE &dev, NvmeFileHandle &fh, void *buffer, NvmeCmdContext &cmd_ctx);
+
+	/// @brief Whether the blocks of a file are compressed, which are those of the temporary files of uncompressed
+	/// blocks when temporary compression is enabled
+	bool IsCompressedTemporaryFile(NvmeFileHandle &handle);
+	/// @brief Reads a block of a temporary file, decompressing it if it is stored compressed
+	void ReadCompressedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location);
+	/// @brief Compresses a block of a temporary file and writes it to a slot of its compressed size
+	void WriteCompressedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location);
+
+	/// @brief Appends a block of a temporary file to the last zone of the file and maps it to where it landed
+	void WriteZonedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location);
+
+	/// @brief Resolves the type, region and placement of a file, and the metadata of a temporary file
+	void ResolveHandle(NvmeFileHandle &handle);
+
+	/// @brief Binds a handle to the metadata of its temporary file, whose generation determines the placement
+	void ResolveTemporaryFile(NvmeFileHandle &handle, shared_ptr<TempFileMetadata> temp_file);
+
+	/// @brief Fetches the metadata of a temporary file, resolving it if the handle was opened before the file existed
+	/// or the file was deleted since
+	TempFileMetadata &GetTemporaryFile(NvmeFileHandle &handle);
+
+	/// @brief Copies ranges of LBAs to another place on the device or to another device, with the device if it can,
+	/// and through host memory otherwise
+	/// @return True if the device copied the ranges
+	bool CopyLBAs(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba);
+
+	/// @brief Overwrites a range of a file with zeros. Used to trim partial LBAs, or whole ranges if the device does
+	/// not support deallocation
+	/// @param handle The file to trim
+	/// @param offset_bytes Offset of the range relative to the file pointer
+	/// @param length_bytes Length of the range in bytes
+	void TrimWithZeros(FileHandle &handle, idx_t offset_bytes, idx_t length_bytes);
+
+	/// @brief Maps a location in a file to the LBA that holds it, allocating a block for temporary files
+	/// @param handle The file
+	/// @param location Byte offset in the file
+	/// @param nr_lbas The number of LBAs that will be read or written
+	idx_t GetLBA(NvmeFileHandle &handle, idx_t location, idx_t nr_lbas);
 
 	/// @brief Checks that the start_lba is within the assigned metadata range and that lba_start+lba_count is within
 	/// the assigned metadata range
-	/// @param filename name of the file to check
+	/// @param handle The file to check
 	/// @param start_lba Start LBA of the IO operation to be performed
 	/// @param lba_count Number of LBAs to be read/written
 	/// @return True if it is in range, false otherwise
-	bool IsLBAInRange(const string &filename, idx_t start_lba, idx_t lba_count);
+	bool IsLBAInRange(const NvmeFileHandle &handle, idx_t start_lba, idx_t lba_count);
 
 private:
 	Allocator &allocator;
+	//! The configuration that the device was opened with, used to open the targets of clones
+	const NvmeConfig config;
 	unique_ptr<GlobalMetadata> metadata;
 	unique_ptr<Device> device;
+	//! The device if it is an NvmeDevice, used for direct calls from the I/O path
+	NvmeDevice *nvme_device;
+	idx_t lba_size;
+	idx_t lba_shift;
 	unique_ptr<TemporaryFileMetadataManager> temp_meta_manager;
+	unique_ptr<BackgroundDeallocator> deallocator;
+	unique_ptr<WriteFrequencyTracker> write_tracker;
+	unique_ptr<BlockChecksumTable> checksums;
+	//! The first LBA of the WAL whose checksum changed since the checksums were last persisted
+	atomic<idx_t> checksums_dirty_lba;
+	unique_ptr<TemporaryBlockCompressor> temp_compressor;
+	unique_ptr<ScanReadahead> readahead;
+	//! Whether the device is zoned, in which case the WAL and temporary files are stored in zones
+	bool zoned;
+	DeviceZoneGeometry zone_geometry;
+	unique_ptr<ZonedWriteAheadLog> zoned_wal;
 	atomic<idx_t> db_location;
 	atomic<idx_t> wal_location;
 	idx_t max_temp_size;
 	idx_t max_wal_size;
+	//! Size of the extents that temporary files are grouped in
+	idx_t temp_extent_size;
+	idx_t hot_write_threshold;
+	idx_t write_tracking_range_size;
+	//! The number of threads that the device was last sized for
+	atomic<idx_t> thread_count;
 	static std::recursive_mutex temp_lock;
 };
 } // namespace duckdb
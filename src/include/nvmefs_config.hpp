@@ -6,6 +6,28 @@
 
 namespace duckdb {
 
+/// @brief Depth of the xNVMe queues used for asynchronous I/O, unless configured otherwise
+static constexpr idx_t NVMEFS_DEFAULT_QUEUE_DEPTH = 1 << 4;
+
+/// @brief Size of the extents that temporary files are allocated in, unless configured otherwise. Matches the reclaim
+/// unit size of common FDP devices
+static constexpr idx_t NVMEFS_DEFAULT_TEMP_EXTENT_SIZE = 64ULL << 20;
+/// @brief Size of the first extent of a temporary file. Later extents double up to the configured extent size, such
+/// that small files do not reserve a whole extent each
+static constexpr idx_t NVMEFS_TEMP_INITIAL_EXTENT_SIZE = 1ULL << 20;
+
+/// @brief Size of the database ranges whose rewrites are counted, unless configured otherwise
+static constexpr idx_t NVMEFS_DEFAULT_WRITE_TRACKING_RANGE_SIZE = 1ULL << 20;
+/// @brief Decayed number of rewrites from which a database range is hot, unless configured otherwise
+static constexpr idx_t NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD = 4;
+
+/// @brief ZSTD level that temporary blocks are compressed with, unless configured otherwise. Negative levels trade
+/// ratio for LZ4-like speed
+static constexpr int64_t NVMEFS_DEFAULT_TEMP_COMPRESSION_LEVEL = 1;
+
+/// @brief Backend that stores the nvmefs layout in a regular file or block device instead of an NVMe namespace
+static constexpr char NVMEFS_FILE_BACKEND[] = "file";
+
 struct CreateSecretInput;
 class CreateSecretFunction;
 
@@ -18,9 +40,44 @@ struct NvmeConfig {
 	string device_path;
 	string backend;
 	bool async;
+	//! Maximum number of FDP placement handles to use, 0 uses all handles reported by the device
+	uint64_t plhdls = 0;
+	//! Overrides of the default placement policy, as category=handle pairs
+	string fdp_placement;
 	uint64_t max_temp_size;
 	uint64_t max_wal_size;
 	uint64_t max_threads;
+	uint64_t hugepage_arena_size = 0;
+	string wait_strategy = "spin";
+	uint64_t reactor_threads = 0;
+	string reactor_cpus;
+	uint64_t queue_depth = NVMEFS_DEFAULT_QUEUE_DEPTH;
+	uint64_t queue_target_latency_us = 0;
+	bool background_deallocation = false;
+	//! Whether temporary and WAL data is checksummed with CRC32C when written and verified when read
+	bool block_checksums = false;
+	//! Size in bytes of the extents that the blocks of a temporary file are grouped in
+	uint64_t temp_extent_size = NVMEFS_DEFAULT_TEMP_EXTENT_SIZE;
+	//! Decayed number of rewrites from which a database range is hot, 0 disables write tracking. Writes are only
+	//! tracked when the database and its hot ranges have different placement handles
+	uint64_t hot_write_threshold = NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD;
+	uint64_t write_tracking_range_size = NVMEFS_DEFAULT_WRITE_TRACKING_RANGE_SIZE;
+	//! Compression of uncompressed temporary blocks, `none` or `zstd`
+	string temp_compression = "none";
+	int64_t temp_compression_level = NVMEFS_DEFAULT_TEMP_COMPRESSION_LEVEL;
+	//! Size in bytes of the host memory that sequential database reads are prefetched into, 0 disables readahead
+	uint64_t readahead_size = 0;
+	//! Size in bytes that a regular file used with the file backend is created with
+	uint64_t device_size = 0;
+	//! Byte offset of the region of the device that holds the database, such that a device can hold several databases,
+	//! e.g. a database and its clones. Must be a multiple of the LBA size
+	uint64_t region_offset = 0;
+	//! Size in bytes of the region that holds the database, 0 for the rest of the device
+	uint64_t region_size = 0;
+	//! Path of a device profile. When set, the device is wrapped in an emulated SSD with the profile's performance
+	string emulation_profile;
+	//! Path of a Zoned Namespace that holds the WAL and temporary files, while the device path holds the database
+	string zns_device_path;
 };
 
 class NvmeConfigManager {
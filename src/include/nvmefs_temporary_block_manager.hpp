@@ -16,6 +16,7 @@ public:
 	idx_t GetSizeInBytes();
 	idx_t GetStartLBA();
 	idx_t GetEndLBA();
+	idx_t GetLBAAmount();
 
 	bool IsFree();
 
@@ -39,6 +40,8 @@ public:
 
 public:
 	TemporaryBlock *AllocateBlock(idx_t lba_amount);
+	/// @brief Same as AllocateBlock, but returns nullptr instead of throwing when no free block is large enough
+	TemporaryBlock *TryAllocateBlock(idx_t lba_amount);
 	void FreeBlock(TemporaryBlock *block);
 
 private:
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief Number of LBAs kept by the partial LBA cache
+static constexpr idx_t PARTIAL_LBA_CACHE_CAPACITY = 64;
+/// @brief Number of locks that partially written LBAs are hashed onto
+static constexpr idx_t PARTIAL_LBA_LOCK_STRIPES = 64;
+
+/// @brief Keeps the contents of LBAs that were recently written partially, e.g. the tail of the WAL or the global
+/// metadata. A following partial write to the same LBA can then be merged with the cached contents instead of reading
+/// the LBA from the device first. Entries are evicted in FIFO order.
+///
+/// The cache must mirror the device, hence every write must either insert the written LBA or invalidate it.
+class PartialLBACache {
+public:
+	/// @brief Creates a cache
+	/// @param lba_size The size of a single LBA in bytes
+	/// @param capacity The number of LBAs that can be cached
+	explicit PartialLBACache(idx_t lba_size, idx_t capacity = PARTIAL_LBA_CACHE_CAPACITY);
+
+	/// @brief Copies the cached contents of an LBA into the buffer
+	/// @param lba The LBA to look up
+	/// @param buffer Buffer of at least one LBA that receives the contents
+	/// @return True if the LBA was cached
+	bool Lookup(idx_t lba, data_ptr_t buffer);
+
+	/// @brief Caches the contents of an LBA that has been written to the device, replacing an older entry
+	/// @param lba The written LBA
+	/// @param buffer The contents of the whole LBA
+	void Insert(idx_t lba, const_data_ptr_t buffer);
+
+	/// @brief Drops cached LBAs within a range that is about to be overwritten
+	/// @param start_lba The first LBA of the range
+	/// @param nr_lbas The number of LBAs in the range
+	void Invalidate(idx_t start_lba, idx_t nr_lbas);
+
+private:
+	const idx_t lba_size;
+	const idx_t capacity;
+	mutex lock;
+	//! Maps a cached LBA to its slot
+	unordered_map<idx_t, idx_t> slots;
+	//! The LBA held by every slot, or INVALID_INDEX if the slot is free
+	vector<idx_t> slot_lbas;
+	unique_ptr<data_t[]> storage;
+	idx_t next_victim;
+	//! Bounds of the cached LBAs, allowing writes outside of them to skip the lock
+	atomic<idx_t> lowest_lba;
+	atomic<idx_t> highest_lba;
+};
+
+/// @brief Serializes the read-modify-write of partially written LBAs. A writer locks the LBAs that it merges with their
+/// current contents from before it reads them until it has written them and updated the PartialLBACache, such that
+/// concurrent partial writes to disjoint bytes of the same LBA are applied one after the other instead of overwriting
+/// each other, and the cache holds the contents of the last write. LBAs are hashed onto a fixed number of locks, which
+/// are taken in ascending order, hence writers that lock overlapping sets of LBAs do not deadlock.
+class PartialLBALocks {
+public:
+	/// @brief Holds the locks of a set of LBAs until it is destroyed
+	class Guard {
+	public:
+		Guard(PartialLBALocks &locks, vector<idx_t> stripes);
+		Guard(Guard &&other) noexcept;
+		Guard(const Guard &) = delete;
+		Guard &operator=(const Guard &) = delete;
+		~Guard();
+
+	private:
+		PartialLBALocks *locks;
+		//! The locked stripes in ascending order
+		vector<idx_t> stripes;
+	};
+
+	/// @brief Locks a set of LBAs, blocking while other writers hold any of them
+	/// @param lbas The LBAs to lock, which may contain duplicates
+	Guard Lock(const vector<idx_t> &lbas);
+
+private:
+	mutex stripes[PARTIAL_LBA_LOCK_STRIPES];
+};
+
+} // namespace duckdb
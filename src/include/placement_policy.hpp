@@ -0,0 +1,81 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief Kinds of data that are kept on separate placement handles
+enum class PlacementCategory : uint8_t {
+	DATABASE = 0,
+	WAL = 1,
+	METADATA = 2,
+	//! Temporary files holding variable sized blocks (S32K to S224K), which are typically short-lived
+	TEMP_SMALL = 3,
+	//! Temporary files holding default sized blocks, e.g. spilled hash tables and sorts
+	TEMP_LARGE = 4,
+	//! Ranges of the database that are rewritten often, e.g. DuckDB metadata and frequently updated row groups
+	DATABASE_HOT = 5
+};
+
+static constexpr idx_t PLACEMENT_CATEGORY_COUNT = 6;
+
+/// @brief Maps the categories of data to the placement handles of an FDP device. By default, the categories are spread
+/// over the available handles such that temporary data is separated from the database first, then the WAL from the
+/// database, the two temporary size classes from each other, the global metadata from the database and finally the
+/// hot ranges of the database from the cold ones.
+///
+/// The defaults can be overridden with a comma separated list of category=handle pairs, where the categories are
+/// db, wal, metadata, tmp_small, tmp_large and db_hot, e.g. "db=0,wal=1,tmp_small=2,tmp_large=2".
+///
+/// Handles that no category is mapped to are shared by the temporary files. Successive generations of temporary files
+/// rotate over their category's handle and the shared handles, such that files that are written at the same time, and
+/// hence deleted at different times, do not fill the same reclaim units.
+class PlacementPolicy {
+public:
+	/// @brief Creates a policy
+	/// @param nr_handles The number of placement handles that can be used, at least 1
+	/// @param overrides Comma separated category=handle pairs that replace the defaults. May be empty
+	PlacementPolicy(idx_t nr_handles, const string &overrides = "");
+
+	/// @brief Fetches the placement handle of a category
+	uint8_t GetPlacementIdentifier(PlacementCategory category) const {
+		return placement_identifiers[static_cast<idx_t>(category)];
+	}
+
+	/// @brief Fetches the placement handle of a temporary file
+	/// @param category TEMP_SMALL or TEMP_LARGE
+	/// @param generation The creation order of the file
+	uint8_t GetTemporaryPlacementIdentifier(PlacementCategory category, idx_t generation) const;
+
+	/// @brief Fetches the placement handle of the file at the given path
+	/// @param path The path of the file
+	/// @param generation The creation order of a temporary file, 0 for other files
+	uint8_t GetFilePlacementIdentifier(const string &path, idx_t generation) const;
+
+	/// @brief Fetches the placement handle of the ranges of the file at the given path that are rewritten often, which
+	/// differs from the handle of the file for the database only
+	uint8_t GetHotFilePlacementIdentifier(const string &path) const;
+
+	/// @brief Determines the category of the file at the given path, which must be a path that NvmeFileSystem accepts
+	static PlacementCategory Classify(const string &path);
+
+	/// @brief Formats the policy as category=handle pairs, in the format accepted as overrides
+	string ToString() const;
+
+	idx_t GetHandleCount() const {
+		return nr_handles;
+	}
+
+private:
+	void ApplyOverrides(const string &overrides);
+	void InitializeSharedIdentifiers();
+	static PlacementCategory ParseCategory(const string &name);
+
+private:
+	idx_t nr_handles;
+	uint8_t placement_identifiers[PLACEMENT_CATEGORY_COUNT];
+	//! Handles that no category is mapped to, which temporary files rotate over
+	vector<uint8_t> shared_identifiers;
+};
+
+} // namespace duckdb
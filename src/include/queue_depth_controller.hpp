@@ -0,0 +1,65 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief Weight of a new latency sample in the moving average of the completion latency
+static constexpr double QUEUE_LATENCY_EWMA_WEIGHT = 0.125;
+/// @brief Smallest window that the controller narrows a queue to
+static constexpr idx_t QUEUE_MIN_WINDOW = 1;
+
+/// @brief Controls the number of commands that may be in flight on a single queue. Once per round (a window worth of
+/// completions), the window is widened by one command if the average completion latency is below the target, and
+/// halved if it is above the target. Without a target latency, the window is fixed at the maximum depth.
+///
+/// The controller is updated by the thread that owns the queue, while the statistics may be read from any thread.
+class QueueDepthController {
+public:
+	/// @brief Creates a controller
+	/// @param max_depth The depth of the queue, which is the upper bound of the window
+	/// @param target_latency_us The target completion latency in microseconds. 0 disables adaptation
+	QueueDepthController(idx_t max_depth, idx_t target_latency_us);
+
+	/// @brief The number of commands that may currently be in flight on the queue
+	idx_t GetWindow() const {
+		return window.load(std::memory_order_relaxed);
+	}
+
+	/// @brief Records the latency of a completed command and adjusts the window at the end of a round
+	/// @param latency_us Time between submission and completion of the command in microseconds
+	void RecordCompletion(idx_t latency_us);
+
+	idx_t GetMaxDepth() const {
+		return max_depth;
+	}
+
+	idx_t GetTargetLatency() const {
+		return target_latency_us;
+	}
+
+	/// @brief The moving average of the completion latency in microseconds
+	double GetAverageLatency() const {
+		return average_latency_us.load(std::memory_order_relaxed);
+	}
+
+	/// @brief The total number of completions recorded
+	idx_t GetCompletionCount() const {
+		return completions.load(std::memory_order_relaxed);
+	}
+
+	bool IsAdaptive() const {
+		return target_latency_us > 0;
+	}
+
+private:
+	const idx_t max_depth;
+	const idx_t target_latency_us;
+	atomic<idx_t> window;
+	atomic<double> average_latency_us;
+	atomic<idx_t> completions;
+	//! Completions observed in the current round, only accessed by the owner of the queue
+	idx_t round_completions;
+};
+
+} // namespace duckdb
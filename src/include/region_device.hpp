@@ -0,0 +1,78 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+#include "nvme_device.hpp"
+
+namespace duckdb {
+
+/// @brief Presents a contiguous range of the LBAs of another device as a device of its own, such that a namespace can
+/// hold several databases, e.g. a database and its clones. LBA 0 of the region is LBA start_lba of the device. Copies
+/// between regions of the same device are left to that device, which copies within a namespace with the NVMe Copy
+/// command. Regions of zoned devices are not supported.
+class RegionDevice final : public Device {
+public:
+	/// @brief Creates a region that owns its device
+	/// @param device The device that holds the region
+	/// @param start_lba The first LBA of the region on the device
+	/// @param lba_count The number of LBAs of the region, 0 for all LBAs from start_lba on
+	RegionDevice(unique_ptr<Device> device, idx_t start_lba, idx_t lba_count);
+
+	/// @brief Creates a region of a device that is owned elsewhere, which must outlive the region
+	RegionDevice(Device &device, idx_t start_lba, idx_t lba_count);
+
+	idx_t Write(void *buffer, const CmdContext &context) override;
+	idx_t Read(void *buffer, const CmdContext &context) override;
+	idx_t WriteBatch(const DeviceIORequest *requests, idx_t count) override;
+	idx_t ReadBatch(const DeviceIORequest *requests, idx_t count) override;
+
+	DeviceGeometry GetDeviceGeometry() override;
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+	/// @brief Copies through the device of the region. A copy to another region of the same device is a copy within
+	/// that device
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+	vector<DeviceQueueStatistics> GetQueueStatistics() override;
+
+	bool GetFDPStatistics(DeviceFDPStatistics &statistics) override;
+	uint8_t GetPlacementIdentifier(const string &path, idx_t generation) override;
+	uint8_t GetHotPlacementIdentifier(const string &path) override;
+	void SetThreadCount(idx_t nr_threads) override;
+
+	/// @brief The device that holds the region
+	Device &GetDevice() {
+		return device;
+	}
+
+	idx_t GetStartLBA() const {
+		return start_lba;
+	}
+
+	/// @brief Whether the region shares LBAs with another device, which is either the device of the region or a region
+	/// of the same device
+	bool Overlaps(Device &other);
+
+	string GetName() const override {
+		return "RegionDevice(" + device.GetName() + ")";
+	}
+
+private:
+	/// @brief Translates an LBA range of the region to the LBAs of the device
+	/// @throws IOException if the range is not within the region
+	DeviceLBARange Translate(const DeviceLBARange &range) const;
+
+	/// @brief Translates a command to the LBAs of the device. Commands are NvmeCmdContexts, whose placement is kept
+	NvmeCmdContext Translate(const CmdContext &context) const;
+
+	idx_t SubmitBatch(const DeviceIORequest *requests, idx_t count, bool write);
+
+private:
+	unique_ptr<Device> owned_device;
+	Device &device;
+	const idx_t start_lba;
+	DeviceGeometry geometry;
+};
+
+} // namespace duckdb
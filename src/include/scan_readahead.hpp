@@ -0,0 +1,154 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+namespace duckdb {
+
+/// @brief Number of reads in sequence after which a stream is prefetched
+static constexpr idx_t READAHEAD_TRIGGER_READS = 2;
+/// @brief Number of reads that a new stream is prefetched ahead of its reader
+static constexpr idx_t READAHEAD_INITIAL_WINDOW = 4;
+/// @brief Maximum number of reads that a stream is prefetched ahead of its reader
+static constexpr idx_t READAHEAD_MAX_WINDOW = 64;
+/// @brief Number of streams that are tracked at once, e.g. the scans of different tables or columns
+static constexpr idx_t READAHEAD_MAX_STREAMS = 16;
+/// @brief Maximum number of prefetches that are submitted to the device in one batch
+static constexpr idx_t READAHEAD_MAX_BATCH = 32;
+
+/// @brief Totals of a ScanReadahead
+struct ReadaheadStatistics {
+	//! Reads that were served from prefetched data
+	idx_t hits;
+	//! Hits that had to wait for their prefetch to complete
+	idx_t late_hits;
+	//! Bytes read ahead from the device
+	idx_t prefetched_bytes;
+	//! Prefetched bytes that were dropped before they were read, because their stream moved past them or they were
+	//! overwritten
+	idx_t wasted_bytes;
+	//! Bytes currently held in the staging area
+	idx_t staged_bytes;
+};
+
+/// @brief Detects sequential reads of a region, e.g. DuckDB scanning the blocks of a table, and reads ahead of them
+/// into a bounded staging area in host memory, such that the device works on the next blocks while the current ones
+/// are processed.
+///
+/// Reads are grouped into streams. A read continues a stream if it has the same size and starts within the window of
+/// the stream, which tolerates the slightly out of order reads of a scan that is spread over several threads. Once a
+/// stream has READAHEAD_TRIGGER_READS reads, the reads that follow it within its window are prefetched by a background
+/// thread. A read of a prefetched range is served with a copy. The window adapts to the rate at which the stream is
+/// consumed: it doubles when a reader has to wait for its prefetch, and halves when prefetched data is dropped unread.
+///
+/// Writes must invalidate the ranges they cover after they have completed. Prefetches that were in flight during the
+/// write are then dropped as well, hence a reader never sees data from before a completed write.
+class ScanReadahead {
+public:
+	/// @brief Creates a readahead
+	/// @param device The device to read from
+	/// @param start_lba The first LBA of the region that is read ahead
+	/// @param end_lba The LBA after the region
+	/// @param capacity The maximum number of bytes held in the staging area
+	/// @param background Whether to start the background thread. Without it, prefetches are only issued by Flush
+	ScanReadahead(Device &device, idx_t start_lba, idx_t end_lba, idx_t capacity, bool background = true);
+	~ScanReadahead();
+
+	/// @brief Records a read with the stream detector, and serves it from the staging area if it has been prefetched,
+	/// waiting for the prefetch if it is in flight
+	/// @param buffer Buffer that receives the data
+	/// @param context The read
+	/// @return True if the read was served, false if the caller should read from the device
+	bool Read(void *buffer, const CmdContext &context);
+
+	/// @brief Drops the prefetched data of a range of LBAs, after the range has been written or deallocated
+	void Invalidate(idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief Issues all queued prefetches and waits for them
+	void Flush();
+
+	ReadaheadStatistics GetStatistics();
+
+private:
+	enum class EntryState : uint8_t { QUEUED, IN_FLIGHT, READY };
+
+	//! A prefetched range of LBAs
+	struct Entry {
+		idx_t nr_lbas;
+		data_ptr_t buffer;
+		EntryState state;
+		//! Set when the range was written while the prefetch was in flight
+		bool stale;
+		//! The stream that the range was prefetched for
+		idx_t stream_id;
+	};
+
+	struct Stream {
+		//! Unique identifier, 0 if the slot is unused
+		idx_t id;
+		//! The LBA after the furthest read of the stream
+		idx_t next_lba;
+		//! The number of LBAs of every read of the stream
+		idx_t request_lbas;
+		//! The LBA up to which the stream has been prefetched
+		idx_t prefetch_lba;
+		//! The number of reads that the stream is prefetched ahead
+		idx_t window;
+		idx_t sequential_reads;
+		//! Clock value of the last read, used to replace the least recently read stream
+		idx_t last_read;
+	};
+
+private:
+	/// @brief Finds the stream that a read continues, or replaces the least recently read stream with a new one
+	Stream &UpdateStreams(idx_t start_lba, idx_t nr_lbas);
+	/// @brief Finds the stream with the given identifier, or nullptr if it has been replaced
+	Stream *GetStream(idx_t stream_id);
+	/// @brief Queues the prefetches of a stream up to the end of its window, as far as the staging area has room
+	void Prefetch(Stream &stream);
+	/// @brief Drops entries of replaced streams, and entries that their stream has moved past, until nr_bytes fit
+	bool MakeRoom(idx_t nr_bytes);
+	/// @brief Removes an entry and frees its buffer
+	/// @param wasted Whether the entry is dropped without having been read, which counts its data as wasted
+	void RemoveEntry(map<idx_t, Entry>::iterator entry, bool wasted);
+	/// @brief Submits a batch of queued prefetches and waits for them, releasing the lock meanwhile
+	/// @return False if no prefetch was queued
+	bool IssueQueued(std::unique_lock<mutex> &guard);
+	void Run();
+
+private:
+	Device &device;
+	const idx_t lba_size;
+	const idx_t start_lba;
+	const idx_t end_lba;
+	const idx_t capacity;
+
+	//! Guards the streams and the staging area
+	mutex lock;
+	//! Signalled when prefetches are queued and when they complete
+	std::condition_variable condition;
+	Stream streams[READAHEAD_MAX_STREAMS];
+	idx_t next_stream_id;
+	idx_t clock;
+	//! Prefetched ranges by their first LBA
+	map<idx_t, Entry> entries;
+	//! The largest number of LBAs of an entry, which bounds the entries that can overlap an LBA
+	idx_t max_entry_lbas;
+	//! First LBAs of the queued entries, in the order they were queued
+	std::deque<idx_t> queue;
+	idx_t staged_bytes;
+
+	idx_t hits;
+	idx_t late_hits;
+	idx_t prefetched_bytes;
+	idx_t wasted_bytes;
+
+	std::thread thread;
+	bool shutdown;
+};
+
+} // namespace duckdb
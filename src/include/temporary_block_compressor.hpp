@@ -0,0 +1,72 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb_zstd {
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+} // namespace duckdb_zstd
+
+namespace duckdb {
+
+/// @brief Totals of the temporary blocks written through a TemporaryBlockCompressor
+struct TemporaryCompressionStatistics {
+	//! Number of blocks that were stored compressed
+	idx_t compressed_blocks;
+	//! Number of blocks that were stored as is, as compressing them did not save an LBA
+	idx_t uncompressed_blocks;
+	//! Bytes of the blocks before compression
+	idx_t block_bytes;
+	//! Bytes written to the device for the blocks, including the padding of compressed blocks to whole LBAs
+	idx_t stored_bytes;
+};
+
+/// @brief Compresses temporary blocks with ZSTD before they are written to the device, such that a spilled block takes
+/// fewer LBAs, and decompresses them when they are read back.
+///
+/// A compressed block is a single ZSTD frame followed by zeros up to the next LBA. The frame knows its own length,
+/// hence no header is stored. Blocks that do not shrink by at least one LBA are stored as is. Compression runs on the
+/// thread that writes the block, with a context taken from a pool that grows to the number of concurrent writers.
+class TemporaryBlockCompressor {
+public:
+	/// @param level The ZSTD compression level
+	/// @param lba_size The size of an LBA in bytes
+	TemporaryBlockCompressor(int64_t level, idx_t lba_size);
+	~TemporaryBlockCompressor();
+
+	/// @brief Compresses a block
+	/// @param block The block
+	/// @param nr_bytes The size of the block, a multiple of the LBA size
+	/// @param out Buffer of nr_bytes bytes that receives the compressed block
+	/// @return The size of the compressed block padded to whole LBAs, or 0 if it would not save an LBA, in which case
+	/// the block should be stored as is
+	idx_t Compress(const_data_ptr_t block, idx_t nr_bytes, data_ptr_t out);
+
+	/// @brief Decompresses a block
+	/// @param compressed The compressed block, padded to whole LBAs
+	/// @param compressed_bytes The padded size of the compressed block
+	/// @param block Buffer that receives the block
+	/// @param nr_bytes The size of the block
+	void Decompress(const_data_ptr_t compressed, idx_t compressed_bytes, data_ptr_t block, idx_t nr_bytes);
+
+	TemporaryCompressionStatistics GetStatistics() const;
+
+	/// @brief Validates the name of a compression method, of which `none` and `zstd` are known
+	/// @return Whether the method compresses
+	static bool ParseCompression(const string &name);
+
+private:
+	const int level;
+	const idx_t lba_size;
+	mutex context_lock;
+	//! Idle contexts, which are reused by the next compression or decompression
+	vector<duckdb_zstd::ZSTD_CCtx_s *> compression_contexts;
+	vector<duckdb_zstd::ZSTD_DCtx_s *> decompression_contexts;
+
+	atomic<idx_t> compressed_blocks;
+	atomic<idx_t> uncompressed_blocks;
+	atomic<idx_t> block_bytes;
+	atomic<idx_t> stored_bytes;
+};
+
+} // namespace duckdb
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "duckdb.hpp"
+#include "nvmefs_config.hpp"
 #include "nvmefs_temporary_block_manager.hpp"
 #include <atomic>
 #include <boost/thread/shared_mutex.hpp> // sudo apt-get install libboost-all-dev
@@ -9,31 +10,111 @@
 
 namespace duckdb {
 
+/// @brief Block size of the temporary files of the DEFAULT size class, which DuckDB writes the blocks to that it has
+/// not compressed. The smaller size classes hold blocks that DuckDB has compressed itself.
+static constexpr idx_t NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE = 262144;
+
+/// @brief Called with the LBA range of a temporary block before it is returned to the block manager
+typedef std::function<void(idx_t start_lba, idx_t nr_lbas)> block_free_function_t;
+
+/// @brief The LBAs that a block of a temporary file is stored in
+struct TemporaryBlockSlot {
+	idx_t start_lba;
+	//! Fewer LBAs than a block if the block is stored compressed
+	idx_t nr_lbas;
+};
+
 class TempFileMetadata {
 public:
-	TempFileMetadata() : file_index(0), block_size(0), nr_blocks(0) /*, block_range(nullptr)*/ {
+	TempFileMetadata()
+	    : file_index(0), block_size(0), nr_blocks(0), generation(0), extent_offset(0) /*, block_range(nullptr)*/ {
 	}
 
+	//! Cleared when the file is deleted, while handles may still hold the metadata
 	std::atomic<bool> is_active;
 	idx_t file_index;
 	idx_t block_size;
 	idx_t nr_blocks;
+	//! Creation order of the file, which rotates temporary files over the placement handles
+	idx_t generation;
 	std::atomic<idx_t> lba_location;
-	map<idx_t, TemporaryBlock *> block_map;
+	//! Start LBA of every block of the file, by block index
+	map<idx_t, idx_t> block_map;
+	//! Extents reserved for the file, in allocation order. New blocks are carved from the last one
+	vector<TemporaryBlock *> extents;
+	//! Number of LBAs of the last extent that have been handed out
+	idx_t extent_offset;
+	//! Start LBAs of truncated blocks, which are reused before the last extent is carved further
+	vector<idx_t> free_lbas;
+	//! Number of LBAs of the blocks that are stored compressed, by block index. Other blocks take block_size bytes
+	map<idx_t, idx_t> compressed_lbas;
+	//! Compressed blocks are packed into frames of the size of a block: the number of LBAs of the compressed blocks in
+	//! every frame, by the start LBA of the frame
+	map<idx_t, idx_t> frame_lbas;
+	//! Free LBAs of the frames, by start LBA. Adjacent free LBAs of the same frame are coalesced into one range
+	map<idx_t, idx_t> free_slots;
 	boost::shared_mutex file_mutex;
 };
 
+/// @brief Maps temporary files onto the temporary region of the device. DuckDB creates and deletes temporary files as
+/// a whole, hence the blocks of a file are grouped in extents, rather than interleaved with the blocks of other files.
+/// Deleting a file thereby frees whole extents, which, with extents the size of a reclaim unit and a placement handle
+/// per file generation, invalidates whole reclaim units at once. Extents are reserved as a file grows: the first one
+/// takes NVMEFS_TEMP_INITIAL_EXTENT_SIZE and every following one doubles up to the configured extent size, such that
+/// the many small files of a query do not reserve a full extent each.
+///
+/// On a zoned device, every extent is a zone, of which zone_capacity LBAs are used. Blocks are then not assigned an
+/// LBA up front: a block reserves room in the last zone of its file with ReserveZoneBlock, is appended to that zone,
+/// and is mapped to the LBA that the device appended it at with MapZoneBlock. Rewritten and truncated blocks leave
+/// their old LBAs behind in the zone, which are reclaimed when the file is deleted and its zones are freed.
+///
+/// Compressed blocks take a slot of fewer LBAs than a block. Slots are packed into frames, which take the place of a
+/// block in the extents of their file, and are carved first-fit from the free LBAs of the frames. A block that is
+/// rewritten with another compressed size moves to a new slot, whose old LBAs are coalesced with the free LBAs around
+/// them, and a frame whose slots are all freed is reused as a block. As no slot straddles two frames, a file never
+/// takes more frames and blocks than it has blocks, however the compressibility of its blocks changes.
 class TemporaryFileMetadataManager {
 public:
-	TemporaryFileMetadataManager(idx_t start_lba, idx_t end_lba, idx_t lba_size)
+	/// @param zone_capacity The number of usable LBAs of a zone of extent_size bytes on a zoned device, 0 otherwise
+	TemporaryFileMetadataManager(idx_t start_lba, idx_t end_lba, idx_t lba_size,
+	                             idx_t extent_size = NVMEFS_DEFAULT_TEMP_EXTENT_SIZE,
+	                             block_free_function_t block_free_function = nullptr, idx_t zone_capacity = 0)
 	    : block_manager(make_uniq<NvmeTemporaryBlockManager>(start_lba, end_lba)), lba_size(lba_size),
-	      lba_amount(end_lba - start_lba) {
+	      lba_amount(end_lba - start_lba), extent_lbas(MaxValue<idx_t>(extent_size / lba_size, 1)),
+	      initial_extent_lbas(MinValue<idx_t>(NVMEFS_TEMP_INITIAL_EXTENT_SIZE / lba_size, extent_lbas)),
+	      zone_capacity(zone_capacity), block_free_function(std::move(block_free_function)), next_generation(0) {
 	}
 
 	void CreateFile(const string &filename);
 
 	idx_t GetLBA(const string &filename, idx_t location, idx_t nr_lbas);
 
+	/// @brief Same as GetLBA(filename, ...) for a file whose metadata has already been looked up with GetFile
+	idx_t GetLBA(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas);
+
+	/// @brief Reserves room for a block in the last zone of the file, reserving a new zone when it is full
+	/// @param tfmeta The file
+	/// @param location Byte offset of the block in the file
+	/// @param nr_lbas The number of LBAs of the block
+	/// @return The first LBA of the zone that the block should be appended to
+	idx_t ReserveZoneBlock(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas);
+
+	/// @brief Maps a block to the LBA that it was appended at
+	void MapZoneBlock(TempFileMetadata &tfmeta, idx_t location, idx_t lba);
+
+	/// @brief Looks up the slot of a block. A block that has not been written yet is given a slot of a whole block
+	/// @param tfmeta The file
+	/// @param location Byte offset of the block in the file
+	TemporaryBlockSlot GetBlockSlot(TempFileMetadata &tfmeta, idx_t location);
+
+	/// @brief Gives a block a slot of the given size, before the block is written. The block keeps its slot if that
+	/// has the same size, and moves to another slot otherwise
+	/// @param tfmeta The file
+	/// @param location Byte offset of the block in the file
+	/// @param nr_lbas The number of LBAs that the block is stored in, which is fewer than a block if it is compressed
+	/// @return The first LBA of the slot
+	idx_t AllocateBlockSlot(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas);
+
 	void TruncateFile(const string &filename, idx_t new_size);
 
 	void DeleteFile(const string &filename);
@@ -52,13 +133,52 @@ public:
 
 	void Clear();
 
-	const TempFileMetadata *GetOrCreateFile(const string &filename);
+	shared_ptr<TempFileMetadata> GetOrCreateFile(const string &filename);
+
+	/// @brief Looks up the metadata of a file. The metadata stays alive while it is held, but is no longer active once
+	/// the file is deleted, after which no blocks can be allocated for it
+	/// @return The metadata, or nullptr if the file does not exist
+	shared_ptr<TempFileMetadata> GetFile(const string &filename);
+
+private:
+	/// @brief Returns a block to the block manager, reporting its LBA range to the block free function first
+	void FreeBlock(TemporaryBlock *block);
+
+	/// @brief Finds the location of a new block of the file, reserving a new extent when the last one is full
+	idx_t AllocateBlockLBA(TempFileMetadata &tfmeta, idx_t nr_lbas);
+
+	/// @brief Unmaps a block of the file, such that its slot is reused by the blocks that are allocated next
+	void ReleaseBlock(TempFileMetadata &tfmeta, idx_t block_index);
+
+	/// @brief Finds a slot of fewer LBAs than a block in the first frame that has room for it, opening a new frame if
+	/// none has
+	idx_t AllocateCompressedSlot(TempFileMetadata &tfmeta, idx_t nr_lbas);
+
+	/// @brief Returns the slot of a compressed block to its frame, and the frame to the free blocks once it is empty
+	void ReleaseCompressedSlot(TempFileMetadata &tfmeta, idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief Reserves the next extent of a file for blocks of the given size. When the temporary region is too
+	/// fragmented for the extent, it is halved until it fits, down to a single block. On a zoned device, extents are
+	/// whole zones
+	/// @param tfmeta The file, whose last extent determines the size of the next one
+	/// @param block_lbas The number of LBAs of a block of the file
+	TemporaryBlock *AllocateExtent(TempFileMetadata &tfmeta, idx_t block_lbas);
+
+	/// @brief Returns all extents of the file to the block manager
+	void FreeExtents(TempFileMetadata &tfmeta);
 
 private:
 	idx_t lba_size;
 	idx_t lba_amount;
+	//! The largest extent of a file
+	idx_t extent_lbas;
+	//! The first extent of a file
+	idx_t initial_extent_lbas;
+	idx_t zone_capacity;
+	block_free_function_t block_free_function;
+	idx_t next_generation;
 	unique_ptr<NvmeTemporaryBlockManager> block_manager;
-	map<string, unique_ptr<TempFileMetadata>> file_to_temp_meta;
+	map<string, shared_ptr<TempFileMetadata>> file_to_temp_meta;
 	static boost::shared_mutex temp_mutex;
 };
 } // namespace duckdb
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+/// @brief log2 of the number of tracked writes after which all write counts decay by half
+static constexpr idx_t WRITE_FREQUENCY_EPOCH_SHIFT = 14;
+/// @brief Write counts saturate at this value
+static constexpr idx_t WRITE_FREQUENCY_MAX_COUNT = 255;
+/// @brief Number of parts of a range whose first write is told apart from a rewrite
+static constexpr idx_t WRITE_FREQUENCY_RANGE_PARTS = 32;
+
+/// @brief Number of ranges whose decayed write count equals write_count
+struct WriteFrequencyBucket {
+	idx_t write_count;
+	idx_t nr_ranges;
+};
+
+/// @brief Tracks how often every range of LBAs of a region is rewritten, such that ranges that are rewritten often
+/// (hot), e.g. DuckDB metadata and frequently updated row groups, can be placed apart from ranges that are written once
+/// (cold), e.g. bulk loaded data.
+///
+/// Only rewrites are counted, such that a range that is loaded once with several writes stays cold. A write is a
+/// rewrite if it covers a part of its range that has been written before, for which every range keeps a bitmap of
+/// WRITE_FREQUENCY_RANGE_PARTS parts. Every range has an 8-bit rewrite count, which halves every
+/// 2^WRITE_FREQUENCY_EPOCH_SHIFT tracked writes. The decay is applied lazily when a range is written or inspected,
+/// using the epoch that the range was last rewritten in, which is stored next to its count in a single 32-bit word.
+class WriteFrequencyTracker {
+public:
+	/// @brief Creates a tracker
+	/// @param start_lba The first LBA of the tracked region
+	/// @param end_lba The LBA after the tracked region
+	/// @param range_lbas The number of LBAs per range, rounded down to a power of two
+	/// @param hot_threshold The decayed write count from which a range is hot
+	WriteFrequencyTracker(idx_t start_lba, idx_t end_lba, idx_t range_lbas, idx_t hot_threshold);
+
+	/// @brief Records a write to the region, which counts as a rewrite of the ranges of which it covers a part that
+	/// has been written before
+	/// @param start_lba The first written LBA
+	/// @param nr_lbas The number of written LBAs
+	/// @return Whether any of the written ranges is hot
+	bool RecordWrite(idx_t start_lba, idx_t nr_lbas);
+
+	/// @brief Determines whether the range holding the LBA is hot
+	bool IsHot(idx_t lba) const;
+
+	/// @brief Counts the ranges by their current decayed rewrite count. Ranges whose count has decayed to 0, or that
+	/// were never rewritten, are left out
+	vector<WriteFrequencyBucket> GetHistogram() const;
+
+	idx_t GetRangeLBAs() const {
+		return idx_t(1) << range_shift;
+	}
+
+	idx_t GetHotThreshold() const {
+		return hot_threshold;
+	}
+
+private:
+	uint32_t GetEpoch() const;
+	static idx_t GetDecayedCount(uint32_t entry, uint32_t epoch);
+
+private:
+	const idx_t start_lba;
+	idx_t range_shift;
+	//! log2 of the number of LBAs of a part of a range
+	idx_t part_shift;
+	const idx_t hot_threshold;
+	//! Per range, the epoch of the last rewrite in the upper 24 bits and the rewrite count in the lower 8 bits
+	vector<atomic<uint32_t>> ranges;
+	//! Per range, a bit for every part that has been written
+	vector<atomic<uint32_t>> written_parts;
+	atomic<idx_t> nr_writes;
+};
+
+} // namespace duckdb
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "device.hpp"
+
+#include <mutex>
+
+namespace duckdb {
+
+/// @brief Stores the WAL in a run of zones of a zoned device. The WAL is only appended to, hence its LBAs are written
+/// with Zone Append, zone after zone, and LBA i of the WAL is LBA i % capacity of zone i / capacity.
+///
+/// Zones can not be rewritten, while DuckDB appends to the WAL in pieces that do not end at LBA boundaries. Only whole
+/// LBAs are therefore appended to the zones, and the partially written last LBA is kept in memory until it is complete.
+/// When the WAL is synced, the partial LBA is written to a conventional LBA, from which it is restored when the WAL is
+/// loaded again.
+class ZonedWriteAheadLog {
+public:
+	/// @brief Creates the WAL on the given zones. Load must be called before the WAL is used
+	/// @param device The zoned device
+	/// @param zones The zone geometry of the device
+	/// @param first_zone The index of the first zone of the WAL
+	/// @param nr_zones The number of zones of the WAL
+	/// @param tail_lba A conventional LBA that holds the partially written last LBA when the WAL is synced
+	ZonedWriteAheadLog(Device &device, const DeviceZoneGeometry &zones, idx_t first_zone, idx_t nr_zones,
+	                   idx_t tail_lba);
+
+	/// @brief Writes to the WAL. The write must not start before the partially written last LBA
+	/// @param buffer The data to write
+	/// @param nr_bytes The number of bytes to write
+	/// @param location Byte offset in the WAL
+	void Write(const void *buffer, idx_t nr_bytes, idx_t location);
+
+	/// @brief Reads from the WAL, taking the partially written last LBA from memory
+	void Read(void *buffer, idx_t nr_bytes, idx_t location);
+
+	/// @brief Persists the partially written last LBA, if it has changed since the last sync
+	void Sync();
+
+	/// @brief Shrinks the WAL. The zones after the new end are reset. The zone that the new end falls into is reset as
+	/// well, after which its remaining whole LBAs are appended again. If the new end falls within an LBA, the part of
+	/// it that is kept becomes the partially written last LBA.
+	/// @param nr_bytes The new size of the WAL in bytes
+	void Truncate(idx_t nr_bytes);
+
+	/// @brief Restores the WAL from the write pointers of its zones. LBAs that were appended after the size was last
+	/// recorded are truncated, and a partially written last LBA that was synced is appended as a whole LBA
+	/// @param nr_lbas The size of the WAL in LBAs as recorded in the metadata
+	void Load(idx_t nr_lbas);
+
+	/// @brief The size of the WAL in LBAs, including the partially written last LBA
+	idx_t GetSizeLBAs();
+
+	/// @brief The number of LBAs that fit in the zones of the WAL
+	idx_t GetCapacityLBAs() const {
+		return nr_zones * zones.zone_capacity;
+	}
+
+private:
+	/// @brief Appends whole LBAs at the end of the WAL, continuing in the next zone when a zone is full
+	void Append(const_data_ptr_t data, idx_t nr_lbas);
+	void TruncateInternal(idx_t nr_lbas);
+	/// @brief Maps an LBA of the WAL to the LBA of the device that holds it
+	idx_t GetDeviceLBA(idx_t lba) const;
+	idx_t GetZoneStart(idx_t zone) const {
+		return zones.GetZoneStart(first_zone + zone);
+	}
+
+private:
+	Device &device;
+	const DeviceZoneGeometry zones;
+	const idx_t first_zone;
+	const idx_t nr_zones;
+	const idx_t tail_lba;
+	const idx_t lba_size;
+
+	mutex lock;
+	//! The number of whole LBAs that have been appended to the zones
+	idx_t appended;
+	//! The partially written LBA that follows the appended LBAs, of which tail_bytes are written
+	vector<data_t> tail;
+	idx_t tail_bytes;
+	//! Whether the partial LBA has changed since it was last synced
+	bool tail_dirty;
+};
+
+} // namespace duckdb
@@ -0,0 +1,74 @@
+#include "nvme_completion.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace duckdb {
+
+NvmeCompletion::NvmeCompletion(idx_t nr_commands, int event_fd)
+    : remaining(nr_commands), failed(0), status(0), event_fd(event_fd) {
+}
+
+void NvmeCompletion::Complete(uint16_t cqe_status) {
+	if (cqe_status) {
+		status.store(cqe_status, std::memory_order_relaxed);
+		failed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Copy the eventfd before releasing the slot, as the waiter may discard the slot as soon as it is complete
+	int fd = event_fd;
+	remaining.fetch_sub(1, std::memory_order_release);
+
+	if (fd >= 0) {
+		uint64_t value = 1;
+		ssize_t written = write(fd, &value, sizeof(value));
+		(void)written;
+	}
+}
+
+int NvmeCompletion::GetThreadEventFd() {
+	struct ThreadEventFd {
+		ThreadEventFd() : fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+		}
+		~ThreadEventFd() {
+			if (fd >= 0) {
+				close(fd);
+			}
+		}
+		int fd;
+	};
+
+	static thread_local ThreadEventFd thread_event_fd;
+	return thread_event_fd.fd;
+}
+
+void NvmeCompletion::WaitEventFd(int event_fd, idx_t timeout_us) {
+	struct pollfd pfd {};
+	pfd.fd = event_fd;
+	pfd.events = POLLIN;
+
+	struct timespec timeout {};
+	timeout.tv_sec = timeout_us / 1000000;
+	timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+
+	if (ppoll(&pfd, 1, &timeout, nullptr) > 0) {
+		// Reset the counter of the eventfd
+		uint64_t value;
+		ssize_t nr_read = read(event_fd, &value, sizeof(value));
+		(void)nr_read;
+	}
+}
+
+NvmeWaitStrategy NvmeCompletion::ParseWaitStrategy(const string &name) {
+	if (name == "spin") {
+		return NvmeWaitStrategy::SPIN;
+	} else if (name == "spin_yield") {
+		return NvmeWaitStrategy::SPIN_YIELD;
+	} else if (name == "eventfd") {
+		return NvmeWaitStrategy::EVENTFD;
+	}
+	throw InvalidInputException("Unknown wait strategy '%s', expected 'spin', 'spin_yield' or 'eventfd'", name);
+}
+
+} // namespace duckdb
@@ -2,95 +2,180 @@
 
 namespace duckdb {
 thread_local optional_idx NvmeDevice::index = optional_idx();
-NvmeDevice::NvmeDevice(const string &device_path, const string &backend, const bool async, const idx_t max_threads)
-    : dev_path(device_path), backend(backend), async(async), max_threads(max_threads) {
+NvmeDevice::NvmeDevice(const NvmeConfig &config)
+    : fdp_configuration_index(0), endurance_group(0), reclaim_unit_size(0), initial_host_bytes_written(0),
+      initial_media_bytes_written(0), dev_path(config.device_path), backend(config.backend), async(config.async),
+      spdk(StringUtil::Equals(config.backend.data(), "spdk")),
+      wait_strategy(NvmeCompletion::ParseWaitStrategy(config.wait_strategy)), copy(false), max_copy_ranges(0),
+      max_copy_range_lbas(0), max_copy_lbas(0), zoned(false), max_append_lbas(0), queue_depth(config.queue_depth),
+      max_threads(config.max_threads) {
+	if (!IsNonZeroPowerOfTwo(queue_depth)) {
+		throw InvalidInputException("Queue depth must be a power of two, got %llu", queue_depth);
+	}
+	if (wait_strategy == NvmeWaitStrategy::EVENTFD && !(async && config.reactor_threads > 0)) {
+		// Without pollers nobody but the waiting thread reaps completions, hence nobody would signal the eventfd
+		throw InvalidInputException("The eventfd wait strategy requires an asynchronous backend and reactor_threads");
+	}
+
 	xnvme_opts opts = xnvme_opts_default();
 	PrepareOpts(opts);
-	device = xnvme_dev_open(device_path.c_str(), &opts);
+	device = xnvme_dev_open(dev_path.c_str(), &opts);
 	if (!device) {
 		xnvme_cli_perr("xnvme_dev_open()", errno);
 		throw InternalException("Unable to open device");
 	}
 
-	// Initialize the xnvme queue for asynchronous IO
-	if (async) {
-		queues = vector<xnvme_queue *>(max_threads, nullptr);
-		// Set the callback function for completed commands. No callback arguments, hence last argument equal to NULL
-	}
+	// SPDK requires DMA memory allocated through xNVMe, hence the hugepage arena is only used for kernel backends
+	idx_t arena_size = spdk ? 0 : config.hugepage_arena_size;
+
+	// NVMe passthrough (ioctl and io_uring_cmd) only requires dword aligned buffers. The block layer backends require
+	// the buffer to be aligned to the logical block size when used with O_DIRECT.
+	bool passthru = StringUtil::Equals(backend.data(), "nvme") || StringUtil::Equals(backend.data(), "io_uring_cmd");
+	direct_io_alignment = passthru ? NVME_DWORD_ALIGNMENT : DEVICE_BUFFER_ALIGNMENT;
+	buffer_pool = make_uniq<DeviceBufferPool>(
+	    [this](idx_t nr_bytes) { return static_cast<data_ptr_t>(xnvme_buf_alloc(device, nr_bytes)); },
+	    [this](data_ptr_t buffer) { xnvme_buf_free(device, buffer); }, arena_size);
 
+	endurance_group = xnvme_dev_get_ns(device)->endgid;
 	fdp = CheckFDP();
+	deallocate = CheckDeallocate();
+	copy = LoadCopyLimits();
 
 	if (fdp) {
 		InitializePlacementHandles();
+		placement_bytes_written.reset(new atomic<idx_t>[placement_handlers.size()]());
+		reclaim_unit_size = LoadReclaimUnitSize();
+		// The lifetime counters of the endurance group are the baseline of the write amplification of this database
+		idx_t media_bytes_erased;
+		ReadFDPStatisticsLog(initial_host_bytes_written, initial_media_bytes_written, media_bytes_erased);
+
+		idx_t nr_handles = placement_handlers.size();
+		if (config.plhdls > 0) {
+			nr_handles = MinValue<idx_t>(nr_handles, config.plhdls);
+		}
+		placement_policy = make_uniq<PlacementPolicy>(nr_handles, config.fdp_placement);
 	}
 
-	GetThreadIndex();
-	allocated_placement_identifiers["nvmefs:///tmp"] = 1;
 	geometry = LoadDeviceGeometry();
+	max_transfer_lbas = LoadMaxTransferLBAs();
+	zoned = LoadZoneGeometry();
+	lba_cache = make_uniq<PartialLBACache>(geometry.lba_size);
+
+	auto submit_function = [this](xnvme_queue *queue, NvmeCommand &command) {
+		return SubmitCommand(queue, command);
+	};
+	if (async && config.reactor_threads > 0) {
+		reactor = make_uniq<NvmeReactor>(device, config.reactor_threads, NvmeReactor::ParseCpuList(config.reactor_cpus),
+		                                 queue_depth, config.queue_target_latency_us, submit_function);
+	} else if (async) {
+		// Create the queues of all threads up front, keeping queue creation out of the I/O path
+		queue_registry = make_uniq<NvmeQueueRegistry>(NvmeQueueFunctions::ForDevice(device), max_threads, queue_depth,
+		                                              config.queue_target_latency_us, submit_function);
+	}
 }
 
 NvmeDevice::~NvmeDevice() {
-	if (async) {
-		for (const auto &queue : queues) {
-			xnvme_queue_term(queue);
-		}
-	}
+	// Stop the pollers before the device is closed
+	reactor.reset();
+	queue_registry.reset();
+	// Cached buffers must be released while the device is still open
+	buffer_pool.reset();
 	xnvme_dev_close(device);
 }
 
 idx_t NvmeDevice::Write(void *buffer, const CmdContext &context) {
+	if (context.nr_lbas > max_transfer_lbas) {
+		DeviceIORequest request {buffer, &context};
+		return WriteBatch(&request, 1);
+	}
 	if (async) {
 		return WriteAsync(buffer, context);
 	}
 
 	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(context);
 	D_ASSERT(ctx.nr_lbas > 0);
-	// We only support offset writes within a single block
-	D_ASSERT((ctx.offset == 0 && ctx.nr_lbas > 1) || (ctx.offset >= 0 && ctx.nr_lbas == 1));
-
-	nvme_buf_ptr dev_buffer = AllocateDeviceBuffer(ctx.nr_bytes);
-	if (ctx.offset > 0) {
-		// Check if write is fully contained within single block
-		D_ASSERT(ctx.offset + ctx.nr_bytes < geometry.lba_size);
-		// Read the whole LBA block
-		Read(dev_buffer, ctx);
+	D_ASSERT(ctx.nr_lbas == (ctx.offset + ctx.nr_bytes + geometry.lba_size - 1) / geometry.lba_size);
+
+	// Submit directly from the caller's buffer when possible to avoid a copy
+	bool direct = CanUseBufferDirectly(buffer, ctx);
+	idx_t buffer_size = ctx.nr_lbas * geometry.lba_size;
+	data_ptr_t dev_buffer = direct ? static_cast<data_ptr_t>(buffer) : AllocateBuffer(buffer_size);
+	NvmePartialLBAs partial = GetPartialLBAs(ctx, geometry.lba_size);
+	vector<idx_t> partial_lbas;
+	if (partial.head.IsValid()) {
+		partial_lbas.push_back(partial.head.GetIndex());
+	}
+	if (partial.tail.IsValid()) {
+		partial_lbas.push_back(partial.tail.GetIndex());
+	}
+	// The partial LBAs stay locked until they have been written and cached
+	PartialLBALocks::Guard guard = lba_locks.Lock(partial_lbas);
+	if (!direct) {
+		// Partially written LBAs at the head and tail must be merged with their current contents
+		if (partial.head.IsValid()) {
+			LoadPartialLBA(ctx, partial.head.GetIndex(), dev_buffer);
+		}
+		if (partial.tail.IsValid()) {
+			idx_t tail_offset = (partial.tail.GetIndex() - ctx.start_lba) * geometry.lba_size;
+			LoadPartialLBA(ctx, partial.tail.GetIndex(), dev_buffer + tail_offset);
+		}
+		memcpy(dev_buffer + ctx.offset, buffer, ctx.nr_bytes);
 	}
-	memcpy(dev_buffer, (char *)buffer + ctx.offset, ctx.nr_bytes);
+	lba_cache->Invalidate(ctx.start_lba, ctx.nr_lbas);
 
 	uint32_t nsid = xnvme_dev_get_nsid(device);
-	uint8_t plid_idx = GetPlacementIdentifierOrDefault(ctx.filepath);
+	uint8_t plid_idx = ctx.placement_identifier;
 	xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
 
-	PrepareIOCmdContext(&xnvme_ctx, context, plid_idx, DATA_PLACEMENT_MODE, true);
+	PrepareIOCmdContext(&xnvme_ctx, context, true);
 
 	int err = xnvme_nvm_write(&xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, dev_buffer, nullptr);
 	if (err) {
+		if (!direct) {
+			FreeBuffer(dev_buffer, buffer_size);
+		}
 		xnvme_cli_perr("Could not write to device with xnvme_nvme_write(): ", err);
 		throw IOException("Encountered error when writing to NVMe device");
 	}
+	RecordPlacementWrite(plid_idx, ctx.nr_lbas);
 
-	FreeDeviceBuffer(dev_buffer);
+	if (!direct) {
+		// Keep the written partial LBAs such that the next partial write to them does not need to read them
+		if (partial.head.IsValid()) {
+			lba_cache->Insert(partial.head.GetIndex(), dev_buffer);
+		}
+		if (partial.tail.IsValid()) {
+			lba_cache->Insert(partial.tail.GetIndex(),
+			                  dev_buffer + (partial.tail.GetIndex() - ctx.start_lba) * geometry.lba_size);
+		}
+		FreeBuffer(dev_buffer, buffer_size);
+	}
 
 	return ctx.nr_lbas;
 }
 
 idx_t NvmeDevice::Read(void *buffer, const CmdContext &context) {
+	if (context.nr_lbas > max_transfer_lbas) {
+		DeviceIORequest request {buffer, &context};
+		return ReadBatch(&request, 1);
+	}
 	if (async) {
 		return ReadAsync(buffer, context);
 	}
 
 	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(context);
 	D_ASSERT(ctx.nr_lbas > 0);
-	// We only support offset reads within a single block
-	D_ASSERT((ctx.offset == 0 && ctx.nr_lbas > 1) || (ctx.offset >= 0 && ctx.nr_lbas == 1));
+	D_ASSERT(ctx.offset + ctx.nr_bytes <= ctx.nr_lbas * geometry.lba_size);
 
-	nvme_buf_ptr dev_buffer = AllocateDeviceBuffer(ctx.nr_bytes);
+	// Read directly into the caller's buffer when possible to avoid a copy
+	bool direct = CanUseBufferDirectly(buffer, ctx);
+	idx_t buffer_size = ctx.nr_lbas * geometry.lba_size;
+	data_ptr_t dev_buffer = direct ? static_cast<data_ptr_t>(buffer) : AllocateBuffer(buffer_size);
 
 	uint32_t nsid = xnvme_dev_get_nsid(device);
-	uint8_t plid_idx = GetPlacementIdentifierOrDefault(ctx.filepath);
 	xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
 
-	PrepareIOCmdContext(&xnvme_ctx, context, plid_idx, 0, false);
+	PrepareIOCmdContext(&xnvme_ctx, context, false);
 
 	int err = xnvme_nvm_read(&xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, dev_buffer, nullptr);
 	if (err) {
@@ -98,34 +183,402 @@ idx_t NvmeDevice::Read(void *buffer, const CmdContext &context) {
 		throw IOException("Encountered error when writing to NVMe device");
 	}
 
-	memcpy(buffer, (char *)dev_buffer + ctx.offset, ctx.nr_bytes);
-
-	FreeDeviceBuffer(dev_buffer);
+	if (!direct) {
+		memcpy(buffer, dev_buffer + ctx.offset, ctx.nr_bytes);
+		FreeBuffer(dev_buffer, buffer_size);
+	}
 
 	return ctx.nr_lbas;
 }
 
+idx_t NvmeDevice::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	vector<NvmeCmdContext> sub_contexts;
+	vector<DeviceIORequest> sub_requests;
+	if (SplitRequests(requests, count, max_transfer_lbas, geometry.lba_size, sub_contexts, sub_requests)) {
+		requests = sub_requests.data();
+		count = sub_requests.size();
+	}
+
+	if (!async) {
+		return Device::WriteBatch(requests, count);
+	}
+	return SubmitBatchAsync(requests, count, true);
+}
+
+idx_t NvmeDevice::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	vector<NvmeCmdContext> sub_contexts;
+	vector<DeviceIORequest> sub_requests;
+	if (SplitRequests(requests, count, max_transfer_lbas, geometry.lba_size, sub_contexts, sub_requests)) {
+		requests = sub_requests.data();
+		count = sub_requests.size();
+	}
+
+	if (!async) {
+		return Device::ReadBatch(requests, count);
+	}
+	return SubmitBatchAsync(requests, count, false);
+}
+
 DeviceGeometry NvmeDevice::GetDeviceGeometry() {
 	return geometry;
 }
 
-uint8_t NvmeDevice::GetPlacementIdentifierOrDefault(const string &path) {
-	uint8_t placement_identifier = 0;
-	for (const auto &kv : allocated_placement_identifiers) {
-		if (StringUtil::StartsWith(path, kv.first)) {
-			placement_identifier = kv.second;
+uint8_t NvmeDevice::GetPlacementIdentifier(const string &path, idx_t generation) {
+	if (!placement_policy) {
+		return 0;
+	}
+	return placement_policy->GetFilePlacementIdentifier(path, generation);
+}
+
+bool NvmeDevice::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	if (!fdp) {
+		return false;
+	}
+
+	statistics.host_bytes_written = 0;
+	statistics.media_bytes_written = 0;
+	statistics.media_bytes_erased = 0;
+	ReadFDPStatisticsLog(statistics.host_bytes_written, statistics.media_bytes_written, statistics.media_bytes_erased);
+	statistics.initial_host_bytes_written = initial_host_bytes_written;
+	statistics.initial_media_bytes_written = initial_media_bytes_written;
+
+	statistics.placement_handles =
+	    GetPlacementStatistics(placement_handlers, ReadReclaimUnitHandleStatus(), placement_bytes_written.get(),
+	                           geometry.lba_size, reclaim_unit_size);
+	return true;
+}
+
+vector<DevicePlacementStatistics>
+NvmeDevice::GetPlacementStatistics(const vector<uint16_t> &placement_identifiers,
+                                   const vector<xnvme_spec_ruhs_desc> &descriptors, const atomic<idx_t> *bytes_written,
+                                   idx_t lba_size, idx_t reclaim_unit_size) {
+	vector<DevicePlacementStatistics> statistics;
+	for (idx_t i = 0; i < placement_identifiers.size(); i++) {
+		DevicePlacementStatistics handle;
+		handle.placement_handle = i;
+		handle.placement_identifier = placement_identifiers[i];
+		handle.reclaim_unit_handle = i < descriptors.size() ? descriptors[i].ruhi : 0;
+		handle.host_bytes_written = bytes_written[i].load(std::memory_order_relaxed);
+		// The available media writes are reported in logical blocks
+		handle.available_bytes = i < descriptors.size() ? descriptors[i].ruamw * lba_size : 0;
+		if (reclaim_unit_size > 0) {
+			handle.used_bytes = reclaim_unit_size - MinValue<idx_t>(handle.available_bytes, reclaim_unit_size);
+		}
+		statistics.push_back(handle);
+	}
+	return statistics;
+}
+
+uint8_t NvmeDevice::GetHotPlacementIdentifier(const string &path) {
+	if (!placement_policy) {
+		return 0;
+	}
+	return placement_policy->GetHotFilePlacementIdentifier(path);
+}
+
+bool NvmeDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	if (!deallocate) {
+		return false;
+	}
+
+	// The range list is transferred to the device, hence it must be located in a device buffer
+	idx_t range_list_size = NVME_MAX_DSM_RANGES * sizeof(xnvme_spec_dsm_range);
+	xnvme_spec_dsm_range *range_list = reinterpret_cast<xnvme_spec_dsm_range *>(AllocateBuffer(range_list_size));
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+	idx_t nr_ranges = 0;
+
+	auto submit = [&]() {
+		xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
+		int err = xnvme_nvm_dsm(&xnvme_ctx, nsid, range_list, nr_ranges - 1, true, false, false);
+		if (err || xnvme_cmd_ctx_cpl_status(&xnvme_ctx)) {
+			xnvme_cli_perr("Could not deallocate with xnvme_nvm_dsm(): ", err);
+			FreeBuffer(reinterpret_cast<data_ptr_t>(range_list), range_list_size);
+			throw IOException("Encountered error when deallocating LBAs on NVMe device");
+		}
+		nr_ranges = 0;
+	};
+
+	for (idx_t i = 0; i < count; i++) {
+		// Cached partial LBAs no longer mirror the device once deallocated
+		lba_cache->Invalidate(ranges[i].start_lba, ranges[i].nr_lbas);
+
+		for (idx_t lba = 0; lba < ranges[i].nr_lbas; lba += NVME_MAX_DSM_RANGE_LBAS) {
+			xnvme_spec_dsm_range &range = range_list[nr_ranges++];
+			range.cattr = 0;
+			range.llb = MinValue<idx_t>(NVME_MAX_DSM_RANGE_LBAS, ranges[i].nr_lbas - lba);
+			range.slba = ranges[i].start_lba + lba;
+
+			if (nr_ranges == NVME_MAX_DSM_RANGES) {
+				submit();
+			}
+		}
+	}
+	if (nr_ranges > 0) {
+		submit();
+	}
+
+	FreeBuffer(reinterpret_cast<data_ptr_t>(range_list), range_list_size);
+	return true;
+}
+
+bool NvmeDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	// Simple Copy only copies within a namespace
+	if (!copy || &destination != this) {
+		return false;
+	}
+	vector<NvmeCopyCommand> commands =
+	    PlanCopy(ranges, count, destination_lba, max_copy_ranges, max_copy_range_lbas, max_copy_lbas);
+
+	// The source ranges are transferred to the device, hence they must be located in a device buffer
+	idx_t range_list_size = sizeof(xnvme_spec_nvm_scopy_source_range);
+	auto range_list = reinterpret_cast<xnvme_spec_nvm_scopy_source_range *>(AllocateBuffer(range_list_size));
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+
+	for (const NvmeCopyCommand &command : commands) {
+		memset(range_list, 0, range_list_size);
+		for (idx_t i = 0; i < command.sources.size(); i++) {
+			xnvme_spec_nvm_scopy_fmt_zero &entry = range_list->entry[i];
+			entry.slba = command.sources[i].start_lba;
+			entry.nlb = command.sources[i].nr_lbas - 1;
+		}
+
+		xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
+		int err = xnvme_nvm_scopy(&xnvme_ctx, nsid, command.destination_lba, range_list, command.sources.size() - 1,
+		                          XNVME_NVM_SCOPY_FMT_ZERO);
+		if (err || xnvme_cmd_ctx_cpl_status(&xnvme_ctx)) {
+			xnvme_cli_perr("Could not copy with xnvme_nvm_scopy(): ", err);
+			FreeBuffer(reinterpret_cast<data_ptr_t>(range_list), range_list_size);
+			throw IOException("Encountered error when copying %llu LBAs to LBA %llu on NVMe device", command.nr_lbas,
+			                  command.destination_lba);
+		}
+		// Cached partial LBAs no longer mirror the device once overwritten
+		lba_cache->Invalidate(command.destination_lba, command.nr_lbas);
+	}
+
+	FreeBuffer(reinterpret_cast<data_ptr_t>(range_list), range_list_size);
+	return true;
+}
+
+vector<NvmeCopyCommand> NvmeDevice::PlanCopy(const DeviceLBARange *ranges, idx_t count, idx_t destination_lba,
+                                             idx_t max_ranges, idx_t max_range_lbas, idx_t max_lbas) {
+	D_ASSERT(max_ranges > 0 && max_range_lbas > 0 && max_lbas > 0);
+	vector<NvmeCopyCommand> commands;
+	for (idx_t i = 0; i < count; i++) {
+		for (idx_t copied = 0; copied < ranges[i].nr_lbas;) {
+			if (commands.empty() || commands.back().sources.size() == max_ranges ||
+			    commands.back().nr_lbas == max_lbas) {
+				commands.push_back(NvmeCopyCommand {{}, destination_lba, 0});
+			}
+			NvmeCopyCommand &command = commands.back();
+			idx_t nr_lbas = MinValue<idx_t>(max_range_lbas, ranges[i].nr_lbas - copied);
+			nr_lbas = MinValue<idx_t>(nr_lbas, max_lbas - command.nr_lbas);
+
+			command.sources.push_back(DeviceLBARange {ranges[i].start_lba + copied, nr_lbas});
+			command.nr_lbas += nr_lbas;
+			copied += nr_lbas;
+			destination_lba += nr_lbas;
+		}
+	}
+	return commands;
+}
+
+bool NvmeDevice::GetZoneGeometry(DeviceZoneGeometry &geometry) {
+	if (!zoned) {
+		return false;
+	}
+	geometry = zone_geometry;
+	return true;
+}
+
+idx_t NvmeDevice::ZoneAppend(void *buffer, const CmdContext &context) {
+	if (!zoned) {
+		return Device::ZoneAppend(buffer, context);
+	}
+	D_ASSERT(context.offset == 0);
+
+	bool split = context.nr_lbas > max_append_lbas;
+	std::shared_lock<std::shared_mutex> shared_guard(append_lock, std::defer_lock);
+	std::unique_lock<std::shared_mutex> exclusive_guard(append_lock, std::defer_lock);
+	if (split) {
+		exclusive_guard.lock();
+	} else {
+		shared_guard.lock();
+	}
+
+	bool direct = CanUseBufferDirectly(buffer, context);
+	idx_t buffer_size = context.nr_lbas * geometry.lba_size;
+	data_ptr_t dev_buffer = direct ? static_cast<data_ptr_t>(buffer) : AllocateBuffer(buffer_size);
+	if (!direct) {
+		memcpy(dev_buffer, buffer, context.nr_bytes);
+		memset(dev_buffer + context.nr_bytes, 0, buffer_size - context.nr_bytes);
+	}
+
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+	optional_idx first_lba;
+	for (idx_t appended = 0; appended < context.nr_lbas;) {
+		idx_t nr_lbas = MinValue<idx_t>(max_append_lbas, context.nr_lbas - appended);
+		xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
+		int err = xnvme_znd_append(&xnvme_ctx, nsid, context.start_lba, nr_lbas - 1,
+		                           dev_buffer + appended * geometry.lba_size, nullptr);
+		if (err || xnvme_cmd_ctx_cpl_status(&xnvme_ctx)) {
+			if (!direct) {
+				FreeBuffer(dev_buffer, buffer_size);
+			}
+			xnvme_cli_perr("Could not append to zone with xnvme_znd_append(): ", err);
+			throw IOException("Encountered error when appending to the zone at LBA %llu", context.start_lba);
+		}
+		// The completion carries the LBA that the data was written to
+		if (!first_lba.IsValid()) {
+			first_lba = xnvme_ctx.cpl.result;
+		}
+		appended += nr_lbas;
+	}
+
+	if (!direct) {
+		FreeBuffer(dev_buffer, buffer_size);
+	}
+	lba_cache->Invalidate(first_lba.GetIndex(), context.nr_lbas);
+	return first_lba.GetIndex();
+}
+
+void NvmeDevice::ResetZone(idx_t zone_start_lba) {
+	if (!zoned) {
+		return Device::ResetZone(zone_start_lba);
+	}
+
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+	xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
+	int err = xnvme_znd_mgmt_send(&xnvme_ctx, nsid, zone_start_lba, false, XNVME_SPEC_ZND_CMD_MGMT_SEND_RESET,
+	                              static_cast<xnvme_spec_znd_mgmt_send_action_so>(0), nullptr);
+	if (err || xnvme_cmd_ctx_cpl_status(&xnvme_ctx)) {
+		xnvme_cli_perr("Could not reset zone with xnvme_znd_mgmt_send(): ", err);
+		throw IOException("Encountered error when resetting the zone at LBA %llu", zone_start_lba);
+	}
+	lba_cache->Invalidate(zone_start_lba, zone_geometry.zone_size);
+}
+
+idx_t NvmeDevice::GetZoneWritePointer(idx_t zone_start_lba) {
+	if (!zoned) {
+		return Device::GetZoneWritePointer(zone_start_lba);
+	}
+
+	xnvme_znd_report *report = xnvme_znd_report_from_dev(device, zone_start_lba, 1, 0);
+	if (!report) {
+		xnvme_cli_perr("xnvme_znd_report_from_dev()", errno);
+		throw IOException("Unable to report the zone at LBA %llu", zone_start_lba);
+	}
+	const xnvme_spec_znd_descr *descriptor = XNVME_ZND_REPORT_DESCR(report, 0);
+	idx_t write_pointer = descriptor->zs == NVME_ZONE_STATE_FULL ? zone_start_lba + descriptor->zcap : descriptor->wp;
+	xnvme_buf_virt_free(report);
+	return write_pointer;
+}
+
+data_ptr_t NvmeDevice::AllocateBuffer(idx_t nr_bytes) {
+	return buffer_pool->Allocate(nr_bytes);
+}
+
+void NvmeDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	buffer_pool->Free(buffer, nr_bytes);
+}
+
+vector<DeviceQueueStatistics> NvmeDevice::GetQueueStatistics() {
+	vector<DeviceQueueStatistics> statistics;
+	auto add_queue = [&](const string &owner, const QueueDepthController &controller) {
+		statistics.push_back(DeviceQueueStatistics {statistics.size(), owner, controller.GetMaxDepth(),
+		                                            controller.GetWindow(), controller.GetTargetLatency(),
+		                                            controller.GetAverageLatency(), controller.GetCompletionCount()});
+	};
+
+	if (queue_registry) {
+		queue_registry->ForEachQueue(add_queue);
+	}
+	if (reactor) {
+		for (idx_t i = 0; i < reactor->GetPollerCount(); i++) {
+			add_queue("reactor " + std::to_string(i), reactor->GetController(i));
 		}
 	}
+	return statistics;
+}
+
+void NvmeDevice::SetThreadCount(idx_t nr_threads) {
+	if (queue_registry) {
+		queue_registry->Resize(MaxValue<idx_t>(nr_threads, 1));
+	}
+}
+
+bool NvmeDevice::CanUseBufferDirectly(const void *buffer, const CmdContext &context) {
+	// The command must cover whole LBAs of the caller's buffer
+	if (context.offset != 0 || context.nr_bytes != context.nr_lbas * geometry.lba_size) {
+		return false;
+	}
+
+	if (reinterpret_cast<uintptr_t>(buffer) % direct_io_alignment != 0) {
+		return false;
+	}
 
-	return placement_identifier;
+	// Kernel backends can DMA from any user memory. SPDK requires memory that it has allocated itself.
+	return !spdk || buffer_pool->IsArenaBuffer(static_cast<const_data_ptr_t>(buffer));
 }
 
-nvme_buf_ptr NvmeDevice::AllocateDeviceBuffer(idx_t nr_bytes) {
-	return xnvme_buf_alloc(device, nr_bytes);
+bool NvmeDevice::SplitRequests(const DeviceIORequest *requests, idx_t count, idx_t max_transfer_lbas, idx_t lba_size,
+                               vector<NvmeCmdContext> &sub_contexts, vector<DeviceIORequest> &sub_requests) {
+	bool split = false;
+	idx_t nr_sub_requests = 0;
+	for (idx_t i = 0; i < count; i++) {
+		idx_t nr_lbas = requests[i].context->nr_lbas;
+		nr_sub_requests += (nr_lbas + max_transfer_lbas - 1) / max_transfer_lbas;
+		split = split || nr_lbas == 0 || nr_lbas > max_transfer_lbas;
+	}
+	if (!split) {
+		return false;
+	}
+
+	// Sub-commands reference their contexts, hence the contexts must not be reallocated
+	sub_contexts.reserve(nr_sub_requests);
+	sub_requests.reserve(nr_sub_requests);
+
+	for (idx_t i = 0; i < count; i++) {
+		const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(*requests[i].context);
+		if (ctx.nr_lbas == 0) {
+			continue;
+		}
+		if (ctx.nr_lbas <= max_transfer_lbas) {
+			sub_requests.push_back(requests[i]);
+			continue;
+		}
+
+		// Only the first sub-command starts at an offset into its first LBA, the following ones continue where the
+		// previous one ended
+		data_ptr_t buffer = static_cast<data_ptr_t>(requests[i].buffer);
+		idx_t remaining_bytes = ctx.nr_bytes;
+		idx_t offset = ctx.offset;
+		for (idx_t lba = 0; lba < ctx.nr_lbas; lba += max_transfer_lbas) {
+			NvmeCmdContext sub_ctx = ctx;
+			sub_ctx.start_lba = ctx.start_lba + lba;
+			sub_ctx.nr_lbas = MinValue<idx_t>(max_transfer_lbas, ctx.nr_lbas - lba);
+			sub_ctx.offset = offset;
+			sub_ctx.nr_bytes = MinValue<idx_t>(remaining_bytes, sub_ctx.nr_lbas * lba_size - offset);
+			sub_contexts.push_back(std::move(sub_ctx));
+			sub_requests.push_back(DeviceIORequest {buffer, &sub_contexts.back()});
+
+			buffer += sub_contexts.back().nr_bytes;
+			remaining_bytes -= sub_contexts.back().nr_bytes;
+			offset = 0;
+		}
+	}
+
+	return true;
 }
 
-void NvmeDevice::FreeDeviceBuffer(nvme_buf_ptr buffer) {
-	xnvme_buf_free(device, buffer);
+idx_t NvmeDevice::LoadMaxTransferLBAs() {
+	const xnvme_geo *geo = xnvme_dev_get_geo(device);
+
+	// An MDTS of 0 means that the controller does not limit the transfer size
+	idx_t max_lbas = NVME_MAX_COMMAND_LBAS;
+	if (geo->mdts_nbytes > 0) {
+		max_lbas = MinValue<idx_t>(max_lbas, geo->mdts_nbytes / geometry.lba_size);
+	}
+	return MaxValue<idx_t>(max_lbas, 1);
 }
 
 DeviceGeometry NvmeDevice::LoadDeviceGeometry() {
@@ -140,6 +593,34 @@ DeviceGeometry NvmeDevice::LoadDeviceGeometry() {
 	return geometry;
 }
 
+bool NvmeDevice::LoadZoneGeometry() {
+	const xnvme_geo *geo = xnvme_dev_get_geo(device);
+	if (geo->type != XNVME_GEO_ZONED) {
+		return false;
+	}
+
+	zone_geometry.conventional_lbas = 0;
+	zone_geometry.zone_size = geo->nsect;
+	zone_geometry.zone_capacity = geo->nsect;
+	zone_geometry.nr_zones = geo->nzone;
+
+	// The zone capacity is the same for all zones of a namespace, hence the first zone is representative
+	xnvme_znd_report *report = xnvme_znd_report_from_dev(device, 0, 1, 0);
+	if (report) {
+		zone_geometry.zone_capacity = XNVME_ZND_REPORT_DESCR(report, 0)->zcap;
+		xnvme_buf_virt_free(report);
+	}
+
+	// A zone append size limit of 0 means that appends are only limited by the maximum data transfer size
+	max_append_lbas = max_transfer_lbas;
+	const xnvme_spec_znd_idfy_ctrlr *zoned_ctrlr = xnvme_znd_dev_get_ctrlr(device);
+	if (zoned_ctrlr && zoned_ctrlr->zasl > 0) {
+		idx_t zasl_lbas = (NVME_MIN_MEMORY_PAGE_SIZE << zoned_ctrlr->zasl) / geometry.lba_size;
+		max_append_lbas = MaxValue<idx_t>(MinValue<idx_t>(max_append_lbas, zasl_lbas), 1);
+	}
+	return true;
+}
+
 void NvmeDevice::PrepareOpts(xnvme_opts &opts) {
 	if (StringUtil::Equals(this->backend.data(), "spdk")) {
 		opts.be = "spdk";
@@ -157,153 +638,372 @@ void NvmeDevice::PrepareOpts(xnvme_opts &opts) {
 }
 
 void NvmeDevice::CommandCallback(struct xnvme_cmd_ctx *ctx, void *cb_args) {
-	// Cast callback args into defined callback struct
-	std::promise<void> *notifier = (std::promise<void> *)cb_args;
+	NvmeCommand *command = (NvmeCommand *)cb_args;
 
 	// Check status
+	uint16_t status = 0;
 	if (xnvme_cmd_ctx_cpl_status(ctx)) {
 		xnvme_cli_pinf("Command did not complete successfully");
 		xnvme_cmd_ctx_pr(ctx, XNVME_PR_DEF);
+		status = ctx->cpl.status.val;
+	}
+
+	if (command->controller) {
+		auto latency = std::chrono::steady_clock::now() - command->submit_time;
+		command->controller->RecordCompletion(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
 	}
 
-	// Put command context back to queue, and notify the future
+	// Put command context back to queue, and notify the submitter. The command must not be accessed afterwards, as
+	// the submitter may discard it as soon as it is complete
 	xnvme_queue_put_cmd_ctx(ctx->async.queue, ctx);
-	notifier->set_value();
+	command->completion->Complete(status);
 }
 
 idx_t NvmeDevice::ReadAsync(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return SubmitBatchAsync(&request, 1, false);
+}
 
-	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(context);
-	D_ASSERT(ctx.nr_lbas > 0);
-	// We only support offset reads within a single block
-	D_ASSERT((ctx.offset == 0 && ctx.nr_lbas > 1) || (ctx.offset >= 0 && ctx.nr_lbas == 1));
+idx_t NvmeDevice::WriteAsync(void *buffer, const CmdContext &context) {
+	DeviceIORequest request {buffer, &context};
+	return SubmitBatchAsync(&request, 1, true);
+}
 
-	nvme_buf_ptr dev_buffer = AllocateDeviceBuffer(ctx.nr_bytes);
+idx_t NvmeDevice::SubmitBatchAsync(const DeviceIORequest *requests, idx_t count, bool write) {
+	if (count == 0) {
+		return 0;
+	}
+	if (write) {
+		return SubmitWriteBatchAsync(requests, count);
+	}
 
-	uint32_t nsid = xnvme_dev_get_nsid(device);
-	uint8_t plid_idx = GetPlacementIdentifierOrDefault(ctx.filepath);
+	// Read into a device buffer for every command that can not use the caller's buffer directly
+	vector<data_ptr_t> dev_buffers(count, nullptr);
+	vector<NvmeCommand> commands(count);
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		const CmdContext &ctx = *requests[i].context;
+		D_ASSERT(ctx.nr_lbas > 0);
 
-	idx_t thread_index = GetThreadIndex();
+		if (!CanUseBufferDirectly(requests[i].buffer, ctx)) {
+			dev_buffers[i] = AllocateBuffer(ctx.nr_lbas * geometry.lba_size);
+		}
+		data_ptr_t buffer = dev_buffers[i] ? dev_buffers[i] : static_cast<data_ptr_t>(requests[i].buffer);
+		commands[i] = NvmeCommand {&ctx, buffer, false, nullptr};
+		nr_lbas += ctx.nr_lbas;
+	}
 
-	xnvme_queue *queue = queues[thread_index];
+	NvmeCompletion completion(0, GetCompletionEventFd());
+	SubmitCommands(commands.data(), count, completion);
 
-	if (!queue) {
-		int err = xnvme_queue_init(device, XNVME_QUEUE_DEPTH, 0, &queues[thread_index]);
-		if (err) {
-			xnvme_cli_perr("Unable to create an queue for asynchronous IO", err);
+	for (idx_t i = 0; i < count; i++) {
+		if (!dev_buffers[i]) {
+			continue;
 		}
+		const CmdContext &ctx = *requests[i].context;
+		memcpy(requests[i].buffer, dev_buffers[i] + ctx.offset, ctx.nr_bytes);
+		FreeBuffer(dev_buffers[i], ctx.nr_lbas * geometry.lba_size);
+	}
+
+	CheckCompletion(completion);
+	return nr_lbas;
+}
+
+idx_t NvmeDevice::SubmitWriteBatchAsync(const DeviceIORequest *requests, idx_t count) {
+	const idx_t lba_size = geometry.lba_size;
+	// Commands reference the contexts of the plan, hence the plan must not change once commands are created
+	const NvmeWriteBatchPlan plan = PlanWriteBatch(requests, count, lba_size);
+
+	// The partial LBAs stay locked until they have been written and cached, such that a concurrent partial write to
+	// one of them is merged with the result of this batch
+	PartialLBALocks::Guard guard = lba_locks.Lock(plan.GetPartialLBAs());
+
+	// Whole LBAs are submitted from the caller's buffer, or through a device buffer if it is not usable for DMA
+	vector<pair<data_ptr_t, idx_t>> dev_buffers;
+	vector<NvmeCommand> commands;
+	for (auto &full_write : plan.full_writes) {
+		const NvmeCmdContext &ctx = full_write.context;
+		lba_cache->Invalidate(ctx.start_lba, ctx.nr_lbas);
+
+		data_ptr_t buffer = const_cast<data_ptr_t>(full_write.data);
+		if (!CanUseBufferDirectly(buffer, ctx)) {
+			buffer = AllocateBuffer(ctx.nr_bytes);
+			memcpy(buffer, full_write.data, ctx.nr_bytes);
+			dev_buffers.emplace_back(buffer, ctx.nr_bytes);
+		}
+		commands.push_back(NvmeCommand {&ctx, buffer, true, nullptr});
+	}
 
-		queue = queues[thread_index];
+	// Partial LBAs that are not cached are read in parallel with the whole LBAs, and written once merged
+	vector<data_ptr_t> partial_buffers;
+	bool needs_read = false;
+	for (auto &partial : plan.partial_writes) {
+		data_ptr_t buffer = AllocateBuffer(lba_size);
+		partial_buffers.push_back(buffer);
+		if (!lba_cache->Lookup(partial.start_lba, buffer)) {
+			commands.push_back(NvmeCommand {&partial, buffer, false, nullptr});
+			needs_read = true;
+		}
 	}
 
-	xnvme_cmd_ctx *xnvme_ctx = xnvme_queue_get_cmd_ctx(queue);
-	PrepareIOCmdContext(xnvme_ctx, context, plid_idx, 0, false);
+	auto release_buffers = [&]() {
+		for (auto &dev_buffer : dev_buffers) {
+			FreeBuffer(dev_buffer.first, dev_buffer.second);
+		}
+		for (data_ptr_t buffer : partial_buffers) {
+			FreeBuffer(buffer, lba_size);
+		}
+	};
+	auto invalidate_partial_writes = [&]() {
+		for (auto &partial : plan.partial_writes) {
+			lba_cache->Invalidate(partial.start_lba, 1);
+		}
+	};
+
+	vector<NvmeCommand> partial_commands;
+	for (idx_t i = 0; i < plan.partial_writes.size(); i++) {
+		partial_commands.push_back(NvmeCommand {&plan.partial_writes[i], partial_buffers[i], true, nullptr});
+	}
+	if (!needs_read) {
+		// Everything is known up front, hence all commands are submitted at once
+		plan.ApplyMerges(partial_buffers);
+		commands.insert(commands.end(), partial_commands.begin(), partial_commands.end());
+		partial_commands.clear();
+	}
+
+	NvmeCompletion completion(0, GetCompletionEventFd());
+	SubmitCommands(commands.data(), commands.size(), completion);
+
+	if (completion.GetFailedCount() == 0 && !partial_commands.empty()) {
+		plan.ApplyMerges(partial_buffers);
+		NvmeCompletion partial_completion(0, GetCompletionEventFd());
+		SubmitCommands(partial_commands.data(), partial_commands.size(), partial_completion);
+		if (partial_completion.GetFailedCount() > 0) {
+			invalidate_partial_writes();
+			release_buffers();
+			CheckCompletion(partial_completion);
+		}
+	}
 
-	std::promise<void> cb_notify;
-	std::future<void> fut = cb_notify.get_future();
+	if (completion.GetFailedCount() > 0) {
+		invalidate_partial_writes();
+		release_buffers();
+		CheckCompletion(completion);
+	}
 
-	xnvme_cmd_ctx_set_cb(xnvme_ctx, CommandCallback, &cb_notify);
+	// Keep the written partial LBAs such that the next partial write to them does not need to read them
+	for (idx_t i = 0; i < plan.partial_writes.size(); i++) {
+		lba_cache->Insert(plan.partial_writes[i].start_lba, partial_buffers[i]);
+	}
+	release_buffers();
 
-	std::future_status status;
-	std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+	return plan.nr_lbas;
+}
 
-	int err = xnvme_nvm_read(xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, dev_buffer, nullptr);
-	if (err) {
-		xnvme_cli_perr("Could not submit command to queue with xnvme_nvme_read(): ", err);
-		throw IOException("Encountered error when writing to NVMe device");
+void NvmeDevice::SubmitCommands(NvmeCommand *commands, idx_t count, NvmeCompletion &completion) {
+	for (idx_t i = 0; i < count; i++) {
+		commands[i].completion = &completion;
 	}
 
-	do {
-		xnvme_queue_poke(queue, 0);
-		status = fut.wait_for(interval);
-	} while (status != std::future_status::ready);
+	if (reactor) {
+		// Hand the commands to a poller and park until it has reaped all of them
+		completion.AddCommands(count);
+		reactor->Submit(commands, count, GetThreadIndex());
+		NvmeReactor::Wait(completion);
+		return;
+	}
 
-	memcpy(buffer, dev_buffer + ctx.offset, ctx.nr_bytes);
+	NvmeQueueLease lease = queue_registry->Acquire();
+	if (lease.shared) {
+		queue_registry->SubmitShared(*lease.shared, commands, count, completion);
+		return;
+	}
 
-	FreeDeviceBuffer(dev_buffer);
+	xnvme_queue *queue = lease.queue;
+	QueueDepthController *controller = lease.controller;
+
+	idx_t submitted = 0;
+	while (submitted < count) {
+		NvmeCommand &command = commands[submitted];
+		command.controller = controller;
+
+		completion.AddCommands(1);
+		int err = SubmitCommand(queue, command);
+		if (err == -EBUSY || err == -EAGAIN) {
+			// The command was never submitted, hence it will never complete. All queue entries or the whole window
+			// are in flight, reap completions before retrying
+			completion.Complete(0);
+			xnvme_queue_poke(queue, 0);
+			continue;
+		}
+		if (err) {
+			// Fail the command but keep submitting, such that the caller can release its buffers once all commands
+			// have completed
+			xnvme_cli_perr("Could not submit command to queue: ", err);
+			completion.Complete(NVME_SUBMIT_ERROR_STATUS);
+		}
+		submitted++;
+	}
 
-	// auto end_time = std::chrono::high_resolution_clock::now();
-	// auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-	// // Print the duration
-	// printf("ReadAsync took %d milliseconds.\n", duration.count());
+	WaitForCompletion(completion, queue);
+}
 
-	return ctx.nr_lbas;
+int NvmeDevice::GetCompletionEventFd() {
+	return reactor ? NvmeCompletion::GetThreadEventFd() : -1;
 }
 
-idx_t NvmeDevice::WriteAsync(void *buffer, const CmdContext &context) {
-	// auto start_time = std::chrono::high_resolution_clock::now();
-	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(context);
-	D_ASSERT(ctx.nr_lbas > 0);
-	// We only support offset reads within a single block
-	D_ASSERT((ctx.offset == 0 && ctx.nr_lbas > 1) || (ctx.offset >= 0 && ctx.nr_lbas == 1));
+void NvmeDevice::CheckCompletion(const NvmeCompletion &completion) {
+	if (completion.GetFailedCount() > 0) {
+		throw IOException("%llu commands failed on NVMe device, last status 0x%x", completion.GetFailedCount(),
+		                  completion.GetStatus());
+	}
+}
 
-	// Prepare buffer
-	nvme_buf_ptr dev_buffer = AllocateDeviceBuffer(ctx.nr_bytes);
-	memcpy(dev_buffer, buffer + ctx.offset, ctx.nr_bytes);
+NvmePartialLBAs NvmeDevice::GetPartialLBAs(const CmdContext &context, idx_t lba_size) {
+	NvmePartialLBAs partial;
+	idx_t end = context.offset + context.nr_bytes;
+	idx_t last_lba = context.start_lba + context.nr_lbas - 1;
 
-	uint32_t nsid = xnvme_dev_get_nsid(device);
-	uint8_t plid_idx = GetPlacementIdentifierOrDefault(ctx.filepath);
+	if (context.offset > 0 || end < lba_size) {
+		partial.head = context.start_lba;
+	}
+	if (end % lba_size != 0 && !(partial.head.IsValid() && last_lba == context.start_lba)) {
+		partial.tail = last_lba;
+	}
+	return partial;
+}
 
-	idx_t thread_index = GetThreadIndex();
+NvmeWriteBatchPlan NvmeDevice::PlanWriteBatch(const DeviceIORequest *requests, idx_t count, idx_t lba_size) {
+	NvmeWriteBatchPlan plan;
+	unordered_map<idx_t, idx_t> partial_indexes;
+	auto add_merge = [&](const NvmeCmdContext &ctx, idx_t lba, idx_t offset, const_data_ptr_t data, idx_t nr_bytes) {
+		auto entry = partial_indexes.find(lba);
+		if (entry == partial_indexes.end()) {
+			NvmeCmdContext partial = ctx;
+			partial.start_lba = lba;
+			partial.nr_lbas = 1;
+			partial.offset = 0;
+			partial.nr_bytes = lba_size;
+			entry = partial_indexes.emplace(lba, plan.partial_writes.size()).first;
+			plan.partial_writes.push_back(partial);
+		}
+		plan.merges.push_back(NvmeWriteBatchPlan::Merge {entry->second, offset, data, nr_bytes});
+	};
+
+	for (idx_t i = 0; i < count; i++) {
+		const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(*requests[i].context);
+		const_data_ptr_t data = static_cast<const_data_ptr_t>(requests[i].buffer);
+		D_ASSERT(ctx.nr_lbas > 0);
+		D_ASSERT(ctx.nr_lbas == (ctx.offset + ctx.nr_bytes + lba_size - 1) / lba_size);
+		plan.nr_lbas += ctx.nr_lbas;
+
+		NvmePartialLBAs partial = GetPartialLBAs(ctx, lba_size);
+		idx_t head_bytes = 0;
+		if (partial.head.IsValid()) {
+			head_bytes = MinValue<idx_t>(lba_size - ctx.offset, ctx.nr_bytes);
+			add_merge(ctx, partial.head.GetIndex(), ctx.offset, data, head_bytes);
+		}
+		if (partial.tail.IsValid()) {
+			idx_t tail_bytes = (ctx.offset + ctx.nr_bytes) % lba_size;
+			add_merge(ctx, partial.tail.GetIndex(), 0, data + ctx.nr_bytes - tail_bytes, tail_bytes);
+		}
 
-	xnvme_queue *queue = queues[thread_index];
-	if (!queue) {
-		int err = xnvme_queue_init(device, XNVME_QUEUE_DEPTH, 0, &queues[thread_index]);
-		if (err) {
-			xnvme_cli_perr("Unable to create an queue for asynchronous IO", err);
+		idx_t middle_start = ctx.start_lba + (partial.head.IsValid() ? 1 : 0);
+		idx_t middle_end = ctx.start_lba + ctx.nr_lbas - (partial.tail.IsValid() ? 1 : 0);
+		if (middle_end <= middle_start) {
+			continue;
 		}
 
-		queue = queues[thread_index];
+		NvmeCmdContext middle = ctx;
+		middle.start_lba = middle_start;
+		middle.nr_lbas = middle_end - middle_start;
+		middle.offset = 0;
+		middle.nr_bytes = middle.nr_lbas * lba_size;
+		plan.full_writes.push_back(NvmeWriteBatchPlan::FullWrite {middle, data + head_bytes});
 	}
+	return plan;
+}
 
-	xnvme_cmd_ctx *xnvme_ctx = xnvme_queue_get_cmd_ctx(queue);
-	PrepareIOCmdContext(xnvme_ctx, context, plid_idx, DATA_PLACEMENT_MODE, true);
+vector<idx_t> NvmeWriteBatchPlan::GetPartialLBAs() const {
+	vector<idx_t> lbas;
+	for (auto &partial : partial_writes) {
+		lbas.push_back(partial.start_lba);
+	}
+	return lbas;
+}
 
-	std::promise<void> cb_notify;
-	std::future<void> fut = cb_notify.get_future();
+void NvmeWriteBatchPlan::ApplyMerges(const vector<data_ptr_t> &buffers) const {
+	for (auto &merge : merges) {
+		memcpy(buffers[merge.partial_index] + merge.offset, merge.data, merge.nr_bytes);
+	}
+}
 
-	xnvme_cmd_ctx_set_cb(xnvme_ctx, CommandCallback, &cb_notify);
+void NvmeDevice::LoadPartialLBA(const NvmeCmdContext &context, idx_t lba, data_ptr_t buffer) {
+	if (lba_cache->Lookup(lba, buffer)) {
+		return;
+	}
 
-	std::future_status status;
-	std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+	NvmeCmdContext read_ctx = context;
+	read_ctx.start_lba = lba;
+	read_ctx.nr_lbas = 1;
+	read_ctx.offset = 0;
+	read_ctx.nr_bytes = geometry.lba_size;
+	Read(buffer, read_ctx);
+}
 
-	int err = xnvme_nvm_write(xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, dev_buffer, nullptr);
-	if (err) {
-		xnvme_cli_perr("Could not submit command to queue with xnvme_nvme_write(): ", err);
-		throw IOException("Encountered error when writing to NVMe device");
+int NvmeDevice::SubmitCommand(xnvme_queue *queue, NvmeCommand &command) {
+	if (command.controller && xnvme_queue_get_outstanding(queue) >= command.controller->GetWindow()) {
+		return -EBUSY;
 	}
 
-	do {
-		xnvme_queue_poke(queue, 0);
-		status = fut.wait_for(interval);
-	} while (status != std::future_status::ready);
+	xnvme_cmd_ctx *xnvme_ctx = xnvme_queue_get_cmd_ctx(queue);
+	if (!xnvme_ctx) {
+		return -EBUSY;
+	}
 
-	FreeDeviceBuffer(dev_buffer);
+	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(*command.context);
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+	uint8_t plid_idx = ctx.placement_identifier;
 
-	// auto end_time = std::chrono::high_resolution_clock::now();
-	// auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-	// // Print the duration
-	// printf("WriteAsync took %d milliseconds.\n", duration.count());
+	PrepareIOCmdContext(xnvme_ctx, ctx, command.write);
+	xnvme_cmd_ctx_set_cb(xnvme_ctx, CommandCallback, &command);
+	command.submit_time = std::chrono::steady_clock::now();
 
-	return ctx.nr_lbas;
+	int err = command.write
+	              ? xnvme_nvm_write(xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, command.buffer, nullptr)
+	              : xnvme_nvm_read(xnvme_ctx, nsid, ctx.start_lba, ctx.nr_lbas - 1, command.buffer, nullptr);
+	if (err) {
+		xnvme_queue_put_cmd_ctx(queue, xnvme_ctx);
+	} else if (command.write) {
+		RecordPlacementWrite(plid_idx, ctx.nr_lbas);
+	}
+	return err;
 }
 
-void NvmeDevice::PrepareIOCmdContext(xnvme_cmd_ctx *ctx, const CmdContext &cmd_ctx, idx_t plid_idx, idx_t dtype,
-                                     bool write) {
-	const NvmeCmdContext &nvme_cmd_ctx = static_cast<const NvmeCmdContext &>(cmd_ctx);
+void NvmeDevice::WaitForCompletion(NvmeCompletion &completion, xnvme_queue *queue) {
+	idx_t pokes = 0;
+
+	while (!completion.IsComplete()) {
+		xnvme_queue_poke(queue, 0);
+		if (completion.IsComplete()) {
+			break;
+		}
 
-	// Specified by the command set specification:
-	// https://nvmexpress.org/wp-content/uploads/NVM-Express-NVM-Command-Set-Specification-Revision-1.1-2024.08.05-Ratified.pdf
-	// cdw12 specifies data placement (dtype) and number of lbas to write/read (0 indexed)
-	// cdw13 hold placement handle id in bit range 16-31
-	uint16_t nr_lbas = nvme_cmd_ctx.nr_lbas - 1;
+		// EVENTFD is only accepted with the reactor, whose waiters block in NvmeReactor::Wait
+		if (wait_strategy == NvmeWaitStrategy::SPIN_YIELD && ++pokes >= NVME_SPIN_YIELD_THRESHOLD) {
+			std::this_thread::yield();
+		}
+	}
+}
 
-	ctx->cmd.common.cdw12 = nr_lbas;
-	if (write && fdp) {
-		ctx->cmd.common.cdw12 |= dtype << 20;
+void NvmeDevice::PrepareIOCmdContext(xnvme_cmd_ctx *ctx, const CmdContext &cmd_ctx, bool write) {
+	const NvmeCmdContext &nvme_cmd_ctx = static_cast<const NvmeCmdContext &>(cmd_ctx);
 
-		uint16_t phid = placement_handlers[plid_idx];
-		ctx->cmd.common.cdw13 = phid << 16;
+	D_ASSERT(nvme_cmd_ctx.nr_lbas <= max_transfer_lbas);
+	NvmeDirectiveFields fields = NvmeDirectiveFields::ForCommand(nvme_cmd_ctx, write, placement_handlers);
+	ctx->cmd.common.cdw12 = fields.cdw12;
+	if (fields.GetDirectiveType() == DATA_PLACEMENT_MODE) {
+		ctx->cmd.common.cdw13 = fields.cdw13;
 	}
 }
 
@@ -322,11 +1022,43 @@ bool NvmeDevice::CheckFDP() {
 		xnvme_cli_perr("xnvme_cmd_pass_admin()", err);
 		xnvme_cmd_ctx_pr(&ctx, XNVME_PR_DEF);
 	}
-	// The first bit of cdw0 in the completion entry specifies if fdp is enabled
+	// The first bit of cdw0 in the completion entry specifies if fdp is enabled, bits 15:8 the configuration in use
+	fdp_configuration_index = (ctx.cpl.cdw0 >> 8) & 0xFF;
 	return ctx.cpl.cdw0 & 0x1;
 }
 
+bool NvmeDevice::CheckDeallocate() {
+	const xnvme_spec_idfy_ctrlr *ctrlr = xnvme_dev_get_ctrlr(device);
+	return ctrlr && ctrlr->oncs.dsm;
+}
+
+bool NvmeDevice::LoadCopyLimits() {
+	const xnvme_spec_idfy_ctrlr *ctrlr = xnvme_dev_get_ctrlr(device);
+	const xnvme_spec_idfy_ns *ns = xnvme_dev_get_ns(device);
+	if (!ctrlr || !ctrlr->oncs.copy || !ns) {
+		return false;
+	}
+
+	// MSRC is 0-based, while MSSRL and MCL are 1-based. Limits of 0 are treated as the smallest valid value.
+	max_copy_ranges = MinValue<idx_t>(static_cast<idx_t>(ns->msrc) + 1, NVME_MAX_COPY_RANGES);
+	max_copy_range_lbas = MinValue<idx_t>(MaxValue<idx_t>(ns->mssrl, 1), NVME_MAX_COPY_RANGE_LBAS);
+	max_copy_lbas = MaxValue<idx_t>(ns->mcl, 1);
+	return true;
+}
+
 void NvmeDevice::InitializePlacementHandles() {
+	placement_handlers = GetPlacementIdentifiers(ReadReclaimUnitHandleStatus());
+}
+
+vector<uint16_t> NvmeDevice::GetPlacementIdentifiers(const vector<xnvme_spec_ruhs_desc> &descriptors) {
+	vector<uint16_t> placement_identifiers;
+	for (const xnvme_spec_ruhs_desc &descriptor : descriptors) {
+		placement_identifiers.push_back(descriptor.pi);
+	}
+	return placement_identifiers;
+}
+
+vector<xnvme_spec_ruhs_desc> NvmeDevice::ReadReclaimUnitHandleStatus() {
 	uint32_t nsid = xnvme_dev_get_nsid(device);
 	xnvme_cmd_ctx xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
 
@@ -334,25 +1066,90 @@ void NvmeDevice::InitializePlacementHandles() {
 	struct xnvme_spec_ruhs header;
 	uint32_t header_bytes = sizeof(header);
 	xnvme_nvm_mgmt_recv(&xnvme_ctx, nsid, XNVME_SPEC_IO_MGMT_RECV_RUHS, 0, &header, header_bytes);
-	uint16_t max_placement_handles = header.nruhsd - 1;
 
 	// Retrieve information about recliam unit handles
 	struct xnvme_spec_ruhs *ruhs = nullptr;
-	uint32_t ruhs_nbytes = sizeof(*ruhs) + max_placement_handles * sizeof(struct xnvme_spec_ruhs_desc);
+	uint32_t ruhs_nbytes = sizeof(*ruhs) + header.nruhsd * sizeof(struct xnvme_spec_ruhs_desc);
 	ruhs = (struct xnvme_spec_ruhs *)xnvme_buf_alloc(device, ruhs_nbytes);
 	memset(ruhs, 0, ruhs_nbytes);
+	xnvme_ctx = xnvme_cmd_ctx_from_dev(device);
 	xnvme_nvm_mgmt_recv(&xnvme_ctx, nsid, XNVME_SPEC_IO_MGMT_RECV_RUHS, 0, ruhs, ruhs_nbytes);
 
-	for (int i = 0; i < max_placement_handles; ++i) {
-		placement_handlers.emplace_back(ruhs->desc[i].pi);
+	vector<xnvme_spec_ruhs_desc> descriptors(ruhs->desc, ruhs->desc + MinValue<uint16_t>(ruhs->nruhsd, header.nruhsd));
+	xnvme_buf_free(device, ruhs);
+	return descriptors;
+}
+
+bool NvmeDevice::ReadLogPage(uint8_t log_identifier, data_ptr_t buffer, uint32_t nr_bytes) {
+	uint32_t nsid = xnvme_dev_get_nsid(device);
+	void *log = xnvme_buf_alloc(device, nr_bytes);
+	if (!log) {
+		return false;
 	}
+	memset(log, 0, nr_bytes);
 
-	xnvme_buf_free(device, ruhs);
+	xnvme_cmd_ctx ctx = xnvme_cmd_ctx_from_dev(device);
+	xnvme_prep_adm_log(&ctx, log_identifier, 0x0, 0, nsid, 0, nr_bytes);
+	// The log specific identifier selects the endurance group of the FDP log pages
+	ctx.cmd.log.lsi = endurance_group;
+
+	int err = xnvme_cmd_pass_admin(&ctx, log, nr_bytes, NULL, 0x0);
+	if (!err) {
+		memcpy(buffer, log, nr_bytes);
+	}
+	xnvme_buf_free(device, log);
+	return !err;
+}
+
+bool NvmeDevice::ReadFDPStatisticsLog(idx_t &host_bytes_written, idx_t &media_bytes_written,
+                                      idx_t &media_bytes_erased) {
+	// The log holds 128-bit counters of the host bytes written (HBMW), media bytes written (MBMW) and media bytes
+	// erased (MBE), of which the lower 64 bits are used
+	data_t log[64];
+	if (!ReadLogPage(NVME_LOG_FDP_STATISTICS, log, sizeof(log))) {
+		return false;
+	}
+	host_bytes_written = Load<uint64_t>(log);
+	media_bytes_written = Load<uint64_t>(log + 16);
+	media_bytes_erased = Load<uint64_t>(log + 32);
+	return true;
+}
+
+idx_t NvmeDevice::LoadReclaimUnitSize() {
+	// The configurations log starts with a 16 byte header, holding the size of the whole log page in bytes 7:4
+	data_t header[16];
+	if (!ReadLogPage(NVME_LOG_FDP_CONFIGURATIONS, header, sizeof(header))) {
+		return 0;
+	}
+	uint32_t log_size = Load<uint32_t>(header + 4);
+	if (log_size <= sizeof(header)) {
+		return 0;
+	}
+
+	vector<data_t> log(log_size);
+	if (!ReadLogPage(NVME_LOG_FDP_CONFIGURATIONS, log.data(), log_size)) {
+		return 0;
+	}
+
+	// The header is followed by variable sized configuration descriptors, each starting with its size in bytes 1:0
+	// and holding the reclaim unit nominal size in bytes 23:16
+	idx_t offset = sizeof(header);
+	for (idx_t index = 0; offset + 24 <= log_size; index++) {
+		uint16_t descriptor_size = Load<uint16_t>(log.data() + offset);
+		if (index == fdp_configuration_index) {
+			return Load<uint64_t>(log.data() + offset + 16);
+		}
+		if (descriptor_size == 0) {
+			break;
+		}
+		offset += descriptor_size;
+	}
+	return 0;
 }
 
 idx_t NvmeDevice::GetThreadIndex() {
 	if (!index.IsValid()) {
-		index = thread_id_counter++ % max_threads;
+		index = thread_id_counter++;
 	}
 
 	return index.GetIndex();
@@ -0,0 +1,278 @@
+#include "nvme_queue_registry.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace duckdb {
+
+atomic<idx_t> NvmeQueueRegistry::registry_counter {0};
+thread_local NvmeQueueRegistry::ThreadLeases NvmeQueueRegistry::thread_leases;
+
+NvmeQueueFunctions NvmeQueueFunctions::ForDevice(xnvme_dev *device) {
+	NvmeQueueFunctions functions;
+	functions.init = [device](idx_t depth, xnvme_queue **queue) {
+		return xnvme_queue_init(device, depth, 0, queue);
+	};
+	functions.term = [](xnvme_queue *queue) {
+		xnvme_queue_term(queue);
+	};
+	return functions;
+}
+
+NvmeQueueRegistry::NvmeQueueRegistry(NvmeQueueFunctions queue_functions_p, idx_t nr_queues, idx_t queue_depth,
+                                     idx_t target_latency_us, reactor_submit_function_t submit_function)
+    : queue_functions(std::move(queue_functions_p)), queue_depth(queue_depth), target_latency_us(target_latency_us),
+      submit_function(std::move(submit_function)), id(registry_counter++), state(make_shared_ptr<State>()),
+      shared_counter(0) {
+	state->term = queue_functions.term;
+	for (idx_t i = 0; i < NVME_SHARED_QUEUE_COUNT; i++) {
+		unique_ptr<NvmeSharedQueue> shared = make_uniq<NvmeSharedQueue>();
+		shared->controller = make_uniq<QueueDepthController>(queue_depth, target_latency_us);
+		int err = queue_functions.init(queue_depth, &shared->queue);
+		if (err) {
+			xnvme_cli_perr("Unable to create a shared queue for asynchronous IO", err);
+			throw IOException("Unable to create a shared queue for asynchronous IO");
+		}
+		shared_queues.push_back(std::move(shared));
+	}
+
+	Resize(nr_queues);
+}
+
+NvmeQueueRegistry::~NvmeQueueRegistry() {
+	lock_guard<mutex> guard(state->lock);
+	state->closed = true;
+	for (auto &slot : state->slots) {
+		if (slot->queue) {
+			queue_functions.term(slot->queue);
+			slot->queue = nullptr;
+		}
+	}
+	for (auto &shared : shared_queues) {
+		queue_functions.term(shared->queue);
+	}
+}
+
+NvmeQueueLease NvmeQueueRegistry::Acquire() {
+	ThreadLease &lease = thread_leases.leases[id];
+
+	// Fast path, the thread already holds a dedicated queue
+	if (lease.slot_ptr) {
+		return NvmeQueueLease {lease.slot_ptr->queue, lease.slot_ptr->controller.get(), nullptr};
+	}
+
+	// Lease a dedicated queue on the first call, or once one has been returned by another thread
+	bool first = lease.state.expired();
+	if (first) {
+		// Drop the leases of registries that no longer exist
+		for (auto it = thread_leases.leases.begin(); it != thread_leases.leases.end();) {
+			if (it->first != id && it->second.state.expired()) {
+				it = thread_leases.leases.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+	if (first || state->nr_free.load() > 0) {
+		lock_guard<mutex> guard(state->lock);
+		lease.state = state;
+		if (!state->free_slots.empty()) {
+			idx_t index = state->free_slots.back();
+			state->free_slots.pop_back();
+			state->nr_free.store(state->free_slots.size());
+
+			Slot &slot = *state->slots[index];
+			slot.leased = true;
+			lease.slot = index;
+			lease.slot_ptr = &slot;
+			return NvmeQueueLease {slot.queue, slot.controller.get(), nullptr};
+		}
+		if (first) {
+			lease.shared = shared_counter++ % shared_queues.size();
+		}
+	}
+
+	NvmeSharedQueue &shared = *shared_queues[lease.shared];
+	return NvmeQueueLease {shared.queue, shared.controller.get(), &shared};
+}
+
+void NvmeQueueRegistry::Resize(idx_t nr_queues) {
+	lock_guard<mutex> guard(state->lock);
+
+	idx_t active = 0;
+	for (auto &slot : state->slots) {
+		if (slot->queue && !slot->retired) {
+			active++;
+		}
+	}
+
+	// Grow by reusing slots whose queue has been destroyed, or reviving retired ones that are still leased
+	for (idx_t i = 0; i < state->slots.size() && active < nr_queues; i++) {
+		Slot &slot = *state->slots[i];
+		if (slot.retired) {
+			slot.retired = false;
+			active++;
+		} else if (!slot.queue) {
+			InitializeSlot(slot);
+			state->free_slots.push_back(i);
+			active++;
+		}
+	}
+	while (active < nr_queues) {
+		state->slots.push_back(make_uniq<Slot>());
+		InitializeSlot(*state->slots.back());
+		state->free_slots.push_back(state->slots.size() - 1);
+		active++;
+	}
+
+	// Shrink by destroying free queues first, and retiring leased queues afterwards
+	while (active > nr_queues && !state->free_slots.empty()) {
+		Slot &slot = *state->slots[state->free_slots.back()];
+		state->free_slots.pop_back();
+		queue_functions.term(slot.queue);
+		slot.queue = nullptr;
+		active--;
+	}
+	for (idx_t i = 0; i < state->slots.size() && active > nr_queues; i++) {
+		Slot &slot = *state->slots[i];
+		if (slot.queue && slot.leased && !slot.retired) {
+			slot.retired = true;
+			active--;
+		}
+	}
+
+	state->nr_free.store(state->free_slots.size());
+}
+
+void NvmeQueueRegistry::SubmitShared(NvmeSharedQueue &shared, NvmeCommand *commands, idx_t count,
+                                     NvmeCompletion &completion) {
+	if (count == 0) {
+		return;
+	}
+
+	completion.AddCommands(count);
+	// Link the commands in reverse order, like the rest of the submission stack
+	for (idx_t i = 0; i < count; i++) {
+		commands[i].controller = shared.controller.get();
+		commands[i].next = i > 0 ? &commands[i - 1] : nullptr;
+	}
+
+	// Push the chain of commands onto the submission stack
+	NvmeCommand *head = shared.submissions.load(std::memory_order_relaxed);
+	do {
+		commands[0].next = head;
+	} while (!shared.submissions.compare_exchange_weak(head, &commands[count - 1], std::memory_order_release,
+	                                                   std::memory_order_relaxed));
+
+	idx_t attempts = 0;
+	while (!completion.IsComplete()) {
+		if (!shared.polling.exchange(true, std::memory_order_acquire)) {
+			PollShared(shared);
+			shared.polling.store(false, std::memory_order_release);
+		} else if (++attempts >= NVME_SPIN_YIELD_THRESHOLD) {
+			// Another submitter is polling on our behalf
+			std::this_thread::yield();
+		}
+	}
+}
+
+idx_t NvmeQueueRegistry::GetQueueCount() {
+	lock_guard<mutex> guard(state->lock);
+	idx_t count = 0;
+	for (auto &slot : state->slots) {
+		if (slot->queue && !slot->retired) {
+			count++;
+		}
+	}
+	return count;
+}
+
+void NvmeQueueRegistry::ForEachQueue(
+    const std::function<void(const string &owner, const QueueDepthController &controller)> &callback) {
+	lock_guard<mutex> guard(state->lock);
+	for (idx_t i = 0; i < state->slots.size(); i++) {
+		Slot &slot = *state->slots[i];
+		if (slot.queue) {
+			callback("thread " + std::to_string(i), *slot.controller);
+		}
+	}
+	for (idx_t i = 0; i < shared_queues.size(); i++) {
+		callback("shared " + std::to_string(i), *shared_queues[i]->controller);
+	}
+}
+
+void NvmeQueueRegistry::InitializeSlot(Slot &slot) {
+	slot.controller = make_uniq<QueueDepthController>(queue_depth, target_latency_us);
+	int err = queue_functions.init(queue_depth, &slot.queue);
+	if (err) {
+		xnvme_cli_perr("Unable to create an queue for asynchronous IO", err);
+		slot.queue = nullptr;
+		throw IOException("Unable to create a queue for asynchronous IO");
+	}
+}
+
+void NvmeQueueRegistry::PollShared(NvmeSharedQueue &shared) {
+	// Take all pushed commands, restoring their order of submission
+	NvmeCommand *head = shared.submissions.exchange(nullptr, std::memory_order_acquire);
+	idx_t first_new = shared.pending.size();
+	for (NvmeCommand *command = head; command; command = command->next) {
+		shared.pending.push_back(command);
+	}
+	std::reverse(shared.pending.begin() + first_new, shared.pending.end());
+
+	idx_t submitted = 0;
+	for (; submitted < shared.pending.size(); submitted++) {
+		NvmeCommand &command = *shared.pending[submitted];
+
+		int err = submit_function(shared.queue, command);
+		if (err == -EBUSY || err == -EAGAIN) {
+			// Queue or window is full, the remaining commands are submitted once completions have been reaped
+			break;
+		}
+		if (err) {
+			xnvme_cli_perr("Could not submit command to shared queue: ", err);
+			command.completion->Complete(NVME_SUBMIT_ERROR_STATUS);
+		}
+	}
+	shared.pending.erase(shared.pending.begin(), shared.pending.begin() + submitted);
+
+	if (xnvme_queue_get_outstanding(shared.queue) > 0) {
+		xnvme_queue_poke(shared.queue, 0);
+	}
+}
+
+void NvmeQueueRegistry::State::Release(idx_t index) {
+	Slot &slot = *slots[index];
+	slot.leased = false;
+	if (closed || !slot.queue) {
+		return;
+	}
+
+	if (slot.retired) {
+		slot.retired = false;
+		term(slot.queue);
+		slot.queue = nullptr;
+		return;
+	}
+
+	free_slots.push_back(index);
+	nr_free.store(free_slots.size());
+}
+
+NvmeQueueRegistry::ThreadLeases::~ThreadLeases() {
+	for (auto &entry : leases) {
+		ThreadLease &lease = entry.second;
+		if (!lease.slot.IsValid()) {
+			continue;
+		}
+
+		// The registry may have been destroyed before the thread exits
+		shared_ptr<State> state = lease.state.lock();
+		if (state) {
+			lock_guard<mutex> guard(state->lock);
+			state->Release(lease.slot.GetIndex());
+		}
+	}
+}
+
+} // namespace duckdb
@@ -0,0 +1,195 @@
+#include "nvme_reactor.hpp"
+
+#include <algorithm>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace duckdb {
+
+NvmeReactor::NvmeReactor(xnvme_dev *device, idx_t nr_pollers, const vector<idx_t> &cpus, idx_t queue_depth,
+                         idx_t target_latency_us, reactor_submit_function_t submit_function)
+    : submit_function(std::move(submit_function)), shutdown(false) {
+	D_ASSERT(nr_pollers > 0);
+
+	try {
+		for (idx_t i = 0; i < nr_pollers; i++) {
+			// The poller is kept before its resources are created, such that Stop releases them on failure
+			pollers.push_back(make_uniq<Poller>());
+			Poller &poller = *pollers.back();
+			poller.controller = make_uniq<QueueDepthController>(queue_depth, target_latency_us);
+
+			int err = xnvme_queue_init(device, queue_depth, 0, &poller.queue);
+			if (err) {
+				poller.queue = nullptr;
+				xnvme_cli_perr("Unable to create a queue for the reactor", err);
+				throw IOException("Unable to create a queue for the reactor");
+			}
+
+			poller.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (poller.wake_fd < 0) {
+				throw IOException("Unable to create an eventfd for the reactor");
+			}
+		}
+
+		for (idx_t i = 0; i < nr_pollers; i++) {
+			optional_idx cpu = cpus.empty() ? optional_idx() : optional_idx(cpus[i % cpus.size()]);
+			Poller &poller = *pollers[i];
+			poller.thread = std::thread([this, &poller, cpu]() { Run(poller, cpu); });
+		}
+	} catch (...) {
+		// The destructor does not run for a reactor that failed to construct
+		Stop();
+		throw;
+	}
+}
+
+NvmeReactor::~NvmeReactor() {
+	Stop();
+}
+
+void NvmeReactor::Stop() {
+	shutdown.store(true);
+
+	for (auto &poller : pollers) {
+		if (poller->wake_fd >= 0) {
+			uint64_t value = 1;
+			ssize_t written = write(poller->wake_fd, &value, sizeof(value));
+			(void)written;
+		}
+	}
+
+	for (auto &poller : pollers) {
+		if (poller->thread.joinable()) {
+			poller->thread.join();
+		}
+		if (poller->queue) {
+			xnvme_queue_term(poller->queue);
+		}
+		if (poller->wake_fd >= 0) {
+			close(poller->wake_fd);
+		}
+	}
+	pollers.clear();
+}
+
+void NvmeReactor::Submit(NvmeCommand *commands, idx_t count, idx_t hint) {
+	Poller &poller = *pollers[hint % pollers.size()];
+	{
+		lock_guard<mutex> guard(poller.submission_lock);
+		for (idx_t i = 0; i < count; i++) {
+			commands[i].controller = poller.controller.get();
+			poller.submissions.push_back(&commands[i]);
+		}
+	}
+
+	// Wake the poller in case it is idle
+	uint64_t value = 1;
+	ssize_t written = write(poller.wake_fd, &value, sizeof(value));
+	(void)written;
+}
+
+void NvmeReactor::Wait(NvmeCompletion &completion) {
+	D_ASSERT(completion.GetEventFd() >= 0);
+	while (!completion.IsComplete()) {
+		NvmeCompletion::WaitEventFd(completion.GetEventFd(), NVME_REACTOR_IDLE_WAIT_US);
+	}
+}
+
+/// @brief Parses a CPU number, which must consist of digits only and fit in a cpu_set_t
+static idx_t ParseCpu(const string &cpu, const string &entry) {
+	if (cpu.empty() || cpu.size() > 9 || !std::all_of(cpu.begin(), cpu.end(), StringUtil::CharacterIsDigit)) {
+		throw InvalidInputException("Invalid CPU '%s' in reactor CPU list", entry);
+	}
+	idx_t result = std::stoull(cpu);
+	if (result >= CPU_SETSIZE) {
+		throw InvalidInputException("CPU %llu in reactor CPU list exceeds the maximum of %d", result, CPU_SETSIZE - 1);
+	}
+	return result;
+}
+
+vector<idx_t> NvmeReactor::ParseCpuList(const string &cpus) {
+	vector<idx_t> result;
+	if (cpus.empty()) {
+		return result;
+	}
+
+	for (string entry : StringUtil::Split(cpus, ",")) {
+		StringUtil::Trim(entry);
+		idx_t dash = entry.find('-');
+		idx_t first = ParseCpu(entry.substr(0, dash), entry);
+		idx_t last = dash == string::npos ? first : ParseCpu(entry.substr(dash + 1), entry);
+		if (last < first) {
+			throw InvalidInputException("Invalid CPU range '%s' in reactor CPU list", entry);
+		}
+
+		for (idx_t cpu = first; cpu <= last; cpu++) {
+			if (std::find(result.begin(), result.end(), cpu) != result.end()) {
+				throw InvalidInputException("CPU %llu is listed twice in reactor CPU list", cpu);
+			}
+			result.push_back(cpu);
+		}
+	}
+	return result;
+}
+
+void NvmeReactor::Run(Poller &poller, optional_idx cpu) {
+	if (cpu.IsValid()) {
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(cpu.GetIndex(), &cpu_set);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+	}
+
+	vector<NvmeCommand *> pending;
+	vector<NvmeCommand *> incoming;
+
+	while (true) {
+		{
+			lock_guard<mutex> guard(poller.submission_lock);
+			incoming.swap(poller.submissions);
+		}
+		pending.insert(pending.end(), incoming.begin(), incoming.end());
+		incoming.clear();
+
+		SubmitPending(poller, pending);
+
+		if (xnvme_queue_get_outstanding(poller.queue) > 0) {
+			// Reap all available completions, which wakes up their waiters through the completion callback
+			xnvme_queue_poke(poller.queue, 0);
+			continue;
+		}
+
+		if (!pending.empty()) {
+			continue;
+		}
+
+		if (shutdown.load()) {
+			break;
+		}
+
+		// Nothing in flight, park until a submitter wakes the poller
+		NvmeCompletion::WaitEventFd(poller.wake_fd, NVME_REACTOR_IDLE_WAIT_US);
+	}
+}
+
+void NvmeReactor::SubmitPending(Poller &poller, vector<NvmeCommand *> &pending) {
+	idx_t submitted = 0;
+	for (; submitted < pending.size(); submitted++) {
+		NvmeCommand &command = *pending[submitted];
+
+		int err = submit_function(poller.queue, command);
+		if (err == -EBUSY || err == -EAGAIN) {
+			// Queue or window is full, the remaining commands are submitted once completions have been reaped
+			break;
+		}
+		if (err) {
+			xnvme_cli_perr("Reactor could not submit command: ", err);
+			command.completion->Complete(NVME_SUBMIT_ERROR_STATUS);
+		}
+	}
+
+	pending.erase(pending.begin(), pending.begin() + submitted);
+}
+
+} // namespace duckdb
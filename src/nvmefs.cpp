@@ -1,8 +1,10 @@
 #include "nvmefs.hpp"
+#include "duckdb/parallel/task_scheduler.hpp"
 
 namespace duckdb {
 NvmeFileHandle::NvmeFileHandle(FileSystem &file_system, string path, FileOpenFlags flags)
-    : FileHandle(file_system, path, flags), cursor_offset(0) {
+    : FileHandle(file_system, path, flags), cursor_offset(0), lba_size(0), lba_shift(0), type(MetadataType::DATABASE),
+      region_start(0), region_end(0), placement_identifier(0), hot_placement_identifier(0), temp_file(nullptr) {
 }
 
 void NvmeFileHandle::Read(void *buffer, idx_t nr_bytes, idx_t location) {
@@ -24,33 +26,19 @@ void NvmeFileHandle::Sync() {
 void NvmeFileHandle::Close() {
 }
 
-unique_ptr<CmdContext> NvmeFileHandle::PrepareWriteCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset) {
-	unique_ptr<NvmeCmdContext> nvme_cmd_ctx = make_uniq<NvmeCmdContext>();
-	nvme_cmd_ctx->nr_bytes = nr_bytes;
-	nvme_cmd_ctx->filepath = path;
-	nvme_cmd_ctx->offset = offset;
-	nvme_cmd_ctx->start_lba = start_lba;
-	nvme_cmd_ctx->nr_lbas = CalculateRequiredLBACount(nr_bytes);
+NvmeCmdContext NvmeFileHandle::PrepareCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset) {
+	NvmeCmdContext nvme_cmd_ctx;
+	nvme_cmd_ctx.nr_bytes = nr_bytes;
+	nvme_cmd_ctx.offset = offset;
+	nvme_cmd_ctx.start_lba = start_lba;
+	nvme_cmd_ctx.nr_lbas = CalculateRequiredLBACount(offset + nr_bytes);
+	nvme_cmd_ctx.placement_identifier = placement_identifier;
 
-	return std::move(nvme_cmd_ctx);
-}
-
-unique_ptr<CmdContext> NvmeFileHandle::PrepareReadCommand(idx_t nr_bytes, idx_t start_lba, idx_t offset) {
-	unique_ptr<NvmeCmdContext> nvme_cmd_ctx = make_uniq<NvmeCmdContext>();
-	nvme_cmd_ctx->nr_bytes = nr_bytes;
-	nvme_cmd_ctx->filepath = path;
-	nvme_cmd_ctx->offset = offset;
-	nvme_cmd_ctx->start_lba = start_lba;
-	nvme_cmd_ctx->nr_lbas = CalculateRequiredLBACount(nr_bytes);
-
-	return std::move(nvme_cmd_ctx);
+	return nvme_cmd_ctx;
 }
 
 idx_t NvmeFileHandle::CalculateRequiredLBACount(idx_t nr_bytes) {
-	NvmeFileSystem &nvmefs = file_system.Cast<NvmeFileSystem>();
-	DeviceGeometry geo = nvmefs.GetDevice().GetDeviceGeometry();
-	idx_t lba_size = geo.lba_size;
-	return (nr_bytes + lba_size - 1) / lba_size;
+	return (nr_bytes + lba_size - 1) >> lba_shift;
 }
 
 void NvmeFileHandle::SetFilePointer(idx_t location) {
@@ -66,14 +54,58 @@ idx_t NvmeFileHandle::GetFilePointer() {
 std::recursive_mutex NvmeFileSystem::temp_lock;
 
 NvmeFileSystem::NvmeFileSystem(NvmeConfig config)
-    : allocator(Allocator::DefaultAllocator()),
-      device(make_uniq<NvmeDevice>(config.device_path, config.backend, config.async, config.max_threads)),
-      max_temp_size(config.max_temp_size), max_wal_size(config.max_wal_size), db_location(0), wal_location(0) {
+    : allocator(Allocator::DefaultAllocator()), config(config), device(CreateDevice(config)),
+      max_temp_size(config.max_temp_size), max_wal_size(config.max_wal_size),
+      temp_extent_size(config.temp_extent_size), hot_write_threshold(config.hot_write_threshold),
+      write_tracking_range_size(config.write_tracking_range_size), db_location(0), wal_location(0),
+      checksums_dirty_lba(DConstants::INVALID_INDEX), thread_count(config.max_threads) {
+	if (config.background_deallocation) {
+		deallocator = make_uniq<BackgroundDeallocator>(*device);
+	}
+	BindDevice();
 }
 
 NvmeFileSystem::NvmeFileSystem(NvmeConfig config, unique_ptr<Device> device)
-    : allocator(Allocator::DefaultAllocator()), device(std::move(device)), max_temp_size(config.max_temp_size),
-      max_wal_size(config.max_wal_size), db_location(0), wal_location(0) {
+    : allocator(Allocator::DefaultAllocator()), config(config), device(std::move(device)),
+      max_temp_size(config.max_temp_size), max_wal_size(config.max_wal_size),
+      temp_extent_size(config.temp_extent_size), hot_write_threshold(config.hot_write_threshold),
+      write_tracking_range_size(config.write_tracking_range_size), db_location(0), wal_location(0),
+      checksums_dirty_lba(DConstants::INVALID_INDEX), thread_count(config.max_threads) {
+	if (config.background_deallocation) {
+		deallocator = make_uniq<BackgroundDeallocator>(*this->device);
+	}
+	BindDevice();
+}
+
+unique_ptr<Device> NvmeFileSystem::CreateDevice(const NvmeConfig &config) {
+	unique_ptr<Device> device;
+	if (config.backend == NVMEFS_FILE_BACKEND) {
+		device = make_uniq<FileDevice>(config);
+	} else {
+		device = make_uniq<NvmeDevice>(config);
+	}
+	if (config.region_offset > 0 || config.region_size > 0) {
+		idx_t lba_size = device->GetDeviceGeometry().lba_size;
+		idx_t start_lba = GetRegionLBAs(config.region_offset, lba_size, "region_offset");
+		idx_t lba_count = GetRegionLBAs(config.region_size, lba_size, "region_size");
+		device = make_uniq<RegionDevice>(std::move(device), start_lba, lba_count);
+	}
+	if (!config.zns_device_path.empty()) {
+		NvmeConfig zoned_config = config;
+		zoned_config.device_path = config.zns_device_path;
+		device = make_uniq<HybridZonedDevice>(std::move(device), make_uniq<NvmeDevice>(zoned_config));
+	}
+	if (!config.emulation_profile.empty()) {
+		device = make_uniq<EmulatedDevice>(std::move(device), EmulatedDeviceProfile::Load(config.emulation_profile));
+	}
+	return device;
+}
+
+idx_t NvmeFileSystem::GetRegionLBAs(idx_t nr_bytes, idx_t lba_size, const string &option) {
+	if (nr_bytes % lba_size != 0) {
+		throw InvalidInputException("%s must be a multiple of the LBA size %llu, got %llu", option, lba_size, nr_bytes);
+	}
+	return nr_bytes / lba_size;
 }
 
 NvmeFileSystem::~NvmeFileSystem() {
@@ -84,6 +116,8 @@ NvmeFileSystem::~NvmeFileSystem() {
 
 unique_ptr<FileHandle> NvmeFileSystem::OpenFile(const string &path, FileOpenFlags flags,
                                                 optional_ptr<FileOpener> opener) {
+	SyncThreadCount(opener);
+
 	bool internal = StringUtil::Equals(NVMEFS_GLOBAL_METADATA_PATH.data(), path.data());
 	if (!internal && !TryLoadMetadata()) {
 		if (GetMetadataType(path) != MetadataType::DATABASE) {
@@ -93,53 +127,205 @@ unique_ptr<FileHandle> NvmeFileSystem::OpenFile(const string &path, FileOpenFlag
 		}
 	}
 
-	if (path == NVMEFS_GLOBAL_METADATA_PATH) {
-		return make_uniq<NvmeFileHandle>(*this, path, flags);
-	}
+	unique_ptr<NvmeFileHandle> handle = make_uniq<NvmeFileHandle>(*this, path, flags);
+	ResolveHandle(*handle);
 
-	if (flags.CreateFileIfNotExists() && GetMetadataType(path) == MetadataType::TEMPORARY) {
-		temp_meta_manager->CreateFile(path); // Create temporary file here since we ensure it is duckdb synchronized
+	if (!internal && flags.CreateFileIfNotExists() && handle->type == MetadataType::TEMPORARY) {
+		// Create temporary file here since we ensure it is duckdb synchronized
+		ResolveTemporaryFile(*handle, temp_meta_manager->GetOrCreateFile(path));
 	}
 
-	unique_ptr<FileHandle> handle = make_uniq<NvmeFileHandle>(*this, path, flags);
 	return std::move(handle);
 }
 
 void NvmeFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes, idx_t location) {
 	NvmeFileHandle &fh = handle.Cast<NvmeFileHandle>();
-	DeviceGeometry geo = device->GetDeviceGeometry();
-
-	idx_t cursor_offset = SeekPosition(handle);
-	location += cursor_offset;
-	idx_t nr_lbas = fh.CalculateRequiredLBACount(nr_bytes);
-	idx_t start_lba = GetLBA(handle.path, nr_bytes, location, nr_lbas);
-	idx_t in_block_offset = location % geo.lba_size;
-	unique_ptr<CmdContext> cmd_ctx = fh.PrepareReadCommand(nr_bytes, start_lba, in_block_offset);
-
-	if (!IsLBAInRange(handle.path, start_lba, cmd_ctx->nr_lbas)) {
-		throw IOException("Read out of range");
+	if (zoned_wal && fh.type == MetadataType::WAL) {
+		zoned_wal->Read(buffer, nr_bytes, location + fh.GetFilePointer());
+		if (checksums) {
+			VerifyZonedWALChecksums(fh, buffer, nr_bytes, location + fh.GetFilePointer());
+		}
+		return;
+	}
+	if (IsCompressedTemporaryFile(fh)) {
+		ReadCompressedTemporary(fh, buffer, nr_bytes, location);
+		return;
 	}
 
-	device->Read(buffer, *cmd_ctx);
+	if (nvme_device) {
+		ReadInternal(*nvme_device, handle.Cast<NvmeFileHandle>(), buffer, nr_bytes, location);
+	} else {
+		ReadInternal(*device, handle.Cast<NvmeFileHandle>(), buffer, nr_bytes, location);
+	}
 }
 
 void NvmeFileSystem::Write(FileHandle &handle, void *buffer, int64_t nr_bytes, idx_t location) {
 	NvmeFileHandle &fh = handle.Cast<NvmeFileHandle>();
-	DeviceGeometry geo = device->GetDeviceGeometry();
+	// Zones are only written sequentially, hence the WAL and temporary files are appended on a zoned device
+	if (zoned_wal && fh.type == MetadataType::WAL) {
+		zoned_wal->Write(buffer, nr_bytes, location + fh.GetFilePointer());
+		if (checksums) {
+			RecordZonedWALChecksums(buffer, nr_bytes, location + fh.GetFilePointer());
+		}
+		wal_location.store(metadata->wal_start + zoned_wal->GetSizeLBAs());
+		return;
+	}
+	if (zoned && fh.type == MetadataType::TEMPORARY) {
+		WriteZonedTemporary(fh, buffer, nr_bytes, location);
+		return;
+	}
+	if (IsCompressedTemporaryFile(fh)) {
+		WriteCompressedTemporary(fh, buffer, nr_bytes, location);
+		return;
+	}
 
-	idx_t cursor_offset = SeekPosition(handle);
-	location += cursor_offset;
-	idx_t nr_lbas = fh.CalculateRequiredLBACount(nr_bytes);
-	idx_t start_lba = GetLBA(fh.path, nr_bytes, location, nr_lbas);
-	idx_t in_block_offset = location % geo.lba_size;
-	unique_ptr<CmdContext> cmd_ctx = fh.PrepareWriteCommand(nr_bytes, start_lba, in_block_offset);
+	if (nvme_device) {
+		WriteInternal(*nvme_device, handle.Cast<NvmeFileHandle>(), buffer, nr_bytes, location);
+	} else {
+		WriteInternal(*device, handle.Cast<NvmeFileHandle>(), buffer, nr_bytes, location);
+	}
+}
 
-	if (!IsLBAInRange(handle.path, start_lba, cmd_ctx->nr_lbas)) {
+template <class DEVICE>
+void NvmeFileSystem::ReadInternal(DEVICE &dev, NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location) {
+	location += fh.GetFilePointer();
+	idx_t in_block_offset = location & (fh.lba_size - 1);
+	idx_t nr_lbas = fh.CalculateRequiredLBACount(in_block_offset + nr_bytes);
+	idx_t start_lba = GetLBA(fh, location, nr_lbas);
+	NvmeCmdContext cmd_ctx = fh.PrepareCommand(nr_bytes, start_lba, in_block_offset);
+	ReadCommand(dev, fh, buffer, cmd_ctx);
+}
+
+template <class DEVICE>
+void NvmeFileSystem::ReadCommand(DEVICE &dev, NvmeFileHandle &fh, void *buffer, NvmeCmdContext &cmd_ctx) {
+	if (!IsLBAInRange(fh, cmd_ctx.start_lba, cmd_ctx.nr_lbas)) {
 		throw IOException("Read out of range");
 	}
 
-	idx_t written_lbas = device->Write(buffer, *cmd_ctx);
-	UpdateMetadata(*cmd_ctx);
+	if (deallocator) {
+		deallocator->NotifyIO();
+	}
+	if (readahead && fh.type == MetadataType::DATABASE && readahead->Read(buffer, cmd_ctx)) {
+		return;
+	}
+	dev.Read(buffer, cmd_ctx);
+	if (checksums && fh.type != MetadataType::DATABASE) {
+		VerifyChecksums(fh, cmd_ctx, buffer);
+	}
+}
+
+template <class DEVICE>
+void NvmeFileSystem::WriteInternal(DEVICE &dev, NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location) {
+	location += fh.GetFilePointer();
+	idx_t in_block_offset = location & (fh.lba_size - 1);
+	idx_t nr_lbas = fh.CalculateRequiredLBACount(in_block_offset + nr_bytes);
+	idx_t start_lba = GetLBA(fh, location, nr_lbas);
+	NvmeCmdContext cmd_ctx = fh.PrepareCommand(nr_bytes, start_lba, in_block_offset);
+	WriteCommand(dev, fh, buffer, cmd_ctx);
+}
+
+template <class DEVICE>
+void NvmeFileSystem::WriteCommand(DEVICE &dev, NvmeFileHandle &fh, void *buffer, NvmeCmdContext &cmd_ctx) {
+	if (!IsLBAInRange(fh, cmd_ctx.start_lba, cmd_ctx.nr_lbas)) {
+		throw IOException("Read out of range");
+	}
+
+	if (fh.type == MetadataType::DATABASE && write_tracker) {
+		// Ranges that are rewritten often are kept apart from data that is written once
+		if (write_tracker->RecordWrite(cmd_ctx.start_lba, cmd_ctx.nr_lbas)) {
+			cmd_ctx.placement_identifier = fh.hot_placement_identifier;
+		}
+	}
+	if (deallocator) {
+		// The LBAs are in use again, they must not be deallocated after they have been written
+		deallocator->Cancel(cmd_ctx.start_lba, cmd_ctx.nr_lbas);
+		deallocator->NotifyIO();
+	}
+	dev.Write(buffer, cmd_ctx);
+	if (readahead && fh.type == MetadataType::DATABASE) {
+		readahead->Invalidate(cmd_ctx.start_lba, cmd_ctx.nr_lbas);
+	}
+	if (checksums && fh.type != MetadataType::DATABASE) {
+		// DuckDB checksums the blocks of the database itself
+		checksums->RecordWrite(cmd_ctx.start_lba, cmd_ctx.offset, static_cast<const_data_ptr_t>(buffer),
+		                       cmd_ctx.nr_bytes);
+		if (fh.type == MetadataType::WAL) {
+			MarkChecksumsDirty(cmd_ctx.start_lba);
+		}
+	}
+	UpdateMetadata(fh, cmd_ctx);
+}
+
+bool NvmeFileSystem::IsCompressedTemporaryFile(NvmeFileHandle &handle) {
+	// Blocks in the smaller size classes have been compressed by DuckDB already
+	return temp_compressor && handle.type == MetadataType::TEMPORARY &&
+	       GetTemporaryFile(handle).block_size == NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE;
+}
+
+void NvmeFileSystem::ReadCompressedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location) {
+	location += fh.GetFilePointer();
+	TempFileMetadata &temp_file = GetTemporaryFile(fh);
+	if (nr_bytes != temp_file.block_size || location % temp_file.block_size != 0) {
+		throw IOException("Temporary file block size mismatch");
+	}
+
+	TemporaryBlockSlot slot = temp_meta_manager->GetBlockSlot(temp_file, location);
+	idx_t slot_bytes = slot.nr_lbas << lba_shift;
+	if (slot_bytes == nr_bytes) {
+		NvmeCmdContext cmd_ctx = fh.PrepareCommand(nr_bytes, slot.start_lba, 0);
+		ReadCommand(*device, fh, buffer, cmd_ctx);
+		return;
+	}
+
+	data_ptr_t compressed = device->AllocateBuffer(slot_bytes);
+	try {
+		NvmeCmdContext cmd_ctx = fh.PrepareCommand(slot_bytes, slot.start_lba, 0);
+		ReadCommand(*device, fh, compressed, cmd_ctx);
+		temp_compressor->Decompress(compressed, slot_bytes, static_cast<data_ptr_t>(buffer), nr_bytes);
+	} catch (...) {
+		device->FreeBuffer(compressed, slot_bytes);
+		throw;
+	}
+	device->FreeBuffer(compressed, slot_bytes);
+}
+
+void NvmeFileSystem::WriteCompressedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location) {
+	location += fh.GetFilePointer();
+	TempFileMetadata &temp_file = GetTemporaryFile(fh);
+	if (nr_bytes != temp_file.block_size) {
+		throw IOException("Temporary file block size mismatch");
+	}
+
+	// The block is compressed on the writing thread, into a buffer that the device writes from without a copy
+	data_ptr_t compressed = device->AllocateBuffer(nr_bytes);
+	try {
+		idx_t compressed_bytes =
+		    temp_compressor->Compress(static_cast<const_data_ptr_t>(buffer), nr_bytes, compressed);
+		void *data = compressed_bytes > 0 ? compressed : buffer;
+		idx_t data_bytes = compressed_bytes > 0 ? compressed_bytes : nr_bytes;
+
+		idx_t start_lba = temp_meta_manager->AllocateBlockSlot(temp_file, location, data_bytes >> lba_shift);
+		NvmeCmdContext cmd_ctx = fh.PrepareCommand(data_bytes, start_lba, 0);
+		WriteCommand(*device, fh, data, cmd_ctx);
+	} catch (...) {
+		device->FreeBuffer(compressed, nr_bytes);
+		throw;
+	}
+	device->FreeBuffer(compressed, nr_bytes);
+}
+
+void NvmeFileSystem::WriteZonedTemporary(NvmeFileHandle &fh, void *buffer, idx_t nr_bytes, idx_t location) {
+	location += fh.GetFilePointer();
+	TempFileMetadata &temp_file = GetTemporaryFile(fh);
+	idx_t nr_lbas = fh.CalculateRequiredLBACount(nr_bytes);
+	idx_t zone_start = temp_meta_manager->ReserveZoneBlock(temp_file, location, nr_lbas);
+
+	NvmeCmdContext cmd_ctx = fh.PrepareCommand(nr_bytes, zone_start, 0);
+	idx_t lba = device->ZoneAppend(buffer, cmd_ctx);
+	if (checksums) {
+		checksums->RecordWrite(lba, 0, static_cast<const_data_ptr_t>(buffer), nr_bytes);
+	}
+	temp_meta_manager->MapZoneBlock(temp_file, location, lba);
 }
 
 int64_t NvmeFileSystem::Read(FileHandle &handle, void *buffer, int64_t nr_bytes) {
@@ -247,6 +433,11 @@ void NvmeFileSystem::Truncate(FileHandle &handle, int64_t new_size) {
 
 		switch (type) {
 		case MetadataType::WAL: {
+			if (zoned_wal) {
+				zoned_wal->Truncate(new_size);
+				wal_location.store(metadata->wal_start + zoned_wal->GetSizeLBAs());
+				break;
+			}
 			idx_t expected_location = wal_location.load();
 			idx_t new_location = metadata->wal_start + new_lba_location;
 
@@ -303,6 +494,13 @@ void NvmeFileSystem::RemoveFile(const string &filename, optional_ptr<FileOpener>
 
 	switch (type) {
 	case WAL:
+		if (zoned_wal) {
+			// Resets the zones of the WAL
+			zoned_wal->Truncate(0);
+		} else if (deallocator) {
+			// The WAL entries are no longer needed, hence the LBAs can be released before the WAL is reused
+			deallocator->Add(metadata->wal_start, wal_location.load() - metadata->wal_start);
+		}
 		// Reset the location poitner (next lba to write to) to the start effectively removing the wal
 		wal_location.store(metadata->wal_start);
 		break;
@@ -332,7 +530,7 @@ void NvmeFileSystem::Seek(FileHandle &handle, idx_t location) {
 		max_seek_bound = ((metadata->tmp_start - 1) - metadata->wal_start) * geo.lba_size;
 		break;
 	case DATABASE:
-		max_seek_bound = ((metadata->wal_start - 1) - metadata->db_start) * geo.lba_size;
+		max_seek_bound = (GetDatabaseEnd(*metadata) - metadata->db_start) * geo.lba_size;
 		break;
 	case TEMPORARY: {
 		max_seek_bound = temp_meta_manager->GetFileSizeLBA(nvme_handle.path) * geo.lba_size;
@@ -388,7 +586,7 @@ optional_idx NvmeFileSystem::GetAvailableDiskSpace(const string &path) {
 	optional_idx remaining;
 
 	if (StringUtil::Equals(path.data(), NVMEFS_PATH_PREFIX.data())) {
-		idx_t db_max_bytes = ((metadata->wal_start - 1) - metadata->db_start) * geo.lba_size;
+		idx_t db_max_bytes = (GetDatabaseEnd(*metadata) - metadata->db_start) * geo.lba_size;
 		idx_t wal_max_bytes = ((metadata->tmp_start - 1) - metadata->wal_start) * geo.lba_size;
 
 		idx_t db_used_bytes = (db_location.load() - metadata->db_start) * geo.lba_size;
@@ -408,14 +606,375 @@ Device &NvmeFileSystem::GetDevice() {
 	return *device;
 }
 
+optional_ptr<BackgroundDeallocator> NvmeFileSystem::GetDeallocator() {
+	return deallocator.get();
+}
+
+unique_ptr<TemporaryFileMetadataManager> NvmeFileSystem::CreateTempMetaManager(idx_t tmp_start) {
+	DeviceGeometry geo = device->GetDeviceGeometry();
+
+	if (zoned) {
+		// Every extent is a zone, which is reset when its file is deleted
+		block_free_function_t reset_function = [this](idx_t start_lba, idx_t nr_lbas) { device->ResetZone(start_lba); };
+		return make_uniq<TemporaryFileMetadataManager>(tmp_start, zone_geometry.GetZoneStart(zone_geometry.nr_zones),
+		                                               geo.lba_size, zone_geometry.zone_size * geo.lba_size,
+		                                               reset_function, zone_geometry.zone_capacity);
+	}
+
+	block_free_function_t block_free_function = nullptr;
+	if (deallocator) {
+		block_free_function = [this](idx_t start_lba, idx_t nr_lbas) { deallocator->Add(start_lba, nr_lbas); };
+	}
+	return make_uniq<TemporaryFileMetadataManager>(tmp_start, geo.lba_count - 1, geo.lba_size, temp_extent_size,
+	                                               block_free_function);
+}
+
+unique_ptr<WriteFrequencyTracker> NvmeFileSystem::CreateWriteFrequencyTracker(const GlobalMetadata &global) {
+	if (hot_write_threshold == 0) {
+		return nullptr;
+	}
+	// Without a separate handle for hot ranges, the writes would be placed the same either way
+	string db_path(global.db_path, global.db_path_size);
+	if (device->GetHotPlacementIdentifier(db_path) == device->GetPlacementIdentifier(db_path, 0)) {
+		return nullptr;
+	}
+	idx_t range_lbas = MaxValue<idx_t>(write_tracking_range_size >> lba_shift, 1);
+	return make_uniq<WriteFrequencyTracker>(global.db_start, global.wal_start, range_lbas, hot_write_threshold);
+}
+
+optional_ptr<WriteFrequencyTracker> NvmeFileSystem::GetWriteFrequencyTracker() {
+	return write_tracker.get();
+}
+
+unique_ptr<BlockChecksumTable> NvmeFileSystem::CreateChecksumTable(const GlobalMetadata &global) {
+	if (!config.block_checksums) {
+		return nullptr;
+	}
+	// The WAL and the temporary region are adjacent and extend to the end of the device
+	return make_uniq<BlockChecksumTable>(global.wal_start, device->GetDeviceGeometry().lba_count, lba_size);
+}
+
+void NvmeFileSystem::MarkChecksumsDirty(idx_t start_lba) {
+	idx_t dirty_lba = checksums_dirty_lba.load();
+	while (start_lba < dirty_lba && !checksums_dirty_lba.compare_exchange_weak(dirty_lba, start_lba)) {
+	}
+}
+
+void NvmeFileSystem::PersistChecksums(GlobalMetadata &global) {
+	if (global.checksum_start == 0) {
+		return;
+	}
+	idx_t end_lba = wal_location.load();
+	if (!checksums) {
+		// The WAL may have been written without checksums since they were persisted, which makes them stale
+		global.checksum_location = global.wal_start;
+		return;
+	}
+
+	idx_t dirty_lba = checksums_dirty_lba.exchange(DConstants::INVALID_INDEX);
+	if (dirty_lba < end_lba) {
+		// Whole LBAs of entries are written, from the one that holds the entry of the first changed LBA
+		idx_t entries_per_lba = lba_size / BLOCK_CHECKSUM_ENTRY_SIZE;
+		idx_t first = (dirty_lba - global.wal_start) / entries_per_lba;
+		idx_t last = (end_lba - global.wal_start + entries_per_lba - 1) / entries_per_lba;
+		idx_t nr_bytes = (last - first) * lba_size;
+
+		data_ptr_t buffer = device->AllocateBuffer(nr_bytes);
+		checksums->Serialize(global.wal_start + first * entries_per_lba, (last - first) * entries_per_lba, buffer);
+		NvmeCmdContext cmd_ctx;
+		cmd_ctx.nr_bytes = nr_bytes;
+		cmd_ctx.nr_lbas = last - first;
+		cmd_ctx.start_lba = global.checksum_start + first;
+		cmd_ctx.offset = 0;
+		try {
+			device->Write(buffer, cmd_ctx);
+		} catch (...) {
+			device->FreeBuffer(buffer, nr_bytes);
+			MarkChecksumsDirty(dirty_lba);
+			throw;
+		}
+		device->FreeBuffer(buffer, nr_bytes);
+	}
+	global.checksum_location = end_lba;
+}
+
+void NvmeFileSystem::LoadChecksums(const GlobalMetadata &global) {
+	if (!checksums || global.checksum_start == 0) {
+		return;
+	}
+	idx_t end_lba = MinValue<idx_t>(global.checksum_location, global.wal_location);
+	if (end_lba <= global.wal_start) {
+		return;
+	}
+	idx_t nr_lbas = end_lba - global.wal_start;
+
+	idx_t entries_per_lba = lba_size / BLOCK_CHECKSUM_ENTRY_SIZE;
+	idx_t nr_bytes = ((nr_lbas + entries_per_lba - 1) / entries_per_lba) * lba_size;
+	data_ptr_t buffer = device->AllocateBuffer(nr_bytes);
+	NvmeCmdContext cmd_ctx;
+	cmd_ctx.nr_bytes = nr_bytes;
+	cmd_ctx.nr_lbas = nr_bytes / lba_size;
+	cmd_ctx.start_lba = global.checksum_start;
+	cmd_ctx.offset = 0;
+	try {
+		device->Read(buffer, cmd_ctx);
+	} catch (...) {
+		device->FreeBuffer(buffer, nr_bytes);
+		throw;
+	}
+	checksums->Deserialize(global.wal_start, nr_lbas, buffer);
+	device->FreeBuffer(buffer, nr_bytes);
+}
+
+idx_t NvmeFileSystem::GetDatabaseEnd(const GlobalMetadata &global) {
+	// The LBA before the WAL is left free, the zoned WAL keeps its partial last LBA there
+	return global.checksum_start != 0 ? global.checksum_start : global.wal_start - 1;
+}
+
+optional_ptr<BlockChecksumTable> NvmeFileSystem::GetBlockChecksums() {
+	return checksums.get();
+}
+
+optional_ptr<TemporaryBlockCompressor> NvmeFileSystem::GetTemporaryBlockCompressor() {
+	return temp_compressor.get();
+}
+
+unique_ptr<ScanReadahead> NvmeFileSystem::CreateScanReadahead(const GlobalMetadata &global) {
+	if (config.readahead_size == 0) {
+		return nullptr;
+	}
+	return make_uniq<ScanReadahead>(*device, global.db_start, GetDatabaseEnd(global), config.readahead_size);
+}
+
+optional_ptr<ScanReadahead> NvmeFileSystem::GetScanReadahead() {
+	return readahead.get();
+}
+
+void NvmeFileSystem::VerifyChecksums(const NvmeFileHandle &handle, const CmdContext &context, const void *buffer) {
+	optional_idx lba = checksums->Verify(context.start_lba, context.offset, static_cast<const_data_ptr_t>(buffer),
+	                                     context.nr_bytes);
+	if (lba.IsValid()) {
+		throw IOException("Checksum mismatch in LBA %llu of %s", lba.GetIndex(), handle.path);
+	}
+}
+
+void NvmeFileSystem::RecordZonedWALChecksums(const void *buffer, idx_t nr_bytes, idx_t location) {
+	idx_t start_lba = metadata->wal_start + (location >> lba_shift);
+	checksums->RecordWrite(start_lba, location & (lba_size - 1), static_cast<const_data_ptr_t>(buffer), nr_bytes);
+	MarkChecksumsDirty(start_lba);
+}
+
+void NvmeFileSystem::VerifyZonedWALChecksums(const NvmeFileHandle &handle, const void *buffer, idx_t nr_bytes,
+                                             idx_t location) {
+	idx_t offset = location & (lba_size - 1);
+	idx_t nr_lbas = (offset + nr_bytes + lba_size - 1) >> lba_shift;
+	CmdContext context {nr_bytes, nr_lbas, metadata->wal_start + (location >> lba_shift), offset};
+	VerifyChecksums(handle, context, buffer);
+}
+
+NvmeCloneStatistics NvmeFileSystem::CloneDatabase(const string &target_path, idx_t target_offset) {
+	if (target_path == config.device_path) {
+		// The device is not opened twice, the clone goes to another region of the open device, which copies the data
+		// within the namespace
+		auto region = dynamic_cast<RegionDevice *>(device.get());
+		if (!region) {
+			throw InvalidInputException(
+			    "Can not clone the database onto its own device %s, unless the database is kept in a region of it",
+			    target_path);
+		}
+		DeviceGeometry geo = device->GetDeviceGeometry();
+		RegionDevice target(region->GetDevice(), GetRegionLBAs(target_offset, geo.lba_size, "The offset of a clone"),
+		                    geo.lba_count);
+		return CloneDatabase(target);
+	}
+	if (target_path == config.zns_device_path) {
+		throw InvalidInputException("Can not clone the database onto its own device %s", target_path);
+	}
+	NvmeConfig target_config = config;
+	target_config.device_path = target_path;
+	target_config.zns_device_path = "";
+	target_config.emulation_profile = "";
+	target_config.region_offset = target_offset;
+	unique_ptr<Device> target = CreateDevice(target_config);
+	return CloneDatabase(*target);
+}
+
+NvmeCloneStatistics NvmeFileSystem::CloneDatabase(Device &target) {
+	if (!TryLoadMetadata()) {
+		throw IOException("There is no database on %s to clone", device->GetName());
+	}
+	if (zoned) {
+		// The WAL in the zones is laid out differently from a WAL on a conventional device
+		throw NotImplementedException("Cloning a database that keeps its WAL in zones is not supported");
+	}
+	auto region = dynamic_cast<RegionDevice *>(device.get());
+	auto target_region = dynamic_cast<RegionDevice *>(&target);
+	if (&target == device.get() || (region && region->Overlaps(target)) ||
+	    (target_region && target_region->Overlaps(*device))) {
+		throw InvalidInputException("Can not clone the database onto LBAs of its own region");
+	}
+	DeviceGeometry geo = device->GetDeviceGeometry();
+	DeviceGeometry target_geo = target.GetDeviceGeometry();
+	if (target_geo.lba_size != geo.lba_size) {
+		throw InvalidInputException("The LBA size of %s is %llu, while the database uses %llu", target.GetName(),
+		                            target_geo.lba_size, geo.lba_size);
+	}
+	if (target_geo.lba_count <= metadata->tmp_start) {
+		throw InvalidInputException("%s has %llu LBAs, while the database needs more than %llu", target.GetName(),
+		                            target_geo.lba_count, metadata->tmp_start);
+	}
+
+	// Persists the current end of the database and WAL, which the clone inherits
+	WriteMetadata(*metadata);
+
+	NvmeCloneStatistics statistics;
+	DeviceLBARange database {metadata->db_start, metadata->db_location - metadata->db_start};
+	DeviceLBARange wal {metadata->wal_start, metadata->wal_location - metadata->wal_start};
+	// The persisted checksums of the WAL go along with it
+	DeviceLBARange checksum {metadata->checksum_start, 0};
+	if (metadata->checksum_start != 0 && metadata->checksum_location > metadata->wal_start) {
+		idx_t entries_per_lba = geo.lba_size / BLOCK_CHECKSUM_ENTRY_SIZE;
+		idx_t nr_entries = metadata->checksum_location - metadata->wal_start;
+		checksum.nr_lbas = (nr_entries + entries_per_lba - 1) / entries_per_lba;
+	}
+	DeviceLBARange global {NVMEFS_GLOBAL_METADATA_LOCATION, 1};
+	for (const DeviceLBARange &range : {database, wal, checksum, global}) {
+		if (range.nr_lbas > 0) {
+			statistics.offloaded &= CopyLBAs(&range, 1, target, range.start_lba);
+		}
+	}
+	statistics.database_bytes = database.nr_lbas * geo.lba_size;
+	statistics.wal_bytes = wal.nr_lbas * geo.lba_size;
+	return statistics;
+}
+
+bool NvmeFileSystem::CopyLBAs(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	if (device->Copy(ranges, count, destination, destination_lba)) {
+		return true;
+	}
+
+	// The ranges are read and written in batches of commands, such that the devices have several commands in flight
+	DeviceGeometry geo = device->GetDeviceGeometry();
+	idx_t command_lbas = MaxValue<idx_t>(NVMEFS_COPY_COMMAND_SIZE / geo.lba_size, 1);
+	idx_t buffer_size = command_lbas * geo.lba_size * NVMEFS_COPY_BATCH_SIZE;
+	data_ptr_t buffer = device->AllocateBuffer(buffer_size);
+	vector<NvmeCmdContext> reads;
+	vector<NvmeCmdContext> writes;
+	vector<DeviceIORequest> read_requests;
+	vector<DeviceIORequest> write_requests;
+
+	auto submit = [&]() {
+		for (idx_t i = 0; i < reads.size(); i++) {
+			read_requests.push_back(DeviceIORequest {buffer + i * command_lbas * geo.lba_size, &reads[i]});
+			write_requests.push_back(DeviceIORequest {buffer + i * command_lbas * geo.lba_size, &writes[i]});
+		}
+		try {
+			device->ReadBatch(read_requests.data(), read_requests.size());
+			destination.WriteBatch(write_requests.data(), write_requests.size());
+		} catch (...) {
+			device->FreeBuffer(buffer, buffer_size);
+			throw;
+		}
+		reads.clear();
+		writes.clear();
+		read_requests.clear();
+		write_requests.clear();
+	};
+
+	for (idx_t i = 0; i < count; i++) {
+		for (idx_t copied = 0; copied < ranges[i].nr_lbas;) {
+			idx_t nr_lbas = MinValue<idx_t>(command_lbas, ranges[i].nr_lbas - copied);
+			NvmeCmdContext context;
+			context.nr_bytes = nr_lbas * geo.lba_size;
+			context.nr_lbas = nr_lbas;
+			context.offset = 0;
+			context.start_lba = ranges[i].start_lba + copied;
+			reads.push_back(context);
+			context.start_lba = destination_lba;
+			writes.push_back(context);
+
+			copied += nr_lbas;
+			destination_lba += nr_lbas;
+			if (reads.size() == NVMEFS_COPY_BATCH_SIZE) {
+				submit();
+			}
+		}
+	}
+	if (!reads.empty()) {
+		submit();
+	}
+
+	device->FreeBuffer(buffer, buffer_size);
+	return false;
+}
+
 bool NvmeFileSystem::Trim(FileHandle &handle, idx_t offset_bytes, idx_t length_bytes) {
+	NvmeFileHandle &fh = handle.Cast<NvmeFileHandle>();
+	DeviceGeometry geo = device->GetDeviceGeometry();
+
+	// Temporary files are not mapped linearly onto the device, hence only the database and WAL are deallocated
+	idx_t location = SeekPosition(handle) + offset_bytes;
+	idx_t first_full_byte = AlignValue<idx_t>(location, geo.lba_size);
+	idx_t last_full_byte = (location + length_bytes) / geo.lba_size * geo.lba_size;
+
+	if (zoned_wal && fh.type == MetadataType::WAL) {
+		// Zones can not be overwritten, and the WAL is only ever truncated as a whole
+		return false;
+	}
+
+	if (fh.type != MetadataType::TEMPORARY && first_full_byte < last_full_byte) {
+		idx_t nr_lbas = (last_full_byte - first_full_byte) / geo.lba_size;
+		idx_t start_lba = GetLBA(fh, first_full_byte, nr_lbas);
+		if (!IsLBAInRange(fh, start_lba, nr_lbas)) {
+			throw IOException("Trim out of range");
+		}
+
+		DeviceLBARange range {start_lba, nr_lbas};
+		if (device->Deallocate(&range, 1)) {
+			if (checksums) {
+				checksums->Invalidate(start_lba, nr_lbas);
+			}
+			if (readahead && fh.type == MetadataType::DATABASE) {
+				readahead->Invalidate(start_lba, nr_lbas);
+			}
+			// The deallocated LBAs remain part of the file
+			NvmeCmdContext cmd_ctx = fh.PrepareCommand(nr_lbas * geo.lba_size, start_lba, 0);
+			UpdateMetadata(fh, cmd_ctx);
+
+			// Only the partial LBAs at the edges are overwritten with zeros
+			TrimWithZeros(handle, offset_bytes, first_full_byte - location);
+			TrimWithZeros(handle, offset_bytes + (last_full_byte - location), location + length_bytes - last_full_byte);
+			return true;
+		}
+	}
+
+	TrimWithZeros(handle, offset_bytes, length_bytes);
+	return true;
+}
+
+void NvmeFileSystem::TrimWithZeros(FileHandle &handle, idx_t offset_bytes, idx_t length_bytes) {
+	if (length_bytes == 0) {
+		return;
+	}
+
 	data_ptr_t data = allocator.AllocateData(length_bytes);
 
 	memset(data, 0, length_bytes);
 	Write(handle, data, length_bytes, offset_bytes);
 
 	allocator.FreeData(data, length_bytes);
-	return true;
+}
+
+void NvmeFileSystem::SyncThreadCount(optional_ptr<FileOpener> opener) {
+	optional_ptr<DatabaseInstance> db = FileOpener::TryGetDatabase(opener);
+	if (!db) {
+		return;
+	}
+
+	idx_t threads = static_cast<idx_t>(TaskScheduler::GetScheduler(*db).NumberOfThreads());
+	if (thread_count.exchange(threads) != threads) {
+		device->SetThreadCount(threads);
+	}
 }
 
 bool NvmeFileSystem::TryLoadMetadata() {
@@ -429,9 +988,17 @@ bool NvmeFileSystem::TryLoadMetadata() {
 		db_location.store(metadata->db_location);
 		wal_location.store(metadata->wal_location);
 
-		DeviceGeometry geo = device->GetDeviceGeometry();
-		temp_meta_manager =
-		    make_uniq<TemporaryFileMetadataManager>(metadata->tmp_start, geo.lba_count - 1, geo.lba_size);
+		temp_meta_manager = CreateTempMetaManager(metadata->tmp_start);
+		write_tracker = CreateWriteFrequencyTracker(*metadata);
+		checksums = CreateChecksumTable(*metadata);
+		readahead = CreateScanReadahead(*metadata);
+		if (zoned) {
+			zoned_wal = CreateZonedWriteAheadLog(*metadata);
+			zoned_wal->Load(metadata->wal_location - metadata->wal_start);
+			wal_location.store(metadata->wal_start + zoned_wal->GetSizeLBAs());
+			ResetTemporaryZones(*metadata);
+		}
+		LoadChecksums(*metadata);
 		return true;
 	}
 
@@ -449,6 +1016,31 @@ void NvmeFileSystem::InitializeMetadata(const string &filename) {
 	idx_t temp_start = (geo.lba_count - 1) - (max_temp_size / geo.lba_size);
 	idx_t wal_lba_count = max_wal_size / geo.lba_size;
 	idx_t wal_start = (temp_start - 1) - wal_lba_count;
+	if (zoned) {
+		// The metadata, the database and the partial LBA of the WAL are kept in the conventional LBAs. The WAL takes
+		// the first zones and the temporary region all remaining zones.
+		if (zone_geometry.conventional_lbas < 3) {
+			throw IOException("A zoned device needs conventional LBAs for the metadata and the database");
+		}
+		idx_t zone_bytes = zone_geometry.zone_capacity * geo.lba_size;
+		idx_t wal_zones = MaxValue<idx_t>((max_wal_size + zone_bytes - 1) / zone_bytes, 1);
+		if (wal_zones >= zone_geometry.nr_zones) {
+			throw IOException("A zoned device needs more than the %llu zones of the WAL", wal_zones);
+		}
+		wal_start = zone_geometry.GetZoneStart(0);
+		temp_start = zone_geometry.GetZoneStart(wal_zones);
+	}
+
+	idx_t checksum_start = 0;
+	if (config.block_checksums) {
+		// The checksums of the WAL are persisted in the LBAs before the LBA before the WAL, which are taken from the
+		// end of the database region
+		idx_t checksum_lbas = ((temp_start - wal_start) * BLOCK_CHECKSUM_ENTRY_SIZE + geo.lba_size - 1) / geo.lba_size;
+		if (wal_start < checksum_lbas + 3) {
+			throw IOException("The device has no room for the checksums of the WAL before the WAL");
+		}
+		checksum_start = wal_start - 1 - checksum_lbas;
+	}
 
 	unique_ptr<GlobalMetadata> global = make_uniq<GlobalMetadata>(GlobalMetadata {});
 
@@ -459,20 +1051,48 @@ void NvmeFileSystem::InitializeMetadata(const string &filename) {
 	global->db_location = 1;
 	global->wal_location = wal_start;
 	global->db_path_size = filename.length();
+	global->version = NVMEFS_METADATA_VERSION;
+	global->checksum_start = checksum_start;
+	global->checksum_location = wal_start;
 
 	strncpy(global->db_path, filename.data(), filename.length());
 	global->db_path[100] = '\0';
 
-	temp_meta_manager = make_uniq<TemporaryFileMetadataManager>(temp_start, geo.lba_count - 1, geo.lba_size);
-
-	WriteMetadata(*global);
+	temp_meta_manager = CreateTempMetaManager(temp_start);
+	write_tracker = CreateWriteFrequencyTracker(*global);
+	checksums = CreateChecksumTable(*global);
+	readahead = CreateScanReadahead(*global);
+	if (zoned) {
+		// Zones of an earlier layout are emptied
+		zoned_wal = CreateZonedWriteAheadLog(*global);
+		zoned_wal->Load(0);
+		ResetTemporaryZones(*global);
+	}
 
 	db_location.store(1);
 	wal_location.store(wal_start);
 
+	WriteMetadata(*global);
+
 	metadata = std::move(global);
 }
 
+unique_ptr<ZonedWriteAheadLog> NvmeFileSystem::CreateZonedWriteAheadLog(const GlobalMetadata &global) {
+	idx_t first_zone = (global.wal_start - zone_geometry.conventional_lbas) / zone_geometry.zone_size;
+	idx_t nr_zones = (global.tmp_start - global.wal_start) / zone_geometry.zone_size;
+	// The LBA before the WAL is not part of the database region
+	return make_uniq<ZonedWriteAheadLog>(*device, zone_geometry, first_zone, nr_zones, global.wal_start - 1);
+}
+
+void NvmeFileSystem::ResetTemporaryZones(const GlobalMetadata &global) {
+	for (idx_t zone_start = global.tmp_start; zone_start < zone_geometry.GetZoneStart(zone_geometry.nr_zones);
+	     zone_start += zone_geometry.zone_size) {
+		if (device->GetZoneWritePointer(zone_start) != zone_start) {
+			device->ResetZone(zone_start);
+		}
+	}
+}
+
 unique_ptr<GlobalMetadata> NvmeFileSystem::ReadMetadata() {
 	idx_t nr_bytes_magic = sizeof(NVMEFS_MAGIC_BYTES);
 	idx_t nr_bytes_global = sizeof(GlobalMetadata);
@@ -483,16 +1103,22 @@ unique_ptr<GlobalMetadata> NvmeFileSystem::ReadMetadata() {
 
 	FileOpenFlags flags = FileOpenFlags::FILE_FLAGS_READ;
 	unique_ptr<FileHandle> fh = OpenFile(NVMEFS_GLOBAL_METADATA_PATH, flags);
-	unique_ptr<CmdContext> cmd_ctx =
-	    fh->Cast<NvmeFileHandle>().PrepareReadCommand(bytes_to_read, NVMEFS_GLOBAL_METADATA_LOCATION, 0);
+	NvmeCmdContext cmd_ctx =
+	    fh->Cast<NvmeFileHandle>().PrepareCommand(bytes_to_read, NVMEFS_GLOBAL_METADATA_LOCATION, 0);
 
-	device->Read(buffer, *cmd_ctx);
+	device->Read(buffer, cmd_ctx);
 
 	if (memcmp(buffer, NVMEFS_MAGIC_BYTES, nr_bytes_magic) == 0) {
-		DeviceGeometry geo = device->GetDeviceGeometry();
 		global = make_uniq<GlobalMetadata>(GlobalMetadata {});
 		memcpy(global.get(), buffer + nr_bytes_magic, nr_bytes_global);
-		temp_meta_manager = make_uniq<TemporaryFileMetadataManager>(global->tmp_start, geo.lba_count - 1, geo.lba_size);
+		if (global->version != NVMEFS_METADATA_VERSION) {
+			// Metadata of the first layout ends after the WAL location and is followed by whatever the write buffer
+			// held. Such a database has no checksums, and is upgraded to the current layout when it is written next.
+			global->version = NVMEFS_METADATA_VERSION;
+			global->checksum_start = 0;
+			global->checksum_location = global->wal_start;
+		}
+		temp_meta_manager = CreateTempMetaManager(global->tmp_start);
 	}
 
 	allocator.FreeData(buffer, bytes_to_read);
@@ -505,6 +1131,14 @@ void NvmeFileSystem::WriteMetadata(GlobalMetadata &global) {
 	idx_t nr_bytes_global = sizeof(GlobalMetadata);
 	idx_t bytes_to_write = nr_bytes_magic + nr_bytes_global;
 
+	if (zoned_wal) {
+		// The size of the WAL includes its partially written last LBA, which is only kept in memory until it is synced
+		zoned_wal->Sync();
+	}
+
+	// The checksums are persisted first, such that the metadata never refers to WAL data without them
+	PersistChecksums(global);
+
 	// update locations
 	global.db_location = db_location.load();
 	global.wal_location = wal_location.load();
@@ -515,19 +1149,16 @@ void NvmeFileSystem::WriteMetadata(GlobalMetadata &global) {
 
 	FileOpenFlags flags = FileOpenFlags::FILE_FLAGS_WRITE;
 	unique_ptr<FileHandle> fh = OpenFile(NVMEFS_GLOBAL_METADATA_PATH, flags);
-	unique_ptr<CmdContext> cmd_ctx =
-	    fh->Cast<NvmeFileHandle>().PrepareWriteCommand(bytes_to_write, NVMEFS_GLOBAL_METADATA_LOCATION, 0);
+	NvmeCmdContext cmd_ctx =
+	    fh->Cast<NvmeFileHandle>().PrepareCommand(bytes_to_write, NVMEFS_GLOBAL_METADATA_LOCATION, 0);
 
-	device->Write(buffer, *cmd_ctx);
+	device->Write(buffer, cmd_ctx);
 
 	allocator.FreeData(buffer, bytes_to_write);
 }
 
-void NvmeFileSystem::UpdateMetadata(CmdContext &context) {
-	NvmeCmdContext &ctx = static_cast<NvmeCmdContext &>(context);
-	MetadataType type = GetMetadataType(ctx.filepath);
-
-	switch (type) {
+void NvmeFileSystem::UpdateMetadata(NvmeFileHandle &handle, const CmdContext &ctx) {
+	switch (handle.type) {
 	case MetadataType::WAL: {
 		idx_t expected_location = wal_location.load();
 		idx_t new_location = ctx.start_lba + ctx.nr_lbas;
@@ -543,7 +1174,6 @@ void NvmeFileSystem::UpdateMetadata(CmdContext &context) {
 		// The temporary metadata remain static given that location is unused.
 		// The file_to_temp_meta map will be updated during GetLBA, hence
 		// no action is required here.
-		temp_meta_manager->MoveLBALocation(ctx.filepath, ctx.start_lba + ctx.nr_lbas);
 		break;
 	case MetadataType::DATABASE: {
 		idx_t expected_location = db_location.load();
@@ -561,80 +1191,103 @@ void NvmeFileSystem::UpdateMetadata(CmdContext &context) {
 	}
 }
 
-MetadataType NvmeFileSystem::GetMetadataType(const string &filename) {
-	if (StringUtil::Contains(filename, ".wal")) {
-		return MetadataType::WAL;
-	} else if (StringUtil::Contains(filename, "/tmp")) {
-		return MetadataType::TEMPORARY;
-	} else if (StringUtil::Contains(filename, ".db")) {
-		return MetadataType::DATABASE;
-	} else {
-		throw InvalidInputException("Unknown file format");
+void NvmeFileSystem::BindDevice() {
+	DeviceGeometry geo = device->GetDeviceGeometry();
+	if (!IsNonZeroPowerOfTwo(geo.lba_size)) {
+		throw InvalidInputException("LBA size must be a power of two, got %llu", geo.lba_size);
+	}
+	lba_size = geo.lba_size;
+	lba_shift = 0;
+	while ((idx_t(1) << lba_shift) < lba_size) {
+		lba_shift++;
 	}
-}
 
-idx_t NvmeFileSystem::GetLBA(const string &filename, idx_t nr_bytes, idx_t location, idx_t nr_lbas) {
-	// auto start_time = std::chrono::high_resolution_clock::now();
-	idx_t lba {};
-	MetadataType type = GetMetadataType(filename);
-	DeviceGeometry geo = device->GetDeviceGeometry();
+	// Calls through the concrete type are resolved statically, as NvmeDevice is final
+	nvme_device = dynamic_cast<NvmeDevice *>(device.get());
+	zoned = device->GetZoneGeometry(zone_geometry);
+
+	// Blocks appended to zones keep the size of a block
+	if (TemporaryBlockCompressor::ParseCompression(config.temp_compression) && !zoned) {
+		temp_compressor = make_uniq<TemporaryBlockCompressor>(config.temp_compression_level, lba_size);
+	}
+}
 
-	idx_t lba_location = location / geo.lba_size;
+void NvmeFileSystem::ResolveHandle(NvmeFileHandle &handle) {
+	handle.lba_size = lba_size;
+	handle.lba_shift = lba_shift;
+	handle.placement_identifier = device->GetPlacementIdentifier(handle.path, 0);
+	handle.hot_placement_identifier = device->GetHotPlacementIdentifier(handle.path);
+	if (handle.path == NVMEFS_GLOBAL_METADATA_PATH) {
+		return;
+	}
 
-	switch (type) {
+	handle.type = GetMetadataType(handle.path);
+	switch (handle.type) {
 	case MetadataType::WAL:
-		lba = metadata->wal_start + lba_location;
+		handle.region_start = metadata->wal_start;
+		handle.region_end = metadata->tmp_start - 1;
 		break;
-	case MetadataType::TEMPORARY: {
-		lba = temp_meta_manager->GetLBA(filename, location, nr_lbas);
-	} break;
-	case MetadataType::DATABASE:
-		lba = metadata->db_start + lba_location;
+	case MetadataType::TEMPORARY:
+		handle.region_start = metadata->tmp_start;
+		handle.region_end = device->GetDeviceGeometry().lba_count - 1;
+		ResolveTemporaryFile(handle, temp_meta_manager->GetFile(handle.path));
 		break;
-	default:
-		throw InvalidInputException("No such metadata type");
+	case MetadataType::DATABASE:
+		handle.region_start = metadata->db_start;
+		handle.region_end = GetDatabaseEnd(*metadata);
 		break;
 	}
+}
 
-	// auto end_time = std::chrono::high_resolution_clock::now();
-	// auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-	// // Print the duration
-	// std::cout << "GetLBA took " << duration.count() << " milliseconds." << std::endl;
+void NvmeFileSystem::ResolveTemporaryFile(NvmeFileHandle &handle, shared_ptr<TempFileMetadata> temp_file) {
+	handle.temp_file = std::move(temp_file);
+	if (handle.temp_file) {
+		handle.placement_identifier = device->GetPlacementIdentifier(handle.path, handle.temp_file->generation);
+	}
+}
 
-	return lba;
+TempFileMetadata &NvmeFileSystem::GetTemporaryFile(NvmeFileHandle &handle) {
+	if (!handle.temp_file || !handle.temp_file->is_active) {
+		ResolveTemporaryFile(handle, temp_meta_manager->GetFile(handle.path));
+		if (!handle.temp_file) {
+			throw IOException("Temporary file %s does not exist", handle.path);
+		}
+	}
+	return *handle.temp_file;
 }
 
-bool NvmeFileSystem::IsLBAInRange(const string &filename, idx_t start_lba, idx_t lba_count) {
-	DeviceGeometry geo = device->GetDeviceGeometry();
-	MetadataType type = GetMetadataType(filename);
-	idx_t current_start {};
-	idx_t current_end {};
+MetadataType NvmeFileSystem::GetMetadataType(const string &filename) {
+	if (StringUtil::Contains(filename, ".wal")) {
+		return MetadataType::WAL;
+	} else if (StringUtil::Contains(filename, "/tmp")) {
+		return MetadataType::TEMPORARY;
+	} else if (StringUtil::Contains(filename, ".db")) {
+		return MetadataType::DATABASE;
+	} else {
+		throw InvalidInputException("Unknown file format");
+	}
+}
 
-	switch (type) {
+idx_t NvmeFileSystem::GetLBA(NvmeFileHandle &handle, idx_t location, idx_t nr_lbas) {
+	switch (handle.type) {
 	case MetadataType::WAL:
-		current_start = metadata->wal_start;
-		current_end = metadata->tmp_start - 1;
-		break;
-	case MetadataType::TEMPORARY:
-		current_start = metadata->tmp_start;
-		current_end = geo.lba_count - 1;
-		break;
 	case MetadataType::DATABASE:
-		current_start = metadata->db_start;
-		current_end = metadata->wal_start - 1;
-		break;
+		return handle.region_start + (location >> handle.lba_shift);
+	case MetadataType::TEMPORARY:
+		return temp_meta_manager->GetLBA(GetTemporaryFile(handle), location, nr_lbas);
 	default:
 		throw InvalidInputException("No such metadata type");
-		break;
 	}
+}
 
+bool NvmeFileSystem::IsLBAInRange(const NvmeFileHandle &handle, idx_t start_lba, idx_t lba_count) {
 	// Check if the LBA start location is within the range of the metadata range
-	if ((start_lba < current_start || start_lba > current_end)) {
+	if ((start_lba < handle.region_start || start_lba > handle.region_end)) {
 		return false;
 	}
 
 	// Check that if the lba is in range that we are not going to read or write out of range
-	if ((start_lba + lba_count) > current_end) {
+	if ((start_lba + lba_count) > handle.region_end) {
 		return false;
 	}
 
@@ -29,6 +29,27 @@ static unique_ptr<BaseSecret> CreateNvmefsSecretFromConfig(ClientContext &contex
 void SetNvmefsSecretParameters(CreateSecretFunction &function) {
 	function.named_parameters["nvme_device_path"] = LogicalType::VARCHAR;
 	function.named_parameters["backend"] = LogicalType::VARCHAR;
+	function.named_parameters["hugepage_arena_size"] = LogicalType::VARCHAR;
+	function.named_parameters["wait_strategy"] = LogicalType::VARCHAR;
+	function.named_parameters["reactor_threads"] = LogicalType::UBIGINT;
+	function.named_parameters["reactor_cpus"] = LogicalType::VARCHAR;
+	function.named_parameters["queue_depth"] = LogicalType::UBIGINT;
+	function.named_parameters["queue_target_latency_us"] = LogicalType::UBIGINT;
+	function.named_parameters["background_deallocation"] = LogicalType::BOOLEAN;
+	function.named_parameters["block_checksums"] = LogicalType::BOOLEAN;
+	function.named_parameters["fdp_plhdls"] = LogicalType::UBIGINT;
+	function.named_parameters["fdp_placement"] = LogicalType::VARCHAR;
+	function.named_parameters["temp_extent_size"] = LogicalType::VARCHAR;
+	function.named_parameters["temp_compression"] = LogicalType::VARCHAR;
+	function.named_parameters["temp_compression_level"] = LogicalType::BIGINT;
+	function.named_parameters["readahead_size"] = LogicalType::VARCHAR;
+	function.named_parameters["hot_write_threshold"] = LogicalType::UBIGINT;
+	function.named_parameters["write_tracking_range_size"] = LogicalType::VARCHAR;
+	function.named_parameters["device_size"] = LogicalType::VARCHAR;
+	function.named_parameters["region_offset"] = LogicalType::VARCHAR;
+	function.named_parameters["region_size"] = LogicalType::VARCHAR;
+	function.named_parameters["emulation_profile"] = LogicalType::VARCHAR;
+	function.named_parameters["zns_device_path"] = LogicalType::VARCHAR;
 }
 
 void RegisterCreateNvmefsSecretFunciton(DatabaseInstance &instance) {
@@ -72,6 +93,97 @@ NvmeConfig NvmeConfigManager::LoadConfig(DatabaseInstance &instance) {
 	secret_reader.TryGetSecretKeyOrSetting<string>("nvme_device_path", "nvme_device_path", device);
 	secret_reader.TryGetSecretKeyOrSetting<string>("backend", "backend", backend);
 
+	string hugepage_arena;
+	idx_t hugepage_arena_size = 0;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("hugepage_arena_size", "hugepage_arena_size", hugepage_arena) &&
+	    !hugepage_arena.empty()) {
+		hugepage_arena_size = DBConfig::ParseMemoryLimit(hugepage_arena);
+	}
+
+	string wait_strategy = "spin";
+	secret_reader.TryGetSecretKeyOrSetting<string>("wait_strategy", "wait_strategy", wait_strategy);
+
+	idx_t reactor_threads = 0;
+	string reactor_cpus;
+	secret_reader.TryGetSecretKeyOrSetting<idx_t>("reactor_threads", "reactor_threads", reactor_threads);
+	secret_reader.TryGetSecretKeyOrSetting<string>("reactor_cpus", "reactor_cpus", reactor_cpus);
+
+	idx_t queue_depth = NVMEFS_DEFAULT_QUEUE_DEPTH;
+	idx_t queue_target_latency_us = 0;
+	secret_reader.TryGetSecretKeyOrSetting<idx_t>("queue_depth", "queue_depth", queue_depth);
+	secret_reader.TryGetSecretKeyOrSetting<idx_t>("queue_target_latency_us", "queue_target_latency_us",
+	                                              queue_target_latency_us);
+
+	bool background_deallocation = false;
+	secret_reader.TryGetSecretKeyOrSetting<bool>("background_deallocation", "background_deallocation",
+	                                             background_deallocation);
+
+	bool block_checksums = false;
+	secret_reader.TryGetSecretKeyOrSetting<bool>("block_checksums", "block_checksums", block_checksums);
+
+	idx_t plhdls = 0;
+	string fdp_placement;
+	secret_reader.TryGetSecretKeyOrSetting<idx_t>("fdp_plhdls", "fdp_plhdls", plhdls);
+	secret_reader.TryGetSecretKeyOrSetting<string>("fdp_placement", "fdp_placement", fdp_placement);
+
+	string temp_extent;
+	idx_t temp_extent_size = NVMEFS_DEFAULT_TEMP_EXTENT_SIZE;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("temp_extent_size", "temp_extent_size", temp_extent) &&
+	    !temp_extent.empty()) {
+		temp_extent_size = DBConfig::ParseMemoryLimit(temp_extent);
+	}
+
+	idx_t hot_write_threshold = NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD;
+	secret_reader.TryGetSecretKeyOrSetting<idx_t>("hot_write_threshold", "hot_write_threshold", hot_write_threshold);
+
+	string write_tracking_range;
+	idx_t write_tracking_range_size = NVMEFS_DEFAULT_WRITE_TRACKING_RANGE_SIZE;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("write_tracking_range_size", "write_tracking_range_size",
+	                                                   write_tracking_range) &&
+	    !write_tracking_range.empty()) {
+		write_tracking_range_size = DBConfig::ParseMemoryLimit(write_tracking_range);
+	}
+
+	string temp_compression = "none";
+	int64_t temp_compression_level = NVMEFS_DEFAULT_TEMP_COMPRESSION_LEVEL;
+	secret_reader.TryGetSecretKeyOrSetting<string>("temp_compression", "temp_compression", temp_compression);
+	secret_reader.TryGetSecretKeyOrSetting<int64_t>("temp_compression_level", "temp_compression_level",
+	                                                temp_compression_level);
+
+	string readahead;
+	idx_t readahead_size = 0;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("readahead_size", "readahead_size", readahead) &&
+	    !readahead.empty()) {
+		readahead_size = DBConfig::ParseMemoryLimit(readahead);
+	}
+
+	string device_size_str;
+	idx_t device_size = 0;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("device_size", "device_size", device_size_str) &&
+	    !device_size_str.empty()) {
+		device_size = DBConfig::ParseMemoryLimit(device_size_str);
+	}
+
+	string region_offset_str;
+	idx_t region_offset = 0;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("region_offset", "region_offset", region_offset_str) &&
+	    !region_offset_str.empty()) {
+		region_offset = DBConfig::ParseMemoryLimit(region_offset_str);
+	}
+
+	string region_size_str;
+	idx_t region_size = 0;
+	if (secret_reader.TryGetSecretKeyOrSetting<string>("region_size", "region_size", region_size_str) &&
+	    !region_size_str.empty()) {
+		region_size = DBConfig::ParseMemoryLimit(region_size_str);
+	}
+
+	string emulation_profile;
+	secret_reader.TryGetSecretKeyOrSetting<string>("emulation_profile", "emulation_profile", emulation_profile);
+
+	string zns_device_path;
+	secret_reader.TryGetSecretKeyOrSetting<string>("zns_device_path", "zns_device_path", zns_device_path);
+
 	config.AddExtensionOption("nvme_device_path", "Path to NVMe device", {LogicalType::VARCHAR}, Value(device));
 	config.AddExtensionOption("backend", "xnvme backend used for IO", {LogicalType::VARCHAR}, Value(backend));
 
@@ -80,16 +192,43 @@ NvmeConfig NvmeConfigManager::LoadConfig(DatabaseInstance &instance) {
 	return NvmeConfig {.device_path = device,
 	                   .backend = backend,
 	                   .async = IsAsynchronousBackend(backend),
+	                   .plhdls = plhdls,
+	                   .fdp_placement = fdp_placement,
 	                   .max_temp_size = max_temp_size,
 	                   .max_wal_size = max_wal_size,
-	                   .max_threads = max_threads};
+	                   .max_threads = max_threads,
+	                   .hugepage_arena_size = hugepage_arena_size,
+	                   .wait_strategy = StringUtil::Lower(wait_strategy),
+	                   .reactor_threads = reactor_threads,
+	                   .reactor_cpus = reactor_cpus,
+	                   .queue_depth = queue_depth,
+	                   .queue_target_latency_us = queue_target_latency_us,
+	                   .background_deallocation = background_deallocation,
+	                   .block_checksums = block_checksums,
+	                   .temp_extent_size = temp_extent_size,
+	                   .hot_write_threshold = hot_write_threshold,
+	                   .write_tracking_range_size = write_tracking_range_size,
+	                   .temp_compression = StringUtil::Lower(temp_compression),
+	                   .temp_compression_level = temp_compression_level,
+	                   .readahead_size = readahead_size,
+	                   .device_size = device_size,
+	                   .region_offset = region_offset,
+	                   .region_size = region_size,
+	                   .emulation_profile = emulation_profile,
+	                   .zns_device_path = zns_device_path};
 }
 
 bool NvmeConfigManager::IsAsynchronousBackend(const string &backend) {
+	if (backend == NVMEFS_FILE_BACKEND) {
+		return true;
+	}
 	return NVMEFS_BACKENDS_ASYNC.find(backend) != NVMEFS_BACKENDS_ASYNC.end();
 }
 
 string NvmeConfigManager::SanatizeBackend(const string &backend) {
+	if (backend == NVMEFS_FILE_BACKEND) {
+		return backend;
+	}
 
 	if (backend.empty() || (NVMEFS_BACKENDS_SYNC.find(backend) == NVMEFS_BACKENDS_SYNC.end() &&
 	                        NVMEFS_BACKENDS_ASYNC.find(backend) == NVMEFS_BACKENDS_ASYNC.end())) {
@@ -5,6 +5,7 @@
 #include "duckdb.hpp"
 #include "duckdb/common/exception.hpp"
 #include "duckdb/common/string_util.hpp"
+#include "duckdb/main/config.hpp"
 #include "duckdb/main/extension_util.hpp"
 #include "duckdb/main/secret/secret_manager.hpp"
 #include "duckdb/main/settings.hpp"
@@ -54,7 +55,356 @@ static unique_ptr<FunctionData> ConfigPrintBind(ClientContext &ctx, TableFunctio
 	return std::move(result);
 }
 
-static void AddConfig(DatabaseInstance &instance) {
+struct NvmeFileSystemFunctionInfo : public TableFunctionInfo {
+	explicit NvmeFileSystemFunctionInfo(NvmeFileSystem &fs) : fs(fs) {
+	}
+
+	NvmeFileSystem &fs;
+};
+
+struct QueueStatsFunctionData : public TableFunctionData {
+	QueueStatsFunctionData() {
+	}
+
+	vector<DeviceQueueStatistics> statistics;
+	idx_t offset = 0;
+};
+
+static void QueueStats(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<QueueStatsFunctionData>();
+
+	idx_t chunk_count = 0;
+	while (data.offset < data.statistics.size() && chunk_count < STANDARD_VECTOR_SIZE) {
+		const DeviceQueueStatistics &queue = data.statistics[data.offset];
+		output.SetValue(0, chunk_count, Value::UBIGINT(queue.queue_id));
+		output.SetValue(1, chunk_count, Value(queue.owner));
+		output.SetValue(2, chunk_count, Value::UBIGINT(queue.max_depth));
+		output.SetValue(3, chunk_count, Value::UBIGINT(queue.window));
+		output.SetValue(4, chunk_count, Value::UBIGINT(queue.target_latency_us));
+		output.SetValue(5, chunk_count, Value::DOUBLE(queue.average_latency_us));
+		output.SetValue(6, chunk_count, Value::UBIGINT(queue.completions));
+		data.offset++;
+		chunk_count++;
+	}
+
+	output.SetCardinality(chunk_count);
+}
+
+static unique_ptr<FunctionData> QueueStatsBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                               vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"queue", "owner", "max_depth", "window", "target_latency_us", "avg_latency_us", "completions"};
+	return_types = {LogicalType::UBIGINT, LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::DOUBLE,  LogicalType::UBIGINT};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<QueueStatsFunctionData>();
+	result->statistics = info.fs.GetDevice().GetQueueStatistics();
+
+	return std::move(result);
+}
+
+struct DeallocationStatsFunctionData : public TableFunctionData {
+	DeallocationStatsFunctionData() {
+	}
+
+	bool enabled = false;
+	idx_t pending_lbas = 0;
+	idx_t released_lbas = 0;
+	bool finished = false;
+};
+
+static void DeallocationStats(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<DeallocationStatsFunctionData>();
+
+	if (data.finished) {
+		return;
+	}
+
+	output.SetValue(0, 0, Value::BOOLEAN(data.enabled));
+	output.SetValue(1, 0, Value::UBIGINT(data.pending_lbas));
+	output.SetValue(2, 0, Value::UBIGINT(data.released_lbas));
+	output.SetCardinality(1);
+
+	data.finished = true;
+}
+
+static unique_ptr<FunctionData> DeallocationStatsBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                                      vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"enabled", "pending_lbas", "released_lbas"};
+	return_types = {LogicalType::BOOLEAN, LogicalType::UBIGINT, LogicalType::UBIGINT};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<DeallocationStatsFunctionData>();
+	optional_ptr<BackgroundDeallocator> deallocator = info.fs.GetDeallocator();
+	if (deallocator) {
+		result->enabled = true;
+		result->pending_lbas = deallocator->GetPendingLBAs();
+		result->released_lbas = deallocator->GetReleasedLBAs();
+	}
+
+	return std::move(result);
+}
+
+struct TempCompressionStatsFunctionData : public TableFunctionData {
+	TempCompressionStatsFunctionData() {
+	}
+
+	bool enabled = false;
+	TemporaryCompressionStatistics statistics {};
+	bool finished = false;
+};
+
+static void TempCompressionStats(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<TempCompressionStatsFunctionData>();
+
+	if (data.finished) {
+		return;
+	}
+
+	const TemporaryCompressionStatistics &statistics = data.statistics;
+	output.SetValue(0, 0, Value::BOOLEAN(data.enabled));
+	output.SetValue(1, 0, Value::UBIGINT(statistics.compressed_blocks));
+	output.SetValue(2, 0, Value::UBIGINT(statistics.uncompressed_blocks));
+	output.SetValue(3, 0, Value::UBIGINT(statistics.block_bytes));
+	output.SetValue(4, 0, Value::UBIGINT(statistics.stored_bytes));
+	output.SetValue(5, 0,
+	                statistics.stored_bytes == 0
+	                    ? Value(LogicalType::DOUBLE)
+	                    : Value::DOUBLE(static_cast<double>(statistics.block_bytes) / statistics.stored_bytes));
+	output.SetCardinality(1);
+
+	data.finished = true;
+}
+
+static unique_ptr<FunctionData> TempCompressionStatsBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                                         vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"enabled", "compressed_blocks", "uncompressed_blocks", "block_bytes", "stored_bytes", "ratio"};
+	return_types = {LogicalType::BOOLEAN, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::DOUBLE};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<TempCompressionStatsFunctionData>();
+	optional_ptr<TemporaryBlockCompressor> compressor = info.fs.GetTemporaryBlockCompressor();
+	if (compressor) {
+		result->enabled = true;
+		result->statistics = compressor->GetStatistics();
+	}
+
+	return std::move(result);
+}
+
+struct ReadaheadStatsFunctionData : public TableFunctionData {
+	ReadaheadStatsFunctionData() {
+	}
+
+	bool enabled = false;
+	ReadaheadStatistics statistics {};
+	bool finished = false;
+};
+
+static void ReadaheadStats(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<ReadaheadStatsFunctionData>();
+
+	if (data.finished) {
+		return;
+	}
+
+	const ReadaheadStatistics &statistics = data.statistics;
+	output.SetValue(0, 0, Value::BOOLEAN(data.enabled));
+	output.SetValue(1, 0, Value::UBIGINT(statistics.hits));
+	output.SetValue(2, 0, Value::UBIGINT(statistics.late_hits));
+	output.SetValue(3, 0, Value::UBIGINT(statistics.prefetched_bytes));
+	output.SetValue(4, 0, Value::UBIGINT(statistics.wasted_bytes));
+	output.SetValue(5, 0, Value::UBIGINT(statistics.staged_bytes));
+	output.SetCardinality(1);
+
+	data.finished = true;
+}
+
+static unique_ptr<FunctionData> ReadaheadStatsBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"enabled", "hits", "late_hits", "prefetched_bytes", "wasted_bytes", "staged_bytes"};
+	return_types = {LogicalType::BOOLEAN, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<ReadaheadStatsFunctionData>();
+	optional_ptr<ScanReadahead> readahead = info.fs.GetScanReadahead();
+	if (readahead) {
+		result->enabled = true;
+		result->statistics = readahead->GetStatistics();
+	}
+
+	return std::move(result);
+}
+
+struct WriteFrequencyFunctionData : public TableFunctionData {
+	WriteFrequencyFunctionData() {
+	}
+
+	vector<WriteFrequencyBucket> histogram;
+	idx_t range_size = 0;
+	idx_t hot_threshold = 0;
+	idx_t offset = 0;
+};
+
+static void WriteFrequency(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<WriteFrequencyFunctionData>();
+
+	idx_t chunk_count = 0;
+	while (data.offset < data.histogram.size() && chunk_count < STANDARD_VECTOR_SIZE) {
+		const WriteFrequencyBucket &bucket = data.histogram[data.offset];
+		output.SetValue(0, chunk_count, Value::UBIGINT(bucket.write_count));
+		output.SetValue(1, chunk_count, Value::UBIGINT(bucket.nr_ranges));
+		output.SetValue(2, chunk_count, Value::UBIGINT(bucket.nr_ranges * data.range_size));
+		output.SetValue(3, chunk_count, Value::BOOLEAN(bucket.write_count >= data.hot_threshold));
+		data.offset++;
+		chunk_count++;
+	}
+
+	output.SetCardinality(chunk_count);
+}
+
+static unique_ptr<FunctionData> WriteFrequencyBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"write_count", "ranges", "bytes", "hot"};
+	return_types = {LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::BOOLEAN};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<WriteFrequencyFunctionData>();
+	optional_ptr<WriteFrequencyTracker> tracker = info.fs.GetWriteFrequencyTracker();
+	if (tracker) {
+		result->histogram = tracker->GetHistogram();
+		result->range_size = tracker->GetRangeLBAs() * info.fs.GetDevice().GetDeviceGeometry().lba_size;
+		result->hot_threshold = tracker->GetHotThreshold();
+	}
+
+	return std::move(result);
+}
+
+struct FDPStatsFunctionData : public TableFunctionData {
+	FDPStatsFunctionData() {
+	}
+
+	DeviceFDPStatistics statistics;
+	idx_t offset = 0;
+};
+
+/// @brief Ratio of media to host bytes written, or NULL if nothing was written by the host
+static Value GetWriteAmplification(idx_t media_bytes_written, idx_t host_bytes_written) {
+	if (host_bytes_written == 0) {
+		return Value(LogicalType::DOUBLE);
+	}
+	return Value::DOUBLE(static_cast<double>(media_bytes_written) / static_cast<double>(host_bytes_written));
+}
+
+static void FDPStats(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<FDPStatsFunctionData>();
+	const DeviceFDPStatistics &statistics = data.statistics;
+
+	// The write amplification since the device was opened covers the writes of this database only, as far as no other
+	// namespace of the endurance group is written concurrently
+	idx_t host_bytes = statistics.host_bytes_written - MinValue(statistics.initial_host_bytes_written,
+	                                                            statistics.host_bytes_written);
+	idx_t media_bytes = statistics.media_bytes_written - MinValue(statistics.initial_media_bytes_written,
+	                                                              statistics.media_bytes_written);
+
+	idx_t chunk_count = 0;
+	while (data.offset < statistics.placement_handles.size() && chunk_count < STANDARD_VECTOR_SIZE) {
+		const DevicePlacementStatistics &handle = statistics.placement_handles[data.offset];
+		output.SetValue(0, chunk_count, Value::UBIGINT(handle.placement_handle));
+		output.SetValue(1, chunk_count, Value::UBIGINT(handle.placement_identifier));
+		output.SetValue(2, chunk_count, Value::UBIGINT(handle.reclaim_unit_handle));
+		output.SetValue(3, chunk_count, Value::UBIGINT(handle.host_bytes_written));
+		output.SetValue(4, chunk_count, Value::UBIGINT(handle.available_bytes));
+		output.SetValue(5, chunk_count,
+		                handle.used_bytes.IsValid() ? Value::UBIGINT(handle.used_bytes.GetIndex())
+		                                            : Value(LogicalType::UBIGINT));
+		output.SetValue(6, chunk_count, Value::UBIGINT(statistics.host_bytes_written));
+		output.SetValue(7, chunk_count, Value::UBIGINT(statistics.media_bytes_written));
+		output.SetValue(8, chunk_count, Value::UBIGINT(statistics.media_bytes_erased));
+		output.SetValue(9, chunk_count, GetWriteAmplification(media_bytes, host_bytes));
+		output.SetValue(10, chunk_count,
+		                GetWriteAmplification(statistics.media_bytes_written, statistics.host_bytes_written));
+		data.offset++;
+		chunk_count++;
+	}
+
+	output.SetCardinality(chunk_count);
+}
+
+static unique_ptr<FunctionData> FDPStatsBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                             vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"placement_handle",
+	         "placement_identifier",
+	         "reclaim_unit_handle",
+	         "host_bytes_written",
+	         "ru_available_bytes",
+	         "ru_used_bytes",
+	         "device_host_bytes_written",
+	         "device_media_bytes_written",
+	         "device_media_bytes_erased",
+	         "waf",
+	         "lifetime_waf"};
+	return_types = {LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::UBIGINT,
+	                LogicalType::UBIGINT, LogicalType::DOUBLE,  LogicalType::DOUBLE};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<FDPStatsFunctionData>();
+	// Devices without FDP return no rows
+	info.fs.GetDevice().GetFDPStatistics(result->statistics);
+
+	return std::move(result);
+}
+
+struct CloneDatabaseFunctionData : public TableFunctionData {
+	CloneDatabaseFunctionData() {
+	}
+
+	optional_ptr<NvmeFileSystem> fs;
+	string target_path;
+	//! Byte offset of the region of the clone on the target device
+	idx_t target_offset = 0;
+	bool finished = false;
+};
+
+static void CloneDatabase(ClientContext &context, TableFunctionInput &data_p, DataChunk &output) {
+	auto &data = data_p.bind_data->CastNoConst<CloneDatabaseFunctionData>();
+
+	if (data.finished) {
+		return;
+	}
+
+	// The clone is made when the function is executed, rather than when it is bound
+	NvmeCloneStatistics statistics = data.fs->CloneDatabase(data.target_path, data.target_offset);
+	output.SetValue(0, 0, Value(data.target_path));
+	output.SetValue(1, 0, Value::UBIGINT(statistics.database_bytes));
+	output.SetValue(2, 0, Value::UBIGINT(statistics.wal_bytes));
+	output.SetValue(3, 0, Value::BOOLEAN(statistics.offloaded));
+	output.SetCardinality(1);
+
+	data.finished = true;
+}
+
+static unique_ptr<FunctionData> CloneDatabaseBind(ClientContext &ctx, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"target", "database_bytes", "wal_bytes", "offloaded"};
+	return_types = {LogicalType::VARCHAR, LogicalType::UBIGINT, LogicalType::UBIGINT, LogicalType::BOOLEAN};
+
+	auto &info = input.info->Cast<NvmeFileSystemFunctionInfo>();
+	auto result = make_uniq<CloneDatabaseFunctionData>();
+	result->fs = &info.fs;
+	result->target_path = StringValue::Get(input.inputs[0]);
+	auto offset = input.named_parameters.find("offset");
+	if (offset != input.named_parameters.end()) {
+		result->target_offset = DBConfig::ParseMemoryLimit(StringValue::Get(offset->second));
+	}
+
+	return std::move(result);
+}
+
+static NvmeFileSystem &AddConfig(DatabaseInstance &instance) {
 
 	DBConfig &config = DBConfig::GetConfig(instance);
 
@@ -63,14 +413,52 @@ static void AddConfig(DatabaseInstance &instance) {
 
 	// Add extension options
 	auto &fs = instance.GetFileSystem();
-	fs.RegisterSubSystem(make_uniq<NvmeFileSystem>(nvmeConfig));
+	auto nvme_fs = make_uniq<NvmeFileSystem>(nvmeConfig);
+	NvmeFileSystem &nvme_fs_ref = *nvme_fs;
+	fs.RegisterSubSystem(std::move(nvme_fs));
+
+	return nvme_fs_ref;
 }
 
 static void LoadInternal(DatabaseInstance &instance) {
-	AddConfig(instance);
+	NvmeFileSystem &fs = AddConfig(instance);
 
 	TableFunction config_print_function("print_config", {}, ConfigPrint, ConfigPrintBind);
 	ExtensionUtil::RegisterFunction(instance, config_print_function);
+
+	auto fs_info = make_shared_ptr<NvmeFileSystemFunctionInfo>(fs);
+
+	TableFunction queue_stats_function("nvmefs_queue_stats", {}, QueueStats, QueueStatsBind);
+	queue_stats_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, queue_stats_function);
+
+	TableFunction deallocation_stats_function("nvmefs_deallocation_stats", {}, DeallocationStats,
+	                                          DeallocationStatsBind);
+	deallocation_stats_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, deallocation_stats_function);
+
+	TableFunction temp_compression_stats_function("nvmefs_temp_compression_stats", {}, TempCompressionStats,
+	                                              TempCompressionStatsBind);
+	temp_compression_stats_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, temp_compression_stats_function);
+
+	TableFunction readahead_stats_function("nvmefs_readahead_stats", {}, ReadaheadStats, ReadaheadStatsBind);
+	readahead_stats_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, readahead_stats_function);
+
+	TableFunction write_frequency_function("nvmefs_write_frequency", {}, WriteFrequency, WriteFrequencyBind);
+	write_frequency_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, write_frequency_function);
+
+	TableFunction fdp_stats_function("nvmefs_fdp_stats", {}, FDPStats, FDPStatsBind);
+	fdp_stats_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, fdp_stats_function);
+
+	TableFunction clone_database_function("nvmefs_clone_database", {LogicalType::VARCHAR}, CloneDatabase,
+	                                      CloneDatabaseBind);
+	clone_database_function.named_parameters["offset"] = LogicalType::VARCHAR;
+	clone_database_function.function_info = fs_info;
+	ExtensionUtil::RegisterFunction(instance, clone_database_function);
 }
 
 void NvmefsExtension::Load(DuckDB &db) {
@@ -23,6 +23,10 @@ idx_t TemporaryBlock::GetEndLBA() {
 	return start_lba + lba_amount - 1;
 }
 
+idx_t TemporaryBlock::GetLBAAmount() {
+	return lba_amount;
+}
+
 bool TemporaryBlock::IsFree() {
 	return is_free;
 }
@@ -62,40 +66,45 @@ uint8_t NvmeTemporaryBlockManager::GetFreeListIndex(idx_t lba_amount) {
 }
 
 TemporaryBlock *NvmeTemporaryBlockManager::AllocateBlock(idx_t lba_amount) {
-	// auto start_time = std::chrono::high_resolution_clock::now();
+	TemporaryBlock *block = TryAllocateBlock(lba_amount);
+	if (block == nullptr) {
+		throw std::runtime_error("No free block available");
+	}
+	return block;
+}
+
+TemporaryBlock *NvmeTemporaryBlockManager::TryAllocateBlock(idx_t lba_amount) {
 	// Get the free list index for the given size
 	uint8_t free_list_index = GetFreeListIndex(lba_amount);
 
 	TemporaryBlock *block = nullptr;
 
-	// Get the free block from the free list
-	for (uint8_t i = free_list_index; i < 8; i++) {
-		if (blocks_free[i] != nullptr) {
-			// Get the block from the free list
-			block = PopFreeBlock(i);
-
-			// Check if the block is large enough
-			// Split the block if it is larger than the requested size
-			if (block->lba_amount > lba_amount) {
-				block = SplitBlock(block, lba_amount);
+	// A free list holds a range of sizes, and the last one every larger size, hence the first block that is large
+	// enough is taken rather than the top of the list
+	for (uint8_t i = free_list_index; i < 8 && block == nullptr; i++) {
+		for (TemporaryBlock *candidate = blocks_free[i]; candidate != nullptr;
+		     candidate = candidate->next_free_block) {
+			if (candidate->lba_amount >= lba_amount) {
+				block = candidate;
+				break;
 			}
-
-			break; // If we are in here we have found a block
 		}
 	}
 
 	if (block == nullptr) {
-		throw std::runtime_error("No free block available");
+		return nullptr;
+	}
+
+	RemoveFreeBlock(block);
+
+	// Split the block if it is larger than the requested size
+	if (block->lba_amount > lba_amount) {
+		block = SplitBlock(block, lba_amount);
 	}
 
 	// Return the block
 	block->is_free = false; // Mark the block as used
 
-	// auto end_time = std::chrono::high_resolution_clock::now();
-	// auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-	// // Print the duration
-	// printf("AllocateBlock took %d milliseconds.\n", duration.count());
-
 	return block;
 }
 
@@ -0,0 +1,97 @@
+#include "partial_lba_cache.hpp"
+
+#include <algorithm>
+
+namespace duckdb {
+
+PartialLBACache::PartialLBACache(idx_t lba_size, idx_t capacity)
+    : lba_size(lba_size), capacity(capacity), slot_lbas(capacity, DConstants::INVALID_INDEX),
+      storage(new data_t[lba_size * capacity]), next_victim(0), lowest_lba(DConstants::INVALID_INDEX),
+      highest_lba(0) {
+	D_ASSERT(capacity > 0);
+}
+
+bool PartialLBACache::Lookup(idx_t lba, data_ptr_t buffer) {
+	lock_guard<mutex> guard(lock);
+	auto entry = slots.find(lba);
+	if (entry == slots.end()) {
+		return false;
+	}
+
+	memcpy(buffer, storage.get() + entry->second * lba_size, lba_size);
+	return true;
+}
+
+void PartialLBACache::Insert(idx_t lba, const_data_ptr_t buffer) {
+	lock_guard<mutex> guard(lock);
+	idx_t slot;
+	auto entry = slots.find(lba);
+	if (entry != slots.end()) {
+		slot = entry->second;
+	} else {
+		slot = next_victim;
+		next_victim = (next_victim + 1) % capacity;
+		if (slot_lbas[slot] != DConstants::INVALID_INDEX) {
+			slots.erase(slot_lbas[slot]);
+		}
+		slot_lbas[slot] = lba;
+		slots[lba] = slot;
+	}
+
+	memcpy(storage.get() + slot * lba_size, buffer, lba_size);
+
+	// The bounds only grow, evicted LBAs merely make them less tight
+	if (lba < lowest_lba.load(std::memory_order_relaxed)) {
+		lowest_lba.store(lba, std::memory_order_relaxed);
+	}
+	if (lba > highest_lba.load(std::memory_order_relaxed)) {
+		highest_lba.store(lba, std::memory_order_relaxed);
+	}
+}
+
+void PartialLBACache::Invalidate(idx_t start_lba, idx_t nr_lbas) {
+	if (start_lba > highest_lba.load(std::memory_order_relaxed) ||
+	    start_lba + nr_lbas <= lowest_lba.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	lock_guard<mutex> guard(lock);
+	for (idx_t slot = 0; slot < capacity; slot++) {
+		idx_t lba = slot_lbas[slot];
+		if (lba != DConstants::INVALID_INDEX && lba >= start_lba && lba < start_lba + nr_lbas) {
+			slots.erase(lba);
+			slot_lbas[slot] = DConstants::INVALID_INDEX;
+		}
+	}
+}
+
+PartialLBALocks::Guard::Guard(PartialLBALocks &locks, vector<idx_t> stripes)
+    : locks(&locks), stripes(std::move(stripes)) {
+}
+
+PartialLBALocks::Guard::Guard(Guard &&other) noexcept : locks(other.locks), stripes(std::move(other.stripes)) {
+	other.stripes.clear();
+}
+
+PartialLBALocks::Guard::~Guard() {
+	for (idx_t stripe : stripes) {
+		locks->stripes[stripe].unlock();
+	}
+}
+
+PartialLBALocks::Guard PartialLBALocks::Lock(const vector<idx_t> &lbas) {
+	vector<idx_t> locked;
+	locked.reserve(lbas.size());
+	for (idx_t lba : lbas) {
+		locked.push_back(lba % PARTIAL_LBA_LOCK_STRIPES);
+	}
+	std::sort(locked.begin(), locked.end());
+	locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+	for (idx_t stripe : locked) {
+		stripes[stripe].lock();
+	}
+	return Guard(*this, std::move(locked));
+}
+
+} // namespace duckdb
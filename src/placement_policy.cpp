@@ -0,0 +1,133 @@
+#include "placement_policy.hpp"
+
+#include "nvmefs.hpp"
+
+namespace duckdb {
+
+static const char *const PLACEMENT_CATEGORY_NAMES[PLACEMENT_CATEGORY_COUNT] = {"db",        "wal",       "metadata",
+                                                                               "tmp_small", "tmp_large", "db_hot"};
+
+//! Default handles of the categories (db, wal, metadata, tmp_small, tmp_large, db_hot) by the number of available
+//! handles
+static const uint8_t DEFAULT_PLACEMENT_IDENTIFIERS[PLACEMENT_CATEGORY_COUNT][PLACEMENT_CATEGORY_COUNT] = {
+    {0, 0, 0, 0, 0, 0}, {0, 0, 0, 1, 1, 0}, {0, 1, 0, 2, 2, 0},
+    {0, 1, 0, 2, 3, 0}, {0, 1, 4, 2, 3, 0}, {0, 1, 4, 2, 3, 5}};
+
+PlacementPolicy::PlacementPolicy(idx_t nr_handles, const string &overrides)
+    : nr_handles(MaxValue<idx_t>(nr_handles, 1)) {
+	idx_t defaults = MinValue<idx_t>(this->nr_handles, PLACEMENT_CATEGORY_COUNT) - 1;
+	for (idx_t i = 0; i < PLACEMENT_CATEGORY_COUNT; i++) {
+		placement_identifiers[i] = DEFAULT_PLACEMENT_IDENTIFIERS[defaults][i];
+	}
+
+	ApplyOverrides(overrides);
+	InitializeSharedIdentifiers();
+}
+
+void PlacementPolicy::ApplyOverrides(const string &overrides) {
+	if (overrides.empty()) {
+		return;
+	}
+
+	for (const string &entry : StringUtil::Split(overrides, ",")) {
+		vector<string> pair = StringUtil::Split(entry, "=");
+		if (pair.size() != 2) {
+			throw InvalidInputException("Invalid placement '%s', expected category=handle", entry);
+		}
+		StringUtil::Trim(pair[0]);
+		StringUtil::Trim(pair[1]);
+
+		PlacementCategory category = ParseCategory(pair[0]);
+		idx_t handle;
+		try {
+			handle = std::stoull(pair[1]);
+		} catch (std::exception &) {
+			throw InvalidInputException("Invalid placement handle '%s' for category %s", pair[1], pair[0]);
+		}
+		if (handle >= nr_handles) {
+			throw InvalidInputException("Placement handle %llu of category %s exceeds the %llu available handles",
+			                            handle, pair[0], nr_handles);
+		}
+		placement_identifiers[static_cast<idx_t>(category)] = static_cast<uint8_t>(handle);
+	}
+}
+
+void PlacementPolicy::InitializeSharedIdentifiers() {
+	// Placement identifiers are 8 bits wide, hence handles beyond 255 cannot be addressed
+	idx_t addressable = MinValue<idx_t>(nr_handles, 256);
+	for (idx_t handle = 0; handle < addressable; handle++) {
+		bool assigned = false;
+		for (idx_t i = 0; i < PLACEMENT_CATEGORY_COUNT; i++) {
+			assigned = assigned || placement_identifiers[i] == handle;
+		}
+		if (!assigned) {
+			shared_identifiers.push_back(static_cast<uint8_t>(handle));
+		}
+	}
+}
+
+uint8_t PlacementPolicy::GetTemporaryPlacementIdentifier(PlacementCategory category, idx_t generation) const {
+	D_ASSERT(category == PlacementCategory::TEMP_SMALL || category == PlacementCategory::TEMP_LARGE);
+	idx_t slot = generation % (shared_identifiers.size() + 1);
+	if (slot == 0) {
+		return GetPlacementIdentifier(category);
+	}
+	return shared_identifiers[slot - 1];
+}
+
+uint8_t PlacementPolicy::GetFilePlacementIdentifier(const string &path, idx_t generation) const {
+	PlacementCategory category = Classify(path);
+	if (category == PlacementCategory::TEMP_SMALL || category == PlacementCategory::TEMP_LARGE) {
+		return GetTemporaryPlacementIdentifier(category, generation);
+	}
+	return GetPlacementIdentifier(category);
+}
+
+uint8_t PlacementPolicy::GetHotFilePlacementIdentifier(const string &path) const {
+	if (Classify(path) != PlacementCategory::DATABASE) {
+		return GetFilePlacementIdentifier(path, 0);
+	}
+	return GetPlacementIdentifier(PlacementCategory::DATABASE_HOT);
+}
+
+PlacementCategory PlacementPolicy::Classify(const string &path) {
+	if (path == NVMEFS_GLOBAL_METADATA_PATH) {
+		return PlacementCategory::METADATA;
+	}
+
+	switch (NvmeFileSystem::GetMetadataType(path)) {
+	case MetadataType::WAL:
+		return PlacementCategory::WAL;
+	case MetadataType::TEMPORARY:
+		// Temporary files are named after their block size, e.g. duckdb_temp_storage_DEFAULT-0.tmp
+		return StringUtil::Contains(path, "DEFAULT") ? PlacementCategory::TEMP_LARGE : PlacementCategory::TEMP_SMALL;
+	default:
+		return PlacementCategory::DATABASE;
+	}
+}
+
+string PlacementPolicy::ToString() const {
+	string result;
+	for (idx_t i = 0; i < PLACEMENT_CATEGORY_COUNT; i++) {
+		if (i > 0) {
+			result += ",";
+		}
+		result += StringUtil::Format("%s=%llu", PLACEMENT_CATEGORY_NAMES[i],
+		                             static_cast<idx_t>(placement_identifiers[i]));
+	}
+	return result;
+}
+
+PlacementCategory PlacementPolicy::ParseCategory(const string &name) {
+	string lower = StringUtil::Lower(name);
+	for (idx_t i = 0; i < PLACEMENT_CATEGORY_COUNT; i++) {
+		if (lower == PLACEMENT_CATEGORY_NAMES[i]) {
+			return static_cast<PlacementCategory>(i);
+		}
+	}
+	throw InvalidInputException("Unknown placement category '%s', expected one of db, wal, metadata, tmp_small, "
+	                            "tmp_large and db_hot",
+	                            name);
+}
+
+} // namespace duckdb
@@ -0,0 +1,40 @@
+#include "queue_depth_controller.hpp"
+
+namespace duckdb {
+
+QueueDepthController::QueueDepthController(idx_t max_depth, idx_t target_latency_us)
+    : max_depth(max_depth), target_latency_us(target_latency_us), window(max_depth), average_latency_us(0),
+      completions(0), round_completions(0) {
+	D_ASSERT(max_depth >= QUEUE_MIN_WINDOW);
+}
+
+void QueueDepthController::RecordCompletion(idx_t latency_us) {
+	double average = average_latency_us.load(std::memory_order_relaxed);
+	if (completions.load(std::memory_order_relaxed) == 0) {
+		average = static_cast<double>(latency_us);
+	} else {
+		average += QUEUE_LATENCY_EWMA_WEIGHT * (static_cast<double>(latency_us) - average);
+	}
+	average_latency_us.store(average, std::memory_order_relaxed);
+	completions.fetch_add(1, std::memory_order_relaxed);
+
+	if (!IsAdaptive()) {
+		return;
+	}
+
+	idx_t current = window.load(std::memory_order_relaxed);
+	if (++round_completions < current) {
+		return;
+	}
+	round_completions = 0;
+
+	// Additive increase while the device keeps up, multiplicative decrease once latency exceeds the target
+	if (average > static_cast<double>(target_latency_us)) {
+		current = MaxValue<idx_t>(current / 2, QUEUE_MIN_WINDOW);
+	} else if (current < max_depth) {
+		current++;
+	}
+	window.store(current, std::memory_order_relaxed);
+}
+
+} // namespace duckdb
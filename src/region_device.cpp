@@ -0,0 +1,141 @@
+#include "region_device.hpp"
+
+namespace duckdb {
+
+RegionDevice::RegionDevice(unique_ptr<Device> device_p, idx_t start_lba, idx_t lba_count)
+    : RegionDevice(*device_p, start_lba, lba_count) {
+	owned_device = std::move(device_p);
+}
+
+RegionDevice::RegionDevice(Device &device, idx_t start_lba, idx_t lba_count) : device(device), start_lba(start_lba) {
+	DeviceZoneGeometry zones;
+	if (device.GetZoneGeometry(zones)) {
+		throw InvalidInputException("%s is zoned, which regions do not support", device.GetName());
+	}
+
+	DeviceGeometry device_geometry = device.GetDeviceGeometry();
+	if (start_lba >= device_geometry.lba_count) {
+		throw InvalidInputException("A region at LBA %llu is beyond the %llu LBAs of %s", start_lba,
+		                            device_geometry.lba_count, device.GetName());
+	}
+	if (lba_count == 0) {
+		lba_count = device_geometry.lba_count - start_lba;
+	}
+	if (lba_count > device_geometry.lba_count - start_lba) {
+		throw InvalidInputException("A region of %llu LBAs at LBA %llu exceeds the %llu LBAs of %s", lba_count,
+		                            start_lba, device_geometry.lba_count, device.GetName());
+	}
+	geometry.lba_size = device_geometry.lba_size;
+	geometry.lba_count = lba_count;
+}
+
+DeviceLBARange RegionDevice::Translate(const DeviceLBARange &range) const {
+	if (range.start_lba + range.nr_lbas > geometry.lba_count) {
+		throw IOException("Range of %llu LBAs at LBA %llu is beyond the %llu LBAs of the region", range.nr_lbas,
+		                  range.start_lba, geometry.lba_count);
+	}
+	return DeviceLBARange {start_lba + range.start_lba, range.nr_lbas};
+}
+
+NvmeCmdContext RegionDevice::Translate(const CmdContext &context) const {
+	NvmeCmdContext translated = static_cast<const NvmeCmdContext &>(context);
+	translated.start_lba = Translate(DeviceLBARange {context.start_lba, context.nr_lbas}).start_lba;
+	return translated;
+}
+
+idx_t RegionDevice::Write(void *buffer, const CmdContext &context) {
+	return device.Write(buffer, Translate(context));
+}
+
+idx_t RegionDevice::Read(void *buffer, const CmdContext &context) {
+	return device.Read(buffer, Translate(context));
+}
+
+idx_t RegionDevice::WriteBatch(const DeviceIORequest *requests, idx_t count) {
+	return SubmitBatch(requests, count, true);
+}
+
+idx_t RegionDevice::ReadBatch(const DeviceIORequest *requests, idx_t count) {
+	return SubmitBatch(requests, count, false);
+}
+
+idx_t RegionDevice::SubmitBatch(const DeviceIORequest *requests, idx_t count, bool write) {
+	// Reserved up front, as the translated requests reference the contexts
+	vector<NvmeCmdContext> contexts(count);
+	vector<DeviceIORequest> translated(count);
+	for (idx_t i = 0; i < count; i++) {
+		contexts[i] = Translate(*requests[i].context);
+		translated[i] = DeviceIORequest {requests[i].buffer, &contexts[i]};
+	}
+	return write ? device.WriteBatch(translated.data(), count) : device.ReadBatch(translated.data(), count);
+}
+
+DeviceGeometry RegionDevice::GetDeviceGeometry() {
+	return geometry;
+}
+
+bool RegionDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	vector<DeviceLBARange> translated;
+	for (idx_t i = 0; i < count; i++) {
+		translated.push_back(Translate(ranges[i]));
+	}
+	return device.Deallocate(translated.data(), translated.size());
+}
+
+bool RegionDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	vector<DeviceLBARange> translated;
+	idx_t nr_lbas = 0;
+	for (idx_t i = 0; i < count; i++) {
+		translated.push_back(Translate(ranges[i]));
+		nr_lbas += ranges[i].nr_lbas;
+	}
+
+	auto region = dynamic_cast<RegionDevice *>(&destination);
+	if (region && &region->device == &device) {
+		DeviceLBARange target = region->Translate(DeviceLBARange {destination_lba, nr_lbas});
+		return device.Copy(translated.data(), translated.size(), device, target.start_lba);
+	}
+	return device.Copy(translated.data(), translated.size(), destination, destination_lba);
+}
+
+data_ptr_t RegionDevice::AllocateBuffer(idx_t nr_bytes) {
+	return device.AllocateBuffer(nr_bytes);
+}
+
+void RegionDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	device.FreeBuffer(buffer, nr_bytes);
+}
+
+vector<DeviceQueueStatistics> RegionDevice::GetQueueStatistics() {
+	return device.GetQueueStatistics();
+}
+
+bool RegionDevice::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	return device.GetFDPStatistics(statistics);
+}
+
+uint8_t RegionDevice::GetPlacementIdentifier(const string &path, idx_t generation) {
+	return device.GetPlacementIdentifier(path, generation);
+}
+
+uint8_t RegionDevice::GetHotPlacementIdentifier(const string &path) {
+	return device.GetHotPlacementIdentifier(path);
+}
+
+void RegionDevice::SetThreadCount(idx_t nr_threads) {
+	device.SetThreadCount(nr_threads);
+}
+
+bool RegionDevice::Overlaps(Device &other) {
+	if (&other == this || &other == &device) {
+		return true;
+	}
+	auto region = dynamic_cast<RegionDevice *>(&other);
+	if (!region || &region->device != &device) {
+		return false;
+	}
+	return start_lba < region->start_lba + region->geometry.lba_count &&
+	       region->start_lba < start_lba + geometry.lba_count;
+}
+
+} // namespace duckdb
@@ -0,0 +1,282 @@
+#include "scan_readahead.hpp"
+
+#include "nvme_device.hpp"
+
+namespace duckdb {
+
+ScanReadahead::ScanReadahead(Device &device, idx_t start_lba, idx_t end_lba, idx_t capacity, bool background)
+    : device(device), lba_size(device.GetDeviceGeometry().lba_size), start_lba(start_lba), end_lba(end_lba),
+      capacity(capacity), streams(), next_stream_id(1), clock(0), max_entry_lbas(0), staged_bytes(0), hits(0),
+      late_hits(0), prefetched_bytes(0), wasted_bytes(0), shutdown(false) {
+	if (background) {
+		thread = std::thread([this]() { Run(); });
+	}
+}
+
+ScanReadahead::~ScanReadahead() {
+	{
+		lock_guard<mutex> guard(lock);
+		shutdown = true;
+	}
+	condition.notify_all();
+	if (thread.joinable()) {
+		thread.join();
+	}
+
+	for (auto &entry : entries) {
+		device.FreeBuffer(entry.second.buffer, entry.second.nr_lbas * lba_size);
+	}
+}
+
+bool ScanReadahead::Read(void *buffer, const CmdContext &context) {
+	// Only reads of whole LBAs are prefetched
+	if (context.offset != 0 || context.start_lba < start_lba || context.start_lba + context.nr_lbas > end_lba) {
+		return false;
+	}
+
+	std::unique_lock<mutex> guard(lock);
+	idx_t stream_id = UpdateStreams(context.start_lba, context.nr_lbas).id;
+
+	data_ptr_t data = nullptr;
+	bool waited = false;
+	while (true) {
+		auto entry = entries.find(context.start_lba);
+		if (entry == entries.end() || entry->second.stale || entry->second.nr_lbas != context.nr_lbas) {
+			break;
+		}
+		if (entry->second.state == EntryState::QUEUED) {
+			// Reading the range directly is faster than waiting for the prefetches that were queued before it
+			RemoveEntry(entry, false);
+			break;
+		}
+		if (entry->second.state == EntryState::IN_FLIGHT) {
+			waited = true;
+			condition.wait(guard);
+			continue;
+		}
+
+		// The entry is taken out of the staging area, such that it can be copied without holding the lock
+		data = entry->second.buffer;
+		staged_bytes -= entry->second.nr_lbas * lba_size;
+		entries.erase(entry);
+		hits++;
+		late_hits += waited;
+		break;
+	}
+
+	Stream *stream = GetStream(stream_id);
+	if (stream) {
+		if (waited) {
+			// The reader caught up with the device, hence the stream is prefetched further ahead
+			stream->window = MinValue<idx_t>(stream->window * 2, READAHEAD_MAX_WINDOW);
+		}
+		if (stream->sequential_reads >= READAHEAD_TRIGGER_READS) {
+			Prefetch(*stream);
+		}
+	}
+	guard.unlock();
+
+	if (!data) {
+		return false;
+	}
+	idx_t nr_bytes = context.nr_lbas * lba_size;
+	memcpy(buffer, data, context.nr_bytes);
+	device.FreeBuffer(data, nr_bytes);
+	return true;
+}
+
+void ScanReadahead::Invalidate(idx_t start_lba, idx_t nr_lbas) {
+	lock_guard<mutex> guard(lock);
+	if (entries.empty()) {
+		return;
+	}
+
+	idx_t end = start_lba + nr_lbas;
+	auto entry = entries.lower_bound(start_lba >= max_entry_lbas ? start_lba - max_entry_lbas + 1 : 0);
+	while (entry != entries.end() && entry->first < end) {
+		auto next = std::next(entry);
+		if (entry->first + entry->second.nr_lbas > start_lba) {
+			if (entry->second.state == EntryState::IN_FLIGHT) {
+				// The prefetch may have read the range before it was written, it is dropped once it completes
+				entry->second.stale = true;
+			} else {
+				RemoveEntry(entry, true);
+			}
+		}
+		entry = next;
+	}
+}
+
+void ScanReadahead::Flush() {
+	std::unique_lock<mutex> guard(lock);
+	while (IssueQueued(guard)) {
+	}
+}
+
+ReadaheadStatistics ScanReadahead::GetStatistics() {
+	lock_guard<mutex> guard(lock);
+	return ReadaheadStatistics {hits, late_hits, prefetched_bytes, wasted_bytes, staged_bytes};
+}
+
+ScanReadahead::Stream &ScanReadahead::UpdateStreams(idx_t lba, idx_t nr_lbas) {
+	clock++;
+	for (Stream &stream : streams) {
+		if (stream.id == 0 || stream.request_lbas != nr_lbas) {
+			continue;
+		}
+		idx_t span = stream.window * stream.request_lbas;
+		if (lba + span < stream.next_lba || lba > stream.next_lba + span) {
+			continue;
+		}
+
+		// Rereads of the same range do not make a stream sequential
+		if (lba + nr_lbas > stream.next_lba) {
+			stream.next_lba = lba + nr_lbas;
+			stream.prefetch_lba = MaxValue<idx_t>(stream.prefetch_lba, stream.next_lba);
+			stream.sequential_reads++;
+		}
+		stream.last_read = clock;
+		return stream;
+	}
+
+	// Unused slots have never been read, hence they are replaced first
+	Stream *replaced = &streams[0];
+	for (Stream &stream : streams) {
+		if (stream.last_read < replaced->last_read) {
+			replaced = &stream;
+		}
+	}
+	*replaced = Stream {next_stream_id++, lba + nr_lbas, nr_lbas, lba + nr_lbas, READAHEAD_INITIAL_WINDOW, 1, clock};
+	return *replaced;
+}
+
+ScanReadahead::Stream *ScanReadahead::GetStream(idx_t stream_id) {
+	for (Stream &stream : streams) {
+		if (stream.id == stream_id) {
+			return &stream;
+		}
+	}
+	return nullptr;
+}
+
+void ScanReadahead::Prefetch(Stream &stream) {
+	idx_t window_end = MinValue<idx_t>(stream.next_lba + stream.window * stream.request_lbas, end_lba);
+	idx_t nr_bytes = stream.request_lbas * lba_size;
+
+	bool queued = false;
+	while (stream.prefetch_lba + stream.request_lbas <= window_end) {
+		idx_t lba = stream.prefetch_lba;
+		if (entries.find(lba) == entries.end()) {
+			if (!MakeRoom(nr_bytes)) {
+				break;
+			}
+			entries.emplace(lba, Entry {stream.request_lbas, device.AllocateBuffer(nr_bytes), EntryState::QUEUED,
+			                            false, stream.id});
+			max_entry_lbas = MaxValue<idx_t>(max_entry_lbas, stream.request_lbas);
+			staged_bytes += nr_bytes;
+			queue.push_back(lba);
+			queued = true;
+		}
+		stream.prefetch_lba += stream.request_lbas;
+	}
+
+	if (queued) {
+		condition.notify_all();
+	}
+}
+
+bool ScanReadahead::MakeRoom(idx_t nr_bytes) {
+	auto entry = entries.begin();
+	while (staged_bytes + nr_bytes > capacity && entry != entries.end()) {
+		auto next = std::next(entry);
+		Stream *stream = GetStream(entry->second.stream_id);
+		bool passed = !stream || entry->first + entry->second.nr_lbas <= stream->next_lba;
+		if (passed && entry->second.state != EntryState::IN_FLIGHT) {
+			if (stream) {
+				// The stream skipped the range, hence it was prefetched too far ahead
+				stream->window = MaxValue<idx_t>(stream->window / 2, 1);
+			}
+			RemoveEntry(entry, true);
+		}
+		entry = next;
+	}
+	return staged_bytes + nr_bytes <= capacity;
+}
+
+void ScanReadahead::RemoveEntry(map<idx_t, Entry>::iterator entry, bool wasted) {
+	D_ASSERT(entry->second.state != EntryState::IN_FLIGHT);
+	idx_t nr_bytes = entry->second.nr_lbas * lba_size;
+	if (wasted && entry->second.state == EntryState::READY) {
+		wasted_bytes += nr_bytes;
+	}
+	device.FreeBuffer(entry->second.buffer, nr_bytes);
+	staged_bytes -= nr_bytes;
+	entries.erase(entry);
+}
+
+bool ScanReadahead::IssueQueued(std::unique_lock<mutex> &guard) {
+	vector<idx_t> batch;
+	while (!queue.empty() && batch.size() < READAHEAD_MAX_BATCH) {
+		idx_t lba = queue.front();
+		queue.pop_front();
+		// Entries that were read or invalidated while queued are gone
+		auto entry = entries.find(lba);
+		if (entry != entries.end() && entry->second.state == EntryState::QUEUED) {
+			entry->second.state = EntryState::IN_FLIGHT;
+			batch.push_back(lba);
+		}
+	}
+	if (batch.empty()) {
+		return false;
+	}
+
+	// Entries in flight are not removed, hence they can be accessed without the lock
+	vector<NvmeCmdContext> contexts(batch.size());
+	vector<DeviceIORequest> requests(batch.size());
+	for (idx_t i = 0; i < batch.size(); i++) {
+		Entry &entry = entries.find(batch[i])->second;
+		contexts[i].nr_bytes = entry.nr_lbas * lba_size;
+		contexts[i].nr_lbas = entry.nr_lbas;
+		contexts[i].start_lba = batch[i];
+		contexts[i].offset = 0;
+		requests[i] = DeviceIORequest {entry.buffer, &contexts[i]};
+	}
+
+	guard.unlock();
+	bool failed = false;
+	try {
+		device.ReadBatch(requests.data(), requests.size());
+	} catch (std::exception &) {
+		// Readers of the ranges read them from the device themselves, which reports the error
+		failed = true;
+	}
+	guard.lock();
+
+	for (idx_t lba : batch) {
+		auto entry = entries.find(lba);
+		entry->second.state = EntryState::READY;
+		if (failed) {
+			RemoveEntry(entry, false);
+			continue;
+		}
+		prefetched_bytes += entry->second.nr_lbas * lba_size;
+		if (entry->second.stale) {
+			RemoveEntry(entry, true);
+		}
+	}
+	condition.notify_all();
+	return true;
+}
+
+void ScanReadahead::Run() {
+	std::unique_lock<mutex> guard(lock);
+	while (true) {
+		condition.wait(guard, [this]() { return shutdown || !queue.empty(); });
+		if (shutdown) {
+			return;
+		}
+		IssueQueued(guard);
+	}
+}
+
+} // namespace duckdb
@@ -0,0 +1,108 @@
+#include "temporary_block_compressor.hpp"
+
+#include "zstd.h"
+
+namespace duckdb {
+
+TemporaryBlockCompressor::TemporaryBlockCompressor(int64_t level, idx_t lba_size)
+    : level(static_cast<int>(level)), lba_size(lba_size), compressed_blocks(0), uncompressed_blocks(0),
+      block_bytes(0), stored_bytes(0) {
+	if (level < duckdb_zstd::ZSTD_minCLevel() || level > duckdb_zstd::ZSTD_maxCLevel()) {
+		throw InvalidInputException("Temporary compression level %lld is outside the ZSTD range [%d, %d]", level,
+		                            duckdb_zstd::ZSTD_minCLevel(), duckdb_zstd::ZSTD_maxCLevel());
+	}
+}
+
+TemporaryBlockCompressor::~TemporaryBlockCompressor() {
+	for (duckdb_zstd::ZSTD_CCtx *context : compression_contexts) {
+		duckdb_zstd::ZSTD_freeCCtx(context);
+	}
+	for (duckdb_zstd::ZSTD_DCtx *context : decompression_contexts) {
+		duckdb_zstd::ZSTD_freeDCtx(context);
+	}
+}
+
+idx_t TemporaryBlockCompressor::Compress(const_data_ptr_t block, idx_t nr_bytes, data_ptr_t out) {
+	duckdb_zstd::ZSTD_CCtx *context = nullptr;
+	{
+		lock_guard<mutex> guard(context_lock);
+		if (!compression_contexts.empty()) {
+			context = compression_contexts.back();
+			compression_contexts.pop_back();
+		}
+	}
+	if (!context) {
+		context = duckdb_zstd::ZSTD_createCCtx();
+	}
+
+	// A frame that does not fit in one LBA less than the block is not worth decompressing, and fails early
+	size_t frame_size =
+	    duckdb_zstd::ZSTD_compressCCtx(context, out, nr_bytes - lba_size, block, nr_bytes, level);
+	{
+		lock_guard<mutex> guard(context_lock);
+		compression_contexts.push_back(context);
+	}
+
+	block_bytes += nr_bytes;
+	if (duckdb_zstd::ZSTD_isError(frame_size)) {
+		uncompressed_blocks++;
+		stored_bytes += nr_bytes;
+		return 0;
+	}
+
+	idx_t compressed_bytes = AlignValue<idx_t>(frame_size, lba_size);
+	memset(out + frame_size, 0, compressed_bytes - frame_size);
+	compressed_blocks++;
+	stored_bytes += compressed_bytes;
+	return compressed_bytes;
+}
+
+void TemporaryBlockCompressor::Decompress(const_data_ptr_t compressed, idx_t compressed_bytes, data_ptr_t block,
+                                          idx_t nr_bytes) {
+	// The frame is followed by the zeros that pad it to whole LBAs
+	size_t frame_size = duckdb_zstd::ZSTD_findFrameCompressedSize(compressed, compressed_bytes);
+	if (duckdb_zstd::ZSTD_isError(frame_size)) {
+		throw IOException("Compressed temporary block is corrupt: %s", duckdb_zstd::ZSTD_getErrorName(frame_size));
+	}
+
+	duckdb_zstd::ZSTD_DCtx *context = nullptr;
+	{
+		lock_guard<mutex> guard(context_lock);
+		if (!decompression_contexts.empty()) {
+			context = decompression_contexts.back();
+			decompression_contexts.pop_back();
+		}
+	}
+	if (!context) {
+		context = duckdb_zstd::ZSTD_createDCtx();
+	}
+
+	size_t result = duckdb_zstd::ZSTD_decompressDCtx(context, block, nr_bytes, compressed, frame_size);
+	{
+		lock_guard<mutex> guard(context_lock);
+		decompression_contexts.push_back(context);
+	}
+
+	if (duckdb_zstd::ZSTD_isError(result)) {
+		throw IOException("Compressed temporary block is corrupt: %s", duckdb_zstd::ZSTD_getErrorName(result));
+	}
+	if (result != nr_bytes) {
+		throw IOException("Compressed temporary block holds %llu bytes instead of %llu", result, nr_bytes);
+	}
+}
+
+TemporaryCompressionStatistics TemporaryBlockCompressor::GetStatistics() const {
+	return TemporaryCompressionStatistics {compressed_blocks.load(), uncompressed_blocks.load(), block_bytes.load(),
+	                                       stored_bytes.load()};
+}
+
+bool TemporaryBlockCompressor::ParseCompression(const string &name) {
+	if (name == "none") {
+		return false;
+	} else if (name == "zstd") {
+		return true;
+	}
+	throw InvalidInputException("Unknown temporary compression '%s', expected 'none' or 'zstd'", name);
+}
+
+} // namespace duckdb
@@ -19,15 +19,15 @@ inline idx_t GetBufferSize(const string buffer_size_string) {
 	} else if (!buffer_size_string.compare("S224K")) {
 		return 229376;
 	} else if (!buffer_size_string.compare("DEFAULT")) {
-		return 262144;
+		return NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE;
 	} else {
 		throw InvalidInputException("Unknown buffer size %s", buffer_size_string.c_str());
 	}
 }
 
-inline unique_ptr<TempFileMetadata> CreateTempFileMetadata(const string &filename) {
+inline shared_ptr<TempFileMetadata> CreateTempFileMetadata(const string &filename) {
 
-	unique_ptr<TempFileMetadata> tfmeta = make_uniq<TempFileMetadata>();
+	shared_ptr<TempFileMetadata> tfmeta = make_shared_ptr<TempFileMetadata>();
 	tfmeta->is_active.store(true);
 
 	// Find the position of the first number
@@ -57,7 +57,7 @@ inline unique_ptr<TempFileMetadata> CreateTempFileMetadata(const string &filenam
 
 boost::shared_mutex TemporaryFileMetadataManager::temp_mutex;
 
-const TempFileMetadata *TemporaryFileMetadataManager::GetOrCreateFile(const string &filename) {
+shared_ptr<TempFileMetadata> TemporaryFileMetadataManager::GetOrCreateFile(const string &filename) {
 
 	// Lock the shared mutex for writing
 	{
@@ -65,19 +65,32 @@ const TempFileMetadata *TemporaryFileMetadataManager::GetOrCreateFile(const stri
 
 		// Check if the file already exists
 		if (file_to_temp_meta.count(filename)) {
-			return file_to_temp_meta[filename].get();
+			return file_to_temp_meta[filename];
 		}
 	}
 
 	boost::unique_lock<boost::shared_mutex> lock(temp_mutex);
 	// Create a new TempFileMetadata object
-	unique_ptr<TempFileMetadata> tfmeta = CreateTempFileMetadata(filename);
+	shared_ptr<TempFileMetadata> tfmeta = CreateTempFileMetadata(filename);
 	tfmeta->is_active.store(true);
 	// printf("Temporary file %s created with block size %d and file index %d\n", filename.c_str(), tfmeta->block_size,
 	//    tfmeta->file_index);
 	auto [entry, is_new] = file_to_temp_meta.emplace(filename, std::move(tfmeta));
+	if (is_new) {
+		entry->second->generation = next_generation++;
+	}
+
+	return file_to_temp_meta[filename];
+}
 
-	return file_to_temp_meta[filename].get();
+shared_ptr<TempFileMetadata> TemporaryFileMetadataManager::GetFile(const string &filename) {
+	boost::shared_lock<boost::shared_mutex> lock(temp_mutex);
+
+	auto entry = file_to_temp_meta.find(filename);
+	if (entry == file_to_temp_meta.end()) {
+		return nullptr;
+	}
+	return entry->second;
 }
 
 void TemporaryFileMetadataManager::CreateFile(const string &filename) {
@@ -86,39 +99,252 @@ void TemporaryFileMetadataManager::CreateFile(const string &filename) {
 }
 
 idx_t TemporaryFileMetadataManager::GetLBA(const string &filename, idx_t location, idx_t nr_lbas) {
+	TempFileMetadata *tfmeta;
 	{
 		boost::shared_lock<boost::shared_mutex> lock(temp_mutex);
+		tfmeta = file_to_temp_meta[filename].get();
+	}
 
-		TempFileMetadata *tfmeta = file_to_temp_meta[filename].get();
-		boost::shared_lock<boost::shared_mutex> file_lock(tfmeta->file_mutex);
+	return GetLBA(*tfmeta, location, nr_lbas);
+}
 
-		idx_t block_index = location / tfmeta->block_size;
+idx_t TemporaryFileMetadataManager::GetLBA(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas) {
+	idx_t block_index = location / tfmeta.block_size;
+	{
+		boost::shared_lock<boost::shared_mutex> lock(temp_mutex);
+		boost::shared_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
 
-		if (nr_lbas != (tfmeta->block_size / lba_size)) {
+		if (nr_lbas != (tfmeta.block_size / lba_size)) {
 			throw IOException("Temporary file block size mismatch");
 		}
 
-		if (tfmeta->block_map.count(block_index)) {
+		auto entry = tfmeta.block_map.find(block_index);
+		if (entry != tfmeta.block_map.end()) {
+			return entry->second;
+		}
+	}
+
+	boost::unique_lock<boost::shared_mutex> lock(temp_mutex);
+	boost::unique_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
+
+	auto entry = tfmeta.block_map.find(block_index);
+	if (entry != tfmeta.block_map.end()) {
+		return entry->second;
+	}
+	idx_t lba = AllocateBlockLBA(tfmeta, nr_lbas);
+	tfmeta.block_map[block_index] = lba;
+
+	return lba;
+}
+
+idx_t TemporaryFileMetadataManager::ReserveZoneBlock(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas) {
+	D_ASSERT(zone_capacity > 0);
+	boost::unique_lock<boost::shared_mutex> lock(temp_mutex);
+	boost::unique_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
+
+	if (nr_lbas != (tfmeta.block_size / lba_size) || location % tfmeta.block_size != 0) {
+		throw IOException("Temporary file block size mismatch");
+	}
+	if (nr_lbas > zone_capacity) {
+		throw IOException("Temporary blocks of %llu LBAs do not fit in zones of %llu LBAs", nr_lbas, zone_capacity);
+	}
+
+	if (!tfmeta.is_active) {
+		throw IOException("Temporary file has been deleted");
+	}
+
+	// Appends to the zone may complete in any order, hence the room of a block is taken when it is reserved
+	if (tfmeta.extents.empty() || tfmeta.extent_offset + nr_lbas > zone_capacity) {
+		tfmeta.extents.push_back(AllocateExtent(tfmeta, nr_lbas));
+		tfmeta.extent_offset = 0;
+	}
+	tfmeta.extent_offset += nr_lbas;
+	return tfmeta.extents.back()->GetStartLBA();
+}
+
+void TemporaryFileMetadataManager::MapZoneBlock(TempFileMetadata &tfmeta, idx_t location, idx_t lba) {
+	boost::unique_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
+	tfmeta.block_map[location / tfmeta.block_size] = lba;
+}
+
+TemporaryBlockSlot TemporaryFileMetadataManager::GetBlockSlot(TempFileMetadata &tfmeta, idx_t location) {
+	idx_t block_index = location / tfmeta.block_size;
+	idx_t block_lbas = tfmeta.block_size / lba_size;
+	{
+		boost::shared_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
 
-			return tfmeta->block_map[block_index]->GetStartLBA();
+		auto entry = tfmeta.block_map.find(block_index);
+		if (entry != tfmeta.block_map.end()) {
+			auto compressed = tfmeta.compressed_lbas.find(block_index);
+			return TemporaryBlockSlot {entry->second,
+			                           compressed != tfmeta.compressed_lbas.end() ? compressed->second : block_lbas};
 		}
 	}
 
+	return TemporaryBlockSlot {GetLBA(tfmeta, location, block_lbas), block_lbas};
+}
+
+idx_t TemporaryFileMetadataManager::AllocateBlockSlot(TempFileMetadata &tfmeta, idx_t location, idx_t nr_lbas) {
+	idx_t block_index = location / tfmeta.block_size;
+	idx_t block_lbas = tfmeta.block_size / lba_size;
+	if (nr_lbas == 0 || nr_lbas > block_lbas || location % tfmeta.block_size != 0) {
+		throw IOException("Temporary file block size mismatch");
+	}
+
 	boost::unique_lock<boost::shared_mutex> lock(temp_mutex);
-	boost::unique_lock<boost::shared_mutex> file_lock(file_to_temp_meta[filename]->file_mutex);
+	boost::unique_lock<boost::shared_mutex> file_lock(tfmeta.file_mutex);
+
+	auto entry = tfmeta.block_map.find(block_index);
+	if (entry != tfmeta.block_map.end()) {
+		auto compressed = tfmeta.compressed_lbas.find(block_index);
+		idx_t slot_lbas = compressed != tfmeta.compressed_lbas.end() ? compressed->second : block_lbas;
+		if (slot_lbas == nr_lbas) {
+			return entry->second;
+		}
+		ReleaseBlock(tfmeta, block_index);
+	}
 
-	TempFileMetadata *tfmeta = file_to_temp_meta[filename].get();
-	idx_t block_index = location / tfmeta->block_size;
+	idx_t lba = AllocateBlockLBA(tfmeta, nr_lbas);
+	tfmeta.block_map[block_index] = lba;
+	if (nr_lbas < block_lbas) {
+		tfmeta.compressed_lbas[block_index] = nr_lbas;
+	}
+	return lba;
+}
 
-	if (!tfmeta->block_map.count(block_index)) {
-		TemporaryBlock *block = block_manager->AllocateBlock(nr_lbas);
-		tfmeta->block_map[block_index] = block;
+idx_t TemporaryFileMetadataManager::AllocateBlockLBA(TempFileMetadata &tfmeta, idx_t nr_lbas) {
+	if (zone_capacity > 0) {
+		// Blocks in zones are mapped when they are appended
+		throw IOException("Temporary block has not been written");
+	}
+	if (!tfmeta.is_active) {
+		// The extents of a deleted file have been freed, and would not be freed again
+		throw IOException("Temporary file has been deleted");
+	}
+
+	idx_t block_lbas = tfmeta.block_size / lba_size;
+	if (nr_lbas < block_lbas) {
+		return AllocateCompressedSlot(tfmeta, nr_lbas);
+	}
+	if (!tfmeta.free_lbas.empty()) {
+		idx_t lba = tfmeta.free_lbas.back();
+		tfmeta.free_lbas.pop_back();
+		return lba;
+	}
+
+	if (tfmeta.extents.empty() || tfmeta.extent_offset + nr_lbas > tfmeta.extents.back()->GetLBAAmount()) {
+		tfmeta.extents.push_back(AllocateExtent(tfmeta, block_lbas));
+		tfmeta.extent_offset = 0;
 	}
-	idx_t lba = tfmeta->block_map[block_index]->GetStartLBA();
 
+	idx_t lba = tfmeta.extents.back()->GetStartLBA() + tfmeta.extent_offset;
+	tfmeta.extent_offset += nr_lbas;
 	return lba;
 }
 
+TemporaryBlock *TemporaryFileMetadataManager::AllocateExtent(TempFileMetadata &tfmeta, idx_t block_lbas) {
+	if (zone_capacity > 0) {
+		// Extents of exactly one zone keep the zones of the temporary region aligned to extents
+		TemporaryBlock *zone = block_manager->TryAllocateBlock(extent_lbas);
+		if (!zone) {
+			throw IOException("No free zone left in the temporary region");
+		}
+		return zone;
+	}
+
+	// Extents double as the file grows, and hold a whole number of blocks, such that no block straddles two extents
+	idx_t nr_lbas = tfmeta.extents.empty() ? initial_extent_lbas : tfmeta.extents.back()->GetLBAAmount() * 2;
+	idx_t nr_blocks = MaxValue<idx_t>(MinValue<idx_t>(nr_lbas, extent_lbas) / block_lbas, 1);
+	while (true) {
+		TemporaryBlock *extent = block_manager->TryAllocateBlock(nr_blocks * block_lbas);
+		if (extent) {
+			return extent;
+		}
+		if (nr_blocks == 1) {
+			throw IOException("No space left in the temporary region for a block of %llu LBAs", block_lbas);
+		}
+		nr_blocks /= 2;
+	}
+}
+
+void TemporaryFileMetadataManager::FreeExtents(TempFileMetadata &tfmeta) {
+	for (TemporaryBlock *extent : tfmeta.extents) {
+		FreeBlock(extent);
+	}
+	tfmeta.extents.clear();
+	tfmeta.extent_offset = 0;
+	tfmeta.free_lbas.clear();
+	tfmeta.frame_lbas.clear();
+	tfmeta.free_slots.clear();
+}
+
+idx_t TemporaryFileMetadataManager::AllocateCompressedSlot(TempFileMetadata &tfmeta, idx_t nr_lbas) {
+	for (auto slot = tfmeta.free_slots.begin(); slot != tfmeta.free_slots.end(); slot++) {
+		if (slot->second < nr_lbas) {
+			continue;
+		}
+		idx_t lba = slot->first;
+		idx_t remaining = slot->second - nr_lbas;
+		tfmeta.free_slots.erase(slot);
+		if (remaining > 0) {
+			tfmeta.free_slots.emplace(lba + nr_lbas, remaining);
+		}
+		std::prev(tfmeta.frame_lbas.upper_bound(lba))->second += nr_lbas;
+		return lba;
+	}
+
+	// The new frame takes the place of a block, either a freed one or a new one carved from the extent
+	idx_t block_lbas = tfmeta.block_size / lba_size;
+	idx_t frame = AllocateBlockLBA(tfmeta, block_lbas);
+	tfmeta.frame_lbas[frame] = nr_lbas;
+	tfmeta.free_slots.emplace(frame + nr_lbas, block_lbas - nr_lbas);
+	return frame;
+}
+
+void TemporaryFileMetadataManager::ReleaseCompressedSlot(TempFileMetadata &tfmeta, idx_t start_lba, idx_t nr_lbas) {
+	auto frame = std::prev(tfmeta.frame_lbas.upper_bound(start_lba));
+	idx_t frame_start = frame->first;
+	idx_t frame_end = frame_start + tfmeta.block_size / lba_size;
+	frame->second -= nr_lbas;
+	if (frame->second == 0) {
+		tfmeta.free_slots.erase(tfmeta.free_slots.lower_bound(frame_start), tfmeta.free_slots.lower_bound(frame_end));
+		tfmeta.frame_lbas.erase(frame);
+		tfmeta.free_lbas.push_back(frame_start);
+		return;
+	}
+
+	// The freed LBAs are merged with the free LBAs around them, but not with those of the frames next to them
+	idx_t end_lba = start_lba + nr_lbas;
+	auto next = tfmeta.free_slots.lower_bound(start_lba);
+	if (next != tfmeta.free_slots.end() && next->first == end_lba && end_lba < frame_end) {
+		end_lba += next->second;
+		next = tfmeta.free_slots.erase(next);
+	}
+	if (next != tfmeta.free_slots.begin() && start_lba > frame_start) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == start_lba) {
+			start_lba = previous->first;
+			tfmeta.free_slots.erase(previous);
+		}
+	}
+	tfmeta.free_slots.emplace(start_lba, end_lba - start_lba);
+}
+
+void TemporaryFileMetadataManager::ReleaseBlock(TempFileMetadata &tfmeta, idx_t block_index) {
+	auto entry = tfmeta.block_map.find(block_index);
+	if (entry == tfmeta.block_map.end()) {
+		return;
+	}
+	auto compressed = tfmeta.compressed_lbas.find(block_index);
+	if (compressed != tfmeta.compressed_lbas.end()) {
+		ReleaseCompressedSlot(tfmeta, entry->second, compressed->second);
+		tfmeta.compressed_lbas.erase(compressed);
+	} else {
+		tfmeta.free_lbas.push_back(entry->second);
+	}
+	tfmeta.block_map.erase(entry);
+}
+
 void TemporaryFileMetadataManager::MoveLBALocation(const string &filename, idx_t lba_location) {
 	// boost::shared_lock<boost::shared_mutex> lock(temp_mutex);
 
@@ -154,10 +380,12 @@ void TemporaryFileMetadataManager::TruncateFile(const string &filename, idx_t ne
 	idx_t from_block_index = tfmeta->block_map.size();
 
 	for (idx_t i = from_block_index; i > to_block_index; i--) {
-		idx_t block_index = i - 1;
-		TemporaryBlock *block = tfmeta->block_map[block_index];
-		block_manager->FreeBlock(block);
-		tfmeta->block_map.erase(block_index);
+		ReleaseBlock(*tfmeta, i - 1);
+	}
+
+	// The extents are only released once the file is empty, as the remaining blocks may be spread over all of them
+	if (tfmeta->block_map.empty()) {
+		FreeExtents(*tfmeta);
 	}
 
 	// file_to_temp_meta[nvme_handle.path] = tfmeta;
@@ -169,9 +397,8 @@ void TemporaryFileMetadataManager::DeleteFile(const string &filename) {
 	TempFileMetadata *tfmeta = file_to_temp_meta[filename].get();
 	{
 		boost::unique_lock<boost::shared_mutex> file_lock(tfmeta->file_mutex);
-		for (const auto &kv : tfmeta->block_map) {
-			block_manager->FreeBlock(kv.second);
-		}
+		tfmeta->is_active.store(false);
+		FreeExtents(*tfmeta);
 	}
 
 	file_to_temp_meta.erase(filename);
@@ -204,9 +431,8 @@ void TemporaryFileMetadataManager::Clear() {
 		TempFileMetadata *tfmeta = kv.second.get();
 		boost::unique_lock<boost::shared_mutex> file_lock(tfmeta->file_mutex);
 
-		for (const auto &block : tfmeta->block_map) {
-			block_manager->FreeBlock(block.second);
-		}
+		tfmeta->is_active.store(false);
+		FreeExtents(*tfmeta);
 	}
 
 	file_to_temp_meta.clear();
@@ -231,12 +457,22 @@ idx_t TemporaryFileMetadataManager::GetAvailableSpace(idx_t lba_count, idx_t lba
 		TempFileMetadata *tfmeta = kv.second.get();
 		boost::shared_lock<boost::shared_mutex> file_lock(tfmeta->file_mutex);
 
-		temp_used_bytes += kv.second->block_size * kv.second->block_map.size();
+		// Extents are reserved for a single file, hence their unused tail is not available to other files either
+		for (TemporaryBlock *extent : tfmeta->extents) {
+			temp_used_bytes += extent->GetLBAAmount() * lba_size;
+		}
 	}
 
 	return (temp_max_bytes - temp_used_bytes);
 }
 
+void TemporaryFileMetadataManager::FreeBlock(TemporaryBlock *block) {
+	if (block_free_function) {
+		block_free_function(block->GetStartLBA(), block->GetEndLBA() - block->GetStartLBA() + 1);
+	}
+	block_manager->FreeBlock(block);
+}
+
 void TemporaryFileMetadataManager::ListFiles(const string &directory,
                                              const std::function<void(const string &, bool)> &callback) {
 	boost::unique_lock<boost::shared_mutex> lock(temp_mutex);
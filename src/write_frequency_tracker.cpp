@@ -0,0 +1,100 @@
+#include "write_frequency_tracker.hpp"
+
+namespace duckdb {
+
+static constexpr uint32_t WRITE_FREQUENCY_COUNT_BITS = 8;
+static constexpr uint32_t WRITE_FREQUENCY_COUNT_MASK = (1U << WRITE_FREQUENCY_COUNT_BITS) - 1;
+static constexpr uint32_t WRITE_FREQUENCY_EPOCH_MASK = (1U << (32 - WRITE_FREQUENCY_COUNT_BITS)) - 1;
+
+WriteFrequencyTracker::WriteFrequencyTracker(idx_t start_lba, idx_t end_lba, idx_t range_lbas, idx_t hot_threshold)
+    : start_lba(start_lba), range_shift(0), part_shift(0), hot_threshold(hot_threshold), nr_writes(0) {
+	while ((idx_t(2) << range_shift) <= range_lbas) {
+		range_shift++;
+	}
+	while ((idx_t(1) << (range_shift - part_shift)) > WRITE_FREQUENCY_RANGE_PARTS) {
+		part_shift++;
+	}
+	idx_t nr_ranges = ((end_lba - start_lba) + GetRangeLBAs() - 1) >> range_shift;
+	ranges = vector<atomic<uint32_t>>(nr_ranges);
+	written_parts = vector<atomic<uint32_t>>(nr_ranges);
+}
+
+bool WriteFrequencyTracker::RecordWrite(idx_t start_lba, idx_t nr_lbas) {
+	if (start_lba < this->start_lba || nr_lbas == 0 || ranges.empty()) {
+		return false;
+	}
+	idx_t first = (start_lba - this->start_lba) >> range_shift;
+	idx_t last = MinValue<idx_t>((start_lba - this->start_lba + nr_lbas - 1) >> range_shift, ranges.size() - 1);
+
+	uint32_t epoch = static_cast<uint32_t>(nr_writes.fetch_add(1, std::memory_order_relaxed) >>
+	                                       WRITE_FREQUENCY_EPOCH_SHIFT) &
+	                 WRITE_FREQUENCY_EPOCH_MASK;
+
+	bool hot = false;
+	for (idx_t i = first; i <= last; i++) {
+		// The parts of the range that the write covers
+		idx_t range_start = this->start_lba + (i << range_shift);
+		idx_t first_part = (MaxValue<idx_t>(start_lba, range_start) - range_start) >> part_shift;
+		idx_t last_part = (MinValue<idx_t>(start_lba + nr_lbas, range_start + GetRangeLBAs()) - 1 - range_start) >>
+		                  part_shift;
+		uint32_t parts = static_cast<uint32_t>(((uint64_t(2) << last_part) - 1) & ~((uint64_t(1) << first_part) - 1));
+
+		uint32_t entry = ranges[i].load(std::memory_order_relaxed);
+		if ((written_parts[i].fetch_or(parts, std::memory_order_relaxed) & parts) == 0) {
+			// The first write of these parts, which does not make the range any hotter
+			hot = hot || GetDecayedCount(entry, epoch) >= hot_threshold;
+			continue;
+		}
+
+		uint32_t updated;
+		do {
+			idx_t count = MinValue<idx_t>(GetDecayedCount(entry, epoch) + 1, WRITE_FREQUENCY_MAX_COUNT);
+			updated = (epoch << WRITE_FREQUENCY_COUNT_BITS) | static_cast<uint32_t>(count);
+		} while (!ranges[i].compare_exchange_weak(entry, updated, std::memory_order_relaxed));
+
+		hot = hot || (updated & WRITE_FREQUENCY_COUNT_MASK) >= hot_threshold;
+	}
+	return hot;
+}
+
+bool WriteFrequencyTracker::IsHot(idx_t lba) const {
+	if (lba < start_lba) {
+		return false;
+	}
+	idx_t index = (lba - start_lba) >> range_shift;
+	if (index >= ranges.size()) {
+		return false;
+	}
+	return GetDecayedCount(ranges[index].load(std::memory_order_relaxed), GetEpoch()) >= hot_threshold;
+}
+
+vector<WriteFrequencyBucket> WriteFrequencyTracker::GetHistogram() const {
+	uint32_t epoch = GetEpoch();
+	vector<idx_t> counts(WRITE_FREQUENCY_MAX_COUNT + 1, 0);
+	for (const atomic<uint32_t> &range : ranges) {
+		counts[GetDecayedCount(range.load(std::memory_order_relaxed), epoch)]++;
+	}
+
+	vector<WriteFrequencyBucket> histogram;
+	for (idx_t write_count = 1; write_count <= WRITE_FREQUENCY_MAX_COUNT; write_count++) {
+		if (counts[write_count] > 0) {
+			histogram.push_back(WriteFrequencyBucket {write_count, counts[write_count]});
+		}
+	}
+	return histogram;
+}
+
+uint32_t WriteFrequencyTracker::GetEpoch() const {
+	return static_cast<uint32_t>(nr_writes.load(std::memory_order_relaxed) >> WRITE_FREQUENCY_EPOCH_SHIFT) &
+	       WRITE_FREQUENCY_EPOCH_MASK;
+}
+
+idx_t WriteFrequencyTracker::GetDecayedCount(uint32_t entry, uint32_t epoch) {
+	uint32_t age = (epoch - (entry >> WRITE_FREQUENCY_COUNT_BITS)) & WRITE_FREQUENCY_EPOCH_MASK;
+	if (age >= WRITE_FREQUENCY_COUNT_BITS) {
+		return 0;
+	}
+	return (entry & WRITE_FREQUENCY_COUNT_MASK) >> age;
+}
+
+} // namespace duckdb
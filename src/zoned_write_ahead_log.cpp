@@ -0,0 +1,245 @@
+#include "zoned_write_ahead_log.hpp"
+
+#include "nvme_device.hpp"
+
+namespace duckdb {
+
+ZonedWriteAheadLog::ZonedWriteAheadLog(Device &device, const DeviceZoneGeometry &zones, idx_t first_zone,
+                                       idx_t nr_zones, idx_t tail_lba)
+    : device(device), zones(zones), first_zone(first_zone), nr_zones(nr_zones), tail_lba(tail_lba),
+      lba_size(device.GetDeviceGeometry().lba_size), appended(0), tail(lba_size, 0), tail_bytes(0),
+      tail_dirty(false) {
+	if (tail_lba >= zones.conventional_lbas) {
+		throw InvalidInputException("The partial LBA of a zoned WAL must be kept in a conventional LBA");
+	}
+}
+
+void ZonedWriteAheadLog::Write(const void *buffer, idx_t nr_bytes, idx_t location) {
+	lock_guard<mutex> guard(lock);
+	idx_t start = appended * lba_size;
+	if (location < start) {
+		throw IOException(
+		    "The WAL on a zoned device can only be appended to, got a write at byte %llu before byte %llu", location,
+		    start);
+	}
+
+	// The written range is merged with the partial LBA, and all LBAs that it completes are appended
+	idx_t end = MaxValue<idx_t>(location + nr_bytes, start + tail_bytes);
+	idx_t nr_lbas = (end - start + lba_size - 1) / lba_size;
+	idx_t full_lbas = (end - start) / lba_size;
+	if (appended + full_lbas > GetCapacityLBAs()) {
+		throw IOException("The WAL exceeds its %llu zones", nr_zones);
+	}
+
+	idx_t buffer_size = nr_lbas * lba_size;
+	data_ptr_t staging = device.AllocateBuffer(buffer_size);
+	memset(staging, 0, buffer_size);
+	memcpy(staging, tail.data(), tail_bytes);
+	memcpy(staging + (location - start), buffer, nr_bytes);
+
+	try {
+		Append(staging, full_lbas);
+	} catch (...) {
+		device.FreeBuffer(staging, buffer_size);
+		throw;
+	}
+
+	tail_bytes = end - start - full_lbas * lba_size;
+	memset(tail.data(), 0, lba_size);
+	memcpy(tail.data(), staging + full_lbas * lba_size, tail_bytes);
+	tail_dirty = tail_bytes > 0;
+	device.FreeBuffer(staging, buffer_size);
+}
+
+void ZonedWriteAheadLog::Read(void *buffer, idx_t nr_bytes, idx_t location) {
+	lock_guard<mutex> guard(lock);
+	idx_t size = (appended + (tail_bytes > 0 ? 1 : 0)) * lba_size;
+	if (location + nr_bytes > size) {
+		throw IOException("Read of %llu bytes at byte %llu is beyond the end of the WAL", nr_bytes, location);
+	}
+
+	data_ptr_t out = static_cast<data_ptr_t>(buffer);
+	while (nr_bytes > 0) {
+		idx_t lba = location / lba_size;
+		idx_t offset = location % lba_size;
+		idx_t count;
+		if (lba >= appended) {
+			count = MinValue<idx_t>(nr_bytes, lba_size - offset);
+			memcpy(out, tail.data() + offset, count);
+		} else {
+			// A command covers the LBAs up to the end of the zone, or of the appended LBAs
+			idx_t zone_end = (lba / zones.zone_capacity + 1) * zones.zone_capacity;
+			count = MinValue<idx_t>(nr_bytes, MinValue<idx_t>(zone_end, appended) * lba_size - location);
+
+			NvmeCmdContext ctx;
+			ctx.nr_bytes = count;
+			ctx.offset = offset;
+			ctx.start_lba = GetDeviceLBA(lba);
+			ctx.nr_lbas = (offset + count + lba_size - 1) / lba_size;
+			device.Read(out, ctx);
+		}
+		out += count;
+		location += count;
+		nr_bytes -= count;
+	}
+}
+
+void ZonedWriteAheadLog::Sync() {
+	lock_guard<mutex> guard(lock);
+	if (!tail_dirty) {
+		return;
+	}
+
+	NvmeCmdContext ctx;
+	ctx.nr_bytes = lba_size;
+	ctx.offset = 0;
+	ctx.start_lba = tail_lba;
+	ctx.nr_lbas = 1;
+	device.Write(tail.data(), ctx);
+	tail_dirty = false;
+}
+
+void ZonedWriteAheadLog::Truncate(idx_t nr_bytes) {
+	lock_guard<mutex> guard(lock);
+	idx_t nr_lbas = nr_bytes / lba_size;
+	idx_t partial_bytes = nr_bytes % lba_size;
+	if (nr_bytes >= appended * lba_size + tail_bytes) {
+		return;
+	}
+
+	// The part of the new last LBA that is kept becomes the partial LBA, which is read before its zone is reset
+	vector<data_t> partial(lba_size, 0);
+	if (nr_lbas == appended) {
+		memcpy(partial.data(), tail.data(), partial_bytes);
+	} else if (partial_bytes > 0) {
+		data_ptr_t lba = device.AllocateBuffer(lba_size);
+		NvmeCmdContext ctx;
+		ctx.nr_bytes = lba_size;
+		ctx.offset = 0;
+		ctx.start_lba = GetDeviceLBA(nr_lbas);
+		ctx.nr_lbas = 1;
+		device.Read(lba, ctx);
+		memcpy(partial.data(), lba, partial_bytes);
+		device.FreeBuffer(lba, lba_size);
+	}
+
+	TruncateInternal(nr_lbas);
+	tail = std::move(partial);
+	tail_bytes = partial_bytes;
+	tail_dirty = partial_bytes > 0;
+}
+
+void ZonedWriteAheadLog::TruncateInternal(idx_t nr_lbas) {
+	if (nr_lbas > appended) {
+		return;
+	}
+	tail_bytes = 0;
+	tail_dirty = false;
+	memset(tail.data(), 0, lba_size);
+	if (nr_lbas == appended) {
+		return;
+	}
+
+	// The LBAs of the last kept zone are read before the zone is reset, and appended again afterwards
+	idx_t zone = nr_lbas / zones.zone_capacity;
+	idx_t kept_lbas = nr_lbas % zones.zone_capacity;
+	idx_t kept_size = kept_lbas * lba_size;
+	data_ptr_t kept = kept_lbas > 0 ? device.AllocateBuffer(kept_size) : nullptr;
+	if (kept) {
+		NvmeCmdContext ctx;
+		ctx.nr_bytes = kept_size;
+		ctx.offset = 0;
+		ctx.start_lba = GetZoneStart(zone);
+		ctx.nr_lbas = kept_lbas;
+		device.Read(kept, ctx);
+	}
+
+	idx_t last_zone = (appended - 1) / zones.zone_capacity;
+	for (idx_t i = zone; i <= last_zone && i < nr_zones; i++) {
+		device.ResetZone(GetZoneStart(i));
+	}
+	appended = zone * zones.zone_capacity;
+
+	if (kept) {
+		Append(kept, kept_lbas);
+		device.FreeBuffer(kept, kept_size);
+	}
+}
+
+void ZonedWriteAheadLog::Load(idx_t nr_lbas) {
+	lock_guard<mutex> guard(lock);
+	tail_bytes = 0;
+	tail_dirty = false;
+	memset(tail.data(), 0, lba_size);
+
+	// Zones are filled in order, hence the zones after the first zone that is not full should be empty. Zones that are
+	// not, e.g. after a truncation was interrupted, are reset.
+	appended = 0;
+	bool filled = true;
+	for (idx_t i = 0; i < nr_zones; i++) {
+		idx_t zone_start = GetZoneStart(i);
+		idx_t written = device.GetZoneWritePointer(zone_start) - zone_start;
+		if (!filled) {
+			if (written > 0) {
+				device.ResetZone(zone_start);
+			}
+			continue;
+		}
+		appended += written;
+		filled = written == zones.zone_capacity;
+	}
+
+	if (nr_lbas < appended) {
+		// LBAs appended after the size was last recorded were never synced, hence they are not part of the WAL
+		TruncateInternal(nr_lbas);
+	} else if (nr_lbas == appended + 1) {
+		// The size of the WAL counts whole LBAs, hence the synced partial LBA becomes a whole LBA
+		NvmeCmdContext ctx;
+		ctx.nr_bytes = lba_size;
+		ctx.offset = 0;
+		ctx.start_lba = tail_lba;
+		ctx.nr_lbas = 1;
+		device.Read(tail.data(), ctx);
+		Append(tail.data(), 1);
+		memset(tail.data(), 0, lba_size);
+	} else if (nr_lbas > appended) {
+		throw IOException("The WAL zones hold %llu LBAs, but the WAL consists of %llu LBAs", appended, nr_lbas);
+	}
+}
+
+idx_t ZonedWriteAheadLog::GetSizeLBAs() {
+	lock_guard<mutex> guard(lock);
+	return appended + (tail_bytes > 0 ? 1 : 0);
+}
+
+void ZonedWriteAheadLog::Append(const_data_ptr_t data, idx_t nr_lbas) {
+	while (nr_lbas > 0) {
+		idx_t zone = appended / zones.zone_capacity;
+		if (zone >= nr_zones) {
+			throw IOException("The WAL exceeds its %llu zones", nr_zones);
+		}
+		idx_t count = MinValue<idx_t>(nr_lbas, zones.zone_capacity - appended % zones.zone_capacity);
+
+		NvmeCmdContext ctx;
+		ctx.nr_bytes = count * lba_size;
+		ctx.offset = 0;
+		ctx.start_lba = GetZoneStart(zone);
+		ctx.nr_lbas = count;
+		idx_t lba = device.ZoneAppend(const_cast<data_ptr_t>(data), ctx);
+		// Only the WAL appends to its zones, hence the data must land at the end of the WAL
+		if (lba != GetDeviceLBA(appended)) {
+			throw IOException("Append to WAL zone %llu landed at LBA %llu instead of LBA %llu", zone, lba,
+			                  GetDeviceLBA(appended));
+		}
+
+		appended += count;
+		data += count * lba_size;
+		nr_lbas -= count;
+	}
+}
+
+idx_t ZonedWriteAheadLog::GetDeviceLBA(idx_t lba) const {
+	return GetZoneStart(lba / zones.zone_capacity) + lba % zones.zone_capacity;
+}
+
+} // namespace duckdb
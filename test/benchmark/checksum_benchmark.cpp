@@ -0,0 +1,79 @@
+// Measures the cost of block checksums: the throughput of the CRC32C implementations, and the WAL
+// I/O path of NvmeFileSystem with and without checksums on the in-memory FakeDevice, where the difference between the
+// two is the cost of computing and verifying the checksums.
+
+#include "crc32c.hpp"
+#include "nvmefs.hpp"
+#include "nvmefs_config.hpp"
+#include "utils/fake_device.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+namespace duckdb {
+
+static constexpr idx_t BENCHMARK_BYTES = 1ULL << 32;
+static constexpr idx_t BENCHMARK_LBA_SIZE = 4096;
+static constexpr idx_t BENCHMARK_LBA_COUNT = (1ULL << 30) / BENCHMARK_LBA_SIZE;
+
+template <class FUNC>
+static void RunBenchmark(const char *name, idx_t nr_bytes, FUNC &&func) {
+	idx_t iterations = BENCHMARK_BYTES / nr_bytes;
+	// Warm up caches and lazily created state
+	for (idx_t i = 0; i < iterations / 16; i++) {
+		func(i);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (idx_t i = 0; i < iterations; i++) {
+		func(i);
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double total_ns = std::chrono::duration<double, std::nano>(end - start).count();
+	printf("%-36s %7llu bytes %10.1f ns/op %8.2f GB/s\n", name, static_cast<unsigned long long>(nr_bytes),
+	       total_ns / iterations, static_cast<double>(BENCHMARK_BYTES) / total_ns);
+}
+
+static void BenchmarkCrc32c(idx_t nr_bytes) {
+	vector<data_t> buffer(nr_bytes, 1);
+	volatile uint32_t crc = 0;
+	RunBenchmark(Crc32cIsHardwareAccelerated() ? "crc32c (sse4.2)" : "crc32c (no sse4.2, tables)", nr_bytes,
+	             [&](idx_t i) { crc = Crc32c(crc, buffer.data(), nr_bytes); });
+	RunBenchmark("crc32c (tables)", nr_bytes, [&](idx_t i) { crc = Crc32cSoftware(crc, buffer.data(), nr_bytes); });
+}
+
+static void BenchmarkFileSystem(idx_t nr_bytes, bool block_checksums) {
+	NvmeConfig config {.device_path = "/dev/null",
+	                   .max_temp_size = 1ULL << 28,
+	                   .max_wal_size = 1ULL << 25,
+	                   .block_checksums = block_checksums};
+	NvmeFileSystem fs(config, make_uniq<FakeDevice>(BENCHMARK_LBA_COUNT, BENCHMARK_LBA_SIZE));
+
+	FileOpenFlags flags =
+	    FileOpenFlags::FILE_FLAGS_READ | FileOpenFlags::FILE_FLAGS_WRITE | FileOpenFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = fs.OpenFile("nvmefs://bench.db", flags);
+	unique_ptr<FileHandle> wal = fs.OpenFile("nvmefs://bench.db.wal", flags);
+
+	vector<data_t> buffer(nr_bytes, 1);
+	// Stay within a small window of the file, such that the working set fits in the CPU caches
+	idx_t window = 1 << 20;
+
+	printf("checksums %s\n", block_checksums ? "on" : "off");
+	RunBenchmark("file system write (wal)", nr_bytes,
+	             [&](idx_t i) { fs.Write(*wal, buffer.data(), nr_bytes, i * nr_bytes % window); });
+	RunBenchmark("file system read (wal)", nr_bytes,
+	             [&](idx_t i) { fs.Read(*wal, buffer.data(), nr_bytes, i * nr_bytes % window); });
+}
+
+} // namespace duckdb
+
+int main() {
+	duckdb::BenchmarkCrc32c(4096);
+	duckdb::BenchmarkCrc32c(262144);
+	duckdb::BenchmarkFileSystem(4096, false);
+	duckdb::BenchmarkFileSystem(4096, true);
+	duckdb::BenchmarkFileSystem(262144, false);
+	duckdb::BenchmarkFileSystem(262144, true);
+	return 0;
+}
@@ -0,0 +1,80 @@
+// Measures the CPU cost that NvmeFileSystem adds to every I/O. The in-memory FakeDevice keeps the device cost close to
+// a memcpy, such that the difference between the device and file system timings is the cost of the I/O path. Build
+// and run it on two revisions to compare the I/O path before and after a change.
+
+#include "nvmefs.hpp"
+#include "nvmefs_config.hpp"
+#include "utils/fake_device.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+namespace duckdb {
+
+static constexpr idx_t BENCHMARK_ITERATIONS = 1 << 20;
+static constexpr idx_t BENCHMARK_LBA_SIZE = 4096;
+static constexpr idx_t BENCHMARK_LBA_COUNT = (1ULL << 30) / BENCHMARK_LBA_SIZE;
+
+template <class FUNC>
+static void RunBenchmark(const char *name, idx_t nr_bytes, FUNC &&func) {
+	// Warm up caches and lazily created state
+	for (idx_t i = 0; i < BENCHMARK_ITERATIONS / 16; i++) {
+		func(i);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (idx_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+		func(i);
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	double total_ns = std::chrono::duration<double, std::nano>(end - start).count();
+	printf("%-32s %6llu bytes %10.1f ns/op\n", name, static_cast<unsigned long long>(nr_bytes),
+	       total_ns / BENCHMARK_ITERATIONS);
+}
+
+static void BenchmarkSize(idx_t nr_bytes) {
+	NvmeConfig config {.device_path = "/dev/null", .max_temp_size = 1ULL << 28, .max_wal_size = 1ULL << 25};
+	NvmeFileSystem fs(config, make_uniq<FakeDevice>(BENCHMARK_LBA_COUNT, BENCHMARK_LBA_SIZE));
+	Device &device = fs.GetDevice();
+
+	FileOpenFlags flags =
+	    FileOpenFlags::FILE_FLAGS_READ | FileOpenFlags::FILE_FLAGS_WRITE | FileOpenFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = fs.OpenFile("nvmefs://bench.db", flags);
+	unique_ptr<FileHandle> wal = fs.OpenFile("nvmefs://bench.db.wal", flags);
+
+	vector<data_t> buffer(nr_bytes, 1);
+	// Stay within a small window of the file, such that the working set fits in the CPU caches
+	idx_t window = 1 << 20;
+
+	CmdContext context {};
+	context.nr_bytes = nr_bytes;
+	context.nr_lbas = (nr_bytes + BENCHMARK_LBA_SIZE - 1) / BENCHMARK_LBA_SIZE;
+	RunBenchmark("device write", nr_bytes, [&](idx_t i) {
+		context.start_lba = (i * nr_bytes % window) / BENCHMARK_LBA_SIZE;
+		context.offset = (i * nr_bytes % window) % BENCHMARK_LBA_SIZE;
+		device.Write(buffer.data(), context);
+	});
+	RunBenchmark("device read", nr_bytes, [&](idx_t i) {
+		context.start_lba = (i * nr_bytes % window) / BENCHMARK_LBA_SIZE;
+		context.offset = (i * nr_bytes % window) % BENCHMARK_LBA_SIZE;
+		device.Read(buffer.data(), context);
+	});
+
+	RunBenchmark("file system write (database)", nr_bytes,
+	             [&](idx_t i) { fs.Write(*db, buffer.data(), nr_bytes, i * nr_bytes % window); });
+	RunBenchmark("file system read (database)", nr_bytes,
+	             [&](idx_t i) { fs.Read(*db, buffer.data(), nr_bytes, i * nr_bytes % window); });
+	RunBenchmark("file system write (wal)", nr_bytes,
+	             [&](idx_t i) { fs.Write(*wal, buffer.data(), nr_bytes, i * nr_bytes % window); });
+	RunBenchmark("file system read (wal)", nr_bytes,
+	             [&](idx_t i) { fs.Read(*wal, buffer.data(), nr_bytes, i * nr_bytes % window); });
+}
+
+} // namespace duckdb
+
+int main() {
+	duckdb::BenchmarkSize(512);
+	duckdb::BenchmarkSize(4096);
+	return 0;
+}
@@ -1,11 +1,34 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <unistd.h>
+#include "duckdb/common/random_engine.hpp"
 #include "nvmefs.hpp"
 #include "nvmefs_config.hpp"
 #include "nvmefs_temporary_block_manager.hpp"
+#include "device_buffer_pool.hpp"
+#include "emulated_device.hpp"
+#include "file_device.hpp"
+#include "hybrid_zoned_device.hpp"
+#include "background_deallocator.hpp"
+#include "block_checksum_table.hpp"
+#include "crc32c.hpp"
+#include "nvme_completion.hpp"
+#include "nvme_queue_registry.hpp"
+#include "nvme_reactor.hpp"
+#include "partial_lba_cache.hpp"
+#include "placement_policy.hpp"
+#include "queue_depth_controller.hpp"
+#include "scan_readahead.hpp"
+#include "temporary_block_compressor.hpp"
 #include "utils/gtest_utils.hpp"
 #include "utils/fake_device.hpp"
+#include "utils/fdp_simulator_device.hpp"
+#include "utils/fake_zoned_device.hpp"
 
+using ::testing::ElementsAre;
 using ::testing::UnorderedElementsAre;
 
 namespace duckdb {
@@ -460,6 +483,26 @@ TEST_F(DiskInteractionTest, WriteAndReadDataWithinBlock) {
 	EXPECT_EQ(string(buffer.data(), data_size), hello);
 }
 
+TEST_F(DiskInteractionTest, WriteAndReadDataAcrossBlockBoundaries) {
+	string file_path = "nvmefs://test.db";
+	unique_ptr<FileHandle> file =
+	    file_system->OpenFile(file_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ);
+	ASSERT_TRUE(file != nullptr);
+
+	// Starts inside the first LBA and ends inside the third LBA
+	vector<char> data(8192);
+	for (idx_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<char>(i % 251);
+	}
+	file->Write(data.data(), data.size(), 4000);
+
+	vector<char> buffer(data.size());
+	file->Read(buffer.data(), buffer.size(), 4000);
+
+	EXPECT_EQ(buffer, data);
+	EXPECT_EQ(file->GetFileSize(), 3 * 4096);
+}
+
 TEST_F(DiskInteractionTest, WriteAndReadDataWithSeek) {
 
 	// Create a file
@@ -747,6 +790,72 @@ TEST_F(DiskInteractionTest, TrimWrittenLocationInFileFromSeekPositionRemovesWrit
 	EXPECT_EQ(file->GetFileSize(), page_size * 4 + 4096); // 4 pages + 1 lba
 }
 
+TEST_F(DiskInteractionTest, TrimDeallocatesWholeBlocksAndZeroesPartialBlocks) {
+	string file_path = "nvmefs://test.db";
+	unique_ptr<FileHandle> file =
+	    file_system->OpenFile(file_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ);
+	ASSERT_TRUE(file != nullptr);
+
+	vector<char> data(4 * 4096, 'x');
+	file->Write(data.data(), data.size(), 0);
+
+	// Partially covers the first and the last LBA, and fully covers the two LBAs in between
+	file->Trim(100, 3 * 4096);
+
+	vector<char> buffer(data.size());
+	file->Read(buffer.data(), buffer.size(), 0);
+
+	vector<char> expected(data);
+	memset(expected.data() + 100, 0, 3 * 4096);
+	EXPECT_EQ(buffer, expected);
+	EXPECT_EQ(file->GetFileSize(), 4 * 4096);
+}
+
+TEST_F(DiskInteractionTest, TmpFileHandleOpenedBeforeCreationResolvesFileOnFirstUse) {
+	string file_path = StringUtil::Format("nvmefs://test.db/tmp/duckdb_temp_storage_%s-%llu.tmp", "S32K", 0);
+
+	// Ensure that metadata is created
+	file_system->OpenFile("nvmefs://test.db", FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ);
+
+	unique_ptr<FileHandle> early = file_system->OpenFile(file_path, FileFlags::FILE_FLAGS_READ);
+	vector<char> read_buffer(32768);
+	EXPECT_THROW(early->Read(read_buffer.data(), read_buffer.size(), 0), IOException);
+
+	unique_ptr<FileHandle> file = file_system->OpenFile(
+	    file_path, FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE);
+	vector<char> write_buffer(32768, 'T');
+	file->Write(write_buffer.data(), write_buffer.size(), 0);
+
+	early->Read(read_buffer.data(), read_buffer.size(), 0);
+	EXPECT_EQ(read_buffer, write_buffer);
+}
+
+TEST_F(DiskInteractionTest, TmpFileHandleOutlivesDeletionOfItsFile) {
+	string file_path = StringUtil::Format("nvmefs://test.db/tmp/duckdb_temp_storage_%s-%llu.tmp", "S32K", 0);
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+
+	// Ensure that metadata is created
+	file_system->OpenFile("nvmefs://test.db", FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ);
+
+	unique_ptr<FileHandle> file = file_system->OpenFile(file_path, flags);
+	vector<char> write_buffer(32768, 'T');
+	file->Write(write_buffer.data(), write_buffer.size(), 0);
+
+	// The handle no longer refers to a file once it has been deleted
+	file_system->RemoveFile(file_path);
+	vector<char> read_buffer(32768);
+	EXPECT_THROW(file->Read(read_buffer.data(), read_buffer.size(), 0), IOException);
+	EXPECT_THROW(file->Write(write_buffer.data(), write_buffer.size(), 0), IOException);
+	EXPECT_FALSE(file_system->FileExists(file_path));
+
+	// A file created again under the same name is picked up by the handle
+	unique_ptr<FileHandle> recreated = file_system->OpenFile(file_path, flags);
+	vector<char> recreated_buffer(32768, 'R');
+	recreated->Write(recreated_buffer.data(), recreated_buffer.size(), 0);
+	file->Read(read_buffer.data(), read_buffer.size(), 0);
+	EXPECT_EQ(read_buffer, recreated_buffer);
+}
+
 TEST_F(DiskInteractionTest, WriteAndReadInsideTmpFile) {
 	// Create a file
 	string file_path = StringUtil::Format("nvmefs://test.db/tmp/duckdb_temp_storage_%s-%llu.tmp", "S32K", 0);
@@ -1077,8 +1186,7 @@ TEST_F(BlockManagerTest,
 	EXPECT_EQ(block4->IsFree(), false);
 }
 
-TEST_F(BlockManagerTest,
-       AllocateFreeBlocksAndFreeSurroundingBlocksAndAllocateALargerBlockYieldsBlockThatStartsFromSameLocation) {
+TEST_F(BlockManagerTest, AllocateLargerBlockAfterFreeingSurroundingBlocksStartsFromSameLocation) {
 
 	// Allocate a block of size 8
 	TemporaryBlock *block = block_manager->AllocateBlock(8);
@@ -1232,6 +1340,20 @@ TEST_F(BlockManagerTest, FreelistCoalesceLeftInTheMiddleOfTheList) {
 	EXPECT_EQ(block11->IsFree(), false);
 }
 
+TEST_F(BlockManagerTest, AllocateSkipsFreeBlocksThatAreTooSmall) {
+	TemporaryBlock *block1 = block_manager->AllocateBlock(100);
+	TemporaryBlock *block2 = block_manager->AllocateBlock(8);
+
+	// The freed block shares the free list of the largest blocks with the remainder, but cannot fit the request
+	block_manager->FreeBlock(block1);
+	TemporaryBlock *block3 = block_manager->AllocateBlock(200);
+
+	EXPECT_EQ(block3->GetStartLBA(), block2->GetEndLBA() + 1);
+	EXPECT_EQ(block3->GetLBAAmount(), 200);
+
+	EXPECT_EQ(block_manager->TryAllocateBlock(1024), nullptr);
+}
+
 class TemporaryMetadataManagerTest : public testing::Test {
 protected:
 	TemporaryMetadataManagerTest() {
@@ -1286,4 +1408,2118 @@ TEST_F(TemporaryMetadataManagerTest, CreateFilesOfDifferentSizes) {
 	EXPECT_EQ(filedefault->block_size, 262144);
 }
 
+TEST_F(TemporaryMetadataManagerTest, BlocksOfAFileAreGroupedInExtents) {
+	string file_path1 = "nvmefs:///tmp/duckdb_temp_storage_DEFAULT-0.tmp";
+	string file_path2 = "nvmefs:///tmp/duckdb_temp_storage_DEFAULT-1.tmp";
+	metadata_manager->CreateFile(file_path1);
+	metadata_manager->CreateFile(file_path2);
+	idx_t block_lbas = 262144 / 4096;
+
+	// Interleaved writes to two files still place the blocks of each file next to each other
+	idx_t file1_block0 = metadata_manager->GetLBA(file_path1, 0, block_lbas);
+	idx_t file2_block0 = metadata_manager->GetLBA(file_path2, 0, block_lbas);
+	idx_t file1_block1 = metadata_manager->GetLBA(file_path1, 262144, block_lbas);
+
+	EXPECT_EQ(file1_block1, file1_block0 + block_lbas);
+	EXPECT_EQ(file2_block0, file1_block0 + NVMEFS_TEMP_INITIAL_EXTENT_SIZE / 4096);
+	EXPECT_LT(metadata_manager->GetFile(file_path1)->generation, metadata_manager->GetFile(file_path2)->generation);
+}
+
+TEST(TemporaryMetadataManagerExtentTest, DeletingAFileFreesWholeExtents) {
+	vector<pair<idx_t, idx_t>> freed;
+	idx_t extent_size = 1 << 20;
+	TemporaryFileMetadataManager metadata_manager(0, 4096, 4096, extent_size, [&](idx_t start_lba, idx_t nr_lbas) {
+		freed.emplace_back(start_lba, nr_lbas);
+	});
+
+	string file_path = "nvmefs:///tmp/duckdb_temp_storage_S32K-0.tmp";
+	metadata_manager.CreateFile(file_path);
+	// 40 blocks of 32 KiB span two extents of 1 MiB
+	for (idx_t i = 0; i < 40; i++) {
+		metadata_manager.GetLBA(file_path, i * 32768, 8);
+	}
+
+	// Truncated blocks are kept within the extents of the file and reused
+	metadata_manager.TruncateFile(file_path, 39 * 32768);
+	EXPECT_TRUE(freed.empty());
+	EXPECT_EQ(metadata_manager.GetLBA(file_path, 39 * 32768, 8), 256 + 7 * 8);
+
+	metadata_manager.DeleteFile(file_path);
+	ASSERT_EQ(freed.size(), 2);
+	EXPECT_EQ(freed[0].first, 0);
+	EXPECT_EQ(freed[0].second, extent_size / 4096);
+	EXPECT_EQ(freed[1].first, extent_size / 4096);
+	EXPECT_EQ(freed[1].second, extent_size / 4096);
+}
+
+TEST(TemporaryMetadataManagerExtentTest, ExtentsGrowWithTheirFile) {
+	vector<pair<idx_t, idx_t>> freed;
+	idx_t extent_lbas = (4 * NVMEFS_TEMP_INITIAL_EXTENT_SIZE) / 4096;
+	idx_t initial_lbas = NVMEFS_TEMP_INITIAL_EXTENT_SIZE / 4096;
+	TemporaryFileMetadataManager metadata_manager(0, 4 * extent_lbas, 4096, extent_lbas * 4096,
+	                                              [&](idx_t start_lba, idx_t nr_lbas) {
+		                                              freed.emplace_back(start_lba, nr_lbas);
+	                                              });
+
+	// A file of a single block only reserves the first extent, hence many small files fit in the region
+	string small_path = "nvmefs:///tmp/duckdb_temp_storage_S32K-0.tmp";
+	metadata_manager.CreateFile(small_path);
+	metadata_manager.GetLBA(small_path, 0, 8);
+	metadata_manager.DeleteFile(small_path);
+	ASSERT_EQ(freed.size(), 1);
+	EXPECT_EQ(freed[0].second, initial_lbas);
+	freed.clear();
+
+	// The extents of a growing file double until they reach the configured extent size
+	string large_path = "nvmefs:///tmp/duckdb_temp_storage_S32K-1.tmp";
+	metadata_manager.CreateFile(large_path);
+	idx_t nr_blocks = (initial_lbas + 2 * initial_lbas + 2 * extent_lbas) / 8;
+	for (idx_t i = 0; i < nr_blocks; i++) {
+		metadata_manager.GetLBA(large_path, i * 32768, 8);
+	}
+	metadata_manager.DeleteFile(large_path);
+	ASSERT_EQ(freed.size(), 4);
+	EXPECT_EQ(freed[0].second, initial_lbas);
+	EXPECT_EQ(freed[1].second, 2 * initial_lbas);
+	EXPECT_EQ(freed[2].second, extent_lbas);
+	EXPECT_EQ(freed[3].second, extent_lbas);
+}
+
+class DeviceBufferPoolTest : public testing::Test {
+protected:
+	DeviceBufferPoolTest() {
+		pool = make_uniq<DeviceBufferPool>(
+		    [this](idx_t nr_bytes) {
+			    allocations++;
+			    return static_cast<data_ptr_t>(aligned_alloc(DEVICE_BUFFER_ALIGNMENT, nr_bytes));
+		    },
+		    [](data_ptr_t buffer) { free(buffer); });
+	}
+
+	idx_t allocations = 0;
+	unique_ptr<DeviceBufferPool> pool;
+};
+
+TEST_F(DeviceBufferPoolTest, FreedBufferIsReusedForSameSizeClass) {
+	data_ptr_t first = pool->Allocate(262144);
+	pool->Free(first, 262144);
+
+	// A smaller request within the same size class should be served from the free list
+	data_ptr_t second = pool->Allocate(229377);
+
+	EXPECT_EQ(first, second);
+	EXPECT_EQ(allocations, 1);
+
+	pool->Free(second, 229377);
+}
+
+TEST_F(DeviceBufferPoolTest, AllocationsAreRoundedUpToSizeClass) {
+	EXPECT_EQ(DeviceBufferPool::GetSizeClass(1), 0);
+	EXPECT_EQ(DeviceBufferPool::GetSizeClass(4097), 1);
+	EXPECT_EQ(DeviceBufferPool::GetSizeClass(32768), 2);
+	EXPECT_EQ(DeviceBufferPool::GetSizeClass(262144), DEVICE_BUFFER_SIZE_CLASS_COUNT - 1);
+	EXPECT_EQ(DeviceBufferPool::GetSizeClass(262145), DEVICE_BUFFER_SIZE_CLASS_COUNT);
+}
+
+TEST_F(DeviceBufferPoolTest, ArenaBuffersAreCarvedFromArena) {
+	unique_ptr<DeviceBufferPool> arena_pool = make_uniq<DeviceBufferPool>(
+	    [](idx_t nr_bytes) { return static_cast<data_ptr_t>(aligned_alloc(DEVICE_BUFFER_ALIGNMENT, nr_bytes)); },
+	    [](data_ptr_t buffer) { free(buffer); }, 1ULL << 21);
+
+	data_ptr_t buffer = arena_pool->Allocate(65536);
+	EXPECT_TRUE(arena_pool->IsArenaBuffer(buffer));
+
+	arena_pool->Free(buffer, 65536);
+}
+
+TEST(DeviceBatchTest, WriteBatchAndReadBatchRoundTrip) {
+	FakeDevice device(64);
+	DeviceGeometry geo = device.GetDeviceGeometry();
+
+	vector<char> first(geo.lba_size, 'A');
+	vector<char> second(geo.lba_size * 2, 'B');
+
+	CmdContext first_ctx {geo.lba_size, 1, 3, 0};
+	CmdContext second_ctx {geo.lba_size * 2, 2, 10, 0};
+	DeviceIORequest writes[] = {{first.data(), &first_ctx}, {second.data(), &second_ctx}};
+
+	EXPECT_EQ(device.WriteBatch(writes, 2), 3);
+
+	vector<char> first_result(first.size());
+	vector<char> second_result(second.size());
+	DeviceIORequest reads[] = {{first_result.data(), &first_ctx}, {second_result.data(), &second_ctx}};
+
+	EXPECT_EQ(device.ReadBatch(reads, 2), 3);
+	EXPECT_EQ(first_result, first);
+	EXPECT_EQ(second_result, second);
+}
+
+TEST(FileDeviceTest, QueueDepthMustBeANonZeroPowerOfTwo) {
+	EXPECT_TRUE(IsNonZeroPowerOfTwo(1));
+	EXPECT_TRUE(IsNonZeroPowerOfTwo(16));
+	EXPECT_FALSE(IsNonZeroPowerOfTwo(0));
+	EXPECT_FALSE(IsNonZeroPowerOfTwo(24));
+
+	NvmeConfig config;
+	config.backend = NVMEFS_FILE_BACKEND;
+	for (idx_t queue_depth : {idx_t(0), idx_t(24)}) {
+		config.queue_depth = queue_depth;
+		EXPECT_THROW(FileDevice device(config), InvalidInputException) << queue_depth;
+	}
+}
+
+TEST(FileDeviceTest, PartialWritesAreMergedWithFileContents) {
+	gtestutils::TemporaryDirectory directory;
+	NvmeConfig config;
+	config.device_path = directory.GetPath("device.img");
+	config.backend = NVMEFS_FILE_BACKEND;
+	config.device_size = 1ULL << 22;
+	{
+		FileDevice device(config);
+		DeviceGeometry geo = device.GetDeviceGeometry();
+		EXPECT_EQ(geo.lba_size, FILE_DEVICE_LBA_SIZE);
+		EXPECT_EQ(geo.lba_count, (1ULL << 22) / FILE_DEVICE_LBA_SIZE);
+
+		vector<char> full(geo.lba_size * 4, 'A');
+		CmdContext full_ctx {full.size(), 4, 2, 0};
+		EXPECT_EQ(device.Write(full.data(), full_ctx), 4);
+
+		// Spans the tail of LBA 3 and the head of LBA 4
+		vector<char> partial(geo.lba_size, 'B');
+		CmdContext partial_ctx {partial.size(), 2, 3, 100};
+		EXPECT_EQ(device.Write(partial.data(), partial_ctx), 2);
+
+		vector<char> result(full.size());
+		EXPECT_EQ(device.Read(result.data(), full_ctx), 4);
+		for (idx_t i = 0; i < result.size(); i++) {
+			bool overwritten = i >= geo.lba_size + 100 && i < 2 * geo.lba_size + 100;
+			ASSERT_EQ(result[i], overwritten ? 'B' : 'A') << "at byte " << i;
+		}
+	}
+
+	// The contents outlive the device
+	FileDevice device(config);
+	vector<char> result(10);
+	CmdContext read_ctx {result.size(), 1, 3, 95};
+	device.Read(result.data(), read_ctx);
+	EXPECT_EQ(string(result.data(), result.size()), "AAAAABBBBB");
+}
+
+TEST(FileDeviceTest, FileIsOnlyCreatedWithADeviceSize) {
+	gtestutils::TemporaryDirectory directory;
+	NvmeConfig config;
+	config.device_path = directory.GetPath("device.img");
+	config.backend = NVMEFS_FILE_BACKEND;
+	EXPECT_THROW(FileDevice device(config), InvalidInputException);
+	EXPECT_NE(access(config.device_path.c_str(), F_OK), 0);
+
+	// A file that can not hold a single LBA is removed again
+	config.device_size = FILE_DEVICE_LBA_SIZE - 1;
+	EXPECT_THROW(FileDevice device(config), InvalidInputException);
+	EXPECT_NE(access(config.device_path.c_str(), F_OK), 0);
+}
+
+TEST(FileDeviceTest, ConcurrentPartialWritesToTheSameLBAAreSerialized) {
+	gtestutils::TemporaryDirectory directory;
+	NvmeConfig config;
+	config.device_path = directory.GetPath("device.img");
+	config.backend = NVMEFS_FILE_BACKEND;
+	config.device_size = 1ULL << 20;
+	FileDevice device(config);
+
+	// Every thread repeatedly writes its own slice of LBA 1, which is read and merged with the file contents
+	const idx_t nr_threads = 8;
+	const idx_t slice_bytes = 100;
+	vector<std::thread> threads;
+	for (idx_t t = 0; t < nr_threads; t++) {
+		threads.emplace_back([&device, t, slice_bytes]() {
+			vector<char> slice(slice_bytes, static_cast<char>('a' + t));
+			CmdContext ctx {slice_bytes, 1, 1, t * slice_bytes};
+			for (idx_t i = 0; i < 100; i++) {
+				device.Write(slice.data(), ctx);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	vector<char> result(nr_threads * slice_bytes);
+	CmdContext read_ctx {result.size(), 1, 1, 0};
+	device.Read(result.data(), read_ctx);
+	for (idx_t i = 0; i < result.size(); i++) {
+		ASSERT_EQ(result[i], static_cast<char>('a' + i / slice_bytes)) << "at byte " << i;
+	}
+}
+
+TEST(FileDeviceTest, BatchWithPartialWritesToTheSameLBAKeepsBoth) {
+	gtestutils::TemporaryDirectory directory;
+	NvmeConfig config;
+	config.device_path = directory.GetPath("device.img");
+	config.backend = NVMEFS_FILE_BACKEND;
+	config.device_size = 1ULL << 20;
+	FileDevice device(config);
+
+	// The second write merges with LBA 2 after the first one has written it, and the third with LBA 3 after the
+	// second one has written it
+	vector<char> first(100, 'X');
+	vector<char> second(FILE_DEVICE_LBA_SIZE, 'Y');
+	vector<char> third(50, 'Z');
+	CmdContext first_ctx {first.size(), 1, 2, 0};
+	CmdContext second_ctx {second.size(), 2, 2, 200};
+	CmdContext third_ctx {third.size(), 1, 3, 300};
+	DeviceIORequest writes[] = {{first.data(), &first_ctx}, {second.data(), &second_ctx}, {third.data(), &third_ctx}};
+	EXPECT_EQ(device.WriteBatch(writes, 3), 4);
+
+	vector<char> result(2 * FILE_DEVICE_LBA_SIZE);
+	CmdContext read_ctx {result.size(), 2, 2, 0};
+	device.Read(result.data(), read_ctx);
+	for (idx_t i = 0; i < result.size(); i++) {
+		char expected = 0;
+		if (i < 100) {
+			expected = 'X';
+		} else if (i >= 200 && i < 200 + FILE_DEVICE_LBA_SIZE) {
+			expected = 'Y';
+		} else if (i >= FILE_DEVICE_LBA_SIZE + 300 && i < FILE_DEVICE_LBA_SIZE + 350) {
+			expected = 'Z';
+		}
+		ASSERT_EQ(result[i], expected) << "at byte " << i;
+	}
+}
+
+TEST(EmulatedDeviceTest, ParsesProfileAndKeepsDefaults) {
+	EmulatedDeviceProfile profile = EmulatedDeviceProfile::Parse("# A drive with four dies\n"
+	                                                             "read_latency_us = 100\n"
+	                                                             "  channels=4\n"
+	                                                             "write_bandwidth = 100MB\n"
+	                                                             "tail_probability = 0.01\n");
+	EXPECT_EQ(profile.read_latency_us, 100);
+	EXPECT_EQ(profile.channels, 4);
+	EXPECT_EQ(profile.write_bandwidth, 100000000);
+	EXPECT_DOUBLE_EQ(profile.tail_probability, 0.01);
+	EXPECT_EQ(profile.write_latency_us, EmulatedDeviceProfile().write_latency_us);
+
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("erase_latency_us = 1"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("channels = many"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("channels = -1"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("seed = +3"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("read_bandwidth = -1GB"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("tail_probability = nan"), InvalidInputException);
+	EXPECT_THROW(EmulatedDeviceProfile::Parse("tail_probability = 2"), InvalidInputException);
+}
+
+static idx_t PeakParallelismOfBatchRead(idx_t nr_channels) {
+	EmulatedDeviceProfile profile;
+	profile.read_latency_us = 1000;
+	profile.read_jitter_us = 0;
+	profile.channels = nr_channels;
+	profile.stripe_size = DEFAULT_BLOCK_SIZE;
+	EmulatedDevice device(make_uniq<FakeDevice>(64), profile);
+
+	vector<char> buffer(DEFAULT_BLOCK_SIZE * 4);
+	CmdContext contexts[4];
+	DeviceIORequest requests[4];
+	for (idx_t i = 0; i < 4; i++) {
+		contexts[i] = CmdContext {DEFAULT_BLOCK_SIZE, 1, i, 0};
+		requests[i] = DeviceIORequest {buffer.data() + i * DEFAULT_BLOCK_SIZE, &contexts[i]};
+	}
+	EXPECT_EQ(device.ReadBatch(requests, 4), 4);
+	return device.GetPeakParallelism();
+}
+
+TEST(EmulatedDeviceTest, CommandsOnDifferentChannelsAreServedInParallel) {
+	// One stripe per LBA, such that the four commands land on four channels, or queue on the single channel
+	EXPECT_EQ(PeakParallelismOfBatchRead(4), 4);
+	EXPECT_EQ(PeakParallelismOfBatchRead(1), 1);
+}
+
+TEST(EmulatedDeviceTest, AsynchronousCommandsAreCompletedOnTheirSlot) {
+	EmulatedDeviceProfile profile;
+	profile.write_jitter_us = 0;
+	vector<char> data(DEFAULT_BLOCK_SIZE * 2, 'w');
+	CmdContext contexts[2] = {{DEFAULT_BLOCK_SIZE, 1, 0, 0}, {DEFAULT_BLOCK_SIZE, 1, 1, 0}};
+	DeviceIORequest requests[2] = {{data.data(), &contexts[0]}, {data.data() + DEFAULT_BLOCK_SIZE, &contexts[1]}};
+
+	// Without latency, the completion thread reports the commands right away
+	profile.write_latency_us = 0;
+	{
+		EmulatedDevice device(make_uniq<FakeDevice>(64), profile);
+		NvmeCompletion completion(2);
+		EXPECT_EQ(device.SubmitBatchAsync(requests, 2, true, completion), 2);
+		while (!completion.IsComplete()) {
+			std::this_thread::yield();
+		}
+		EXPECT_EQ(completion.GetFailedCount(), 0);
+		EXPECT_EQ(device.GetInFlightCount(), 0);
+	}
+
+	// The commands are held back for their latency, but the data is written right away. Closing the device completes
+	// the commands that are still in flight.
+	profile.write_latency_us = 60 * 1000 * 1000;
+	NvmeCompletion completion(2);
+	{
+		unique_ptr<FakeDevice> fake = make_uniq<FakeDevice>(64);
+		FakeDevice &wrapped = *fake;
+		EmulatedDevice device(std::move(fake), profile);
+		EXPECT_EQ(device.SubmitBatchAsync(requests, 2, true, completion), 2);
+		EXPECT_EQ(device.GetInFlightCount(), 2);
+		EXPECT_FALSE(completion.IsComplete());
+
+		vector<char> result(data.size());
+		CmdContext read_ctx {result.size(), 2, 0, 0};
+		EXPECT_EQ(wrapped.Read(result.data(), read_ctx), 2);
+		EXPECT_EQ(result, data);
+	}
+	EXPECT_TRUE(completion.IsComplete());
+}
+
+TEST(NvmeDeviceTest, SplitRequestsAtTheMaximumTransferSize) {
+	const idx_t max_lbas = 8;
+	const idx_t lba_size = DEFAULT_BLOCK_SIZE;
+	vector<data_t> buffer(4 * max_lbas * lba_size);
+	auto make_context = [](idx_t nr_bytes, idx_t nr_lbas, idx_t start_lba, idx_t offset) {
+		NvmeCmdContext context;
+		context.nr_bytes = nr_bytes;
+		context.nr_lbas = nr_lbas;
+		context.start_lba = start_lba;
+		context.offset = offset;
+		return context;
+	};
+
+	// Exactly the maximum transfer size is submitted as is
+	NvmeCmdContext exact = make_context(max_lbas * lba_size, max_lbas, 10, 0);
+	DeviceIORequest exact_request {buffer.data(), &exact};
+	vector<NvmeCmdContext> sub_contexts;
+	vector<DeviceIORequest> sub_requests;
+	EXPECT_FALSE(NvmeDevice::SplitRequests(&exact_request, 1, max_lbas, lba_size, sub_contexts, sub_requests));
+
+	// One LBA more takes a second command
+	NvmeCmdContext over = make_context((max_lbas + 1) * lba_size, max_lbas + 1, 10, 0);
+	DeviceIORequest over_request {buffer.data(), &over};
+	ASSERT_TRUE(NvmeDevice::SplitRequests(&over_request, 1, max_lbas, lba_size, sub_contexts, sub_requests));
+	ASSERT_EQ(sub_requests.size(), 2);
+	EXPECT_EQ(sub_requests[0].context->start_lba, 10);
+	EXPECT_EQ(sub_requests[0].context->nr_lbas, max_lbas);
+	EXPECT_EQ(sub_requests[0].context->nr_bytes, max_lbas * lba_size);
+	EXPECT_EQ(sub_requests[1].context->start_lba, 10 + max_lbas);
+	EXPECT_EQ(sub_requests[1].context->nr_lbas, 1);
+	EXPECT_EQ(sub_requests[1].buffer, buffer.data() + max_lbas * lba_size);
+
+	// Only the first command starts at the offset into its LBA
+	NvmeCmdContext unaligned = make_context(max_lbas * lba_size, max_lbas + 1, 20, 100);
+	DeviceIORequest unaligned_request {buffer.data(), &unaligned};
+	sub_contexts.clear();
+	sub_requests.clear();
+	ASSERT_TRUE(NvmeDevice::SplitRequests(&unaligned_request, 1, max_lbas, lba_size, sub_contexts, sub_requests));
+	ASSERT_EQ(sub_requests.size(), 2);
+	EXPECT_EQ(sub_requests[0].context->offset, 100);
+	EXPECT_EQ(sub_requests[0].context->nr_bytes, max_lbas * lba_size - 100);
+	EXPECT_EQ(sub_requests[1].context->offset, 0);
+	EXPECT_EQ(sub_requests[1].context->nr_bytes, 100);
+	EXPECT_EQ(sub_requests[1].buffer, buffer.data() + max_lbas * lba_size - 100);
+
+	// A request of 0 LBAs can not be submitted and is dropped
+	NvmeCmdContext empty = make_context(0, 0, 30, 0);
+	DeviceIORequest batch[] = {{buffer.data(), &empty}, {buffer.data(), &exact}};
+	sub_contexts.clear();
+	sub_requests.clear();
+	ASSERT_TRUE(NvmeDevice::SplitRequests(batch, 2, max_lbas, lba_size, sub_contexts, sub_requests));
+	ASSERT_EQ(sub_requests.size(), 1);
+	EXPECT_EQ(sub_requests[0].context, &exact);
+}
+
+TEST(NvmeDeviceTest, GetPartialLBAsFindsPartiallyWrittenHeadAndTail) {
+	const idx_t lba_size = 512;
+	auto get_partial = [&](idx_t nr_bytes, idx_t nr_lbas, idx_t start_lba, idx_t offset) {
+		CmdContext context {nr_bytes, nr_lbas, start_lba, offset};
+		return NvmeDevice::GetPartialLBAs(context, lba_size);
+	};
+
+	// Whole LBAs
+	NvmePartialLBAs whole = get_partial(2 * lba_size, 2, 10, 0);
+	EXPECT_FALSE(whole.head.IsValid());
+	EXPECT_FALSE(whole.tail.IsValid());
+
+	// Within a single LBA, which is only the head
+	NvmePartialLBAs within = get_partial(100, 1, 10, 50);
+	EXPECT_EQ(within.head.GetIndex(), 10);
+	EXPECT_FALSE(within.tail.IsValid());
+
+	// Starting at an offset and ending on an LBA boundary
+	NvmePartialLBAs head = get_partial(2 * lba_size - 100, 2, 10, 100);
+	EXPECT_EQ(head.head.GetIndex(), 10);
+	EXPECT_FALSE(head.tail.IsValid());
+
+	// Starting on an LBA boundary and ending within an LBA
+	NvmePartialLBAs tail = get_partial(lba_size + 100, 2, 10, 0);
+	EXPECT_FALSE(tail.head.IsValid());
+	EXPECT_EQ(tail.tail.GetIndex(), 11);
+
+	// Both ends within an LBA
+	NvmePartialLBAs both = get_partial(2 * lba_size, 3, 10, 100);
+	EXPECT_EQ(both.head.GetIndex(), 10);
+	EXPECT_EQ(both.tail.GetIndex(), 12);
+}
+
+TEST(NvmeDeviceTest, EveryReclaimUnitHandleIsAPlacementHandle) {
+	vector<xnvme_spec_ruhs_desc> descriptors(3);
+	for (idx_t i = 0; i < descriptors.size(); i++) {
+		descriptors[i].pi = static_cast<uint16_t>(10 + i);
+		descriptors[i].ruhi = static_cast<uint16_t>(i);
+		descriptors[i].ruamw = 8 * (i + 1);
+	}
+	vector<uint16_t> placement_identifiers = NvmeDevice::GetPlacementIdentifiers(descriptors);
+	EXPECT_EQ(placement_identifiers, vector<uint16_t>({10, 11, 12}));
+
+	unique_ptr<atomic<idx_t>[]> bytes_written(new atomic<idx_t>[3]());
+	bytes_written[2] = 4096;
+	vector<DevicePlacementStatistics> statistics =
+	    NvmeDevice::GetPlacementStatistics(placement_identifiers, descriptors, bytes_written.get(), 512, 16384);
+	ASSERT_EQ(statistics.size(), 3);
+	for (idx_t i = 0; i < statistics.size(); i++) {
+		EXPECT_EQ(statistics[i].placement_handle, i);
+		EXPECT_EQ(statistics[i].placement_identifier, 10 + i);
+		EXPECT_EQ(statistics[i].reclaim_unit_handle, i);
+		EXPECT_EQ(statistics[i].available_bytes, 8 * (i + 1) * 512);
+		EXPECT_EQ(statistics[i].used_bytes.GetIndex(), 16384 - 8 * (i + 1) * 512);
+	}
+	EXPECT_EQ(statistics[0].host_bytes_written, 0);
+	EXPECT_EQ(statistics[2].host_bytes_written, 4096);
+
+	// Without a known reclaim unit size, the used bytes are not reported
+	statistics = NvmeDevice::GetPlacementStatistics(placement_identifiers, descriptors, bytes_written.get(), 512, 0);
+	EXPECT_FALSE(statistics[0].used_bytes.IsValid());
+}
+
+/// Flattens the commands of a copy into (command, source start, source length, command destination) tuples
+static vector<std::tuple<idx_t, idx_t, idx_t, idx_t>> FlattenCopy(const vector<NvmeCopyCommand> &commands) {
+	vector<std::tuple<idx_t, idx_t, idx_t, idx_t>> sources;
+	for (idx_t i = 0; i < commands.size(); i++) {
+		idx_t nr_lbas = 0;
+		for (const DeviceLBARange &source : commands[i].sources) {
+			sources.emplace_back(i, source.start_lba, source.nr_lbas, commands[i].destination_lba);
+			nr_lbas += source.nr_lbas;
+		}
+		EXPECT_EQ(commands[i].nr_lbas, nr_lbas);
+	}
+	return sources;
+}
+
+TEST(NvmeDeviceTest, CopiesAreSplitAtTheCopyLimitsOfTheNamespace) {
+	vector<DeviceLBARange> ranges {{0, 10}, {100, 3}, {150, 0}, {200, 1}};
+	using Source = std::tuple<idx_t, idx_t, idx_t, idx_t>;
+
+	// Source ranges of at most 4 LBAs (MSSRL), 2 source ranges (MSRC + 1) and 6 LBAs per command (MCL)
+	vector<NvmeCopyCommand> commands = NvmeDevice::PlanCopy(ranges.data(), ranges.size(), 1000, 2, 4, 6);
+	EXPECT_THAT(FlattenCopy(commands), ElementsAre(Source(0, 0, 4, 1000), Source(0, 4, 2, 1000), Source(1, 6, 4, 1006),
+	                                               Source(1, 100, 2, 1006), Source(2, 102, 1, 1012),
+	                                               Source(2, 200, 1, 1012)));
+
+	// Only the source range count limits the commands
+	commands = NvmeDevice::PlanCopy(ranges.data(), ranges.size(), 1000, 1, 1 << 16, 1 << 16);
+	EXPECT_THAT(FlattenCopy(commands),
+	            ElementsAre(Source(0, 0, 10, 1000), Source(1, 100, 3, 1010), Source(2, 200, 1, 1013)));
+
+	// Only the source range length limits the commands
+	commands = NvmeDevice::PlanCopy(ranges.data(), ranges.size(), 1000, 128, 3, 1 << 16);
+	EXPECT_THAT(FlattenCopy(commands),
+	            ElementsAre(Source(0, 0, 3, 1000), Source(0, 3, 3, 1000), Source(0, 6, 3, 1000), Source(0, 9, 1, 1000),
+	                        Source(0, 100, 3, 1000), Source(0, 200, 1, 1000)));
+
+	// Only the copy length limits the commands, which splits a source range across commands
+	commands = NvmeDevice::PlanCopy(ranges.data(), ranges.size(), 1000, 128, 1 << 16, 4);
+	EXPECT_THAT(FlattenCopy(commands),
+	            ElementsAre(Source(0, 0, 4, 1000), Source(1, 4, 4, 1004), Source(2, 8, 2, 1008),
+	                        Source(2, 100, 2, 1008), Source(3, 102, 1, 1012), Source(3, 200, 1, 1012)));
+}
+
+TEST(NvmeDeviceTest, PlanWriteBatchMergesPartialWritesToTheSameLBA) {
+	const idx_t lba_size = 512;
+	vector<data_t> first(100, 1);
+	vector<data_t> second(150, 2);
+	vector<data_t> spanning(2 * lba_size + 200, 3);
+	auto make_context = [](idx_t nr_bytes, idx_t nr_lbas, idx_t start_lba, idx_t offset) {
+		NvmeCmdContext context;
+		context.nr_bytes = nr_bytes;
+		context.nr_lbas = nr_lbas;
+		context.start_lba = start_lba;
+		context.offset = offset;
+		return context;
+	};
+
+	// Two writes to disjoint bytes of LBA 5, of which the second overlaps the first by 50 bytes, and a write from the
+	// middle of LBA 6 to the middle of LBA 9
+	NvmeCmdContext first_ctx = make_context(first.size(), 1, 5, 0);
+	NvmeCmdContext second_ctx = make_context(second.size(), 1, 5, 50);
+	NvmeCmdContext spanning_ctx = make_context(spanning.size(), 4, 6, lba_size - 100);
+	DeviceIORequest requests[] = {
+	    {first.data(), &first_ctx}, {second.data(), &second_ctx}, {spanning.data(), &spanning_ctx}};
+
+	NvmeWriteBatchPlan plan = NvmeDevice::PlanWriteBatch(requests, 3, lba_size);
+	EXPECT_EQ(plan.nr_lbas, 6);
+	EXPECT_THAT(plan.GetPartialLBAs(), UnorderedElementsAre(5, 6, 9));
+	for (auto &partial : plan.partial_writes) {
+		EXPECT_EQ(partial.nr_lbas, 1);
+		EXPECT_EQ(partial.offset, 0);
+		EXPECT_EQ(partial.nr_bytes, lba_size);
+	}
+
+	// The whole LBAs in between are written from the data of the request
+	ASSERT_EQ(plan.full_writes.size(), 1);
+	EXPECT_EQ(plan.full_writes[0].context.start_lba, 7);
+	EXPECT_EQ(plan.full_writes[0].context.nr_lbas, 2);
+	EXPECT_EQ(plan.full_writes[0].context.offset, 0);
+	EXPECT_EQ(plan.full_writes[0].context.nr_bytes, 2 * lba_size);
+	EXPECT_EQ(plan.full_writes[0].data, spanning.data() + 100);
+
+	// The merges are applied in the order of the requests onto the current contents of the LBAs
+	vector<vector<data_t>> contents(plan.partial_writes.size(), vector<data_t>(lba_size, 9));
+	vector<data_ptr_t> buffers;
+	for (auto &content : contents) {
+		buffers.push_back(content.data());
+	}
+	plan.ApplyMerges(buffers);
+
+	for (idx_t i = 0; i < plan.partial_writes.size(); i++) {
+		vector<data_t> expected(lba_size, 9);
+		switch (plan.partial_writes[i].start_lba) {
+		case 5:
+			std::fill(expected.begin(), expected.begin() + 100, 1);
+			std::fill(expected.begin() + 50, expected.begin() + 200, 2);
+			break;
+		case 6:
+			std::fill(expected.begin() + lba_size - 100, expected.end(), 3);
+			break;
+		case 9:
+			std::fill(expected.begin(), expected.begin() + 100, 3);
+			break;
+		default:
+			FAIL() << "Unexpected partial write to LBA " << plan.partial_writes[i].start_lba;
+		}
+		EXPECT_EQ(contents[i], expected) << "LBA " << plan.partial_writes[i].start_lba;
+	}
+}
+
+TEST(NvmeCompletionTest, CompletesAfterAllCommandsAndRecordsFailedStatus) {
+	NvmeCompletion completion(2, NvmeCompletion::GetThreadEventFd());
+
+	completion.Complete(0);
+	EXPECT_FALSE(completion.IsComplete());
+
+	completion.Complete(0x281);
+	EXPECT_TRUE(completion.IsComplete());
+	EXPECT_EQ(completion.GetFailedCount(), 1);
+	EXPECT_EQ(completion.GetStatus(), 0x281);
+
+	// The eventfd was signalled, hence waiting on it returns immediately
+	NvmeCompletion::WaitEventFd(completion.GetEventFd(), 1000000);
+}
+
+TEST(NvmeCompletionTest, ParseWaitStrategyRejectsUnknownNames) {
+	EXPECT_EQ(NvmeCompletion::ParseWaitStrategy("spin"), NvmeWaitStrategy::SPIN);
+	EXPECT_EQ(NvmeCompletion::ParseWaitStrategy("spin_yield"), NvmeWaitStrategy::SPIN_YIELD);
+	EXPECT_EQ(NvmeCompletion::ParseWaitStrategy("eventfd"), NvmeWaitStrategy::EVENTFD);
+	EXPECT_THROW(NvmeCompletion::ParseWaitStrategy("unknown"), InvalidInputException);
+}
+
+TEST(NvmeReactorTest, ParseCpuListExpandsRangesAndRejectsMalformedEntries) {
+	EXPECT_TRUE(NvmeReactor::ParseCpuList("").empty());
+	EXPECT_EQ(NvmeReactor::ParseCpuList("2,3"), vector<idx_t>({2, 3}));
+	EXPECT_EQ(NvmeReactor::ParseCpuList("0-3, 8"), vector<idx_t>({0, 1, 2, 3, 8}));
+	EXPECT_EQ(NvmeReactor::ParseCpuList("5-5"), vector<idx_t>({5}));
+
+	EXPECT_THROW(NvmeReactor::ParseCpuList("2,2"), InvalidInputException);
+	EXPECT_THROW(NvmeReactor::ParseCpuList("0-3,2"), InvalidInputException);
+	for (const char *malformed : {"a", "1x", "-1", "1-", "3-1", "1-2-3", "99999999999"}) {
+		EXPECT_THROW(NvmeReactor::ParseCpuList(malformed), InvalidInputException) << malformed;
+	}
+}
+
+/// @brief Hands out distinct queue handles without a device, and tracks which of them have not been destroyed
+class FakeQueues {
+public:
+	~FakeQueues() {
+		for (xnvme_queue *queue : live) {
+			delete reinterpret_cast<char *>(queue);
+		}
+	}
+
+	NvmeQueueFunctions GetFunctions() {
+		NvmeQueueFunctions functions;
+		functions.init = [this](idx_t depth, xnvme_queue **queue) {
+			lock_guard<mutex> guard(lock);
+			*queue = reinterpret_cast<xnvme_queue *>(new char);
+			live.insert(*queue);
+			created++;
+			return 0;
+		};
+		functions.term = [this](xnvme_queue *queue) {
+			lock_guard<mutex> guard(lock);
+			EXPECT_EQ(live.erase(queue), 1);
+			delete reinterpret_cast<char *>(queue);
+		};
+		return functions;
+	}
+
+	/// @brief The number of queues that exist, including the shared queues
+	idx_t GetLiveCount() {
+		lock_guard<mutex> guard(lock);
+		return live.size();
+	}
+
+	idx_t GetCreatedCount() {
+		lock_guard<mutex> guard(lock);
+		return created;
+	}
+
+private:
+	mutex lock;
+	set<xnvme_queue *> live;
+	idx_t created = 0;
+};
+
+/// @brief A thread that acquires a queue and holds its lease until it is released
+class LeasingThread {
+public:
+	explicit LeasingThread(NvmeQueueRegistry &registry) {
+		std::promise<NvmeQueueLease> leased;
+		lease = leased.get_future();
+		thread = std::thread([&registry, this](std::promise<NvmeQueueLease> leased) {
+			leased.set_value(registry.Acquire());
+			release.get_future().wait();
+			// Acquire again after the release, e.g. to pick up a dedicated queue that became free
+			reacquired = registry.Acquire();
+		}, std::move(leased));
+	}
+
+	NvmeQueueLease GetLease() {
+		return lease.get();
+	}
+
+	/// @brief Acquires again on the thread and lets it exit, which returns a dedicated queue
+	NvmeQueueLease Exit() {
+		release.set_value();
+		thread.join();
+		return reacquired;
+	}
+
+private:
+	std::future<NvmeQueueLease> lease;
+	std::promise<void> release;
+	NvmeQueueLease reacquired;
+	std::thread thread;
+};
+
+static reactor_submit_function_t UnusedSubmitFunction() {
+	return [](xnvme_queue *queue, NvmeCommand &command) {
+		return -EIO;
+	};
+}
+
+TEST(NvmeQueueRegistryTest, LeasesDedicatedQueuesAndReturnsThemOnThreadExit) {
+	FakeQueues queues;
+	NvmeQueueRegistry registry(queues.GetFunctions(), 2, 8, 0, UnusedSubmitFunction());
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT + 2);
+
+	LeasingThread first(registry);
+	LeasingThread second(registry);
+	NvmeQueueLease first_lease = first.GetLease();
+	NvmeQueueLease second_lease = second.GetLease();
+	EXPECT_EQ(first_lease.shared, nullptr);
+	EXPECT_EQ(second_lease.shared, nullptr);
+	EXPECT_NE(first_lease.queue, second_lease.queue);
+	EXPECT_NE(first_lease.controller, second_lease.controller);
+
+	// A thread keeps its queue
+	NvmeQueueLease reacquired = second.Exit();
+	EXPECT_EQ(reacquired.queue, second_lease.queue);
+
+	// The queue is handed to the next thread once its thread exits
+	LeasingThread third(registry);
+	EXPECT_EQ(third.GetLease().queue, second_lease.queue);
+	third.Exit();
+	first.Exit();
+	EXPECT_EQ(queues.GetCreatedCount(), NVME_SHARED_QUEUE_COUNT + 2);
+}
+
+TEST(NvmeQueueRegistryTest, ThreadsBeyondTheQueuesShareAQueueUntilOneIsReturned) {
+	FakeQueues queues;
+	NvmeQueueRegistry registry(queues.GetFunctions(), 1, 8, 0, UnusedSubmitFunction());
+
+	LeasingThread owner(registry);
+	NvmeQueueLease owner_lease = owner.GetLease();
+	ASSERT_EQ(owner_lease.shared, nullptr);
+
+	LeasingThread waiter(registry);
+	NvmeQueueLease shared_lease = waiter.GetLease();
+	ASSERT_NE(shared_lease.shared, nullptr);
+	EXPECT_EQ(shared_lease.queue, shared_lease.shared->queue);
+	EXPECT_NE(shared_lease.queue, owner_lease.queue);
+
+	// The thread on the shared queue moves to the dedicated queue on its next acquire
+	owner.Exit();
+	NvmeQueueLease handed_over = waiter.Exit();
+	EXPECT_EQ(handed_over.shared, nullptr);
+	EXPECT_EQ(handed_over.queue, owner_lease.queue);
+}
+
+TEST(NvmeQueueRegistryTest, ResizeCreatesAndDestroysFreeQueues) {
+	FakeQueues queues;
+	NvmeQueueRegistry registry(queues.GetFunctions(), 2, 8, 0, UnusedSubmitFunction());
+	EXPECT_EQ(registry.GetQueueCount(), 2);
+
+	registry.Resize(4);
+	EXPECT_EQ(registry.GetQueueCount(), 4);
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT + 4);
+
+	registry.Resize(1);
+	EXPECT_EQ(registry.GetQueueCount(), 1);
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT + 1);
+
+	idx_t owners = 0;
+	registry.ForEachQueue([&](const string &owner, const QueueDepthController &controller) {
+		owners++;
+		EXPECT_EQ(controller.GetMaxDepth(), 8);
+	});
+	EXPECT_EQ(owners, NVME_SHARED_QUEUE_COUNT + 1);
+}
+
+TEST(NvmeQueueRegistryTest, ResizeWhileLeasedRetiresQueueUntilItIsReturned) {
+	FakeQueues queues;
+	NvmeQueueRegistry registry(queues.GetFunctions(), 1, 8, 0, UnusedSubmitFunction());
+
+	// A leased queue is retired instead of destroyed, and destroyed once its thread exits
+	LeasingThread retired(registry);
+	ASSERT_EQ(retired.GetLease().shared, nullptr);
+	registry.Resize(0);
+	EXPECT_EQ(registry.GetQueueCount(), 0);
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT + 1);
+	retired.Exit();
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT);
+
+	// Growing while a queue is retired revives it instead of creating another one
+	registry.Resize(1);
+	LeasingThread revived(registry);
+	NvmeQueueLease revived_lease = revived.GetLease();
+	ASSERT_EQ(revived_lease.shared, nullptr);
+	registry.Resize(0);
+	idx_t created = queues.GetCreatedCount();
+	registry.Resize(1);
+	EXPECT_EQ(queues.GetCreatedCount(), created);
+	EXPECT_EQ(registry.GetQueueCount(), 1);
+	revived.Exit();
+
+	// The revived queue is returned to the registry rather than destroyed
+	EXPECT_EQ(queues.GetLiveCount(), NVME_SHARED_QUEUE_COUNT + 1);
+	LeasingThread next(registry);
+	EXPECT_EQ(next.GetLease().queue, revived_lease.queue);
+	next.Exit();
+}
+
+TEST(QueueDepthControllerTest, WindowIsFixedWithoutTargetLatency) {
+	QueueDepthController controller(16, 0);
+
+	for (idx_t i = 0; i < 100; i++) {
+		controller.RecordCompletion(10000);
+	}
+
+	EXPECT_EQ(controller.GetWindow(), 16);
+	EXPECT_EQ(controller.GetCompletionCount(), 100);
+	EXPECT_DOUBLE_EQ(controller.GetAverageLatency(), 10000);
+}
+
+TEST(QueueDepthControllerTest, NarrowsAboveTargetAndWidensBelowTarget) {
+	QueueDepthController controller(16, 100);
+
+	// Emulate a device that is saturated, every completion takes longer than the target
+	for (idx_t i = 0; i < 64; i++) {
+		controller.RecordCompletion(400);
+	}
+	EXPECT_EQ(controller.GetWindow(), 1);
+
+	// Latency recovers once the window is narrow, after which the window grows by one command per round
+	for (idx_t i = 0; i < 16; i++) {
+		controller.RecordCompletion(20);
+	}
+	idx_t window = controller.GetWindow();
+	EXPECT_GT(window, 1);
+	EXPECT_LT(window, 16);
+
+	for (idx_t i = 0; i < 1000; i++) {
+		controller.RecordCompletion(20);
+	}
+	EXPECT_EQ(controller.GetWindow(), 16);
+}
+
+TEST(PartialLBACacheTest, LookupReturnsLastInsertedContents) {
+	PartialLBACache cache(16, 2);
+	vector<data_t> lba(16, 1);
+	vector<data_t> result(16, 0);
+
+	EXPECT_FALSE(cache.Lookup(7, result.data()));
+
+	cache.Insert(7, lba.data());
+	lba[0] = 2;
+	cache.Insert(7, lba.data());
+
+	ASSERT_TRUE(cache.Lookup(7, result.data()));
+	EXPECT_EQ(result, lba);
+}
+
+TEST(PartialLBACacheTest, EvictsOldestAndInvalidatesOverwrittenRange) {
+	PartialLBACache cache(16, 2);
+	vector<data_t> lba(16, 1);
+	vector<data_t> result(16, 0);
+
+	cache.Insert(1, lba.data());
+	cache.Insert(2, lba.data());
+	cache.Insert(3, lba.data());
+	EXPECT_FALSE(cache.Lookup(1, result.data()));
+	EXPECT_TRUE(cache.Lookup(2, result.data()));
+
+	cache.Invalidate(3, 10);
+	EXPECT_TRUE(cache.Lookup(2, result.data()));
+	EXPECT_FALSE(cache.Lookup(3, result.data()));
+}
+
+TEST(PartialLBALocksTest, SerializesWritersOfOverlappingLBAs) {
+	PartialLBALocks locks;
+	// LBA 1 and 65 share a lock, and the writers lock their LBAs in different orders
+	vector<vector<idx_t>> lba_sets = {{1, 2}, {2, 1}, {65, 3}, {3, 65, 1}};
+	const idx_t iterations = 2000;
+	idx_t counter = 0;
+
+	vector<std::thread> writers;
+	for (auto &lbas : lba_sets) {
+		writers.emplace_back([&locks, &counter, lbas]() {
+			for (idx_t i = 0; i < iterations; i++) {
+				PartialLBALocks::Guard guard = locks.Lock(lbas);
+				// Every set overlaps with every other set, hence the increments never race
+				counter++;
+			}
+		});
+	}
+	for (auto &writer : writers) {
+		writer.join();
+	}
+	EXPECT_EQ(counter, lba_sets.size() * iterations);
+
+	// The locks are released with their guard
+	PartialLBALocks::Guard guard = locks.Lock({1, 2, 3});
+}
+
+TEST(BackgroundDeallocatorTest, CoalescesRangesAndSkipsCancelledLBAs) {
+	FakeDevice device(16);
+	BackgroundDeallocator deallocator(device, false);
+	DeviceGeometry geo = device.GetDeviceGeometry();
+
+	vector<data_t> data(geo.lba_size * 16, 1);
+	CmdContext ctx {};
+	ctx.nr_bytes = data.size();
+	ctx.nr_lbas = 16;
+	ctx.start_lba = 0;
+	device.Write(data.data(), ctx);
+
+	deallocator.Add(0, 4);
+	deallocator.Add(4, 4);
+	deallocator.Add(10, 2);
+	EXPECT_EQ(deallocator.GetPendingLBAs(), 10);
+
+	deallocator.Cancel(2, 1);
+	EXPECT_EQ(deallocator.GetPendingLBAs(), 9);
+
+	EXPECT_EQ(deallocator.Flush(), 9);
+	EXPECT_EQ(deallocator.GetPendingLBAs(), 0);
+	EXPECT_EQ(deallocator.GetReleasedLBAs(), 9);
+
+	vector<data_t> result(data.size(), 0);
+	device.Read(result.data(), ctx);
+	for (idx_t lba = 0; lba < 16; lba++) {
+		bool released = (lba < 8 && lba != 2) || lba == 10 || lba == 11;
+		data_t expected = released ? 0 : 1;
+		EXPECT_EQ(result[lba * geo.lba_size], expected) << "LBA " << lba;
+	}
+}
+
+TEST(BackgroundDeallocatorTest, CancelWaitsForInFlightDeallocation) {
+	// Blocks deallocation until it is released, such that writes can be interleaved with it
+	class BlockingDevice : public FakeDevice {
+	public:
+		BlockingDevice() : FakeDevice(16), entered(false), released(false) {
+		}
+
+		bool Deallocate(const DeviceLBARange *ranges, idx_t count) override {
+			unique_lock<mutex> guard(lock);
+			entered = true;
+			condition.notify_all();
+			condition.wait(guard, [this]() { return released; });
+			guard.unlock();
+			return FakeDevice::Deallocate(ranges, count);
+		}
+
+		void WaitUntilEntered() {
+			unique_lock<mutex> guard(lock);
+			condition.wait(guard, [this]() { return entered; });
+		}
+
+		void Release() {
+			lock_guard<mutex> guard(lock);
+			released = true;
+			condition.notify_all();
+		}
+
+	private:
+		mutex lock;
+		std::condition_variable condition;
+		bool entered;
+		bool released;
+	};
+
+	BlockingDevice device;
+	BackgroundDeallocator deallocator(device, false);
+	DeviceGeometry geo = device.GetDeviceGeometry();
+
+	deallocator.Add(0, 4);
+	std::thread flusher([&]() { EXPECT_EQ(deallocator.Flush(), 4); });
+	device.WaitUntilEntered();
+	EXPECT_EQ(deallocator.GetPendingLBAs(), 0);
+
+	// A write to a flushed LBA cancels it first, which must wait for the deallocation, or the write is wiped
+	atomic<bool> written(false);
+	vector<data_t> data(geo.lba_size, 2);
+	std::thread writer([&]() {
+		deallocator.Cancel(1, 1);
+		CmdContext ctx {geo.lba_size, 1, 1, 0};
+		device.Write(data.data(), ctx);
+		written = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_FALSE(written.load());
+
+	// LBAs outside of the flushed ranges are not held up, and neither is the lock
+	deallocator.Add(8, 2);
+	deallocator.Cancel(8, 2);
+	EXPECT_EQ(deallocator.GetPendingLBAs(), 0);
+
+	device.Release();
+	flusher.join();
+	writer.join();
+
+	vector<data_t> result(geo.lba_size, 0);
+	CmdContext ctx {geo.lba_size, 1, 1, 0};
+	device.Read(result.data(), ctx);
+	EXPECT_EQ(result, data);
+	EXPECT_EQ(deallocator.GetReleasedLBAs(), 4);
+}
+
+TEST(PlacementPolicyTest, DefaultsSeparateTemporaryDataFirst) {
+	PlacementPolicy single(1);
+	EXPECT_EQ(single.GetPlacementIdentifier(PlacementCategory::TEMP_LARGE), 0);
+
+	PlacementPolicy two(2);
+	EXPECT_EQ(two.GetPlacementIdentifier(PlacementCategory::DATABASE), 0);
+	EXPECT_EQ(two.GetPlacementIdentifier(PlacementCategory::WAL), 0);
+	EXPECT_EQ(two.GetPlacementIdentifier(PlacementCategory::TEMP_SMALL), 1);
+	EXPECT_EQ(two.GetPlacementIdentifier(PlacementCategory::TEMP_LARGE), 1);
+
+	PlacementPolicy eight(8);
+	EXPECT_EQ(eight.ToString(), "db=0,wal=1,metadata=4,tmp_small=2,tmp_large=3,db_hot=5");
+
+	EXPECT_EQ(PlacementPolicy::Classify("nvmefs://test.db"), PlacementCategory::DATABASE);
+	EXPECT_EQ(PlacementPolicy::Classify("nvmefs://test.db.wal"), PlacementCategory::WAL);
+	EXPECT_EQ(PlacementPolicy::Classify("nvmefs://.global_metadata"), PlacementCategory::METADATA);
+	EXPECT_EQ(PlacementPolicy::Classify("nvmefs:///tmp/duckdb_temp_storage_S32K-0.tmp"), PlacementCategory::TEMP_SMALL);
+	EXPECT_EQ(PlacementPolicy::Classify("nvmefs:///tmp/duckdb_temp_storage_DEFAULT-0.tmp"),
+	          PlacementCategory::TEMP_LARGE);
+	// Files are classified like the file system resolves them, hence unknown files are rejected the same way
+	EXPECT_THROW(PlacementPolicy::Classify("nvmefs://test.csv"), InvalidInputException);
+}
+
+TEST(PlacementPolicyTest, OverridesReplaceDefaultsWithinAvailableHandles) {
+	PlacementPolicy policy(4, "wal = 3, tmp_small=1");
+	EXPECT_EQ(policy.GetPlacementIdentifier(PlacementCategory::DATABASE), 0);
+	EXPECT_EQ(policy.GetPlacementIdentifier(PlacementCategory::WAL), 3);
+	EXPECT_EQ(policy.GetPlacementIdentifier(PlacementCategory::TEMP_SMALL), 1);
+	EXPECT_EQ(policy.GetPlacementIdentifier(PlacementCategory::TEMP_LARGE), 3);
+
+	EXPECT_THROW(PlacementPolicy(2, "db=2"), InvalidInputException);
+	EXPECT_THROW(PlacementPolicy(2, "index=1"), InvalidInputException);
+	EXPECT_THROW(PlacementPolicy(2, "db"), InvalidInputException);
+}
+
+TEST(PlacementPolicyTest, TemporaryFilesRotateOverUnassignedHandles) {
+	PlacementPolicy eight(8);
+	EXPECT_EQ(eight.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_LARGE, 0), 3);
+	EXPECT_EQ(eight.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_LARGE, 1), 6);
+	EXPECT_EQ(eight.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_LARGE, 2), 7);
+	EXPECT_EQ(eight.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_LARGE, 3), 3);
+	EXPECT_EQ(eight.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_SMALL, 3), 2);
+
+	// Without unassigned handles, temporary files keep the handle of their category
+	PlacementPolicy four(4);
+	EXPECT_EQ(four.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_SMALL, 1), 2);
+	EXPECT_EQ(four.GetTemporaryPlacementIdentifier(PlacementCategory::TEMP_LARGE, 1), 3);
+}
+
+TEST(WriteFrequencyTrackerTest, RewrittenRangesBecomeHot) {
+	// Ranges of 8 LBAs over LBAs 100 to 1124
+	WriteFrequencyTracker tracker(100, 1124, 8, 3);
+
+	// Bulk load every range once
+	for (idx_t lba = 100; lba < 1124; lba += 8) {
+		EXPECT_FALSE(tracker.RecordWrite(lba, 8));
+	}
+
+	EXPECT_TRUE(tracker.GetHistogram().empty());
+
+	// Rewrite the range of LBAs 108 to 115 until it reaches the threshold
+	EXPECT_FALSE(tracker.RecordWrite(109, 1));
+	EXPECT_FALSE(tracker.RecordWrite(108, 8));
+	EXPECT_TRUE(tracker.RecordWrite(110, 2));
+	EXPECT_TRUE(tracker.IsHot(115));
+	EXPECT_FALSE(tracker.IsHot(116));
+
+	vector<WriteFrequencyBucket> histogram = tracker.GetHistogram();
+	ASSERT_EQ(histogram.size(), 1);
+	EXPECT_EQ(histogram[0].write_count, 3);
+	EXPECT_EQ(histogram[0].nr_ranges, 1);
+}
+
+TEST(WriteFrequencyTrackerTest, RangesLoadedWithSeveralBlocksStayCold) {
+	// The default ranges of 1 MiB hold four DuckDB blocks of 256 KiB
+	const idx_t lba_size = 4096;
+	const idx_t block_lbas = 262144 / lba_size;
+	const idx_t range_lbas = NVMEFS_DEFAULT_WRITE_TRACKING_RANGE_SIZE / lba_size;
+	WriteFrequencyTracker tracker(1, 1 + 16 * range_lbas, range_lbas, NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD);
+
+	// A bulk load writes every block once, also when the blocks of a range are written out of order
+	for (idx_t range = 0; range < 16; range++) {
+		for (idx_t block : {idx_t(2), idx_t(0), idx_t(3), idx_t(1)}) {
+			EXPECT_FALSE(tracker.RecordWrite(1 + range * range_lbas + block * block_lbas, block_lbas));
+		}
+	}
+	EXPECT_FALSE(tracker.IsHot(1));
+	EXPECT_TRUE(tracker.GetHistogram().empty());
+
+	// Rewriting a block makes its range hot
+	for (idx_t i = 0; i < NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD; i++) {
+		EXPECT_EQ(tracker.RecordWrite(1 + block_lbas, block_lbas), i + 1 == NVMEFS_DEFAULT_HOT_WRITE_THRESHOLD);
+	}
+	EXPECT_TRUE(tracker.IsHot(1));
+	EXPECT_FALSE(tracker.IsHot(1 + range_lbas));
+}
+
+TEST(WriteFrequencyTrackerTest, WriteCountsDecayOverEpochs) {
+	WriteFrequencyTracker tracker(0, 1024, 1, 4);
+
+	// The first write is not a rewrite
+	for (idx_t i = 0; i < 5; i++) {
+		tracker.RecordWrite(0, 1);
+	}
+	EXPECT_TRUE(tracker.IsHot(0));
+
+	// Writes elsewhere advance the epoch, which halves the count of LBA 0
+	for (idx_t i = 5; i < (idx_t(1) << WRITE_FREQUENCY_EPOCH_SHIFT); i++) {
+		tracker.RecordWrite(1 + i % 1023, 1);
+	}
+	tracker.RecordWrite(1, 1);
+	EXPECT_FALSE(tracker.IsHot(0));
+	EXPECT_FALSE(tracker.RecordWrite(0, 1));
+	EXPECT_TRUE(tracker.RecordWrite(0, 1));
+}
+
+TEST(WriteFrequencyTrackerTest, WritesAreOnlyTrackedWithASeparateHotHandle) {
+	NvmeConfig config {.device_path = "/dev/ng1n1", .max_temp_size = 1ULL << 24, .max_wal_size = 1ULL << 24};
+	FileOpenFlags flags = FileOpenFlags::FILE_FLAGS_WRITE | FileOpenFlags::FILE_FLAGS_FILE_CREATE;
+
+	// Below 6 handles, hot ranges share the handle of the database by default
+	NvmeFileSystem shared(config, make_uniq<FdpSimulatorDevice>(16384, 1024, 5));
+	shared.OpenFile("nvmefs://test.db", flags);
+	EXPECT_FALSE(shared.GetWriteFrequencyTracker());
+
+	NvmeFileSystem separate(config, make_uniq<FdpSimulatorDevice>(16384, 1024, 6));
+	separate.OpenFile("nvmefs://test.db", flags);
+	EXPECT_TRUE(separate.GetWriteFrequencyTracker());
+}
+
+TEST(FdpSimulatorTest, WritesAreProgrammedThroughTheirPlacementHandle) {
+	NvmeDirectiveFields fields = NvmeDirectiveFields::Encode(8, DATA_PLACEMENT_MODE, 3);
+	EXPECT_EQ(fields.GetLBACount(), 8);
+	EXPECT_EQ(fields.GetDirectiveType(), DATA_PLACEMENT_MODE);
+	EXPECT_EQ(fields.GetPlacementHandle(), 3);
+
+	FdpSimulatorDevice device(1024, 64, 4);
+	vector<char> data(DEFAULT_BLOCK_SIZE * 2, 'x');
+	NvmeCmdContext ctx;
+	ctx.nr_bytes = data.size();
+	ctx.nr_lbas = 2;
+	ctx.start_lba = 10;
+	ctx.offset = 0;
+	ctx.placement_identifier = 3;
+	device.Write(data.data(), ctx);
+
+	DeviceFDPStatistics statistics;
+	ASSERT_TRUE(device.GetFDPStatistics(statistics));
+	ASSERT_EQ(statistics.placement_handles.size(), 4);
+	EXPECT_EQ(statistics.placement_handles[0].host_bytes_written, 0);
+	EXPECT_EQ(statistics.placement_handles[3].host_bytes_written, data.size());
+	EXPECT_EQ(statistics.placement_handles[3].used_bytes.GetIndex(), data.size());
+	EXPECT_EQ(statistics.media_bytes_written, data.size());
+	EXPECT_DOUBLE_EQ(device.GetWriteAmplification(), 1.0);
+}
+
+TEST(FdpSimulatorTest, CommandsAreEncodedWithTheHandleOfTheirPlacementIdentifier) {
+	vector<uint16_t> placement_handles {5, 7, 9};
+	NvmeCmdContext ctx;
+	ctx.nr_lbas = NVME_MAX_COMMAND_LBAS;
+	ctx.placement_identifier = 1;
+
+	NvmeDirectiveFields write = NvmeDirectiveFields::ForCommand(ctx, true, placement_handles);
+	EXPECT_EQ(write.GetLBACount(), NVME_MAX_COMMAND_LBAS);
+	EXPECT_EQ(write.GetDirectiveType(), DATA_PLACEMENT_MODE);
+	EXPECT_EQ(write.GetPlacementHandle(), 7);
+
+	// Reads and writes without FDP carry no directive
+	NvmeDirectiveFields read = NvmeDirectiveFields::ForCommand(ctx, false, placement_handles);
+	EXPECT_EQ(read.GetDirectiveType(), 0);
+	EXPECT_EQ(read.cdw13, 0);
+	NvmeDirectiveFields no_fdp = NvmeDirectiveFields::ForCommand(ctx, true, {});
+	EXPECT_EQ(no_fdp.GetDirectiveType(), 0);
+	EXPECT_EQ(no_fdp.cdw13, 0);
+}
+
+TEST(FdpSimulatorTest, WritesOfMoreLBAsThanACommandHoldsAreSplit) {
+	const idx_t lba_size = 512;
+	const idx_t nr_lbas = NVME_MAX_COMMAND_LBAS + 100;
+	FdpSimulatorDevice device(nr_lbas + 10, 1024, 2, true, 0.1, lba_size);
+
+	vector<char> data(nr_lbas * lba_size, 'x');
+	NvmeCmdContext ctx;
+	ctx.nr_bytes = data.size();
+	ctx.nr_lbas = nr_lbas;
+	ctx.start_lba = 5;
+	ctx.offset = 0;
+	ctx.placement_identifier = 1;
+	device.Write(data.data(), ctx);
+
+	DeviceFDPStatistics statistics;
+	ASSERT_TRUE(device.GetFDPStatistics(statistics));
+	EXPECT_EQ(statistics.host_bytes_written, data.size());
+	EXPECT_EQ(statistics.placement_handles[1].host_bytes_written, data.size());
+	// Only the last reclaim unit of the handle is still open
+	EXPECT_EQ(statistics.placement_handles[1].used_bytes.GetIndex(), (nr_lbas % 1024) * lba_size);
+}
+
+/// Spills temporary files through an NvmeFileSystem, which writes their blocks sequentially and reuses their extents
+/// once they are removed, interleaved with random rewrites of the database
+static double ReplaySpillWorkload(bool fdp) {
+	const idx_t lba_size = DEFAULT_BLOCK_SIZE;
+	const idx_t block_size = 32768;
+	const idx_t blocks_per_file = 32;
+	const idx_t live_files = 3;
+
+	auto simulator = make_uniq<FdpSimulatorDevice>(8192, 64, 4, fdp);
+	FdpSimulatorDevice &device = *simulator;
+	NvmeConfig config {.device_path = "/dev/ng1n1", .max_temp_size = 1ULL << 23, .max_wal_size = 1ULL << 20};
+	NvmeFileSystem fs(config, std::move(simulator));
+	FileOpenFlags flags =
+	    FileOpenFlags::FILE_FLAGS_READ | FileOpenFlags::FILE_FLAGS_WRITE | FileOpenFlags::FILE_FLAGS_FILE_CREATE;
+
+	// Fill the database, which leaves the temporary files the only free space of the device
+	unique_ptr<FileHandle> db = fs.OpenFile("nvmefs://test.db", flags);
+	const idx_t db_lbas = 4096;
+	vector<char> page(lba_size, 'd');
+	for (idx_t lba = 0; lba < db_lbas; lba++) {
+		db->Write(page.data(), lba_size, lba * lba_size);
+	}
+
+	std::mt19937_64 random(42);
+	vector<char> block(block_size, 't');
+	for (idx_t file = 0; file < 64; file++) {
+		string path = StringUtil::Format("nvmefs:///tmp/duckdb_temp_storage_S32K-%llu.tmp", file);
+		unique_ptr<FileHandle> fh = fs.OpenFile(path, flags);
+		for (idx_t i = 0; i < blocks_per_file; i++) {
+			fh->Write(block.data(), block_size, i * block_size);
+			for (idx_t j = 0; j < 4; j++) {
+				db->Write(page.data(), lba_size, (random() % db_lbas) * lba_size);
+			}
+		}
+		fh.reset();
+		if (file >= live_files) {
+			fs.RemoveFile(StringUtil::Format("nvmefs:///tmp/duckdb_temp_storage_S32K-%llu.tmp", file - live_files));
+		}
+	}
+
+	vector<FdpSimulatorSample> history = device.GetHistory();
+	EXPECT_FALSE(history.empty());
+	for (idx_t i = 1; i < history.size(); i++) {
+		EXPECT_GE(history[i].media_bytes_written, history[i - 1].media_bytes_written);
+	}
+	return device.GetWriteAmplification();
+}
+
+TEST(FdpSimulatorTest, SeparatingTemporaryFilesLowersWriteAmplification) {
+	double with_fdp = ReplaySpillWorkload(true);
+	double without_fdp = ReplaySpillWorkload(false);
+	EXPECT_GE(with_fdp, 1.0);
+	EXPECT_LT(with_fdp, without_fdp);
+}
+
+TEST(ZonedStorageTest, WALIsAppendedAcrossZonesAndRestoredFromItsZones) {
+	const idx_t lba_size = 512;
+	FakeZonedDevice device(4, 16, 12, 4, lba_size);
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+
+	// Appends that do not end at LBA boundaries, filling two and a half zones
+	vector<char> data(15000);
+	for (idx_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<char>(i % 251);
+	}
+	ZonedWriteAheadLog wal(device, zones, 0, 4, 3);
+	wal.Load(0);
+	for (idx_t location = 0; location < data.size(); location += 150) {
+		wal.Write(data.data() + location, 150, location);
+	}
+	EXPECT_EQ(wal.GetSizeLBAs(), 30);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), zones.GetZoneStart(0) + 12);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(2)), zones.GetZoneStart(2) + 5);
+	EXPECT_THROW(wal.Write(data.data(), 10, 0), IOException);
+
+	vector<char> result(data.size());
+	wal.Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, data);
+
+	// The partial last LBA is restored after a sync
+	wal.Sync();
+	ZonedWriteAheadLog reloaded(device, zones, 0, 4, 3);
+	reloaded.Load(30);
+	EXPECT_EQ(reloaded.GetSizeLBAs(), 30);
+	std::fill(result.begin(), result.end(), 0);
+	reloaded.Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, data);
+
+	// Truncating into the first zone resets the later zones and rewrites the kept LBAs of the first zone
+	idx_t resets = device.GetResetCount();
+	reloaded.Truncate(5 * lba_size);
+	EXPECT_EQ(device.GetResetCount(), resets + 3);
+	EXPECT_EQ(reloaded.GetSizeLBAs(), 5);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), zones.GetZoneStart(0) + 5);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(1)), zones.GetZoneStart(1));
+	result.resize(5 * lba_size);
+	reloaded.Read(result.data(), result.size(), 0);
+	EXPECT_TRUE(std::equal(result.begin(), result.end(), data.begin()));
+}
+
+TEST(ZonedStorageTest, WALTruncatedWithinAnLBAKeepsThePartOfTheLBABeforeTheNewEnd) {
+	const idx_t lba_size = 512;
+	FakeZonedDevice device(4, 16, 12, 4, lba_size);
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+
+	vector<char> data(15000);
+	for (idx_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<char>(i % 251);
+	}
+	ZonedWriteAheadLog wal(device, zones, 0, 4, 3);
+	wal.Load(0);
+	wal.Write(data.data(), data.size(), 0);
+
+	// Only the 5 whole LBAs are appended again, the 200 bytes of the sixth LBA become the partial LBA
+	idx_t size = 5 * lba_size + 200;
+	wal.Truncate(size);
+	EXPECT_EQ(wal.GetSizeLBAs(), 6);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), zones.GetZoneStart(0) + 5);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(1)), zones.GetZoneStart(1));
+
+	// Appending at the new end continues the partial LBA
+	vector<char> appended(1000, 'a');
+	wal.Write(appended.data(), appended.size(), size);
+	std::copy(appended.begin(), appended.end(), data.begin() + size);
+	size += appended.size();
+	EXPECT_EQ(wal.GetSizeLBAs(), 8);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), zones.GetZoneStart(0) + 7);
+	vector<char> result(size);
+	wal.Read(result.data(), result.size(), 0);
+	EXPECT_TRUE(std::equal(result.begin(), result.end(), data.begin()));
+
+	// A truncation within the partial LBA only shortens it
+	idx_t resets = device.GetResetCount();
+	size -= 100;
+	wal.Truncate(size);
+	EXPECT_EQ(device.GetResetCount(), resets);
+	EXPECT_EQ(wal.GetSizeLBAs(), 8);
+	wal.Sync();
+
+	ZonedWriteAheadLog reloaded(device, zones, 0, 4, 3);
+	reloaded.Load(8);
+	result.resize(size);
+	reloaded.Read(result.data(), result.size(), 0);
+	EXPECT_TRUE(std::equal(result.begin(), result.end(), data.begin()));
+}
+
+TEST(HybridZonedDeviceTest, CommandsAreRoutedToTheirNamespace) {
+	const idx_t lba_size = 512;
+	auto conventional_device = make_uniq<FakeDevice>(8, lba_size);
+	auto zoned_device = make_uniq<FakeZonedDevice>(2, 16, 12, 2, lba_size);
+	FakeDevice &conventional = *conventional_device;
+	FakeZonedDevice &zoned = *zoned_device;
+	HybridZonedDevice device(std::move(conventional_device), std::move(zoned_device));
+
+	// The conventional LBAs of the zoned device follow those of the conventional device
+	EXPECT_EQ(device.GetDeviceGeometry().lba_count, 8 + 2 + 32);
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+	EXPECT_EQ(zones.conventional_lbas, 10);
+	EXPECT_EQ(zones.GetZoneStart(1), 26);
+
+	vector<char> data(2 * lba_size, 'c');
+	CmdContext conventional_ctx {data.size(), 2, 6, 0};
+	device.Write(data.data(), conventional_ctx);
+	vector<char> zoned_data(lba_size, 'z');
+	NvmeCmdContext zoned_ctx;
+	zoned_ctx.nr_bytes = zoned_data.size();
+	zoned_ctx.nr_lbas = 1;
+	zoned_ctx.start_lba = zones.GetZoneStart(1);
+	zoned_ctx.offset = 0;
+	device.Write(zoned_data.data(), zoned_ctx);
+
+	vector<char> result(data.size());
+	CmdContext read_ctx {data.size(), 2, 6, 0};
+	conventional.Read(result.data(), read_ctx);
+	EXPECT_EQ(result, data);
+	result.resize(lba_size);
+	read_ctx = CmdContext {lba_size, 1, 18, 0};
+	zoned.Read(result.data(), read_ctx);
+	EXPECT_EQ(result, zoned_data);
+	EXPECT_EQ(zoned.GetZoneWritePointer(18), 19);
+
+	// A batch is split over both devices
+	vector<char> batch_result(lba_size);
+	NvmeCmdContext batch_ctx = zoned_ctx;
+	DeviceIORequest requests[] = {{result.data(), &conventional_ctx}, {batch_result.data(), &batch_ctx}};
+	conventional_ctx.nr_bytes = lba_size;
+	conventional_ctx.nr_lbas = 1;
+	device.ReadBatch(requests, 2);
+	EXPECT_EQ(result[0], 'c');
+	EXPECT_EQ(batch_result, zoned_data);
+
+	// A command must not span both devices
+	NvmeCmdContext spanning_ctx;
+	spanning_ctx.nr_bytes = data.size();
+	spanning_ctx.nr_lbas = 2;
+	spanning_ctx.start_lba = 7;
+	spanning_ctx.offset = 0;
+	EXPECT_THROW(device.Write(data.data(), spanning_ctx), IOException);
+}
+
+TEST(HybridZonedDeviceTest, ZonesAreAppendedAndResetAtTheirCombinedLBAs) {
+	const idx_t lba_size = 512;
+	auto zoned_device = make_uniq<FakeZonedDevice>(0, 16, 12, 2, lba_size);
+	FakeZonedDevice &zoned = *zoned_device;
+	HybridZonedDevice device(make_uniq<FakeDevice>(8, lba_size), std::move(zoned_device));
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+
+	vector<char> data(3 * lba_size, 'a');
+	NvmeCmdContext ctx;
+	ctx.nr_bytes = data.size();
+	ctx.nr_lbas = 3;
+	ctx.start_lba = zones.GetZoneStart(0);
+	ctx.offset = 0;
+	EXPECT_EQ(device.ZoneAppend(data.data(), ctx), 8);
+	EXPECT_EQ(device.ZoneAppend(data.data(), ctx), 11);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), 14);
+	EXPECT_EQ(zoned.GetZoneWritePointer(0), 6);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(1)), zones.GetZoneStart(1));
+
+	device.ResetZone(zones.GetZoneStart(0));
+	EXPECT_EQ(zoned.GetResetCount(), 1);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), 8);
+	EXPECT_EQ(device.ZoneAppend(data.data(), ctx), 8);
+}
+
+TEST(ZonedStorageTest, TemporaryFilesAreAppendedToTheirOwnZonesAndResetOnDelete) {
+	// Zones of 64 LBAs hold six blocks of 32 KiB each
+	const idx_t zone_capacity = 48;
+	NvmeConfig config {.device_path = "", .max_temp_size = 0, .max_wal_size = zone_capacity * DEFAULT_BLOCK_SIZE};
+	auto zoned_device = make_uniq<FakeZonedDevice>(64, 64, zone_capacity, 8);
+	FakeZonedDevice &device = *zoned_device;
+	NvmeFileSystem file_system(config, std::move(zoned_device));
+	file_system.OpenFile("nvmefs://test.db", FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ);
+
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> first = file_system.OpenFile("nvmefs:///tmp/duckdb_temp_storage_S32K-0.tmp", flags);
+	unique_ptr<FileHandle> second = file_system.OpenFile("nvmefs:///tmp/duckdb_temp_storage_S32K-1.tmp", flags);
+
+	const idx_t block_size = 32768;
+	vector<char> block(block_size);
+	for (idx_t i = 0; i < 8; i++) {
+		std::fill(block.begin(), block.end(), static_cast<char>('a' + i));
+		first->Write(block.data(), block_size, i * block_size);
+	}
+	second->Write(block.data(), block_size, 0);
+
+	// The WAL takes zone 0, the first file zones 1 and 2 and the second file zone 3
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(1)), zones.GetZoneStart(1) + zone_capacity);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(2)), zones.GetZoneStart(2) + 16);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(3)), zones.GetZoneStart(3) + 8);
+
+	// A rewritten block is appended again
+	std::fill(block.begin(), block.end(), 'z');
+	first->Write(block.data(), block_size, 2 * block_size);
+	vector<char> result(block_size);
+	for (idx_t i = 0; i < 8; i++) {
+		first->Read(result.data(), block_size, i * block_size);
+		EXPECT_EQ(result[0], i == 2 ? 'z' : static_cast<char>('a' + i)) << "block " << i;
+	}
+
+	// The WAL is appended to its zone as well
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	wal->Write(block.data(), 100, 0);
+	wal->Write(block.data(), 5000, 100);
+	EXPECT_EQ(file_system.GetFileSize(*wal), 2 * DEFAULT_BLOCK_SIZE);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(0)), zones.GetZoneStart(0) + 1);
+
+	idx_t resets = device.GetResetCount();
+	file_system.RemoveFile("nvmefs:///tmp/duckdb_temp_storage_S32K-0.tmp");
+	EXPECT_EQ(device.GetResetCount(), resets + 2);
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(1)), zones.GetZoneStart(1));
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(2)), zones.GetZoneStart(2));
+	EXPECT_EQ(device.GetZoneWritePointer(zones.GetZoneStart(3)), zones.GetZoneStart(3) + 8);
+}
+
+TEST(CloneDatabaseTest, ClonesTheDatabaseAndWALOntoAnotherDevice) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE};
+	auto source_device = make_uniq<FakeDevice>(1024);
+	FakeDevice &source = *source_device;
+	NvmeFileSystem file_system(config, std::move(source_device));
+
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = file_system.OpenFile("nvmefs://test.db", flags);
+	vector<char> data(DEFAULT_BLOCK_SIZE * 3, 'd');
+	db->Write(data.data(), data.size(), 0);
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	vector<char> wal_data(100, 'w');
+	wal->Write(wal_data.data(), wal_data.size(), 0);
+
+	// A FakeDevice copies to another FakeDevice itself
+	auto target_device = make_uniq<FakeDevice>(1024);
+	NvmeCloneStatistics statistics = file_system.CloneDatabase(*target_device);
+	EXPECT_TRUE(statistics.offloaded);
+	EXPECT_EQ(statistics.database_bytes, data.size());
+	EXPECT_EQ(statistics.wal_bytes, DEFAULT_BLOCK_SIZE);
+	// The database, the WAL and the metadata
+	EXPECT_EQ(source.GetCopiedLBAs(), 3 + 1 + 1);
+
+	// The clone is a database of its own
+	NvmeFileSystem clone(config, std::move(target_device));
+	unique_ptr<FileHandle> cloned_db = clone.OpenFile("nvmefs://test.db", flags);
+	EXPECT_EQ(clone.GetFileSize(*cloned_db), data.size());
+	vector<char> result(data.size());
+	cloned_db->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, data);
+	unique_ptr<FileHandle> cloned_wal = clone.OpenFile("nvmefs://test.db.wal", flags);
+	result.resize(wal_data.size());
+	cloned_wal->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, wal_data);
+
+	// Other targets are copied through host memory
+	EmulatedDevice emulated(make_uniq<FakeDevice>(1024), EmulatedDeviceProfile());
+	statistics = file_system.CloneDatabase(emulated);
+	EXPECT_FALSE(statistics.offloaded);
+	EXPECT_EQ(source.GetCopiedLBAs(), 3 + 1 + 1);
+	result.resize(data.size());
+	CmdContext read_ctx {result.size(), 3, 1, 0};
+	emulated.Read(result.data(), read_ctx);
+	EXPECT_EQ(result, data);
+
+	// The target needs room for the layout of the database
+	FakeDevice small(512);
+	EXPECT_THROW(file_system.CloneDatabase(small), InvalidInputException);
+}
+
+TEST(CloneDatabaseTest, ClonesIntoAnotherRegionOfTheSameDevice) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE};
+	auto base_device = make_uniq<FakeDevice>(4096);
+	FakeDevice &base = *base_device;
+	NvmeFileSystem file_system(config, make_uniq<RegionDevice>(std::move(base_device), 0, 1024));
+
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = file_system.OpenFile("nvmefs://test.db", flags);
+	vector<char> data(DEFAULT_BLOCK_SIZE * 3, 'd');
+	db->Write(data.data(), data.size(), 0);
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	vector<char> wal_data(100, 'w');
+	wal->Write(wal_data.data(), wal_data.size(), 0);
+
+	// The regions overlap the region of the database
+	RegionDevice overlapping(base, 512, 1024);
+	EXPECT_THROW(file_system.CloneDatabase(overlapping), InvalidInputException);
+	EXPECT_THROW(file_system.CloneDatabase(base), InvalidInputException);
+
+	// The clone is copied within the device
+	RegionDevice target(base, 2048, 1024);
+	NvmeCloneStatistics statistics = file_system.CloneDatabase(target);
+	EXPECT_TRUE(statistics.offloaded);
+	EXPECT_EQ(base.GetCopiedLBAs(), 3 + 1 + 1);
+
+	NvmeFileSystem clone(config, make_uniq<RegionDevice>(base, 2048, 1024));
+	unique_ptr<FileHandle> cloned_db = clone.OpenFile("nvmefs://test.db", flags);
+	EXPECT_EQ(clone.GetFileSize(*cloned_db), data.size());
+	vector<char> result(data.size());
+	cloned_db->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, data);
+	unique_ptr<FileHandle> cloned_wal = clone.OpenFile("nvmefs://test.db.wal", flags);
+	result.resize(wal_data.size());
+	cloned_wal->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, wal_data);
+
+	// Writes to the clone leave the database as it is
+	vector<char> rewrite(DEFAULT_BLOCK_SIZE, 'c');
+	cloned_db->Write(rewrite.data(), rewrite.size(), 0);
+	result.resize(data.size());
+	db->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, data);
+}
+
+TEST(RegionDeviceTest, CommandsAreTranslatedIntoTheRegion) {
+	FakeDevice base(64);
+	EXPECT_THROW(RegionDevice(base, 64, 0), InvalidInputException);
+	EXPECT_THROW(RegionDevice(base, 32, 33), InvalidInputException);
+
+	RegionDevice region(base, 16, 0);
+	EXPECT_EQ(region.GetDeviceGeometry().lba_count, 48);
+	vector<char> data(2 * DEFAULT_BLOCK_SIZE, 'r');
+	NvmeCmdContext ctx;
+	ctx.nr_bytes = data.size();
+	ctx.nr_lbas = 2;
+	ctx.start_lba = 4;
+	ctx.offset = 0;
+	region.Write(data.data(), ctx);
+
+	vector<char> result(data.size());
+	NvmeCmdContext base_ctx = ctx;
+	base_ctx.start_lba = 20;
+	base.Read(result.data(), base_ctx);
+	EXPECT_EQ(result, data);
+
+	// Commands must stay within the region
+	ctx.start_lba = 47;
+	EXPECT_THROW(region.Write(data.data(), ctx), IOException);
+	DeviceLBARange range {40, 9};
+	EXPECT_THROW(region.Deallocate(&range, 1), IOException);
+
+	// Regions of the same device overlap if they share an LBA
+	EXPECT_TRUE(region.Overlaps(base));
+	RegionDevice before(base, 0, 16);
+	EXPECT_FALSE(region.Overlaps(before));
+	RegionDevice shared(base, 15, 2);
+	EXPECT_TRUE(region.Overlaps(shared));
+	FakeDevice other(64);
+	RegionDevice elsewhere(other, 16, 0);
+	EXPECT_FALSE(region.Overlaps(elsewhere));
+}
+
+TEST(Crc32cTest, MatchesTheCheckValueAndTheSoftwareImplementation) {
+	const char *check = "123456789";
+	EXPECT_EQ(Crc32c(0, const_data_ptr_cast(check), 9), 0xE3069283);
+	EXPECT_EQ(Crc32cSoftware(0, const_data_ptr_cast(check), 9), 0xE3069283);
+
+	// Lengths and alignments that exercise the byte, word and three stream paths
+	vector<uint8_t> data(100000);
+	for (idx_t i = 0; i < data.size(); i++) {
+		data[i] = static_cast<uint8_t>(i * 2654435761ULL >> 13);
+	}
+	for (idx_t offset : {0, 1, 7}) {
+		for (idx_t nr_bytes : {0, 5, 64, 767, 768, 4096, 24576, 24583, 99000}) {
+			EXPECT_EQ(Crc32c(0, data.data() + offset, nr_bytes), Crc32cSoftware(0, data.data() + offset, nr_bytes));
+		}
+	}
+
+	// A checksum is extended by the bytes that follow
+	uint32_t crc = Crc32c(0, data.data(), 30000);
+	EXPECT_EQ(Crc32c(crc, data.data() + 30000, 50000), Crc32c(0, data.data(), 80000));
+}
+
+TEST(BlockChecksumTableTest, AppendsExtendTheChecksumAndOtherWritesInvalidateIt) {
+	BlockChecksumTable table(100, 200, 512);
+	vector<uint8_t> data(1024, 'a');
+	table.RecordWrite(100, 0, data.data(), 1024);
+	// LBAs outside the region are ignored
+	table.RecordWrite(98, 0, data.data(), 1024);
+	EXPECT_EQ(table.GetChecksummedLBAs(), 2);
+	EXPECT_FALSE(table.Verify(100, 0, data.data(), 1024).IsValid());
+
+	data[600] = 'b';
+	EXPECT_EQ(table.Verify(100, 0, data.data(), 1024).GetIndex(), 101);
+	// A read of part of an LBA is not verified
+	EXPECT_FALSE(table.Verify(101, 10, data.data() + 522, 100).IsValid());
+
+	// An append to LBA 102 extends its checksum, and a read of the covered bytes verifies it
+	table.RecordWrite(102, 0, data.data(), 100);
+	table.RecordWrite(102, 100, data.data() + 100, 50);
+	EXPECT_FALSE(table.Verify(102, 0, data.data(), 150).IsValid());
+	EXPECT_FALSE(table.Verify(102, 0, data.data(), 512).IsValid());
+	data[120] = 'c';
+	EXPECT_EQ(table.Verify(102, 0, data.data(), 150).GetIndex(), 102);
+
+	// Rewriting the middle of the covered bytes leaves the LBA unverified
+	table.RecordWrite(102, 20, data.data(), 10);
+	EXPECT_FALSE(table.Verify(102, 0, data.data(), 150).IsValid());
+	EXPECT_EQ(table.GetChecksummedLBAs(), 2);
+
+	table.Invalidate(90, 11);
+	EXPECT_EQ(table.GetChecksummedLBAs(), 1);
+}
+
+TEST(BlockChecksumTableTest, SerializedChecksumsAreLoadedIntoAnotherTable) {
+	BlockChecksumTable table(100, 200, 512);
+	vector<uint8_t> data(1024, 'a');
+	table.RecordWrite(100, 0, data.data(), 1024);
+	table.RecordWrite(103, 0, data.data(), 100);
+
+	// LBAs outside the region are serialized as unverified
+	vector<uint8_t> buffer(6 * BLOCK_CHECKSUM_ENTRY_SIZE, 0xFF);
+	table.Serialize(99, 6, buffer.data());
+	EXPECT_EQ(buffer[0], 0);
+
+	BlockChecksumTable loaded(100, 200, 512);
+	loaded.RecordWrite(102, 0, data.data(), 512);
+	loaded.Deserialize(99, 6, buffer.data());
+	EXPECT_EQ(loaded.GetChecksummedLBAs(), 3);
+	EXPECT_FALSE(loaded.Verify(100, 0, data.data(), 1024).IsValid());
+	EXPECT_FALSE(loaded.Verify(103, 0, data.data(), 100).IsValid());
+	data[50] = 'b';
+	EXPECT_EQ(loaded.Verify(103, 0, data.data(), 100).GetIndex(), 103);
+}
+
+TEST(BlockChecksumTest, CorruptedWALAndTemporaryDataFailTheRead) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .block_checksums = true};
+	auto device = make_uniq<FakeDevice>(1024);
+	FakeDevice &fake = *device;
+	NvmeFileSystem file_system(config, std::move(device));
+
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = file_system.OpenFile("nvmefs://test.db", flags);
+	vector<char> data(DEFAULT_BLOCK_SIZE, 'd');
+	db->Write(data.data(), data.size(), 0);
+
+	// The WAL is appended in parts of an LBA
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	vector<char> wal_data(150, 'w');
+	wal->Write(wal_data.data(), 100, 0);
+	wal->Write(wal_data.data() + 100, 50, 100);
+	vector<char> result(wal_data.size());
+	wal->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, wal_data);
+
+	string tmp_path = StringUtil::Format("nvmefs:///tmp/duckdb_temp_storage_%s-%llu.tmp", "S32K", 0);
+	unique_ptr<FileHandle> tmp = file_system.OpenFile(tmp_path, flags);
+	vector<char> tmp_data(32768, 't');
+	tmp->Write(tmp_data.data(), tmp_data.size(), 0);
+	EXPECT_EQ(file_system.GetBlockChecksums()->GetChecksummedLBAs(), 2);
+
+	// Flip a byte of every LBA behind the back of the file system. The database is checksummed by DuckDB.
+	char corrupt = 'x';
+	DeviceGeometry geo = fake.GetDeviceGeometry();
+	idx_t temp_start = (geo.lba_count - 1) - (config.max_temp_size / geo.lba_size);
+	idx_t wal_start = (temp_start - 1) - (config.max_wal_size / geo.lba_size);
+	for (idx_t lba : {idx_t(1), wal_start, temp_start}) {
+		CmdContext corrupt_ctx {1, 1, lba, 10};
+		fake.Write(&corrupt, corrupt_ctx);
+	}
+
+	db->Read(result.data(), result.size(), 0);
+	EXPECT_THROW(wal->Read(result.data(), result.size(), 0), IOException);
+	result.resize(tmp_data.size());
+	EXPECT_THROW(tmp->Read(result.data(), result.size(), 0), IOException);
+}
+
+TEST(BlockChecksumTest, WALChecksumsArePersistedWithTheMetadata) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .block_checksums = true};
+	FakeDevice fake(1024);
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	vector<char> wal_data(DEFAULT_BLOCK_SIZE + 100, 'w');
+	{
+		// A region of the whole device lets the device outlive the file system
+		NvmeFileSystem file_system(config, make_uniq<RegionDevice>(fake, 0, 0));
+		file_system.OpenFile("nvmefs://test.db", flags);
+		unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+		wal->Write(wal_data.data(), wal_data.size(), 0);
+		file_system.FileSync(*wal);
+	}
+
+	DeviceGeometry geo = fake.GetDeviceGeometry();
+	idx_t temp_start = (geo.lba_count - 1) - (config.max_temp_size / geo.lba_size);
+	idx_t wal_start = (temp_start - 1) - (config.max_wal_size / geo.lba_size);
+	{
+		NvmeFileSystem file_system(config, make_uniq<RegionDevice>(fake, 0, 0));
+		unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+		EXPECT_EQ(file_system.GetBlockChecksums()->GetChecksummedLBAs(), 2);
+		vector<char> result(wal_data.size());
+		wal->Read(result.data(), result.size(), 0);
+		EXPECT_EQ(result, wal_data);
+
+		// The WAL that is replayed after a restart is verified
+		char corrupt = 'x';
+		CmdContext corrupt_ctx {1, 1, wal_start + 1, 10};
+		fake.Write(&corrupt, corrupt_ctx);
+		EXPECT_THROW(wal->Read(result.data(), result.size(), 0), IOException);
+		corrupt = 'w';
+		fake.Write(&corrupt, corrupt_ctx);
+	}
+
+	// Without checksums, the WAL may change behind the persisted checksums, which are dropped
+	NvmeConfig unchecked = config;
+	unchecked.block_checksums = false;
+	{
+		NvmeFileSystem file_system(unchecked, make_uniq<RegionDevice>(fake, 0, 0));
+		unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+		vector<char> rewrite(100, 'r');
+		wal->Write(rewrite.data(), rewrite.size(), 0);
+		file_system.FileSync(*wal);
+	}
+	NvmeFileSystem file_system(config, make_uniq<RegionDevice>(fake, 0, 0));
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	EXPECT_EQ(file_system.GetBlockChecksums()->GetChecksummedLBAs(), 0);
+	vector<char> result(wal_data.size());
+	wal->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result[0], 'r');
+}
+
+TEST(BlockChecksumTest, MetadataOfTheFirstLayoutHasNoChecksums) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .block_checksums = true};
+	NvmeConfig unchecked = config;
+	unchecked.block_checksums = false;
+	FakeDevice fake(1024);
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	vector<char> wal_data(DEFAULT_BLOCK_SIZE + 100, 'w');
+	{
+		NvmeFileSystem file_system(unchecked, make_uniq<RegionDevice>(fake, 0, 0));
+		file_system.OpenFile("nvmefs://test.db", flags);
+		unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+		wal->Write(wal_data.data(), wal_data.size(), 0);
+		file_system.FileSync(*wal);
+	}
+
+	// The first layout ended after the WAL location and left whatever the write buffer held behind it
+	vector<uint8_t> block(DEFAULT_BLOCK_SIZE);
+	CmdContext metadata_ctx {DEFAULT_BLOCK_SIZE, 1, NVMEFS_GLOBAL_METADATA_LOCATION, 0};
+	fake.Read(block.data(), metadata_ctx);
+	idx_t first_layout_end = sizeof(NVMEFS_MAGIC_BYTES) + offsetof(GlobalMetadata, version);
+	memset(block.data() + first_layout_end, 0xAB, block.size() - first_layout_end);
+	fake.Write(block.data(), metadata_ctx);
+
+	{
+		NvmeFileSystem file_system(config, make_uniq<RegionDevice>(fake, 0, 0));
+		unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+		EXPECT_EQ(file_system.GetBlockChecksums()->GetChecksummedLBAs(), 0);
+		vector<char> result(wal_data.size());
+		wal->Read(result.data(), result.size(), 0);
+		EXPECT_EQ(result, wal_data);
+		file_system.FileSync(*wal);
+	}
+
+	// The metadata is upgraded when it is written, still without checksums
+	fake.Read(block.data(), metadata_ctx);
+	GlobalMetadata global;
+	memcpy(&global, block.data() + sizeof(NVMEFS_MAGIC_BYTES), sizeof(GlobalMetadata));
+	EXPECT_EQ(global.version, NVMEFS_METADATA_VERSION);
+	EXPECT_EQ(global.checksum_start, 0);
+	EXPECT_EQ(global.checksum_location, global.wal_start);
+}
+
+TEST(BlockChecksumTest, TheWALInZonesIsChecksummedByItsBytes) {
+	const idx_t zone_capacity = 48;
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 0,
+	                   .max_wal_size = zone_capacity * DEFAULT_BLOCK_SIZE,
+	                   .block_checksums = true};
+	auto zoned_device = make_uniq<FakeZonedDevice>(64, 64, zone_capacity, 8);
+	FakeZonedDevice &device = *zoned_device;
+	NvmeFileSystem file_system(config, std::move(zoned_device));
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	file_system.OpenFile("nvmefs://test.db", flags);
+
+	// The first LBA of the WAL is appended to its zone, and the rest is kept in the LBA before the zone
+	unique_ptr<FileHandle> wal = file_system.OpenFile("nvmefs://test.db.wal", flags);
+	vector<char> wal_data(DEFAULT_BLOCK_SIZE + 1000, 'w');
+	wal->Write(wal_data.data(), 100, 0);
+	wal->Write(wal_data.data() + 100, wal_data.size() - 100, 100);
+	file_system.FileSync(*wal);
+	EXPECT_EQ(file_system.GetBlockChecksums()->GetChecksummedLBAs(), 2);
+	vector<char> result(wal_data.size());
+	wal->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, wal_data);
+
+	// The zone is corrupted behind the back of the zone rules
+	DeviceZoneGeometry zones;
+	ASSERT_TRUE(device.GetZoneGeometry(zones));
+	char corrupt = 'x';
+	CmdContext corrupt_ctx {1, 1, zones.GetZoneStart(0), 10};
+	device.FakeDevice::Write(&corrupt, corrupt_ctx);
+	EXPECT_THROW(wal->Read(result.data(), result.size(), 0), IOException);
+	result.resize(1000);
+	wal->Read(result.data(), result.size(), DEFAULT_BLOCK_SIZE);
+}
+
+TEST(TemporaryBlockCompressorTest, CompressedBlocksArePaddedToLBAsAndIncompressibleBlocksAreKept) {
+	TemporaryBlockCompressor compressor(NVMEFS_DEFAULT_TEMP_COMPRESSION_LEVEL, 4096);
+	idx_t block_size = NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE;
+	vector<data_t> block(block_size);
+	for (idx_t i = 0; i < block_size; i++) {
+		block[i] = static_cast<data_t>(i % 100);
+	}
+	vector<data_t> compressed(block_size, 0xFF);
+
+	idx_t compressed_bytes = compressor.Compress(block.data(), block_size, compressed.data());
+	EXPECT_GT(compressed_bytes, 0);
+	EXPECT_LT(compressed_bytes, block_size);
+	EXPECT_EQ(compressed_bytes % 4096, 0);
+	vector<data_t> result(block_size);
+	compressor.Decompress(compressed.data(), compressed_bytes, result.data(), block_size);
+	EXPECT_EQ(result, block);
+
+	// Random data does not save an LBA
+	RandomEngine random(42);
+	for (idx_t i = 0; i < block_size; i++) {
+		block[i] = static_cast<data_t>(random.NextRandomInteger());
+	}
+	EXPECT_EQ(compressor.Compress(block.data(), block_size, compressed.data()), 0);
+
+	TemporaryCompressionStatistics statistics = compressor.GetStatistics();
+	EXPECT_EQ(statistics.compressed_blocks, 1);
+	EXPECT_EQ(statistics.uncompressed_blocks, 1);
+	EXPECT_EQ(statistics.block_bytes, 2 * block_size);
+	EXPECT_EQ(statistics.stored_bytes, compressed_bytes + block_size);
+
+	EXPECT_THROW(TemporaryBlockCompressor::ParseCompression("lz5"), InvalidInputException);
+}
+
+TEST(TemporaryMetadataManagerExtentTest, CompressedBlocksTakeSlotsOfTheirSize) {
+	TemporaryFileMetadataManager metadata_manager(0, 4096, 4096, 1 << 20);
+	string file_path = "nvmefs:///tmp/duckdb_temp_storage_DEFAULT-0.tmp";
+	metadata_manager.CreateFile(file_path);
+	TempFileMetadata &file = *metadata_manager.GetFile(file_path);
+
+	// Compressed blocks are packed into a frame that takes the place of a block in the extent of the file
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 0, 10), 0);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 262144, 64), 64);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 2 * 262144, 20), 10);
+	EXPECT_EQ(metadata_manager.GetBlockSlot(file, 262144).nr_lbas, 64);
+	EXPECT_EQ(metadata_manager.GetBlockSlot(file, 2 * 262144).start_lba, 10);
+	EXPECT_EQ(metadata_manager.GetFileSizeLBA(file_path), 3 * 64);
+
+	// A block rewritten at the same size keeps its slot, and otherwise moves to the first slot that fits it
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 0, 10), 0);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 0, 12), 30);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 3 * 262144, 10), 0);
+
+	// Freed slots are coalesced with the free LBAs next to them, such that larger blocks fit
+	metadata_manager.TruncateFile(file_path, 262144);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 262144, 20), 0);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 2 * 262144, 64), 64);
+	EXPECT_THROW(metadata_manager.AllocateBlockSlot(file, 0, 65), IOException);
+
+	// A frame whose slots are all freed is reused as a block
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 262144, 64), 128);
+	EXPECT_EQ(metadata_manager.AllocateBlockSlot(file, 0, 64), 0);
+}
+
+TEST(TemporaryMetadataManagerExtentTest, CompressedBlocksOfChangingSizeDoNotGrowTheFile) {
+	TemporaryFileMetadataManager metadata_manager(0, 4096, 4096, 1 << 20);
+	string file_path = "nvmefs:///tmp/duckdb_temp_storage_DEFAULT-0.tmp";
+	metadata_manager.CreateFile(file_path);
+	TempFileMetadata &file = *metadata_manager.GetFile(file_path);
+
+	const idx_t nr_blocks = 16;
+	const idx_t block_lbas = 64;
+	for (idx_t i = 0; i < nr_blocks; i++) {
+		metadata_manager.AllocateBlockSlot(file, i * 262144, block_lbas);
+	}
+	idx_t available = metadata_manager.GetAvailableSpace(4096, 0);
+
+	// Blocks are rewritten at random with every compressibility, from a single LBA to incompressible
+	RandomEngine random(42);
+	for (idx_t i = 0; i < 5000; i++) {
+		idx_t block = random.NextRandomInteger() % nr_blocks;
+		idx_t nr_lbas = 1 + random.NextRandomInteger() % block_lbas;
+		metadata_manager.AllocateBlockSlot(file, block * 262144, nr_lbas);
+		ASSERT_EQ(metadata_manager.GetAvailableSpace(4096, 0), available) << "rewrite " << i;
+	}
+
+	// The slots do not overlap
+	vector<TemporaryBlockSlot> slots;
+	for (idx_t i = 0; i < nr_blocks; i++) {
+		slots.push_back(metadata_manager.GetBlockSlot(file, i * 262144));
+	}
+	std::sort(slots.begin(), slots.end(), [](const TemporaryBlockSlot &a, const TemporaryBlockSlot &b) {
+		return a.start_lba < b.start_lba;
+	});
+	for (idx_t i = 1; i < slots.size(); i++) {
+		EXPECT_LE(slots[i - 1].start_lba + slots[i - 1].nr_lbas, slots[i].start_lba);
+	}
+}
+
+TEST(TemporaryCompressionTest, UncompressedSpillBlocksAreStoredCompressed) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 1ULL << 26,
+	                   .max_wal_size = 1ULL << 22,
+	                   .temp_compression = "zstd"};
+	NvmeFileSystem file_system(config, make_uniq<FakeDevice>(32768, 4096));
+	TemporaryBlockCompressor &compressor = *file_system.GetTemporaryBlockCompressor();
+
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = file_system.OpenFile("nvmefs://test.db", flags);
+	string tmp_path = StringUtil::Format("nvmefs:///tmp/duckdb_temp_storage_%s-%llu.tmp", "DEFAULT", 0);
+	unique_ptr<FileHandle> tmp = file_system.OpenFile(tmp_path, flags);
+
+	vector<char> compressible(NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	vector<char> incompressible(NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	RandomEngine random(42);
+	for (idx_t i = 0; i < compressible.size(); i++) {
+		compressible[i] = static_cast<char>(i % 7);
+		incompressible[i] = static_cast<char>(random.NextRandomInteger());
+	}
+	tmp->Write(compressible.data(), compressible.size(), 0);
+	tmp->Write(incompressible.data(), incompressible.size(), NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	EXPECT_EQ(file_system.GetFileSize(*tmp), 2 * NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+
+	vector<char> result(NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	tmp->Read(result.data(), result.size(), 0);
+	EXPECT_EQ(result, compressible);
+	tmp->Read(result.data(), result.size(), NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	EXPECT_EQ(result, incompressible);
+
+	// The incompressible block is rewritten with compressible contents, and moves to a smaller slot
+	tmp->Write(compressible.data(), compressible.size(), NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	tmp->Read(result.data(), result.size(), NVMEFS_UNCOMPRESSED_TEMP_BLOCK_SIZE);
+	EXPECT_EQ(result, compressible);
+	TemporaryCompressionStatistics statistics = compressor.GetStatistics();
+	EXPECT_EQ(statistics.compressed_blocks, 2);
+	EXPECT_EQ(statistics.uncompressed_blocks, 1);
+
+	// DuckDB has compressed the blocks of the smaller size classes already
+	string small_path = StringUtil::Format("nvmefs:///tmp/duckdb_temp_storage_%s-%llu.tmp", "S32K", 0);
+	unique_ptr<FileHandle> small = file_system.OpenFile(small_path, flags);
+	small->Write(compressible.data(), 32768, 0);
+	EXPECT_EQ(compressor.GetStatistics().block_bytes, statistics.block_bytes);
+}
+
+TEST(ScanReadaheadTest, SequentialReadsAreServedFromPrefetchesAndWritesDropThem) {
+	FakeDevice device(1024);
+	DeviceGeometry geo = device.GetDeviceGeometry();
+	for (idx_t lba = 0; lba < geo.lba_count; lba++) {
+		vector<data_t> data(geo.lba_size, static_cast<data_t>(lba));
+		CmdContext ctx {geo.lba_size, 1, lba, 0};
+		device.Write(data.data(), ctx);
+	}
+	ScanReadahead readahead(device, 1, geo.lba_count, 1ULL << 20, false);
+
+	vector<data_t> result(2 * geo.lba_size);
+	auto read = [&](idx_t lba) {
+		CmdContext ctx {result.size(), 2, lba, 0};
+		return readahead.Read(result.data(), ctx);
+	};
+
+	// The second read in sequence queues the window of 4 reads that follow it
+	EXPECT_FALSE(read(10));
+	EXPECT_FALSE(read(12));
+	EXPECT_EQ(readahead.GetStatistics().staged_bytes, 4 * result.size());
+	readahead.Flush();
+	EXPECT_EQ(readahead.GetStatistics().prefetched_bytes, 4 * result.size());
+
+	EXPECT_TRUE(read(14));
+	EXPECT_EQ(result[0], 14);
+	EXPECT_EQ(result[geo.lba_size], 15);
+
+	// A write drops the prefetch that covers it
+	readahead.Invalidate(17, 1);
+	EXPECT_FALSE(read(16));
+	ReadaheadStatistics statistics = readahead.GetStatistics();
+	EXPECT_EQ(statistics.hits, 1);
+	EXPECT_EQ(statistics.wasted_bytes, result.size());
+
+	readahead.Flush();
+	EXPECT_TRUE(read(18));
+	EXPECT_EQ(result[0], 18);
+}
+
+TEST(ScanReadaheadTest, StagingAreaIsBoundedAndSkippedPrefetchesAreDropped) {
+	FakeDevice device(1024);
+	idx_t read_size = 2 * device.GetDeviceGeometry().lba_size;
+	ScanReadahead readahead(device, 1, 1024, 2 * read_size, false);
+
+	vector<data_t> result(read_size);
+	auto read = [&](idx_t lba) {
+		CmdContext ctx {read_size, 2, lba, 0};
+		return readahead.Read(result.data(), ctx);
+	};
+
+	EXPECT_FALSE(read(10));
+	EXPECT_FALSE(read(12));
+	EXPECT_EQ(readahead.GetStatistics().staged_bytes, 2 * read_size);
+	readahead.Flush();
+	EXPECT_TRUE(read(14));
+
+	// The stream skips the prefetch of LBA 16, which makes room for the reads after it
+	EXPECT_FALSE(read(20));
+	ReadaheadStatistics statistics = readahead.GetStatistics();
+	EXPECT_LE(statistics.staged_bytes, 2 * read_size);
+	EXPECT_EQ(statistics.wasted_bytes, read_size);
+
+	readahead.Flush();
+	EXPECT_TRUE(read(22));
+	EXPECT_FALSE(read(22));
+}
+
+TEST(ScanReadaheadTest, DatabaseReadsSeeCompletedWrites) {
+	NvmeConfig config {.device_path = "",
+	                   .max_temp_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .max_wal_size = 64 * DEFAULT_BLOCK_SIZE,
+	                   .readahead_size = 1ULL << 20};
+	NvmeFileSystem file_system(config, make_uniq<FakeDevice>(1024));
+
+	FileOpenFlags flags = FileFlags::FILE_FLAGS_WRITE | FileFlags::FILE_FLAGS_READ | FileFlags::FILE_FLAGS_FILE_CREATE;
+	unique_ptr<FileHandle> db = file_system.OpenFile("nvmefs://test.db", flags);
+	ASSERT_TRUE(file_system.GetScanReadahead());
+	idx_t block_size = 2 * DEFAULT_BLOCK_SIZE;
+	for (idx_t block = 0; block < 16; block++) {
+		vector<char> data(block_size, static_cast<char>('a' + block));
+		db->Write(data.data(), data.size(), block * block_size);
+	}
+
+	// The first reads start prefetching the blocks after them, one of which is then rewritten
+	vector<char> result(block_size);
+	for (idx_t block = 0; block < 3; block++) {
+		db->Read(result.data(), result.size(), block * block_size);
+		EXPECT_EQ(result[0], 'a' + block);
+	}
+	vector<char> rewritten(block_size, 'z');
+	db->Write(rewritten.data(), rewritten.size(), 4 * block_size);
+
+	for (idx_t block = 3; block < 16; block++) {
+		db->Read(result.data(), result.size(), block * block_size);
+		EXPECT_EQ(result[0], block == 4 ? 'z' : 'a' + block) << "block " << block;
+		EXPECT_EQ(result[block_size - 1], result[0]);
+	}
+	EXPECT_LE(file_system.GetScanReadahead()->GetStatistics().staged_bytes, config.readahead_size);
+}
+
 } // namespace duckdb
@@ -1,8 +1,17 @@
 #include "fake_device.hpp"
 
+#include "nvme_device.hpp"
+
 namespace duckdb {
 FakeDevice::FakeDevice(idx_t lba_count, idx_t lba_size)
-    : Device(), geometry(DeviceGeometry {lba_size, lba_count}), memory(new uint8_t[lba_size * lba_count]) {
+    : Device(), geometry(DeviceGeometry {lba_size, lba_count}), memory(new uint8_t[lba_size * lba_count]),
+      buffer_pool(
+          [](idx_t nr_bytes) {
+	          idx_t aligned_bytes = (nr_bytes + DEVICE_BUFFER_ALIGNMENT - 1) & ~(DEVICE_BUFFER_ALIGNMENT - 1);
+	          return static_cast<data_ptr_t>(aligned_alloc(DEVICE_BUFFER_ALIGNMENT, aligned_bytes));
+          },
+          [](data_ptr_t buffer) { free(buffer); }),
+      copied_lbas(0) {
 }
 
 FakeDevice::~FakeDevice() {
@@ -38,4 +47,45 @@ idx_t FakeDevice::Read(void *buffer, const CmdContext &context) {
 DeviceGeometry FakeDevice::GetDeviceGeometry() {
 	return geometry;
 }
+
+bool FakeDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	for (idx_t i = 0; i < count; i++) {
+		D_ASSERT(ranges[i].start_lba + ranges[i].nr_lbas <= geometry.lba_count);
+		memset(memory + ranges[i].start_lba * geometry.lba_size, 0, ranges[i].nr_lbas * geometry.lba_size);
+	}
+	return true;
+}
+
+bool FakeDevice::Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) {
+	if (!dynamic_cast<FakeDevice *>(&destination) || destination.GetDeviceGeometry().lba_size != geometry.lba_size) {
+		return false;
+	}
+
+	for (idx_t i = 0; i < count; i++) {
+		D_ASSERT(ranges[i].start_lba + ranges[i].nr_lbas <= geometry.lba_count);
+		// Copied through a separate buffer, as the ranges may overlap on the same device
+		idx_t nr_bytes = ranges[i].nr_lbas * geometry.lba_size;
+		vector<uint8_t> data(memory + ranges[i].start_lba * geometry.lba_size,
+		                     memory + ranges[i].start_lba * geometry.lba_size + nr_bytes);
+
+		NvmeCmdContext context;
+		context.nr_bytes = nr_bytes;
+		context.nr_lbas = ranges[i].nr_lbas;
+		context.start_lba = destination_lba;
+		context.offset = 0;
+		destination.Write(data.data(), context);
+
+		destination_lba += ranges[i].nr_lbas;
+		copied_lbas += ranges[i].nr_lbas;
+	}
+	return true;
+}
+
+data_ptr_t FakeDevice::AllocateBuffer(idx_t nr_bytes) {
+	return buffer_pool.Allocate(nr_bytes);
+}
+
+void FakeDevice::FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) {
+	buffer_pool.Free(buffer, nr_bytes);
+}
 } // namespace duckdb
@@ -1,4 +1,7 @@
+#pragma once
+
 #include "device.hpp"
+#include "device_buffer_pool.hpp"
 
 namespace duckdb {
 constexpr idx_t DEFAULT_BLOCK_SIZE = 1ULL << 12;
@@ -13,6 +16,21 @@ public:
 
 	DeviceGeometry GetDeviceGeometry() override;
 
+	/// @brief Deallocates the ranges by zeroing their memory
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+
+	/// @brief Copies to a FakeDevice by writing the ranges from memory through the Write of the destination, such that
+	/// the destination applies its own rules to the copied LBAs
+	bool Copy(const DeviceLBARange *ranges, idx_t count, Device &destination, idx_t destination_lba) override;
+
+	/// @brief The number of LBAs copied by Copy since creation
+	idx_t GetCopiedLBAs() const {
+		return copied_lbas;
+	}
+
+	data_ptr_t AllocateBuffer(idx_t nr_bytes) override;
+	void FreeBuffer(data_ptr_t buffer, idx_t nr_bytes) override;
+
 	string GetName() const override {
 		return "FakeDevice";
 	}
@@ -20,5 +38,7 @@ public:
 private:
 	const DeviceGeometry geometry;
 	uint8_t *memory;
+	DeviceBufferPool buffer_pool;
+	atomic<idx_t> copied_lbas;
 };
 } // namespace duckdb
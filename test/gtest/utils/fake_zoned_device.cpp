@@ -0,0 +1,87 @@
+#include "fake_zoned_device.hpp"
+
+namespace duckdb {
+
+FakeZonedDevice::FakeZonedDevice(idx_t conventional_lbas, idx_t zone_size, idx_t zone_capacity, idx_t nr_zones,
+                                 idx_t lba_size)
+    : FakeDevice(conventional_lbas + zone_size * nr_zones, lba_size),
+      zones(DeviceZoneGeometry {conventional_lbas, zone_size, zone_capacity, nr_zones}), write_pointers(nr_zones, 0),
+      resets(0) {
+	D_ASSERT(zone_capacity <= zone_size);
+}
+
+idx_t FakeZonedDevice::Write(void *buffer, const CmdContext &context) {
+	if (context.start_lba + context.nr_lbas > zones.conventional_lbas) {
+		lock_guard<mutex> guard(lock);
+		if (context.start_lba < zones.conventional_lbas) {
+			throw IOException("FakeZonedDevice: write at LBA %llu spans conventional LBAs and a zone",
+			                  context.start_lba);
+		}
+		AdvanceWritePointer((context.start_lba - zones.conventional_lbas) / zones.zone_size, context);
+	}
+	return FakeDevice::Write(buffer, context);
+}
+
+bool FakeZonedDevice::GetZoneGeometry(DeviceZoneGeometry &geometry) {
+	geometry = zones;
+	return true;
+}
+
+idx_t FakeZonedDevice::ZoneAppend(void *buffer, const CmdContext &context) {
+	D_ASSERT(context.offset == 0);
+	CmdContext append = context;
+	{
+		lock_guard<mutex> guard(lock);
+		idx_t zone = GetZone(context.start_lba);
+		append.start_lba = context.start_lba + write_pointers[zone];
+		AdvanceWritePointer(zone, append);
+	}
+	FakeDevice::Write(buffer, append);
+	return append.start_lba;
+}
+
+void FakeZonedDevice::ResetZone(idx_t zone_start_lba) {
+	lock_guard<mutex> guard(lock);
+	idx_t zone = GetZone(zone_start_lba);
+	write_pointers[zone] = 0;
+	resets++;
+
+	DeviceLBARange range {zone_start_lba, zones.zone_size};
+	FakeDevice::Deallocate(&range, 1);
+}
+
+idx_t FakeZonedDevice::GetZoneWritePointer(idx_t zone_start_lba) {
+	lock_guard<mutex> guard(lock);
+	return zone_start_lba + write_pointers[GetZone(zone_start_lba)];
+}
+
+idx_t FakeZonedDevice::GetResetCount() {
+	lock_guard<mutex> guard(lock);
+	return resets;
+}
+
+idx_t FakeZonedDevice::GetZone(idx_t zone_start_lba) {
+	if (zone_start_lba < zones.conventional_lbas || (zone_start_lba - zones.conventional_lbas) % zones.zone_size != 0 ||
+	    zone_start_lba >= zones.GetZoneStart(zones.nr_zones)) {
+		throw IOException("FakeZonedDevice: LBA %llu is not the start of a zone", zone_start_lba);
+	}
+	return (zone_start_lba - zones.conventional_lbas) / zones.zone_size;
+}
+
+void FakeZonedDevice::AdvanceWritePointer(idx_t zone, const CmdContext &context) {
+	if (zone >= zones.nr_zones) {
+		throw IOException("FakeZonedDevice: LBA %llu is beyond the last zone", context.start_lba);
+	}
+	idx_t write_pointer = zones.GetZoneStart(zone) + write_pointers[zone];
+	if (context.start_lba != write_pointer) {
+		throw IOException("FakeZonedDevice: write at LBA %llu, but the write pointer of zone %llu is at LBA %llu",
+		                  context.start_lba, zone, write_pointer);
+	}
+	if (write_pointers[zone] + context.nr_lbas > zones.zone_capacity) {
+		throw IOException("FakeZonedDevice: write of %llu LBAs exceeds the capacity of zone %llu", context.nr_lbas,
+		                  zone);
+	}
+	write_pointers[zone] += context.nr_lbas;
+}
+
+} // namespace duckdb
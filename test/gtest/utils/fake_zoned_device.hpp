@@ -0,0 +1,49 @@
+#pragma once
+
+#include "fake_device.hpp"
+
+#include <mutex>
+
+namespace duckdb {
+
+/// @brief A FakeDevice whose LBAs after a conventional prefix are split into zones, which enforce the rules of a Zoned
+/// Namespace: a zone is only written at its write pointer and up to its capacity, and only rewritten after a reset.
+/// Writes that break these rules throw an IOException, like the device would fail them.
+class FakeZonedDevice : public FakeDevice {
+public:
+	FakeZonedDevice(idx_t conventional_lbas, idx_t zone_size, idx_t zone_capacity, idx_t nr_zones,
+	                idx_t lba_size = DEFAULT_BLOCK_SIZE);
+
+	/// @brief Writes conventional LBAs anywhere, and zones at their write pointer
+	idx_t Write(void *buffer, const CmdContext &context) override;
+
+	bool GetZoneGeometry(DeviceZoneGeometry &geometry) override;
+	idx_t ZoneAppend(void *buffer, const CmdContext &context) override;
+	/// @brief Moves the write pointer back to the start of the zone and zeroes the zone
+	void ResetZone(idx_t zone_start_lba) override;
+	idx_t GetZoneWritePointer(idx_t zone_start_lba) override;
+
+	/// @brief The number of zone resets since creation
+	idx_t GetResetCount();
+
+	string GetName() const override {
+		return "FakeZonedDevice";
+	}
+
+private:
+	/// @brief Finds the zone that starts at the given LBA
+	idx_t GetZone(idx_t zone_start_lba);
+
+	/// @brief Advances the write pointer of the zone that the command writes to, checking that it is written
+	/// sequentially and within its capacity
+	void AdvanceWritePointer(idx_t zone, const CmdContext &context);
+
+private:
+	mutex lock;
+	const DeviceZoneGeometry zones;
+	//! The write pointer of every zone, relative to the start of the zone
+	vector<idx_t> write_pointers;
+	idx_t resets;
+};
+
+} // namespace duckdb
@@ -0,0 +1,197 @@
+#include "fdp_simulator_device.hpp"
+
+namespace duckdb {
+
+constexpr uint32_t FdpSimulatorDevice::UNMAPPED;
+constexpr idx_t FdpSimulatorDevice::RESERVED_UNITS;
+
+FdpSimulatorDevice::FdpSimulatorDevice(idx_t lba_count, idx_t reclaim_unit_lbas, idx_t nr_handles, bool fdp,
+                                       double over_provisioning, idx_t lba_size)
+    : FakeDevice(lba_count, lba_size), lba_size(lba_size), reclaim_unit_lbas(reclaim_unit_lbas), fdp(fdp),
+      logical_to_physical(lba_count, UNMAPPED), handles(fdp ? nr_handles : 1), host_lbas_written(0),
+      media_lbas_written(0), units_erased(0) {
+	if (fdp) {
+		placement_policy = make_uniq<PlacementPolicy>(nr_handles);
+		for (idx_t i = 0; i < nr_handles; i++) {
+			placement_handles.push_back(static_cast<uint16_t>(i));
+		}
+	}
+
+	// Every handle keeps up to two reclaim units open, which must not eat into the over-provisioned space
+	idx_t nr_units = (lba_count + reclaim_unit_lbas - 1) / reclaim_unit_lbas;
+	idx_t spare_units = static_cast<idx_t>(static_cast<double>(lba_count) * over_provisioning) / reclaim_unit_lbas;
+	nr_units += MaxValue<idx_t>(spare_units, 2 * handles.size()) + RESERVED_UNITS;
+
+	units.resize(nr_units);
+	physical_to_logical.resize(nr_units * reclaim_unit_lbas, UNMAPPED);
+	for (idx_t i = nr_units; i > 0; i--) {
+		free_units.push_back(i - 1);
+	}
+}
+
+idx_t FdpSimulatorDevice::Write(void *buffer, const CmdContext &context) {
+	idx_t nr_lbas = FakeDevice::Write(buffer, context);
+
+	lock_guard<mutex> guard(lock);
+	const NvmeCmdContext &ctx = static_cast<const NvmeCmdContext &>(context);
+	NvmeCmdContext command = ctx;
+	for (idx_t done = 0; done < ctx.nr_lbas; done += command.nr_lbas) {
+		// Decode the handle from the command dwords that NvmeDevice would submit, split like NvmeDevice splits writes
+		// that exceed the 16 bit LBA count
+		command.start_lba = ctx.start_lba + done;
+		command.nr_lbas = MinValue<idx_t>(ctx.nr_lbas - done, NVME_MAX_COMMAND_LBAS);
+		NvmeDirectiveFields fields = NvmeDirectiveFields::ForCommand(command, true, placement_handles);
+		idx_t handle = GetReclaimUnitHandle(fields);
+
+		for (idx_t lba = command.start_lba; lba < command.start_lba + fields.GetLBACount(); lba++) {
+			if (free_units.size() <= RESERVED_UNITS) {
+				CollectGarbage();
+			}
+			Program(lba, handle, false);
+			host_lbas_written++;
+			handles[handle].host_bytes_written += lba_size;
+			if (host_lbas_written % reclaim_unit_lbas == 0) {
+				history.push_back(FdpSimulatorSample {host_lbas_written * lba_size, media_lbas_written * lba_size});
+			}
+		}
+	}
+	return nr_lbas;
+}
+
+idx_t FdpSimulatorDevice::GetReclaimUnitHandle(const NvmeDirectiveFields &fields) {
+	if (fields.GetDirectiveType() != DATA_PLACEMENT_MODE) {
+		return 0;
+	}
+	for (idx_t handle = 0; handle < placement_handles.size(); handle++) {
+		if (placement_handles[handle] == fields.GetPlacementHandle()) {
+			return handle;
+		}
+	}
+	throw InvalidInputException("Write with unknown placement handle %d", fields.GetPlacementHandle());
+}
+
+bool FdpSimulatorDevice::Deallocate(const DeviceLBARange *ranges, idx_t count) {
+	lock_guard<mutex> guard(lock);
+	for (idx_t i = 0; i < count; i++) {
+		for (idx_t lba = ranges[i].start_lba; lba < ranges[i].start_lba + ranges[i].nr_lbas; lba++) {
+			Invalidate(lba);
+			logical_to_physical[lba] = UNMAPPED;
+		}
+	}
+	return FakeDevice::Deallocate(ranges, count);
+}
+
+void FdpSimulatorDevice::Program(idx_t lba, idx_t handle, bool relocation) {
+	optional_idx &open = relocation ? handles[handle].gc_unit : handles[handle].host_unit;
+	if (!open.IsValid() || units[open.GetIndex()].write_pointer == reclaim_unit_lbas) {
+		if (open.IsValid()) {
+			units[open.GetIndex()].state = ReclaimUnitState::FULL;
+		}
+		open = OpenReclaimUnit(handle);
+	}
+
+	ReclaimUnit &unit = units[open.GetIndex()];
+	idx_t physical = open.GetIndex() * reclaim_unit_lbas + unit.write_pointer++;
+	Invalidate(lba);
+	logical_to_physical[lba] = static_cast<uint32_t>(physical);
+	physical_to_logical[physical] = static_cast<uint32_t>(lba);
+	unit.valid++;
+	media_lbas_written++;
+}
+
+void FdpSimulatorDevice::Invalidate(idx_t lba) {
+	uint32_t physical = logical_to_physical[lba];
+	if (physical == UNMAPPED) {
+		return;
+	}
+	physical_to_logical[physical] = UNMAPPED;
+	units[physical / reclaim_unit_lbas].valid--;
+}
+
+idx_t FdpSimulatorDevice::OpenReclaimUnit(idx_t handle) {
+	if (free_units.empty()) {
+		throw IOException("FdpSimulatorDevice: no free reclaim unit left");
+	}
+	idx_t index = free_units.back();
+	free_units.pop_back();
+
+	ReclaimUnit &unit = units[index];
+	unit.state = ReclaimUnitState::OPEN;
+	unit.handle = handle;
+	unit.valid = 0;
+	unit.write_pointer = 0;
+	return index;
+}
+
+void FdpSimulatorDevice::CollectGarbage() {
+	// Relocating a victim may fill the open garbage collection unit without freeing a unit in net, hence give up once
+	// every unit could have been collected
+	for (idx_t attempt = 0; free_units.size() <= RESERVED_UNITS; attempt++) {
+		optional_idx victim;
+		for (idx_t i = 0; i < units.size(); i++) {
+			if (units[i].state == ReclaimUnitState::FULL &&
+			    (!victim.IsValid() || units[i].valid < units[victim.GetIndex()].valid)) {
+				victim = i;
+			}
+		}
+		if (!victim.IsValid() || units[victim.GetIndex()].valid == reclaim_unit_lbas || attempt == units.size()) {
+			throw IOException("FdpSimulatorDevice: garbage collection found no reclaimable space");
+		}
+
+		ReclaimUnit &unit = units[victim.GetIndex()];
+		idx_t first = victim.GetIndex() * reclaim_unit_lbas;
+		for (idx_t physical = first; physical < first + reclaim_unit_lbas; physical++) {
+			if (physical_to_logical[physical] != UNMAPPED) {
+				Program(physical_to_logical[physical], unit.handle, true);
+			}
+		}
+		D_ASSERT(unit.valid == 0);
+
+		unit.state = ReclaimUnitState::FREE;
+		unit.write_pointer = 0;
+		free_units.push_back(victim.GetIndex());
+		units_erased++;
+	}
+}
+
+bool FdpSimulatorDevice::GetFDPStatistics(DeviceFDPStatistics &statistics) {
+	if (!fdp) {
+		return false;
+	}
+
+	lock_guard<mutex> guard(lock);
+	statistics.host_bytes_written = host_lbas_written * lba_size;
+	statistics.media_bytes_written = media_lbas_written * lba_size;
+	statistics.media_bytes_erased = units_erased * reclaim_unit_lbas * lba_size;
+	statistics.placement_handles.clear();
+	for (idx_t i = 0; i < handles.size(); i++) {
+		const ReclaimUnitHandle &handle = handles[i];
+		idx_t written = handle.host_unit.IsValid() ? units[handle.host_unit.GetIndex()].write_pointer : 0;
+		statistics.placement_handles.push_back(DevicePlacementStatistics {
+		    i, i, i, handle.host_bytes_written, (reclaim_unit_lbas - written) * lba_size, written * lba_size});
+	}
+	return true;
+}
+
+uint8_t FdpSimulatorDevice::GetPlacementIdentifier(const string &path, idx_t generation) {
+	return placement_policy ? placement_policy->GetFilePlacementIdentifier(path, generation) : 0;
+}
+
+uint8_t FdpSimulatorDevice::GetHotPlacementIdentifier(const string &path) {
+	return placement_policy ? placement_policy->GetHotFilePlacementIdentifier(path) : 0;
+}
+
+double FdpSimulatorDevice::GetWriteAmplification() {
+	lock_guard<mutex> guard(lock);
+	if (host_lbas_written == 0) {
+		return 0;
+	}
+	return static_cast<double>(media_lbas_written) / static_cast<double>(host_lbas_written);
+}
+
+vector<FdpSimulatorSample> FdpSimulatorDevice::GetHistory() {
+	lock_guard<mutex> guard(lock);
+	return history;
+}
+
+} // namespace duckdb
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "fake_device.hpp"
+#include "nvme_device.hpp"
+#include "placement_policy.hpp"
+
+#include <mutex>
+
+namespace duckdb {
+
+/// @brief Write and erase counters of the simulator after a number of host bytes
+struct FdpSimulatorSample {
+	idx_t host_bytes_written;
+	idx_t media_bytes_written;
+};
+
+/// @brief A FakeDevice that models the flash translation layer of an FDP drive, such that the write amplification of
+/// placement policies can be compared without FDP hardware.
+///
+/// The media consists of reclaim units, which are erased as a whole, and holds over_provisioning more LBAs than the
+/// namespace exposes. Every reclaim unit handle has a reclaim unit that host writes are appended to and one that
+/// garbage collection relocates to, such that data of different handles never shares a reclaim unit. Writes select a
+/// handle through the directive fields of the command, which are encoded by NvmeDirectiveFields::ForCommand exactly as
+/// NvmeDevice submits them, including the split of commands that exceed NVME_MAX_COMMAND_LBAS. Placement identifier i
+/// maps to placement handle i of reclaim unit handle i. Without FDP, or for writes without the data placement
+/// directive, all data goes to handle 0. When fewer than two reclaim units are free, the full reclaim unit with the
+/// fewest valid LBAs is collected (greedy).
+class FdpSimulatorDevice : public FakeDevice {
+public:
+	/// @brief Creates a simulator
+	/// @param lba_count The number of LBAs of the namespace
+	/// @param reclaim_unit_lbas The number of LBAs per reclaim unit
+	/// @param nr_handles The number of reclaim unit handles
+	/// @param fdp Whether FDP is enabled. Otherwise, every write goes to handle 0 and placement identifiers are 0
+	/// @param over_provisioning Spare media capacity, as a fraction of lba_count
+	FdpSimulatorDevice(idx_t lba_count, idx_t reclaim_unit_lbas, idx_t nr_handles, bool fdp = true,
+	                   double over_provisioning = 0.1, idx_t lba_size = DEFAULT_BLOCK_SIZE);
+
+	/// @brief Writes the data and programs the LBAs through the handle selected by the NvmeCmdContext
+	idx_t Write(void *buffer, const CmdContext &context) override;
+
+	/// @brief Deallocates the ranges, which invalidates their LBAs on the media
+	bool Deallocate(const DeviceLBARange *ranges, idx_t count) override;
+
+	/// @brief Reports the lifetime counters since creation and the usage of every handle
+	bool GetFDPStatistics(DeviceFDPStatistics &statistics) override;
+
+	/// @brief Maps files to handles with a default PlacementPolicy, like NvmeDevice
+	uint8_t GetPlacementIdentifier(const string &path, idx_t generation) override;
+	uint8_t GetHotPlacementIdentifier(const string &path) override;
+
+	/// @brief The media bytes written per host byte written so far
+	double GetWriteAmplification();
+
+	/// @brief The counters after every reclaim unit worth of host writes
+	vector<FdpSimulatorSample> GetHistory();
+
+	string GetName() const override {
+		return "FdpSimulatorDevice";
+	}
+
+private:
+	enum class ReclaimUnitState : uint8_t { FREE, OPEN, FULL };
+
+	struct ReclaimUnit {
+		ReclaimUnitState state = ReclaimUnitState::FREE;
+		idx_t handle = 0;
+		idx_t valid = 0;
+		idx_t write_pointer = 0;
+	};
+
+	struct ReclaimUnitHandle {
+		optional_idx host_unit;
+		optional_idx gc_unit;
+		idx_t host_bytes_written = 0;
+	};
+
+	/// @brief The reclaim unit handle that a command with the given directive fields writes to
+	idx_t GetReclaimUnitHandle(const NvmeDirectiveFields &fields);
+	/// @brief Appends an LBA to the host or garbage collection reclaim unit of a handle, invalidating its old location
+	void Program(idx_t lba, idx_t handle, bool relocation);
+	void Invalidate(idx_t lba);
+	idx_t OpenReclaimUnit(idx_t handle);
+	/// @brief Collects reclaim units until more than the reserve is free
+	void CollectGarbage();
+
+private:
+	static constexpr uint32_t UNMAPPED = UINT32_MAX;
+	//! Number of free reclaim units that garbage collection keeps, such that relocation always has a destination
+	static constexpr idx_t RESERVED_UNITS = 2;
+
+	mutex lock;
+	const idx_t lba_size;
+	const idx_t reclaim_unit_lbas;
+	const bool fdp;
+	unique_ptr<PlacementPolicy> placement_policy;
+	//! The placement handle of every placement identifier, empty without FDP
+	vector<uint16_t> placement_handles;
+	//! Physical location of every LBA, and the LBA stored at every physical location
+	vector<uint32_t> logical_to_physical;
+	vector<uint32_t> physical_to_logical;
+	vector<ReclaimUnit> units;
+	vector<idx_t> free_units;
+	vector<ReclaimUnitHandle> handles;
+	idx_t host_lbas_written;
+	idx_t media_lbas_written;
+	idx_t units_erased;
+	vector<FdpSimulatorSample> history;
+};
+
+} // namespace duckdb
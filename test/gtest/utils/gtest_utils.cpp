@@ -1,5 +1,8 @@
 #include "gtest_utils.hpp"
 
+#include <dirent.h>
+#include <unistd.h>
+
 namespace duckdb {
 	namespace gtestutils {
 		static bool DeallocDevice() {
@@ -11,5 +14,31 @@ namespace duckdb {
 			}
 			return true;
 		}
+
+		TemporaryDirectory::TemporaryDirectory() {
+			char pattern[] = "/tmp/nvmefs_gtest_XXXXXX";
+			if (!mkdtemp(pattern)) {
+				throw IOException("Unable to create a temporary directory: %s", strerror(errno));
+			}
+			path = pattern;
+		}
+
+		TemporaryDirectory::~TemporaryDirectory() {
+			DIR *dir = opendir(path.c_str());
+			if (dir) {
+				while (dirent *entry = readdir(dir)) {
+					string name = entry->d_name;
+					if (name != "." && name != "..") {
+						unlink(GetPath(name).c_str());
+					}
+				}
+				closedir(dir);
+			}
+			rmdir(path.c_str());
+		}
+
+		string TemporaryDirectory::GetPath(const string &name) const {
+			return path + "/" + name;
+		}
 	}
 }
@@ -6,6 +6,19 @@ namespace duckdb {
 namespace gtestutils {
 static bool DeallocDevice();
 
+/// @brief A unique directory for the files of a test, which is removed with its files when it goes out of scope
+class TemporaryDirectory {
+public:
+	TemporaryDirectory();
+	~TemporaryDirectory();
+
+	/// @brief The path of a file in the directory
+	string GetPath(const string &name) const;
+
+private:
+	string path;
+};
+
 static const struct NvmeConfig TEST_CONFIG {
     .device_path = "/dev/ng1n1",
     .plhdls = 8,